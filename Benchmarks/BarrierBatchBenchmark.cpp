@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+#include "BarrierBatcher.h"
+#include "NullDevice.h"
+
+#include <vector>
+
+// A frame's barriers, shaped like the renderer's compute passes: 16 passes each uploading to 4 buffers,
+// then reading them in a dispatch, one read as a UAV straight away, and everything returned to common
+// at the end of the frame. Unbatched issues barriers one call each as they come, as FilteredCommandList
+// used to; Batched goes through a BarrierBatcher flushed before each command, as it does now. The null
+// command list costs nothing, so timings are the batcher's overhead (per barrier requested), while the
+// counters show what reaches the driver per frame.
+
+namespace
+{
+  const uint32_t c_numPasses = 16;
+  const uint32_t c_buffersPerPass = 4;
+  const uint32_t c_numResources = c_numPasses * c_buffersPerPass;
+
+  // Only ever compared, values as D3D12_RESOURCE_STATES:
+  const uint32_t c_stateCommon = 0;
+  const uint32_t c_stateUnorderedAccess = 0x8;
+  const uint32_t c_stateShaderResource = 0x40 | 0x80;
+  const uint32_t c_stateCopyDest = 0x400;
+
+  class FrameRecorder
+  {
+  public:
+    FrameRecorder()
+      : m_resources(c_numResources)
+      , m_states(c_numResources, c_stateCommon)
+      , m_numRequested(0)
+    {
+    }
+
+    // transition(resource, before, after) and command() are called as the frame is recorded:
+    template<typename TransitionFunc, typename CommandFunc>
+    void Record(TransitionFunc&& transition, CommandFunc&& command)
+    {
+      auto setState = [&](uint32_t index, uint32_t state) {
+        if (m_states[index] != state)
+        {
+          transition(m_resources.Get(index), m_states[index], state);
+          m_states[index] = state;
+          ++m_numRequested;
+        }
+      };
+
+      for (uint32_t pass = 0; pass < c_numPasses; ++pass)
+      {
+        const uint32_t first = pass * c_buffersPerPass;
+        for (uint32_t i = first; i < first + c_buffersPerPass; ++i)
+          setState(i, c_stateCopyDest);
+        command();
+
+        for (uint32_t i = first; i < first + c_buffersPerPass; ++i)
+          setState(i, c_stateShaderResource);
+        setState(first, c_stateUnorderedAccess);
+        command();
+      }
+
+      for (uint32_t i = 0; i < c_numResources; ++i)
+        setState(i, c_stateCommon);
+      command();
+    }
+
+    uint64_t NumRequested() const { return m_numRequested; }
+
+  private:
+    NullResources m_resources;
+    std::vector<uint32_t> m_states;
+    uint64_t m_numRequested;
+  };
+
+  void SetCounters(BenchmarkContext& context, const NullCommandList& commandList)
+  {
+    context.SetCounter("barrier calls/frame", static_cast<double>(commandList.numBarrierCalls) / context.Iterations());
+    context.SetCounter("barriers/frame", static_cast<double>(commandList.numBarriers) / context.Iterations());
+  }
+}
+
+DX12_BENCHMARK(BarrierBatch_Frame_Unbatched)
+{
+  FrameRecorder recorder;
+  NullCommandList commandList = {};
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    recorder.Record([&](const void* resource, uint32_t before, uint32_t after) {
+      BatchedBarrier barrier = {};
+      barrier.resource = resource;
+      barrier.stateBefore = before;
+      barrier.stateAfter = after;
+      commandList.ResourceBarrier(1, &barrier);
+      DoNotOptimise(barrier);
+      }, []() {});
+  }
+  context.StopTimer();
+
+  context.SetItemsPerIteration(recorder.NumRequested() / context.Iterations());
+  SetCounters(context, commandList);
+}
+
+DX12_BENCHMARK(BarrierBatch_Frame_Batched)
+{
+  FrameRecorder recorder;
+  BarrierBatcher batcher;
+  NullCommandList commandList = {};
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    recorder.Record([&](const void* resource, uint32_t before, uint32_t after) {
+      batcher.Transition(resource, 0, before, after);
+      }, [&]() {
+      batcher.Flush([&](const BatchedBarrier* barriers, uint32_t numBarriers) {
+        commandList.ResourceBarrier(numBarriers, barriers);
+        DoNotOptimise(barriers[0]);
+        });
+      });
+  }
+  context.StopTimer();
+
+  context.SetItemsPerIteration(recorder.NumRequested() / context.Iterations());
+  SetCounters(context, commandList);
+}
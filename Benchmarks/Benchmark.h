@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// A result reported alongside the timing, e.g. something measured in simulated rather than real time:
+struct BenchmarkCounter
+{
+	const char*	name;
+	double			value;
+};
+
+// Minimal microbenchmark harness. Benchmarks are declared with DX12_BENCHMARK and receive a context
+// holding the number of iterations to run, which the runner calibrates so each measurement lasts long
+// enough to be stable. Setup can be excluded from timing with StartTimer()/StopTimer().
+class BenchmarkContext
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit BenchmarkContext(uint64_t iterations)
+		: m_iterations(iterations)
+		, m_itemsPerIteration(1)
+		, m_isTiming(false)
+		, m_elapsed(0)
+	{
+	}
+
+	uint64_t Iterations() const { return m_iterations; }
+
+	// For benchmarks that process many items per iteration (e.g. culling N objects), so results are
+	// reported per item rather than per iteration:
+	void SetItemsPerIteration(uint64_t items) { m_itemsPerIteration = items; }
+	uint64_t ItemsPerIteration() const { return m_itemsPerIteration; }
+
+	void StartTimer()
+	{
+		m_isTiming = true;
+		m_start = Clock::now();
+	}
+
+	void StopTimer()
+	{
+		if (m_isTiming)
+			m_elapsed += Clock::now() - m_start;
+		m_isTiming = false;
+	}
+
+	bool HasTimed() const { return m_elapsed.count() > 0 || m_isTiming; }
+	Clock::duration Elapsed() const { return m_elapsed; }
+
+	// Printed after the timing, from the last run:
+	void SetCounter(const char* name, double value) { m_counters.push_back(BenchmarkCounter{ name, value }); }
+	const std::vector<BenchmarkCounter>& Counters() const { return m_counters; }
+
+private:
+	uint64_t											m_iterations;
+	uint64_t											m_itemsPerIteration;
+	bool													m_isTiming;
+	Clock::time_point							m_start;
+	Clock::duration								m_elapsed;
+	std::vector<BenchmarkCounter>	m_counters;
+};
+
+using BenchmarkFunc = void(*)(BenchmarkContext&);
+
+struct BenchmarkInfo
+{
+	const char*		name;
+	BenchmarkFunc	func;
+};
+
+std::vector<BenchmarkInfo>& GetRegisteredBenchmarks();
+
+struct BenchmarkRegistration
+{
+	BenchmarkRegistration(const char* name, BenchmarkFunc func)
+	{
+		GetRegisteredBenchmarks().push_back(BenchmarkInfo{ name, func });
+	}
+};
+
+#define DX12_BENCHMARK(name) \
+	static void name(BenchmarkContext& context); \
+	static BenchmarkRegistration s_##name##Registration(#name, &name); \
+	static void name(BenchmarkContext& context)
+
+// Stops the compiler from optimising away a value that's otherwise unused:
+template<typename T>
+inline void DoNotOptimise(const T& value)
+{
+#if defined(_MSC_VER)
+	static volatile char sink;
+	sink = *reinterpret_cast<const volatile char*>(&value);
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
@@ -0,0 +1,136 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+std::vector<BenchmarkInfo>& GetRegisteredBenchmarks()
+{
+  static std::vector<BenchmarkInfo> benchmarks;
+  return benchmarks;
+}
+
+namespace
+{
+  const double c_minMeasurementSecs = 0.05;  // Iterations are doubled until one run takes at least this long.
+  const int c_numRepetitions = 5;            // The median of this many runs is reported.
+
+  struct BenchmarkResult
+  {
+    const char* name;
+    uint64_t iterations;
+    double nsPerItem;                        // Median of the repetitions...
+    double minNsPerItem;                     // ...and their spread.
+    double maxNsPerItem;
+    std::vector<BenchmarkCounter> counters;
+  };
+
+  double RunOnce(const BenchmarkInfo& benchmark, uint64_t iterations, uint64_t& itemsPerIteration,
+    std::vector<BenchmarkCounter>& counters)
+  {
+    BenchmarkContext context(iterations);
+    auto t0 = BenchmarkContext::Clock::now();
+    benchmark.func(context);
+    auto t1 = BenchmarkContext::Clock::now();
+
+    itemsPerIteration = context.ItemsPerIteration();
+    counters = context.Counters();
+
+    // Benchmarks that never start the timer are timed as a whole:
+    auto elapsed = context.HasTimed() ? context.Elapsed() : t1 - t0;
+    return std::chrono::duration<double>(elapsed).count();
+  }
+
+  // Names are C identifiers, and are kept stable so results can be compared across commits by name:
+  bool SaveJson(const std::string& path, const std::vector<BenchmarkResult>& results)
+  {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+      return false;
+
+    char text[256];
+    file << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+      const BenchmarkResult& result = results[i];
+      std::snprintf(text, sizeof(text), "    { \"name\": \"%s\", \"iterations\": %llu, \"nsPerItem\": %.4f, "
+        "\"minNsPerItem\": %.4f, \"maxNsPerItem\": %.4f, \"counters\": {", result.name,
+        static_cast<unsigned long long>(result.iterations), result.nsPerItem, result.minNsPerItem, result.maxNsPerItem);
+      file << text;
+
+      for (size_t j = 0; j < result.counters.size(); ++j)
+      {
+        std::snprintf(text, sizeof(text), "%s \"%s\": %.6g", j == 0 ? "" : ",", result.counters[j].name,
+          result.counters[j].value);
+        file << text;
+      }
+      file << (result.counters.empty() ? "} }" : " } }") << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+  }
+}
+
+// Usage: Dx12Benchmarks [filter] [--json <path>], only benchmarks whose name contains filter are run.
+// With --json, results are also written to path.
+int main(int argc, char** argv)
+{
+  const char* filter = "";
+  const char* jsonPath = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      jsonPath = argv[++i];
+    else
+      filter = argv[i];
+  }
+
+  std::vector<BenchmarkInfo> benchmarks = GetRegisteredBenchmarks();
+  std::sort(benchmarks.begin(), benchmarks.end(), [](const BenchmarkInfo& a, const BenchmarkInfo& b) {
+    return std::strcmp(a.name, b.name) < 0;
+    });
+
+  std::printf("%-48s %14s %14s %16s\n", "Benchmark", "Iterations", "ns/item", "items/s");
+
+  std::vector<BenchmarkResult> results;
+
+  for (const BenchmarkInfo& benchmark : benchmarks)
+  {
+    if (!std::strstr(benchmark.name, filter))
+      continue;
+
+    // Calibrate iteration count:
+    uint64_t iterations = 1;
+    uint64_t itemsPerIteration = 1;
+    std::vector<BenchmarkCounter> counters;
+    while (RunOnce(benchmark, iterations, itemsPerIteration, counters) < c_minMeasurementSecs && iterations < (1ull << 40))
+      iterations *= 2;
+
+    double secs[c_numRepetitions];
+    for (int i = 0; i < c_numRepetitions; ++i)
+      secs[i] = RunOnce(benchmark, iterations, itemsPerIteration, counters);
+
+    std::sort(secs, secs + c_numRepetitions);
+    const double medianSecs = secs[c_numRepetitions / 2];
+    const double items = static_cast<double>(iterations) * itemsPerIteration;
+
+    std::printf("%-48s %14llu %14.3f %16.0f", benchmark.name, static_cast<unsigned long long>(iterations),
+      medianSecs * 1e9 / items, items / medianSecs);
+    for (const BenchmarkCounter& counter : counters)
+      std::printf("  %s=%.3g", counter.name, counter.value);
+    std::printf("\n");
+
+    results.push_back(BenchmarkResult{ benchmark.name, iterations, medianSecs * 1e9 / items, secs[0] * 1e9 / items,
+      secs[c_numRepetitions - 1] * 1e9 / items, counters });
+  }
+
+  if (jsonPath && !SaveJson(jsonPath, results))
+  {
+    std::fprintf(stderr, "Failed to write %s\n", jsonPath);
+    return 1;
+  }
+
+  return 0;
+}
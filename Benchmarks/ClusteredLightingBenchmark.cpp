@@ -0,0 +1,104 @@
+#include "Benchmark.h"
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Assigns 4096 point lights to a 16x9x24 cluster grid with each path, results are per light. Lights are
+// scattered through the view frustum at a mix of sizes, so most clusters end up with a few dozen lights.
+
+namespace
+{
+  const uint32_t c_numLights = 4096;
+  const uint32_t c_maxLightIndices = 1024 * 1024;
+
+  const LightClusterGrid& GetGrid()
+  {
+    static LightClusterGrid s_grid;
+    if (s_grid.NumClusters() == 0)
+    {
+      // 1 radian vertical field of view at 16:9, like the frustum culling benchmark:
+      LightClusterGridDesc desc;
+      desc.tanHalfFovY = std::tan(0.5f);
+      desc.tanHalfFovX = desc.tanHalfFovY * 16.0f / 9.0f;
+      desc.nearZ = 0.1f;
+      desc.farZ = 1000.0f;
+      s_grid.Build(desc);
+    }
+    return s_grid;
+  }
+
+  const std::vector<ClusterLight>& GetLights()
+  {
+    static std::vector<ClusterLight> s_lights;
+    if (s_lights.empty())
+    {
+      const LightClusterGridDesc& desc = GetGrid().GetDesc();
+      std::mt19937 random(1234);
+      std::uniform_real_distribution<float> ndc(-1.0f, 1.0f);
+      std::uniform_real_distribution<float> depth(1.0f, 300.0f);
+      std::uniform_real_distribution<float> radius(1.0f, 15.0f);
+
+      s_lights.resize(c_numLights);
+      for (ClusterLight& light : s_lights)
+      {
+        light.position[2] = depth(random);
+        light.position[0] = ndc(random) * light.position[2] * desc.tanHalfFovX;
+        light.position[1] = ndc(random) * light.position[2] * desc.tanHalfFovY;
+        light.radius = radius(random);
+      }
+    }
+    return s_lights;
+  }
+
+  void RunClustering(BenchmarkContext& context, CullingPath path)
+  {
+    const std::vector<ClusterLight>& lights = GetLights();
+    LightClusterBuilder builder(c_maxLightIndices);
+
+    context.SetItemsPerIteration(c_numLights);
+
+    context.StartTimer();
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+      builder.Build(GetGrid(), lights.data(), c_numLights, path);
+    context.StopTimer();
+
+    DoNotOptimise(builder.GetStats().numLightIndices);
+  }
+}
+
+DX12_BENCHMARK(ClusteredLights_4K_Scalar)
+{
+  RunClustering(context, CullingPath::Scalar);
+}
+
+DX12_BENCHMARK(ClusteredLights_4K_SSE)
+{
+  RunClustering(context, CullingPath::SSE);
+}
+
+DX12_BENCHMARK(ClusteredLights_4K_AVX2)
+{
+  if (GetBestCullingPath() != CullingPath::AVX2)
+    return;
+
+  RunClustering(context, CullingPath::AVX2);
+}
+
+DX12_BENCHMARK(ClusteredLights_4K_ParallelBest)
+{
+  static JobSystem s_jobSystem;
+  const std::vector<ClusterLight>& lights = GetLights();
+  LightClusterBuilder builder(c_maxLightIndices);
+
+  context.SetItemsPerIteration(c_numLights);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    builder.BuildParallel(s_jobSystem, GetGrid(), lights.data(), c_numLights, GetBestCullingPath());
+  context.StopTimer();
+
+  DoNotOptimise(builder.GetStats().numLightIndices);
+}
@@ -0,0 +1,41 @@
+#include "Benchmark.h"
+#include "FencedPool.h"
+#include "NullDevice.h"
+
+// Recycling command allocators as CommandQueue does, through a FencedPool, against a null GPU running 3
+// frames behind with 8 command lists recorded per frame, results are per command list. Allocators are
+// only created until there are enough to cover the frames in flight, after which every one is reused.
+
+namespace
+{
+  const uint32_t c_numFramesInFlight = 3;
+  const uint32_t c_commandListsPerFrame = 8;
+}
+
+DX12_BENCHMARK(CommandAllocator_Recycle)
+{
+  FencedPool<NullCommandAllocator> pool;
+  NullFence fence(c_numFramesInFlight);
+  uint32_t numCreated = 0;
+  context.SetItemsPerIteration(c_commandListsPerFrame);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    NullCommandAllocator allocators[c_commandListsPerFrame];
+    for (NullCommandAllocator& allocator : allocators)
+    {
+      if (pool.TryAcquire(fence.GetCompletedValue(), allocator))
+        allocator.Reset();
+      else
+        allocator = NullCommandAllocator{ numCreated++, 0 };
+    }
+
+    const uint64_t fenceValue = fence.Signal();
+    for (const NullCommandAllocator& allocator : allocators)
+      pool.Release(allocator, fenceValue);
+  }
+  context.StopTimer();
+
+  context.SetCounter("allocators created", numCreated);
+}
@@ -0,0 +1,69 @@
+#include "Benchmark.h"
+#include "DescriptorAllocator.h"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+// Descriptor churn in a 64K descriptor heap that's already fragmented: three quarters full of ranges of
+// 1-8 descriptors with every other one freed, then each iteration allocates a range of 1-16 descriptors
+// and frees a random live one, results are per allocate/free pair. Sizes and victims are drawn up front
+// from a fixed seed, so every run sees the same sequence.
+
+namespace
+{
+  const uint32_t c_numDescriptors = 64 * 1024;
+  const uint32_t c_sequenceLength = 4096;
+
+  using LiveRange = std::pair<uint32_t, uint32_t>;
+}
+
+DX12_BENCHMARK(DescriptorAllocator_AllocateFree)
+{
+  std::mt19937 random(11);
+  DescriptorAllocator allocator(c_numDescriptors);
+  std::vector<LiveRange> live;
+
+  std::uniform_int_distribution<uint32_t> initialCount(1, 8);
+  while (allocator.NumFree() > c_numDescriptors / 4)
+  {
+    const uint32_t count = initialCount(random);
+    live.emplace_back(allocator.Allocate(count), count);
+  }
+  for (size_t i = 0; i < live.size(); i += 2)
+    allocator.Free(live[i].first, live[i].second);
+  for (size_t i = 0; i < live.size() / 2; ++i)
+    live[i] = live[i * 2 + 1];
+  live.resize(live.size() / 2);
+
+  std::uniform_int_distribution<uint32_t> count(1, 16);
+  std::uniform_int_distribution<size_t> victim(0, live.size() - 1);
+  std::vector<uint32_t> counts(c_sequenceLength);
+  std::vector<size_t> victims(c_sequenceLength);
+  for (uint32_t i = 0; i < c_sequenceLength; ++i)
+  {
+    counts[i] = count(random);
+    victims[i] = victim(random);
+  }
+
+  uint64_t numFailed = 0;
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    const uint32_t step = static_cast<uint32_t>(i % c_sequenceLength);
+    const uint32_t index = allocator.Allocate(counts[step]);
+    if (index == DescriptorAllocator::c_invalidIndex)
+    {
+      ++numFailed;
+      continue;
+    }
+
+    LiveRange& freed = live[victims[step]];
+    allocator.Free(freed.first, freed.second);
+    freed = LiveRange(index, counts[step]);
+  }
+  context.StopTimer();
+
+  context.SetCounter("free ranges", allocator.NumFreeRanges());
+  context.SetCounter("failed allocations", static_cast<double>(numFailed));
+}
@@ -0,0 +1,119 @@
+#include "Benchmark.h"
+#include "DrawPacket.h"
+#include "JobSystem.h"
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Sorting a frame's draw keys (with the draw index carried along) with std::sort against the radix
+// sort, serial and across the job system. Keys mimic a real frame: mostly opaque draws spread over a few
+// hundred PSOs and a few thousand materials, plus some transparent ones. Results are per draw.
+
+namespace
+{
+  struct KeyIndex
+  {
+    uint64_t  key;
+    uint32_t  index;
+  };
+
+  std::vector<uint64_t> MakeDrawKeys(uint32_t count)
+  {
+    std::mt19937 random(99);
+    std::uniform_int_distribution<uint32_t> pipeline(0, 255);
+    std::uniform_int_distribution<uint32_t> material(0, 4095);
+    std::uniform_real_distribution<float> depth(0.1f, 1000.0f);
+    std::uniform_int_distribution<uint32_t> layer(0, 99);
+
+    std::vector<uint64_t> keys(count);
+    for (uint64_t& key : keys)
+    {
+      const uint32_t roll = layer(random);
+      const DrawLayer drawLayer = (roll < 80) ? DrawLayer_Opaque : (roll < 95) ? DrawLayer_AlphaTested : DrawLayer_Transparent;
+      key = DrawSortKey::Make(drawLayer, pipeline(random), material(random),
+        DrawSortKey::QuantiseDepth(depth(random), 0.1f, 1000.0f));
+    }
+    return keys;
+  }
+
+  void RunStdSort(BenchmarkContext& context, uint32_t count)
+  {
+    const std::vector<uint64_t> keys = MakeDrawKeys(count);
+    std::vector<KeyIndex> entries(count);
+
+    context.SetItemsPerIteration(count);
+
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+    {
+      for (uint32_t j = 0; j < count; ++j)
+        entries[j] = KeyIndex{ keys[j], j };
+
+      context.StartTimer();
+      std::sort(entries.begin(), entries.end(), [](const KeyIndex& a, const KeyIndex& b) { return a.key < b.key; });
+      context.StopTimer();
+    }
+
+    DoNotOptimise(entries.front().index);
+  }
+
+  void RunRadixSort(BenchmarkContext& context, uint32_t count, JobSystem* jobSystem)
+  {
+    const std::vector<uint64_t> keys = MakeDrawKeys(count);
+    std::vector<uint64_t> sortedKeys(count);
+    std::vector<uint32_t> indices(count);
+    RadixSortScratch scratch;
+
+    context.SetItemsPerIteration(count);
+
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+    {
+      sortedKeys = keys;
+      for (uint32_t j = 0; j < count; ++j)
+        indices[j] = j;
+
+      context.StartTimer();
+      RadixSort(sortedKeys.data(), indices.data(), count, scratch, jobSystem);
+      context.StopTimer();
+    }
+
+    DoNotOptimise(indices.front());
+  }
+
+  JobSystem& GetJobSystem()
+  {
+    static JobSystem s_jobSystem;
+    return s_jobSystem;
+  }
+}
+
+DX12_BENCHMARK(DrawSort_100K_StdSort)
+{
+  RunStdSort(context, 100 * 1000);
+}
+
+DX12_BENCHMARK(DrawSort_100K_Radix)
+{
+  RunRadixSort(context, 100 * 1000, nullptr);
+}
+
+DX12_BENCHMARK(DrawSort_100K_RadixParallel)
+{
+  RunRadixSort(context, 100 * 1000, &GetJobSystem());
+}
+
+DX12_BENCHMARK(DrawSort_1M_StdSort)
+{
+  RunStdSort(context, 1000 * 1000);
+}
+
+DX12_BENCHMARK(DrawSort_1M_Radix)
+{
+  RunRadixSort(context, 1000 * 1000, nullptr);
+}
+
+DX12_BENCHMARK(DrawSort_1M_RadixParallel)
+{
+  RunRadixSort(context, 1000 * 1000, &GetJobSystem());
+}
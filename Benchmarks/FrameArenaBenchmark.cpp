@@ -0,0 +1,138 @@
+#include "Benchmark.h"
+#include "FrameArena.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+
+// Builds the transient CPU data of a frame: 8 command lists recorded in parallel, each growing draw
+// and barrier lists one element at a time plus a debug name, then a frustum cull of 64K objects. Heap
+// runs it on the global heap, Arena out of FrameArenas cycled over 3 frames in flight, results are per
+// frame. That the arena's steady state makes no heap allocations is checked by Dx12AllocationTests, which
+// hooks operator new; replacing it here would slow down every other benchmark too.
+
+namespace
+{
+  const uint32_t c_numFramesInFlight = 3;
+  const uint32_t c_numCommandLists = 8;
+  const uint32_t c_drawsPerCommandList = 2000;
+  const uint32_t c_barriersPerCommandList = 64;
+  const uint32_t c_numObjects = 64 * 1024;
+
+  struct DrawCommand
+  {
+    uint64_t sortKey;
+    uint32_t meshId;
+    uint32_t objectIndex;
+  };
+
+  struct Barrier
+  {
+    uint32_t resourceId;
+    uint32_t before;
+    uint32_t after;
+  };
+
+  const CullingBounds& GetScene()
+  {
+    static CullingBounds s_bounds;
+    if (s_bounds.Size() == 0)
+    {
+      std::mt19937 random(1234);
+      std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+      const float extents[3] = { 1.0f, 1.0f, 1.0f };
+
+      s_bounds.Reserve(c_numObjects);
+      for (uint32_t i = 0; i < c_numObjects; ++i)
+      {
+        const float center[3] = { position(random), position(random), position(random) };
+        s_bounds.Add(center, extents);
+      }
+    }
+    return s_bounds;
+  }
+
+  // Culling against the +Z half-space, the frustum itself doesn't matter here:
+  Frustum MakeFrustum()
+  {
+    Frustum frustum = {};
+    frustum.planes[Frustum::Plane_Near][2] = 1.0f;
+    for (uint32_t plane = 0; plane < Frustum::Plane_Count; ++plane)
+    {
+      if (plane != Frustum::Plane_Near)
+        frustum.planes[plane][3] = 1000.0f;
+    }
+    return frustum;
+  }
+
+  // Each thread records into its own arena, or the heap if there are no arenas:
+  uint64_t RecordCommandList(uint32_t commandListIndex, LinearArena* arena)
+  {
+    ArenaVector<DrawCommand> draws(arena);
+    ArenaVector<Barrier> barriers(arena);
+    for (uint32_t i = 0; i < c_drawsPerCommandList; ++i)
+      draws.push_back(DrawCommand{ (static_cast<uint64_t>(i) * 2654435761u) >> 8, i % 97, i });
+    for (uint32_t i = 0; i < c_barriersPerCommandList; ++i)
+      barriers.push_back(Barrier{ i, 1, 2 });
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%u", commandListIndex);
+    ArenaString name("Command list for the opaque pass of view ", arena);
+    name += buffer;
+
+    return draws.back().sortKey + barriers.size() + name.size();
+  }
+
+  uint64_t BuildFrame(JobSystem& jobSystem, FrameArenas* frameArenas, std::vector<uint32_t>& visibleIndices)
+  {
+    std::atomic<uint64_t> checksum(0);
+    jobSystem.ParallelFor(c_numCommandLists, 1, [&](uint32_t begin, uint32_t end) {
+      LinearArena* arena = frameArenas ? &frameArenas->Get(jobSystem.CurrentThreadIndex()) : nullptr;
+      for (uint32_t i = begin; i < end; ++i)
+        checksum.fetch_add(RecordCommandList(i, arena), std::memory_order_relaxed);
+      });
+
+    LinearArena* arena = frameArenas ? &frameArenas->Get(jobSystem.CurrentThreadIndex()) : nullptr;
+    CullFrustumParallel(jobSystem, MakeFrustum(), GetScene(), visibleIndices, GetBestCullingPath(), arena);
+    return checksum.load() + visibleIndices.size();
+  }
+
+  void RunFrames(BenchmarkContext& context, bool useArenas)
+  {
+    static JobSystem s_jobSystem;
+    FrameArenas frameArenas(c_numFramesInFlight, s_jobSystem.NumThreads());
+    FrameArenas* arenas = useArenas ? &frameArenas : nullptr;
+    std::vector<uint32_t> visibleIndices;
+
+    // A couple of rounds of frames in flight, so the arenas and visibleIndices have reached their size:
+    uint32_t frameIndex = 0;
+    for (uint32_t i = 0; i < c_numFramesInFlight * 2; ++i, frameIndex = (frameIndex + 1) % c_numFramesInFlight)
+    {
+      frameArenas.BeginFrame(frameIndex);
+      DoNotOptimise(BuildFrame(s_jobSystem, arenas, visibleIndices));
+    }
+
+    context.StartTimer();
+    for (uint64_t i = 0; i < context.Iterations(); ++i, frameIndex = (frameIndex + 1) % c_numFramesInFlight)
+    {
+      frameArenas.BeginFrame(frameIndex);
+      DoNotOptimise(BuildFrame(s_jobSystem, arenas, visibleIndices));
+    }
+    context.StopTimer();
+
+    if (useArenas)
+      context.SetCounter("peak KB/frame", frameArenas.GetStats().highWaterMark / 1024.0);
+  }
+}
+
+DX12_BENCHMARK(FrameArena_TransientFrame_Heap)
+{
+  RunFrames(context, false);
+}
+
+DX12_BENCHMARK(FrameArena_TransientFrame_Arena)
+{
+  RunFrames(context, true);
+}
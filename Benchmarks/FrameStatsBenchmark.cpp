@@ -0,0 +1,75 @@
+#include "Benchmark.h"
+#include "FramePacer.h"
+#include "InputLatency.h"
+
+#include <random>
+#include <vector>
+
+// The per-frame statistics the renderer keeps: Aggregate feeds a frame's worth of events (4 inputs, frame
+// start, submit, present, GPU completion and display two frames later) through the input latency tracker
+// and frame pacer and asks for the next frame's start time, results are per frame. Percentiles is the
+// once-a-second report over a full latency history, results are per report. Times are simulated at 60Hz
+// with fixed-seed jitter.
+
+namespace
+{
+  const uint64_t c_frameTimeUs = 16667;
+  const uint32_t c_inputsPerFrame = 4;
+  const uint32_t c_historySize = 1024;
+}
+
+DX12_BENCHMARK(FrameStats_Aggregate)
+{
+  std::mt19937 random(3);
+  std::uniform_int_distribution<uint64_t> jitter(0, 2000);
+  std::vector<uint64_t> jitters(1024);
+  for (uint64_t& value : jitters)
+    value = jitter(random);
+
+  InputLatencyTracker inputLatency;
+  FramePacer framePacer;
+
+  context.StartTimer();
+  for (uint64_t frameId = 1; frameId <= context.Iterations(); ++frameId)
+  {
+    const uint64_t frameStartUs = frameId * c_frameTimeUs;
+    const uint64_t frameJitterUs = jitters[frameId % jitters.size()];
+    for (uint32_t i = 0; i < c_inputsPerFrame; ++i)
+      inputLatency.RecordInput(frameStartUs - c_frameTimeUs + (i + 1) * c_frameTimeUs / (c_inputsPerFrame + 1));
+
+    inputLatency.OnFrameStart(frameId, frameStartUs);
+    framePacer.OnFrameStart(frameId, frameStartUs);
+    framePacer.OnFrameSubmitted(frameId, frameStartUs + 4000 + frameJitterUs);
+    inputLatency.OnPresent(frameId, frameStartUs + 5000 + frameJitterUs);
+
+    if (frameId > 2)
+    {
+      const uint64_t displayedFrameId = frameId - 2;
+      const uint64_t displayedStartUs = displayedFrameId * c_frameTimeUs;
+      framePacer.OnGpuFrameCompleted(displayedFrameId, displayedStartUs + 6000, displayedStartUs + 14000);
+      inputLatency.OnDisplayed(displayedFrameId, frameStartUs);
+    }
+
+    DoNotOptimise(framePacer.GetFrameStartTime(frameStartUs + 5000));
+  }
+  context.StopTimer();
+
+  context.SetCounter("display latency p50 ms", inputLatency.GetInputToDisplay().GetPercentiles().p50);
+}
+
+DX12_BENCHMARK(FrameStats_Percentiles)
+{
+  std::mt19937 random(3);
+  std::uniform_int_distribution<uint64_t> latencyUs(10000, 60000);
+  LatencyHistory history(c_historySize);
+  for (uint32_t i = 0; i < c_historySize; ++i)
+    history.Add(latencyUs(random));
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    const LatencyPercentiles percentiles = history.GetPercentiles();
+    DoNotOptimise(percentiles.p99);
+  }
+  context.StopTimer();
+}
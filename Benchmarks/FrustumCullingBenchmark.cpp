@@ -0,0 +1,109 @@
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Frustum culls 1M boxes scattered around a camera with each path, results are per object. Roughly a
+// sixth of the boxes end up visible, so compaction is exercised as well as the plane tests.
+
+namespace
+{
+  const uint32_t c_numObjects = 1000 * 1000;
+
+  // Row-vector, left-handed projection (XMMatrixPerspectiveFovLH) looking down +Z from the origin:
+  Frustum MakeCameraFrustum()
+  {
+    const float fovY = 1.0f;
+    const float aspect = 16.0f / 9.0f;
+    const float nearZ = 0.1f;
+    const float farZ = 1000.0f;
+
+    const float yScale = 1.0f / std::tan(fovY * 0.5f);
+    const float xScale = yScale / aspect;
+    const float range = farZ / (farZ - nearZ);
+
+    const float viewProjection[16] =
+    {
+      xScale, 0.0f,   0.0f,             0.0f,
+      0.0f,   yScale, 0.0f,             0.0f,
+      0.0f,   0.0f,   range,            1.0f,
+      0.0f,   0.0f,   -range * nearZ,   0.0f,
+    };
+    return Frustum::FromViewProjection(viewProjection);
+  }
+
+  const CullingBounds& GetScene()
+  {
+    static CullingBounds s_bounds;
+    if (s_bounds.Size() == 0)
+    {
+      std::mt19937 random(1234);
+      std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+      std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+      s_bounds.Reserve(c_numObjects);
+      for (uint32_t i = 0; i < c_numObjects; ++i)
+      {
+        const float center[3] = { position(random), position(random), position(random) };
+        const float extents[3] = { size(random), size(random), size(random) };
+        s_bounds.Add(center, extents);
+      }
+    }
+    return s_bounds;
+  }
+
+  void RunCulling(BenchmarkContext& context, CullingPath path)
+  {
+    const CullingBounds& bounds = GetScene();
+    const Frustum frustum = MakeCameraFrustum();
+    std::vector<uint32_t> visibleIndices(bounds.PaddedSize());
+
+    context.SetItemsPerIteration(c_numObjects);
+
+    uint32_t numVisible = 0;
+    context.StartTimer();
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+      numVisible += CullFrustum(frustum, bounds, 0, bounds.Size(), visibleIndices.data(), path);
+    context.StopTimer();
+
+    DoNotOptimise(numVisible);
+  }
+}
+
+DX12_BENCHMARK(FrustumCulling_1M_Scalar)
+{
+  RunCulling(context, CullingPath::Scalar);
+}
+
+DX12_BENCHMARK(FrustumCulling_1M_SSE)
+{
+  RunCulling(context, CullingPath::SSE);
+}
+
+DX12_BENCHMARK(FrustumCulling_1M_AVX2)
+{
+  if (GetBestCullingPath() != CullingPath::AVX2)
+    return;
+
+  RunCulling(context, CullingPath::AVX2);
+}
+
+DX12_BENCHMARK(FrustumCulling_1M_ParallelBest)
+{
+  static JobSystem s_jobSystem;
+  const CullingBounds& bounds = GetScene();
+  const Frustum frustum = MakeCameraFrustum();
+  std::vector<uint32_t> visibleIndices;
+
+  context.SetItemsPerIteration(c_numObjects);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    CullFrustumParallel(s_jobSystem, frustum, bounds, visibleIndices, GetBestCullingPath());
+  context.StopTimer();
+
+  DoNotOptimise(visibleIndices.size());
+}
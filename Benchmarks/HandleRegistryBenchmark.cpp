@@ -0,0 +1,198 @@
+#include "Benchmark.h"
+#include "HandleRegistry.h"
+
+#include <atomic>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <wrl.h>
+#endif
+
+#if defined(_MSC_VER)
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+// Compares passing resources around as ComPtr copies (what the renderer's helpers used to do) with
+// passing 32-bit handles and resolving them through a HandleRegistry.
+
+namespace
+{
+#if defined(_WIN32)
+  // Stand-in for a D3D12 object, reference counted the same way (interlocked, through a vtable):
+  struct FakeResource : public IUnknown
+  {
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override
+    {
+      *object = nullptr;
+      return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override { return ::InterlockedIncrement(&refCount); }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+      ULONG count = ::InterlockedDecrement(&refCount);
+      if (count == 0)
+        delete this;
+      return count;
+    }
+
+    virtual ~FakeResource() = default;
+
+    volatile ULONG  refCount = 1;
+    uint64_t        payload = 0;
+  };
+
+  template<typename T>
+  using ComPtrType = Microsoft::WRL::ComPtr<T>;
+
+  ComPtrType<FakeResource> MakeFakeResource(uint64_t payload)
+  {
+    ComPtrType<FakeResource> resource;
+    resource.Attach(new FakeResource());
+    resource->payload = payload;
+    return resource;
+  }
+#else
+  // No WRL outside Windows, so mirror what a ComPtr copy costs: a virtual AddRef/Release pair, each an
+  // atomic read-modify-write of the object's reference count.
+  struct FakeResource
+  {
+    virtual unsigned long AddRef() { return refCount.fetch_add(1) + 1; }
+
+    virtual unsigned long Release()
+    {
+      unsigned long count = refCount.fetch_sub(1) - 1;
+      if (count == 0)
+        delete this;
+      return count;
+    }
+
+    virtual ~FakeResource() = default;
+
+    std::atomic<unsigned long>  refCount{ 1 };
+    uint64_t                    payload = 0;
+  };
+
+  template<typename T>
+  class ComPtrType
+  {
+  public:
+    ComPtrType() : m_ptr(nullptr) {}
+    ComPtrType(const ComPtrType& other) : m_ptr(other.m_ptr) { if (m_ptr) m_ptr->AddRef(); }
+    ComPtrType(ComPtrType&& other) : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
+    ~ComPtrType() { if (m_ptr) m_ptr->Release(); }
+
+    ComPtrType& operator=(ComPtrType other)
+    {
+      std::swap(m_ptr, other.m_ptr);
+      return *this;
+    }
+
+    void Attach(T* ptr) { m_ptr = ptr; }
+    T* Get() const { return m_ptr; }
+    T* operator->() const { return m_ptr; }
+
+  private:
+    T* m_ptr;
+  };
+
+  ComPtrType<FakeResource> MakeFakeResource(uint64_t payload)
+  {
+    ComPtrType<FakeResource> resource;
+    resource.Attach(new FakeResource());
+    resource->payload = payload;
+    return resource;
+  }
+#endif
+
+  using FakeRegistry = HandleRegistry<ComPtrType<FakeResource>, FakeResource>;
+
+  const uint32_t c_numResources = 4096;   // Small enough to stay cache resident, so only call overhead is measured.
+
+  BENCHMARK_NOINLINE uint64_t UseByValue(ComPtrType<FakeResource> resource)
+  {
+    return resource->payload;
+  }
+
+  BENCHMARK_NOINLINE uint64_t UseByRawPointer(FakeResource* resource)
+  {
+    return resource->payload;
+  }
+
+  BENCHMARK_NOINLINE uint64_t UseByHandle(FakeRegistry& registry, FakeRegistry::HandleType handle)
+  {
+    return registry.Get(handle)->Get()->payload;
+  }
+}
+
+DX12_BENCHMARK(ResourceAccess_ComPtrByValue)
+{
+  std::vector<ComPtrType<FakeResource>> resources;
+  for (uint32_t i = 0; i < c_numResources; ++i)
+    resources.push_back(MakeFakeResource(i));
+
+  uint64_t sum = 0;
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    sum += UseByValue(resources[i % c_numResources]);
+  context.StopTimer();
+
+  DoNotOptimise(sum);
+}
+
+DX12_BENCHMARK(ResourceAccess_RawPointer)
+{
+  std::vector<ComPtrType<FakeResource>> resources;
+  for (uint32_t i = 0; i < c_numResources; ++i)
+    resources.push_back(MakeFakeResource(i));
+
+  uint64_t sum = 0;
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    sum += UseByRawPointer(resources[i % c_numResources].Get());
+  context.StopTimer();
+
+  DoNotOptimise(sum);
+}
+
+DX12_BENCHMARK(ResourceAccess_HandleLookup)
+{
+  FakeRegistry registry;
+  std::vector<FakeRegistry::HandleType> handles;
+  for (uint32_t i = 0; i < c_numResources; ++i)
+    handles.push_back(registry.Add(MakeFakeResource(i)));
+
+  uint64_t sum = 0;
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    sum += UseByHandle(registry, handles[i % c_numResources]);
+  context.StopTimer();
+
+  DoNotOptimise(sum);
+}
+
+DX12_BENCHMARK(HandleRegistry_AddReleaseCollect)
+{
+  FakeRegistry registry;
+  std::vector<FakeRegistry::HandleType> handles(c_numResources);
+  for (uint32_t i = 0; i < c_numResources; ++i)
+    handles[i] = registry.Add(MakeFakeResource(i));
+
+  // Churn a slot per iteration, collecting garbage as a frame loop would:
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    const uint32_t slot = static_cast<uint32_t>(i % c_numResources);
+    registry.Release(handles[slot], i);
+    handles[slot] = registry.Add(MakeFakeResource(i));
+    registry.CollectGarbage(i);
+  }
+  context.StopTimer();
+
+  DoNotOptimise(registry.NumLive());
+}
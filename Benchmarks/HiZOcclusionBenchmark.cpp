@@ -0,0 +1,104 @@
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "HiZOcclusion.h"
+
+#include <random>
+#include <vector>
+
+// CPU HiZ occlusion culling: building the pyramid from a 1080p depth buffer (per pixel), and testing
+// boxes against it (per box). The depth buffer is a wall of occluders with gaps, boxes are scattered
+// behind and in front of it so roughly half are occluded.
+
+namespace
+{
+  const uint32_t c_width = 1920;
+  const uint32_t c_height = 1080;
+  const float c_nearZ = 0.1f;
+  const float c_farZ = 1000.0f;
+
+  void MakeViewProjection(float viewProjection[16])
+  {
+    // 90 degree perspective, camera at the origin looking down +z (row-vector, D3D depth):
+    const float q = c_farZ / (c_farZ - c_nearZ);
+    const float matrix[16] = {
+      static_cast<float>(c_height) / c_width, 0.0f, 0.0f, 0.0f,
+      0.0f, 1.0f, 0.0f, 0.0f,
+      0.0f, 0.0f, q, 1.0f,
+      0.0f, 0.0f, -q * c_nearZ, 0.0f,
+    };
+    for (int i = 0; i < 16; ++i)
+      viewProjection[i] = matrix[i];
+  }
+
+  float ToDepth(float viewZ)
+  {
+    const float q = c_farZ / (c_farZ - c_nearZ);
+    return q - q * c_nearZ / viewZ;
+  }
+
+  // Occluders 50 units away, with a regular pattern of gaps showing the far plane:
+  std::vector<float> MakeDepthBuffer()
+  {
+    std::vector<float> depth(static_cast<size_t>(c_width) * c_height);
+    for (uint32_t y = 0; y < c_height; ++y)
+    {
+      for (uint32_t x = 0; x < c_width; ++x)
+        depth[static_cast<size_t>(y) * c_width + x] = ((x / 128 + y / 128) % 3 == 0) ? 1.0f : ToDepth(50.0f);
+    }
+    return depth;
+  }
+}
+
+DX12_BENCHMARK(HiZ_BuildPyramid_1080p)
+{
+  const std::vector<float> depth = MakeDepthBuffer();
+  HiZPyramid pyramid;
+
+  context.SetItemsPerIteration(static_cast<uint64_t>(c_width) * c_height);
+  context.StartTimer();
+
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    pyramid.Build(depth.data(), c_width, c_height);
+
+  context.StopTimer();
+  DoNotOptimise(pyramid.GetLevel(pyramid.NumLevels() - 1)[0]);
+}
+
+DX12_BENCHMARK(HiZ_OcclusionTest_100K)
+{
+  const uint32_t count = 100 * 1000;
+  const std::vector<float> depth = MakeDepthBuffer();
+  HiZPyramid pyramid;
+  pyramid.Build(depth.data(), c_width, c_height);
+
+  float viewProjection[16];
+  MakeViewProjection(viewProjection);
+
+  std::mt19937 random(11);
+  std::uniform_real_distribution<float> distance(10.0f, 200.0f);
+  std::uniform_real_distribution<float> spread(-0.8f, 0.8f);
+  std::uniform_real_distribution<float> size(0.2f, 3.0f);
+
+  CullingBounds bounds;
+  std::vector<uint32_t> indices(count);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const float z = distance(random);
+    const float center[3] = { spread(random) * z * 1.7f, spread(random) * z, z };
+    const float extent = size(random);
+    const float extents[3] = { extent, extent, extent };
+    indices[i] = bounds.Add(center, extents);
+  }
+
+  std::vector<uint32_t> visible(count), occluded(count);
+  uint32_t numOccluded = 0;
+
+  context.SetItemsPerIteration(count);
+  context.StartTimer();
+
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    CullOcclusion(pyramid, viewProjection, bounds, indices.data(), count, visible.data(), occluded.data(), numOccluded);
+
+  context.StopTimer();
+  DoNotOptimise(numOccluded);
+}
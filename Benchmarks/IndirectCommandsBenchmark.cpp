@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "IndirectCommands.h"
+#include "RootSignatureLayout.h"
+
+#include <random>
+#include <vector>
+
+// CPU generation of GPU-driven draw commands (GenerateIndirectDraws(), the reference/fallback for the
+// InstanceCulling.hlsl pass): cull each instance and pack a root constant + DrawIndexed command for the
+// visible ones. Instances are scattered around a camera looking down +z, about a third end up visible.
+// Results are per instance.
+
+namespace
+{
+  RootSignatureLayout MakeDrawRootLayout()
+  {
+    RootParameterDesc objectIndex = {};
+    objectIndex.type = RootParameterType::Constants;
+    objectIndex.visibility = ShaderVisibility::Vertex;
+    objectIndex.num32BitValues = 1;
+
+    RootSignatureLayout layout;
+    layout.parameters.push_back(objectIndex);
+    layout.bindingLocations.push_back(RootBindingLocation{ "DrawConstants", 0, 0 });
+    return layout;
+  }
+
+  Frustum MakeFrustum()
+  {
+    // 90 degree perspective, near 0.1, far 1000, camera at the origin (row-vector, D3D depth):
+    const float nearZ = 0.1f, farZ = 1000.0f;
+    const float q = farZ / (farZ - nearZ);
+    const float viewProjection[16] = {
+      1.0f, 0.0f, 0.0f,         0.0f,
+      0.0f, 1.0f, 0.0f,         0.0f,
+      0.0f, 0.0f, q,            1.0f,
+      0.0f, 0.0f, -q * nearZ,   0.0f,
+    };
+    return Frustum::FromViewProjection(viewProjection);
+  }
+
+  void RunGenerateIndirectDraws(BenchmarkContext& context, uint32_t count)
+  {
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+    std::vector<IndirectMeshDraw> meshDraws(64);
+    for (uint32_t i = 0; i < meshDraws.size(); ++i)
+      meshDraws[i] = IndirectMeshDraw{ 3 * 512, i * 3 * 512, 0, 0 };
+
+    std::vector<IndirectInstance> instances(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      const float extent = size(random);
+      instances[i] = IndirectInstance{ { position(random), position(random), position(random) }, i % 64,
+        { extent, extent, extent }, i };
+    }
+
+    const IndirectCommandLayout layout = BuildIndirectCommandLayout(MakeDrawRootLayout(), { "DrawConstants" },
+      IndirectArgumentType::DrawIndexed);
+    const Frustum frustum = MakeFrustum();
+    std::vector<uint8_t> commands(static_cast<size_t>(count) * layout.byteStride);
+
+    context.SetItemsPerIteration(count);
+    context.StartTimer();
+
+    uint32_t numCommands = 0;
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+      numCommands += GenerateIndirectDraws(layout, 0, frustum, instances.data(), count, meshDraws.data(), commands.data());
+
+    context.StopTimer();
+    DoNotOptimise(numCommands);
+  }
+}
+
+DX12_BENCHMARK(IndirectCommands_GenerateDraws_1M)
+{
+  RunGenerateIndirectDraws(context, 1000 * 1000);
+}
@@ -0,0 +1,156 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <vector>
+
+// Scheduling overhead (empty jobs, dependency chains) and ParallelFor scaling across thread counts. Every
+// benchmark creates its own JobSystem outside the timed region, so thread start-up isn't measured.
+
+namespace
+{
+  const uint32_t c_numEmptyJobs = 1024;
+  const uint32_t c_chainLength = 256;
+  const uint32_t c_numElements = 1 << 20;
+  const uint32_t c_grainSize = 4096;
+
+  void EmptyJob(void*)
+  {
+  }
+
+  struct ChainLink
+  {
+    JobCounter  counter;
+    uint32_t*   value;
+  };
+
+  void IncrementJob(void* data)
+  {
+    ++*static_cast<ChainLink*>(data)->value;
+  }
+
+  // Enough arithmetic per element that memory bandwidth doesn't hide scaling:
+  void TransformRange(const float* input, float* output, uint32_t begin, uint32_t end)
+  {
+    for (uint32_t i = begin; i < end; ++i)
+    {
+      const float x = input[i];
+      output[i] = std::sqrt(x * x + 1.0f) * std::sin(x) + std::cos(x * 0.5f);
+    }
+  }
+
+  void RunEmptyJobs(BenchmarkContext& context, uint32_t numWorkers)
+  {
+    JobSystem jobSystem(numWorkers);
+    context.SetItemsPerIteration(c_numEmptyJobs);
+
+    context.StartTimer();
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+    {
+      JobCounter counter;
+      for (uint32_t j = 0; j < c_numEmptyJobs; ++j)
+        jobSystem.Run(&EmptyJob, nullptr, &counter);
+      jobSystem.Wait(counter);
+    }
+    context.StopTimer();
+  }
+
+  void RunParallelFor(BenchmarkContext& context, uint32_t numWorkers)
+  {
+    JobSystem jobSystem(numWorkers);
+    std::vector<float> input(c_numElements);
+    std::vector<float> output(c_numElements);
+    for (uint32_t i = 0; i < c_numElements; ++i)
+      input[i] = static_cast<float>(i) * 0.001f;
+
+    context.SetItemsPerIteration(c_numElements);
+
+    context.StartTimer();
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+    {
+      jobSystem.ParallelFor(c_numElements, c_grainSize, [&](uint32_t begin, uint32_t end) {
+        TransformRange(input.data(), output.data(), begin, end);
+        });
+    }
+    context.StopTimer();
+
+    DoNotOptimise(output[c_numElements - 1]);
+  }
+}
+
+DX12_BENCHMARK(JobSystem_RunWaitEmpty_Workers0)
+{
+  RunEmptyJobs(context, 0);
+}
+
+DX12_BENCHMARK(JobSystem_RunWaitEmpty_WorkersAll)
+{
+  RunEmptyJobs(context, JobSystem::c_defaultNumWorkers);
+}
+
+// Each job only becomes runnable when the previous one finishes, measures the dependency hand-off:
+DX12_BENCHMARK(JobSystem_DependencyChain)
+{
+  JobSystem jobSystem;
+  std::vector<ChainLink> links(c_chainLength);
+  uint32_t value = 0;
+  for (ChainLink& link : links)
+    link.value = &value;
+
+  context.SetItemsPerIteration(c_chainLength);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    jobSystem.Run(&IncrementJob, &links[0], &links[0].counter);
+    for (uint32_t j = 1; j < c_chainLength; ++j)
+      jobSystem.RunAfter(links[j - 1].counter, &IncrementJob, &links[j], &links[j].counter);
+
+    jobSystem.Wait(links[c_chainLength - 1].counter);
+  }
+  context.StopTimer();
+
+  DoNotOptimise(value);
+}
+
+DX12_BENCHMARK(JobSystem_ParallelFor_Serial)
+{
+  std::vector<float> input(c_numElements);
+  std::vector<float> output(c_numElements);
+  for (uint32_t i = 0; i < c_numElements; ++i)
+    input[i] = static_cast<float>(i) * 0.001f;
+
+  context.SetItemsPerIteration(c_numElements);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    TransformRange(input.data(), output.data(), 0, c_numElements);
+  context.StopTimer();
+
+  DoNotOptimise(output[c_numElements - 1]);
+}
+
+DX12_BENCHMARK(JobSystem_ParallelFor_Workers0)
+{
+  RunParallelFor(context, 0);
+}
+
+DX12_BENCHMARK(JobSystem_ParallelFor_Workers1)
+{
+  RunParallelFor(context, 1);
+}
+
+DX12_BENCHMARK(JobSystem_ParallelFor_Workers3)
+{
+  RunParallelFor(context, 3);
+}
+
+DX12_BENCHMARK(JobSystem_ParallelFor_Workers7)
+{
+  RunParallelFor(context, 7);
+}
+
+DX12_BENCHMARK(JobSystem_ParallelFor_WorkersAll)
+{
+  RunParallelFor(context, JobSystem::c_defaultNumWorkers);
+}
@@ -0,0 +1,50 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+
+// What accounting costs per tracked allocation: creating and releasing a TrackedAllocation, on one
+// thread and from every thread at once (all hitting the same category's counters), results are per
+// allocation. The live allocations counter should be back to 0 afterwards.
+
+namespace
+{
+  const uint32_t c_allocationsPerIteration = 1024;
+
+  void TrackAllocations(uint32_t count)
+  {
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      TrackedAllocation allocation(MemoryCategory::Buffers, 64 * 1024);
+      DoNotOptimise(allocation.GetBytes());
+    }
+  }
+}
+
+DX12_BENCHMARK(MemoryTracker_TrackAndRelease_SingleThread)
+{
+  context.SetItemsPerIteration(c_allocationsPerIteration);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+    TrackAllocations(c_allocationsPerIteration);
+  context.StopTimer();
+}
+
+DX12_BENCHMARK(MemoryTracker_TrackAndRelease_AllThreads)
+{
+  static JobSystem s_jobSystem;
+  const uint32_t numAllocations = c_allocationsPerIteration * s_jobSystem.NumThreads();
+  context.SetItemsPerIteration(numAllocations);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    s_jobSystem.ParallelFor(numAllocations, c_allocationsPerIteration, [](uint32_t begin, uint32_t end) {
+      TrackAllocations(end - begin);
+      });
+  }
+  context.StopTimer();
+
+  const MemorySnapshot snapshot = GetMemoryTracker().GetSnapshot();
+  context.SetCounter("live allocations", static_cast<double>(snapshot.Get(MemoryCategory::Buffers).numAllocations));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Stand-ins for the D3D12 objects the renderer's CPU-side code hands around, so it can be benchmarked
+// without a device (or Windows). They do no work beyond counting what they're asked to do, so results
+// are the renderer's own cost, not the driver's.
+
+// A GPU whose fence completes framesOfLatency frames behind the CPU, as with that many frames in flight:
+class NullFence
+{
+public:
+	explicit NullFence(uint64_t framesOfLatency)
+		: m_framesOfLatency(framesOfLatency)
+		, m_value(0)
+	{
+	}
+
+	uint64_t Signal() { return ++m_value; }
+	uint64_t GetCompletedValue() const { return m_value > m_framesOfLatency ? m_value - m_framesOfLatency : 0; }
+
+private:
+	uint64_t	m_framesOfLatency;
+	uint64_t	m_value;
+};
+
+struct NullCommandAllocator
+{
+	uint32_t	id;
+	uint32_t	numResets;
+
+	void Reset() { ++numResets; }
+};
+
+struct NullCommandList
+{
+	uint64_t	numBarrierCalls;
+	uint64_t	numBarriers;
+
+	template<typename Barrier>
+	void ResourceBarrier(uint32_t count, const Barrier* /*barriers*/)
+	{
+		++numBarrierCalls;
+		numBarriers += count;
+	}
+};
+
+// Resources are only ever compared by address:
+class NullResources
+{
+public:
+	explicit NullResources(uint32_t count) : m_resources(count) {}
+
+	const void* Get(uint32_t index) const { return &m_resources[index]; }
+
+private:
+	std::vector<uint8_t>	m_resources;
+};
@@ -0,0 +1,98 @@
+#include "Benchmark.h"
+#include "ResizeCoalescer.h"
+
+// Replays 10 simulated seconds of dragging a window edge: WM_SIZE every 4ms (a 250Hz mouse) while the
+// mouse moves, in 400ms strokes with 300ms pauses, and a frame boundary every 16.7ms. Each swap chain
+// resize waits for the GPU to finish the frames in flight, so the stalls/s counter (resizes per
+// simulated second) is what matters; timings are per WM_SIZE handled.
+//
+// PerEvent resizes on every WM_SIZE, as Resize() used to, PerFrame applies the latest size at each
+// frame boundary, and Settled is what the renderer does during a drag.
+
+namespace
+{
+  const uint64_t c_durationUs = 10000000;
+  const uint64_t c_eventIntervalUs = 4000;
+  const uint64_t c_frameIntervalUs = 16667;
+  const uint64_t c_strokeUs = 400000;
+  const uint64_t c_pauseUs = 300000;
+
+  enum class ResizePolicy
+  {
+    PerEvent,
+    PerFrame,
+    Settled,
+  };
+
+  // Returns the number of resizes, numEvents being set to the number of WM_SIZEs:
+  uint64_t SimulateDrag(ResizePolicy policy, uint64_t& numEvents)
+  {
+    ResizeCoalescer coalescer(1280, 720);
+    coalescer.SetInteractive(policy == ResizePolicy::Settled);
+
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint64_t numResizes = 0;
+    uint64_t nextFrameUs = c_frameIntervalUs;
+    numEvents = 0;
+
+    for (uint64_t nowUs = 0; nowUs < c_durationUs; nowUs += c_eventIntervalUs)
+    {
+      for (; nextFrameUs <= nowUs; nextFrameUs += c_frameIntervalUs)
+      {
+        uint32_t newWidth = 0;
+        uint32_t newHeight = 0;
+        if (coalescer.TakeResize(nextFrameUs, newWidth, newHeight) && policy != ResizePolicy::PerEvent)
+          ++numResizes;
+      }
+
+      // Growing then shrinking a few pixels per event, so the size never repeats within a stroke:
+      const bool isMoving = nowUs % (c_strokeUs + c_pauseUs) < c_strokeUs;
+      if (!isMoving)
+        continue;
+
+      const bool isGrowing = (nowUs / (c_strokeUs + c_pauseUs)) % 2 == 0;
+      width = isGrowing ? width + 3 : width - 3;
+      height = isGrowing ? height + 2 : height - 2;
+      ++numEvents;
+
+      coalescer.OnResize(width, height, nowUs);
+      if (policy == ResizePolicy::PerEvent)
+        ++numResizes;
+    }
+
+    return numResizes;
+  }
+
+  void RunDrag(BenchmarkContext& context, ResizePolicy policy)
+  {
+    uint64_t numEvents = 0;
+    uint64_t numResizes = 0;
+
+    context.StartTimer();
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+    {
+      numResizes = SimulateDrag(policy, numEvents);
+      DoNotOptimise(numResizes);
+    }
+    context.StopTimer();
+
+    context.SetItemsPerIteration(numEvents);
+    context.SetCounter("stalls/s", static_cast<double>(numResizes) * 1e6 / c_durationUs);
+  }
+}
+
+DX12_BENCHMARK(ResizeStorm_Drag_PerEvent)
+{
+  RunDrag(context, ResizePolicy::PerEvent);
+}
+
+DX12_BENCHMARK(ResizeStorm_Drag_PerFrame)
+{
+  RunDrag(context, ResizePolicy::PerFrame);
+}
+
+DX12_BENCHMARK(ResizeStorm_Drag_Settled)
+{
+  RunDrag(context, ResizePolicy::Settled);
+}
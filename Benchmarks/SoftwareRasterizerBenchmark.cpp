@@ -0,0 +1,158 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "SoftwareRasterizer.h"
+
+#include <random>
+#include <vector>
+
+// Renders a 1280x720 frame on the CPU reference backend: clears, then 20000 small depth-tested
+// triangles scattered over the screen at random depths, results are per triangle. The overdraw variant
+// alpha blends 16 full screen quads instead, results are per pixel written.
+
+namespace
+{
+  const uint32_t c_width = 1280;
+  const uint32_t c_height = 720;
+  const uint32_t c_numTriangles = 20000;
+  const uint32_t c_numOverdrawLayers = 16;
+
+  struct Vertex
+  {
+    float position[4];
+    float colour[4];
+  };
+
+  void TransformVertex(const void* /*constants*/, const void* vertex, uint32_t /*instanceId*/, SwVertexOutput& output)
+  {
+    const Vertex& input = *static_cast<const Vertex*>(vertex);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+      output.position[i] = input.position[i];
+      output.varyings[i] = input.colour[i];
+    }
+  }
+
+  void ShadeColour(const void* /*constants*/, const SwPixelBlock& input, float colour[4][g_swNumLanes])
+  {
+    for (uint32_t channel = 0; channel < 4; ++channel)
+    {
+      for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+        colour[channel][lane] = input.varyings[channel][lane];
+    }
+  }
+
+  const std::vector<Vertex>& GetTriangles()
+  {
+    static std::vector<Vertex> s_vertices;
+    if (s_vertices.empty())
+    {
+      // Around 20 pixels across, with a quarter of them partly off screen:
+      std::mt19937 random(1234);
+      std::uniform_real_distribution<float> centre(-1.1f, 1.1f);
+      std::uniform_real_distribution<float> offset(-0.02f, 0.02f);
+      std::uniform_real_distribution<float> unorm(0.0f, 1.0f);
+
+      s_vertices.reserve(c_numTriangles * 3);
+      for (uint32_t i = 0; i < c_numTriangles; ++i)
+      {
+        const float x = centre(random);
+        const float y = centre(random);
+        const float z = unorm(random);
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+          Vertex vertex = { { x + offset(random), y + offset(random), z, 1.0f }, {} };
+          for (uint32_t channel = 0; channel < 3; ++channel)
+            vertex.colour[channel] = unorm(random);
+          vertex.colour[3] = 1.0f;
+          s_vertices.push_back(vertex);
+        }
+      }
+    }
+    return s_vertices;
+  }
+
+  const std::vector<Vertex>& GetOverdrawQuads()
+  {
+    static std::vector<Vertex> s_vertices;
+    if (s_vertices.empty())
+    {
+      for (uint32_t i = 0; i < c_numOverdrawLayers; ++i)
+      {
+        const float shade = static_cast<float>(i) / c_numOverdrawLayers;
+        const Vertex corners[4] = {
+          { { -1.0f, 1.0f, 0.5f, 1.0f }, { shade, 0.5f, 1.0f - shade, 0.25f } },
+          { { 1.0f, 1.0f, 0.5f, 1.0f }, { shade, 0.5f, 1.0f - shade, 0.25f } },
+          { { -1.0f, -1.0f, 0.5f, 1.0f }, { shade, 0.5f, 1.0f - shade, 0.25f } },
+          { { 1.0f, -1.0f, 0.5f, 1.0f }, { shade, 0.5f, 1.0f - shade, 0.25f } },
+        };
+        for (uint32_t index : { 0, 1, 2, 2, 1, 3 })
+          s_vertices.push_back(corners[index]);
+      }
+    }
+    return s_vertices;
+  }
+
+  void RunFrame(BenchmarkContext& context, JobSystem* jobSystem, const std::vector<Vertex>& vertices,
+    const SwPipelineState& pipelineState, uint64_t itemsPerFrame)
+  {
+    SoftwareRasterizer rasterizer(jobSystem);
+    SwTexture colour(SwFormat::RGBA8, c_width, c_height);
+    SwTexture depth(SwFormat::R32Float, c_width, c_height);
+    const float clearColour[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    SwCommandList commandList;
+    commandList.ClearRenderTargetView(&colour, clearColour);
+    commandList.ClearDepthStencilView(&depth, 1.0f);
+    commandList.OMSetRenderTargets(&colour, &depth);
+    commandList.RSSetViewports({ 0.0f, 0.0f, static_cast<float>(c_width), static_cast<float>(c_height), 0.0f, 1.0f });
+    commandList.SetPipelineState(&pipelineState);
+    commandList.IASetVertexBuffers(vertices.data(), sizeof(Vertex), static_cast<uint32_t>(vertices.size()));
+    commandList.DrawInstanced(static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+
+    context.SetItemsPerIteration(itemsPerFrame);
+
+    context.StartTimer();
+    for (uint64_t i = 0; i < context.Iterations(); ++i)
+      rasterizer.Execute(commandList);
+    context.StopTimer();
+
+    DoNotOptimise(colour.GetColour()[0]);
+  }
+
+  SwPipelineState GetPipelineState(SwBlendMode blendMode)
+  {
+    SwPipelineState pipelineState;
+    pipelineState.vertexShader = TransformVertex;
+    pipelineState.pixelShader = ShadeColour;
+    pipelineState.numVaryings = 4;
+    pipelineState.cullMode = SwCullMode::None;
+    pipelineState.blendMode = blendMode;
+    pipelineState.depthTest = blendMode == SwBlendMode::Opaque;
+    pipelineState.depthWrite = blendMode == SwBlendMode::Opaque;
+    return pipelineState;
+  }
+}
+
+DX12_BENCHMARK(SoftwareRasterizer_720p_20KTriangles_Serial)
+{
+  RunFrame(context, nullptr, GetTriangles(), GetPipelineState(SwBlendMode::Opaque), c_numTriangles);
+}
+
+DX12_BENCHMARK(SoftwareRasterizer_720p_20KTriangles_Parallel)
+{
+  static JobSystem s_jobSystem;
+  RunFrame(context, &s_jobSystem, GetTriangles(), GetPipelineState(SwBlendMode::Opaque), c_numTriangles);
+}
+
+DX12_BENCHMARK(SoftwareRasterizer_720p_Overdraw16_Serial)
+{
+  RunFrame(context, nullptr, GetOverdrawQuads(), GetPipelineState(SwBlendMode::Alpha),
+    static_cast<uint64_t>(c_width) * c_height * c_numOverdrawLayers);
+}
+
+DX12_BENCHMARK(SoftwareRasterizer_720p_Overdraw16_Parallel)
+{
+  static JobSystem s_jobSystem;
+  RunFrame(context, &s_jobSystem, GetOverdrawQuads(), GetPipelineState(SwBlendMode::Alpha),
+    static_cast<uint64_t>(c_width) * c_height * c_numOverdrawLayers);
+}
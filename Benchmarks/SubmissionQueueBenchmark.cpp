@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+#include "SubmissionQueue.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+// The channel recording threads hand closed command lists to the submission thread through, with items
+// standing in for the lists. Contention has 1 to 8 producers reserving keys and pushing as fast as they
+// can while the consumer pops batches of up to 16, as CommandQueue::ExecuteSubmissions() does; results
+// are per item. Stress gives each producer a stride of keys, so they arrive out of order, with random
+// pauses and a ring of 8 so producers keep catching up with the consumer. Both check the consumer gets
+// every key once, in order: "misordered" has to be 0. Threads are started outside the timed region.
+
+namespace
+{
+  const uint32_t c_maxItemsPerPop = 16;
+  const uint32_t c_stressCapacity = 8;
+  const uint32_t c_numStressProducers = 4;
+
+  template<typename Queue>
+  void Consume(Queue& queue, uint64_t numItems, uint64_t& numPops, uint64_t& numMisordered)
+  {
+    uint64_t items[c_maxItemsPerPop];
+    uint64_t expected = 0;
+    while (expected < numItems)
+    {
+      const uint32_t numPopped = queue.TryPop(items, c_maxItemsPerPop);
+      if (numPopped == 0)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      ++numPops;
+      for (uint32_t i = 0; i < numPopped; ++i, ++expected)
+      {
+        if (items[i] != expected)
+          ++numMisordered;
+      }
+    }
+  }
+
+  void RunContention(BenchmarkContext& context, uint32_t numProducers)
+  {
+    SubmissionQueue<uint64_t, 256> queue;
+    const uint64_t numItems = context.Iterations();
+    std::atomic<bool> start(false);
+
+    std::vector<std::thread> producers;
+    for (uint32_t i = 0; i < numProducers; ++i)
+    {
+      producers.emplace_back([&]() {
+        while (!start.load(std::memory_order_acquire))
+          std::this_thread::yield();
+
+        for (uint64_t key = queue.ReserveKey(); key < numItems; key = queue.ReserveKey())
+          queue.Push(key, key);
+        });
+    }
+
+    uint64_t numPops = 0;
+    uint64_t numMisordered = 0;
+
+    context.StartTimer();
+    start.store(true, std::memory_order_release);
+    Consume(queue, numItems, numPops, numMisordered);
+    context.StopTimer();
+
+    for (std::thread& producer : producers)
+      producer.join();
+
+    context.SetCounter("items/pop", static_cast<double>(numItems) / numPops);
+    context.SetCounter("misordered", static_cast<double>(numMisordered));
+  }
+}
+
+DX12_BENCHMARK(SubmissionQueue_Contention_1Producer)
+{
+  RunContention(context, 1);
+}
+
+DX12_BENCHMARK(SubmissionQueue_Contention_2Producers)
+{
+  RunContention(context, 2);
+}
+
+DX12_BENCHMARK(SubmissionQueue_Contention_4Producers)
+{
+  RunContention(context, 4);
+}
+
+DX12_BENCHMARK(SubmissionQueue_Contention_8Producers)
+{
+  RunContention(context, 8);
+}
+
+DX12_BENCHMARK(SubmissionQueue_Stress)
+{
+  SubmissionQueue<uint64_t, c_stressCapacity> queue;
+  const uint64_t numItems = context.Iterations();
+  std::atomic<bool> start(false);
+
+  // Keys are handed out up front, as the submission thread does, so ReserveKey() isn't used:
+  std::vector<std::thread> producers;
+  for (uint32_t i = 0; i < c_numStressProducers; ++i)
+  {
+    producers.emplace_back([&, i]() {
+      std::mt19937 random(i);
+      std::uniform_int_distribution<uint32_t> pause(0, 64);
+      while (!start.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+      for (uint64_t key = i; key < numItems; key += c_numStressProducers)
+      {
+        for (uint32_t spin = pause(random); spin > 0; --spin)
+          DoNotOptimise(spin);
+        if (pause(random) == 0)
+          std::this_thread::yield();
+        queue.Push(key, key);
+      }
+      });
+  }
+
+  uint64_t numPops = 0;
+  uint64_t numMisordered = 0;
+
+  context.StartTimer();
+  start.store(true, std::memory_order_release);
+  Consume(queue, numItems, numPops, numMisordered);
+  context.StopTimer();
+
+  for (std::thread& producer : producers)
+    producer.join();
+
+  context.SetCounter("items/pop", static_cast<double>(numItems) / numPops);
+  context.SetCounter("misordered", static_cast<double>(numMisordered));
+}
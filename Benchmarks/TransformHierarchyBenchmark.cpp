@@ -0,0 +1,201 @@
+#include "Benchmark.h"
+#include "TransformHierarchy.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// World matrix updates over a 256K node scene, with everything moving and with 1% of nodes moving,
+// against a conventional scene graph of individually allocated nodes walked recursively. Results are
+// per node in the scene.
+
+namespace
+{
+  // 4096 trees of 64 nodes: a root with 3 children, each with 4 children, each with 4 leaves:
+  const uint32_t c_numRoots = 4096;
+  const uint32_t c_branching[] = { 3, 4, 4 };
+  const uint32_t c_nodesPerTree = 1 + 3 + 3 * 4 + 3 * 4 * 4;
+  const uint32_t c_numNodes = c_numRoots * c_nodesPerTree;
+
+  TransformLocal MakeLocal(std::mt19937& random)
+  {
+    std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+    TransformLocal local = { { offset(random), offset(random), offset(random) },
+      { 0.0f, 0.382683f, 0.0f, 0.92388f }, { 1.0f, 1.0f, 1.0f } };
+    return local;
+  }
+
+  // Adds the scene breadth first, so the hierarchy never needs re-sorting. Returns the ids of the roots:
+  std::vector<TransformId> BuildScene(TransformHierarchy& hierarchy)
+  {
+    std::mt19937 random(42);
+    std::vector<TransformId> roots;
+    for (uint32_t i = 0; i < c_numRoots; ++i)
+      roots.push_back(hierarchy.Add(g_invalidTransformId, MakeLocal(random)));
+
+    std::vector<TransformId> level = roots;
+    for (uint32_t branching : c_branching)
+    {
+      std::vector<TransformId> nextLevel;
+      for (TransformId parent : level)
+      {
+        for (uint32_t i = 0; i < branching; ++i)
+          nextLevel.push_back(hierarchy.Add(parent, MakeLocal(random)));
+      }
+      level.swap(nextLevel);
+    }
+
+    hierarchy.Update();
+    return roots;
+  }
+
+  // The pointer-chasing alternative: AoS nodes, each allocated on its own, children reached by pointer:
+  struct SceneNode
+  {
+    TransformLocal                          local;
+    Matrix4x4                               world;
+    std::vector<std::unique_ptr<SceneNode>> children;
+  };
+
+  void ComputeLocalMatrix(const TransformLocal& local, Matrix4x4& out)
+  {
+    const float x = local.rotation[0], y = local.rotation[1], z = local.rotation[2], w = local.rotation[3];
+    const float rotation[3][3] =
+    {
+      { 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y) },
+      { 2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x) },
+      { 2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y) },
+    };
+
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+        out.m[row * 4 + column] = rotation[row][column] * local.scale[row];
+      out.m[row * 4 + 3] = 0.0f;
+    }
+    out.m[12] = local.position[0];
+    out.m[13] = local.position[1];
+    out.m[14] = local.position[2];
+    out.m[15] = 1.0f;
+  }
+
+  void UpdateSceneNode(SceneNode& node, const Matrix4x4* parentWorld)
+  {
+    Matrix4x4 local;
+    ComputeLocalMatrix(node.local, local);
+
+    if (parentWorld)
+    {
+      for (int row = 0; row < 4; ++row)
+      {
+        for (int column = 0; column < 4; ++column)
+        {
+          node.world.m[row * 4 + column] = local.m[row * 4 + 0] * parentWorld->m[0 + column] +
+            local.m[row * 4 + 1] * parentWorld->m[4 + column] + local.m[row * 4 + 2] * parentWorld->m[8 + column] +
+            local.m[row * 4 + 3] * parentWorld->m[12 + column];
+        }
+      }
+    }
+    else
+      node.world = local;
+
+    for (std::unique_ptr<SceneNode>& child : node.children)
+      UpdateSceneNode(*child, &node.world);
+  }
+
+  void AddSceneChildren(SceneNode& node, uint32_t level, std::mt19937& random)
+  {
+    if (level == sizeof(c_branching) / sizeof(c_branching[0]))
+      return;
+
+    for (uint32_t i = 0; i < c_branching[level]; ++i)
+    {
+      node.children.push_back(std::make_unique<SceneNode>());
+      node.children.back()->local = MakeLocal(random);
+      AddSceneChildren(*node.children.back(), level + 1, random);
+    }
+  }
+}
+
+DX12_BENCHMARK(TransformHierarchy_UpdateAll_256K)
+{
+  TransformHierarchy hierarchy;
+  const std::vector<TransformId> roots = BuildScene(hierarchy);
+
+  context.SetItemsPerIteration(c_numNodes);
+
+  uint64_t numChanged = 0;
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    // Moving every root dirties every node:
+    for (TransformId root : roots)
+    {
+      TransformLocal local = hierarchy.GetLocal(root);
+      local.position[1] += 0.01f;
+      hierarchy.SetLocal(root, local);
+    }
+    numChanged += hierarchy.Update().numChanged;
+  }
+  context.StopTimer();
+
+  DoNotOptimise(numChanged);
+}
+
+DX12_BENCHMARK(TransformHierarchy_UpdateSparse1Percent_256K)
+{
+  TransformHierarchy hierarchy;
+  BuildScene(hierarchy);
+
+  std::mt19937 random(7);
+  std::uniform_int_distribution<TransformId> nodeIds(0, c_numNodes - 1);
+
+  context.SetItemsPerIteration(c_numNodes);
+
+  uint64_t numChanged = 0;
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    for (uint32_t j = 0; j < c_numNodes / 100; ++j)
+    {
+      const TransformId id = nodeIds(random);
+      TransformLocal local = hierarchy.GetLocal(id);
+      local.position[0] += 0.01f;
+      hierarchy.SetLocal(id, local);
+    }
+    numChanged += hierarchy.Update().numChanged;
+  }
+  context.StopTimer();
+
+  DoNotOptimise(numChanged);
+}
+
+DX12_BENCHMARK(PointerSceneGraph_UpdateAll_256K)
+{
+  std::mt19937 random(42);
+  std::vector<std::unique_ptr<SceneNode>> roots;
+  for (uint32_t i = 0; i < c_numRoots; ++i)
+  {
+    roots.push_back(std::make_unique<SceneNode>());
+    roots.back()->local = MakeLocal(random);
+  }
+
+  // Children are allocated tree by tree, after all the roots, like a scene loaded over time:
+  for (std::unique_ptr<SceneNode>& root : roots)
+    AddSceneChildren(*root, 0, random);
+
+  context.SetItemsPerIteration(c_numNodes);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    for (std::unique_ptr<SceneNode>& root : roots)
+    {
+      root->local.position[1] += 0.01f;
+      UpdateSceneNode(*root, nullptr);
+    }
+  }
+  context.StopTimer();
+
+  DoNotOptimise(roots.front()->world.m[13]);
+}
@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+#include "UploadAllocator.h"
+
+#include <random>
+#include <vector>
+
+// Per-frame upload allocation as UploadBuffer does it, with a buffer per frame in flight cycled as a
+// ring of 3: each frame resets its buffer and makes 1024 allocations of 16B-4KB (constants, instance
+// data), a quarter of them 256 byte aligned like constant buffers, results are per allocation.
+
+namespace
+{
+  const uint32_t c_numFramesInFlight = 3;
+  const uint32_t c_allocationsPerFrame = 1024;
+  const uint64_t c_bufferSize = 8 * 1024 * 1024;
+
+  struct UploadRequest
+  {
+    uint64_t size;
+    uint64_t alignment;
+  };
+}
+
+DX12_BENCHMARK(UploadRing_Allocate)
+{
+  std::mt19937 random(5);
+  std::uniform_int_distribution<uint64_t> size(16, 4096);
+  std::vector<UploadRequest> requests(c_allocationsPerFrame);
+  for (uint32_t i = 0; i < c_allocationsPerFrame; ++i)
+    requests[i] = UploadRequest{ size(random), (i % 4 == 0) ? 256u : 16u };
+
+  UploadAllocator allocators[c_numFramesInFlight];
+  uint64_t numFailed = 0;
+  context.SetItemsPerIteration(c_allocationsPerFrame);
+
+  context.StartTimer();
+  for (uint64_t i = 0; i < context.Iterations(); ++i)
+  {
+    UploadAllocator& allocator = allocators[i % c_numFramesInFlight];
+    allocator.Reset(c_bufferSize);
+
+    for (const UploadRequest& request : requests)
+    {
+      const uint64_t offset = allocator.Allocate(request.size, request.alignment);
+      numFailed += offset == UploadAllocator::c_invalidOffset;
+      DoNotOptimise(offset);
+    }
+  }
+  context.StopTimer();
+
+  context.SetCounter("KB per frame", allocators[0].UsedSize() / 1024.0);
+  context.SetCounter("failed allocations", static_cast<double>(numFailed));
+}
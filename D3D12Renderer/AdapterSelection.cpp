@@ -0,0 +1,181 @@
+#include "AdapterSelection.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+  // First line of the cache file, bumped whenever the format changes so old files are ignored:
+  const char* const c_cacheHeader = "AdapterCapabilityCache 1";
+
+  bool Matches(const AdapterInfo& adapter, uint64_t luid, uint64_t driverVersion, uint32_t vendorId, uint32_t deviceId)
+  {
+    return adapter.luid == luid && adapter.driverVersion == driverVersion && adapter.vendorId == vendorId &&
+      adapter.deviceId == deviceId;
+  }
+}
+
+void AdapterCapabilityCache::Load(const std::string& path)
+{
+  m_entries.clear();
+  m_isDirty = false;
+
+  std::ifstream file(path);
+  std::string header;
+  if (!std::getline(file, header) || header != c_cacheHeader)
+    return;
+
+  // One adapter per line: LUID, driver version, vendor/device ids, then its capabilities:
+  Entry entry;
+  uint32_t supportsD3D12 = 0;
+  while (file >> std::hex >> entry.luid >> entry.driverVersion >> entry.vendorId >> entry.deviceId >> supportsD3D12 >>
+    entry.capabilities.maxFeatureLevel)
+  {
+    entry.capabilities.supportsD3D12 = supportsD3D12 != 0;
+    m_entries.push_back(entry);
+  }
+}
+
+bool AdapterCapabilityCache::Save(const std::string& path) const
+{
+  std::ofstream file(path, std::ios::trunc);
+  if (!file)
+    return false;
+
+  file << c_cacheHeader << '\n' << std::hex;
+  for (const Entry& entry : m_entries)
+  {
+    file << entry.luid << ' ' << entry.driverVersion << ' ' << entry.vendorId << ' ' << entry.deviceId << ' ' <<
+      (entry.capabilities.supportsD3D12 ? 1 : 0) << ' ' << entry.capabilities.maxFeatureLevel << '\n';
+  }
+  return static_cast<bool>(file);
+}
+
+bool AdapterCapabilityCache::Find(const AdapterInfo& adapter, AdapterCapabilities& capabilities) const
+{
+  const Entry* entry = FindEntry(adapter);
+  if (!entry)
+    return false;
+
+  capabilities = entry->capabilities;
+  return true;
+}
+
+void AdapterCapabilityCache::Insert(const AdapterInfo& adapter, const AdapterCapabilities& capabilities)
+{
+  m_isDirty = true;
+  if (Entry* entry = FindEntry(adapter))
+  {
+    entry->capabilities = capabilities;
+    return;
+  }
+
+  // An adapter's LUID only ever has one driver at a time, so older versions' entries are dead:
+  m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+    [&](const Entry& entry) { return entry.luid == adapter.luid; }), m_entries.end());
+
+  m_entries.push_back({ adapter.luid, adapter.driverVersion, adapter.vendorId, adapter.deviceId, capabilities });
+}
+
+void AdapterCapabilityCache::Prune(const std::vector<AdapterInfo>& adapters)
+{
+  const size_t numEntries = m_entries.size();
+  m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) {
+    return std::none_of(adapters.begin(), adapters.end(),
+      [&](const AdapterInfo& adapter) { return adapter.luid == entry.luid; });
+    }), m_entries.end());
+
+  if (m_entries.size() != numEntries)
+    m_isDirty = true;
+}
+
+AdapterCapabilityCache::Entry* AdapterCapabilityCache::FindEntry(const AdapterInfo& adapter)
+{
+  return const_cast<Entry*>(static_cast<const AdapterCapabilityCache*>(this)->FindEntry(adapter));
+}
+
+const AdapterCapabilityCache::Entry* AdapterCapabilityCache::FindEntry(const AdapterInfo& adapter) const
+{
+  for (const Entry& entry : m_entries)
+  {
+    if (Matches(adapter, entry.luid, entry.driverVersion, entry.vendorId, entry.deviceId))
+      return &entry;
+  }
+  return nullptr;
+}
+
+bool SelectAdapter(IAdapterProbe& probe, AdapterCapabilityCache& cache, const AdapterPolicy& policy,
+  uint32_t& adapterIndex, AdapterSelectionStats* stats)
+{
+  const std::vector<AdapterInfo>& adapters = probe.GetAdapters();
+  cache.Prune(adapters);
+
+  // Candidates in the order the policy prefers them. Software adapters are only ever picked for WARP:
+  std::vector<uint32_t> candidates;
+  switch (policy.preference)
+  {
+  case AdapterPreference::Index:
+    if (policy.index < adapters.size())
+      candidates.push_back(policy.index);
+    break;
+
+  case AdapterPreference::Warp:
+    for (uint32_t i = 0; i < adapters.size(); ++i)
+    {
+      if (adapters[i].isSoftware)
+        candidates.push_back(i);
+    }
+    break;
+
+  case AdapterPreference::HighPerformance:
+  case AdapterPreference::MinimumPower:
+  {
+    for (uint32_t i = 0; i < adapters.size(); ++i)
+    {
+      if (!adapters[i].isSoftware)
+        candidates.push_back(i);
+    }
+
+    // Ties (e.g. ranks the OS couldn't provide) are broken on dedicated video memory, discrete GPUs
+    // having the most and integrated ones next to none:
+    const bool isHighPerformance = policy.preference == AdapterPreference::HighPerformance;
+    std::stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+      const uint32_t rankA = isHighPerformance ? adapters[a].highPerformanceRank : adapters[a].minimumPowerRank;
+      const uint32_t rankB = isHighPerformance ? adapters[b].highPerformanceRank : adapters[b].minimumPowerRank;
+      if (rankA != rankB)
+        return rankA < rankB;
+
+      const uint64_t memoryA = adapters[a].dedicatedVideoMemory;
+      const uint64_t memoryB = adapters[b].dedicatedVideoMemory;
+      return isHighPerformance ? memoryA > memoryB : memoryA < memoryB;
+    });
+    break;
+  }
+  }
+
+  AdapterSelectionStats selectionStats = {};
+  bool isFound = false;
+  for (uint32_t candidate : candidates)
+  {
+    AdapterCapabilities capabilities;
+    if (cache.Find(adapters[candidate], capabilities))
+      ++selectionStats.numCached;
+    else
+    {
+      capabilities = probe.ProbeCapabilities(candidate);
+      cache.Insert(adapters[candidate], capabilities);
+      ++selectionStats.numProbed;
+    }
+
+    if (capabilities.supportsD3D12 && capabilities.maxFeatureLevel >= policy.minFeatureLevel)
+    {
+      adapterIndex = candidate;
+      isFound = true;
+      break;
+    }
+  }
+
+  if (stats)
+    *stats = selectionStats;
+  return isFound;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Feature levels use D3D_FEATURE_LEVEL's values, so they can be compared without the D3D headers:
+const uint32_t g_featureLevel11_0 = 0xb000;
+
+struct AdapterInfo
+{
+	uint64_t	luid;
+	uint64_t	driverVersion;					// User-mode driver version, changes whenever the driver is updated.
+	uint32_t	vendorId;
+	uint32_t	deviceId;
+	uint64_t	dedicatedVideoMemory;
+	bool			isSoftware;							// E.g. WARP.
+	uint32_t	highPerformanceRank;		// Order the OS would pick adapters in for performance, lowest first...
+	uint32_t	minimumPowerRank;				// ...and for power saving.
+};
+
+struct AdapterCapabilities
+{
+	bool			supportsD3D12;
+	uint32_t	maxFeatureLevel;				// 0 unless supportsD3D12.
+};
+
+// Where adapters come from, a DXGI factory in the renderer. Probing an adapter's capabilities means
+// creating a device on it, which is what makes it expensive:
+class IAdapterProbe
+{
+public:
+	virtual ~IAdapterProbe() = default;
+
+	virtual const std::vector<AdapterInfo>& GetAdapters() = 0;
+	virtual AdapterCapabilities ProbeCapabilities(uint32_t adapterIndex) = 0;
+};
+
+// Probe results by adapter LUID and driver version, persisted between runs so repeat startups don't
+// create any devices just to find out what they support. LUIDs are only stable until the adapter is
+// re-enumerated (e.g. a reboot), after which entries stop matching, are probed again, and the old ones
+// are pruned so the file doesn't grow with every boot.
+class AdapterCapabilityCache
+{
+public:
+	// A missing or unreadable file leaves the cache empty:
+	void Load(const std::string& path);
+	bool Save(const std::string& path) const;
+
+	bool Find(const AdapterInfo& adapter, AdapterCapabilities& capabilities) const;
+	void Insert(const AdapterInfo& adapter, const AdapterCapabilities& capabilities);
+
+	// Drops entries whose LUID none of the currently enumerated adapters has, which can never match
+	// again. SelectAdapter() does this, anything else probing through the cache should before saving:
+	void Prune(const std::vector<AdapterInfo>& adapters);
+
+	bool IsDirty() const { return m_isDirty; }
+	size_t Size() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint64_t							luid;
+		uint64_t							driverVersion;
+		uint32_t							vendorId;
+		uint32_t							deviceId;
+		AdapterCapabilities		capabilities;
+	};
+
+	Entry* FindEntry(const AdapterInfo& adapter);
+	const Entry* FindEntry(const AdapterInfo& adapter) const;
+
+	std::vector<Entry>	m_entries;
+	bool								m_isDirty = false;
+};
+
+enum class AdapterPreference
+{
+	HighPerformance,
+	MinimumPower,
+	Index,						// AdapterPolicy::index into IAdapterProbe::GetAdapters().
+	Warp,							// The first software adapter.
+};
+
+struct AdapterPolicy
+{
+	AdapterPreference	preference = AdapterPreference::HighPerformance;
+	uint32_t					index = 0;
+	uint32_t					minFeatureLevel = g_featureLevel11_0;
+};
+
+struct AdapterSelectionStats
+{
+	uint32_t	numProbed;				// Adapters whose capabilities weren't cached.
+	uint32_t	numCached;
+};
+
+// Picks the adapter the policy asks for among those supporting at least its minimum feature level.
+// Candidates are considered in preference order and only probed (through the cache) until one is
+// found, so a warm cache means no devices created at all. The cache is pruned of adapters no longer
+// there. Returns false if no adapter qualifies, e.g. the explicitly requested one doesn't support D3D12:
+bool SelectAdapter(IAdapterProbe& probe, AdapterCapabilityCache& cache, const AdapterPolicy& policy,
+	uint32_t& adapterIndex, AdapterSelectionStats* stats = nullptr);
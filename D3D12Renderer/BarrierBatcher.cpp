@@ -0,0 +1,63 @@
+#include "BarrierBatcher.h"
+
+namespace
+{
+  // How far back a transition looks for one to merge with. Barriers on the same resource are nearly
+  // always close together, while searching a large batch for each barrier would make it quadratic:
+  const size_t c_maxMergeDistance = 16;
+}
+
+BarrierBatcher::BarrierBatcher()
+  : m_stats()
+{
+}
+
+void BarrierBatcher::Add(const BatchedBarrier& barrier)
+{
+  ++m_stats.barriersAdded;
+  if (!TryMerge(barrier))
+    m_pending.push_back(barrier);
+}
+
+void BarrierBatcher::Transition(const void* resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter)
+{
+  BatchedBarrier barrier = {};
+  barrier.type = BarrierType::Transition;
+  barrier.resource = resource;
+  barrier.subresource = subresource;
+  barrier.stateBefore = stateBefore;
+  barrier.stateAfter = stateAfter;
+  Add(barrier);
+}
+
+bool BarrierBatcher::TryMerge(const BatchedBarrier& barrier)
+{
+  if (barrier.type != BarrierType::Transition || barrier.flags != 0)
+    return false;
+
+  // Only the latest barrier touching the resource can be merged with, anything on it (or on every
+  // resource) in between has to stay in order:
+  const size_t end = m_pending.size() > c_maxMergeDistance ? m_pending.size() - c_maxMergeDistance : 0;
+  for (size_t i = m_pending.size(); i-- > end;)
+  {
+    BatchedBarrier& pending = m_pending[i];
+    const bool isGlobal = pending.type != BarrierType::Transition && !pending.resource && !pending.resourceAfter;
+    if (!isGlobal && pending.resource != barrier.resource && pending.resourceAfter != barrier.resource)
+      continue;
+
+    // Transitions of different subresources (e.g. one of them all subresources) aren't merged, nor ones
+    // that don't follow on, which the debug layer will report once issued:
+    if (isGlobal || pending.type != BarrierType::Transition || pending.flags != 0 ||
+        pending.subresource != barrier.subresource || pending.stateAfter != barrier.stateBefore)
+      return false;
+
+    ++m_stats.barriersMerged;
+    if (pending.stateBefore == barrier.stateAfter)
+      m_pending.erase(m_pending.begin() + i);
+    else
+      pending.stateAfter = barrier.stateAfter;
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class BarrierType : uint8_t
+{
+	Transition,
+	Uav,
+	Aliasing,
+};
+
+// A resource barrier, API-independent: resources, states and flags are the API's, as opaque values.
+struct BatchedBarrier
+{
+	BarrierType	type;
+	uint32_t	flags;				// Split barriers, which are never merged.
+	const void*	resource;			// Null for UAV and aliasing barriers on every resource.
+	const void*	resourceAfter;		// Aliasing barriers only.
+	uint32_t	subresource;
+	uint32_t	stateBefore;		// Transitions only.
+	uint32_t	stateAfter;
+};
+
+struct BarrierBatchStats
+{
+	uint64_t	barriersAdded;
+	uint64_t	barriersMerged;		// Folded into, or cancelling out, a transition already in the batch.
+	uint64_t	barriersIssued;
+	uint64_t	batchesIssued;
+};
+
+// Collects barriers so they reach the driver in as few calls as possible, each call costing the same
+// whatever it holds. A transition of a subresource already transitioning in the batch is folded into that
+// one (A->B then B->C becomes A->C), or cancels it out if it goes back (A->B then B->A). Barriers keep
+// their order otherwise, and nothing is merged across another barrier on the same resource.
+//
+// Barriers have to be issued before the work depending on them, so the owner flushes the batch before
+// every command that accesses resources.
+class BarrierBatcher
+{
+public:
+	BarrierBatcher();
+
+	void Add(const BatchedBarrier& barrier);
+	void Transition(const void* resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter);
+
+	bool IsEmpty() const { return m_pending.empty(); }
+
+	// Hands the batch to issue(const BatchedBarrier* barriers, uint32_t numBarriers), if there is one:
+	template<typename IssueFunc>
+	void Flush(IssueFunc&& issue);
+
+	// Drops the batch without issuing it:
+	void Clear() { m_pending.clear(); }
+
+	const BarrierBatchStats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = {}; }
+
+private:
+	bool TryMerge(const BatchedBarrier& barrier);
+
+	std::vector<BatchedBarrier>	m_pending;			// In the order they're to be issued.
+	BarrierBatchStats			m_stats;
+};
+
+template<typename IssueFunc>
+void BarrierBatcher::Flush(IssueFunc&& issue)
+{
+	if (m_pending.empty())
+		return;
+
+	issue(m_pending.data(), static_cast<uint32_t>(m_pending.size()));
+	m_stats.barriersIssued += m_pending.size();
+	++m_stats.batchesIssued;
+	m_pending.clear();
+}
@@ -0,0 +1,232 @@
+#include "ClusteredLightCuller.h"
+#include "FilteredCommandList.h"
+#include "GpuMemoryTracking.h"
+#include "Helpers.h"
+#include "ShaderCompiler.h"
+#include "UploadBuffer.h"
+
+#include "Dx12Headers/d3dx12.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+static_assert(sizeof(ClusterLight) == 16 && sizeof(ClusterBounds) == 32 && sizeof(ClusterRange) == 8,
+  "Cluster structures must match their layouts in ClusteredLighting.hlsl!");
+
+namespace
+{
+  const wchar_t* const c_clusteredLightingShaderFile = L"ClusteredLighting.hlsl";
+  const uint32_t c_maxClusters = D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION;   // A group per cluster.
+
+  // ClusterConstants in ClusteredLighting.hlsl:
+  struct ClusterConstants
+  {
+    uint32_t  numLights;
+    uint32_t  numClusters;
+    uint32_t  maxLightIndices;
+  };
+}
+
+ClusteredLightCuller::ClusteredLightCuller(ID3D12Device2* device, ShaderCompiler& shaderCompiler,
+  RootSignatureCache& rootSignatures, uint32_t maxLights, uint32_t maxLightIndices)
+  : m_device(device)
+  , m_rootSignatures(rootSignatures)
+  , m_maxLights(maxLights)
+  , m_maxLightIndices(maxLightIndices)
+  , m_numLights(0)
+  , m_numClusters(0)
+{
+  m_countPass = CreatePass(shaderCompiler, "CSCountLights");
+  m_scanPass = CreatePass(shaderCompiler, "CSScanClusters");
+  m_writePass = CreatePass(shaderCompiler, "CSWriteLights");
+
+  m_lightBufferState = D3D12_RESOURCE_STATE_COPY_DEST;
+  m_lightIndexBufferState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+  m_lightBuffer = CreateBuffer(static_cast<uint64_t>(maxLights) * sizeof(ClusterLight), D3D12_RESOURCE_FLAG_NONE,
+    m_lightBufferState, m_lightBufferMemory);
+  m_lightIndexBuffer = CreateBuffer(static_cast<uint64_t>(maxLightIndices) * sizeof(uint32_t),
+    D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, m_lightIndexBufferState, m_lightIndexBufferMemory);
+}
+
+void ClusteredLightCuller::SetGrid(FilteredCommandList& commandList, UploadBuffer& uploadBuffer,
+  const LightClusterGrid& grid)
+{
+  assert(grid.NumClusters() <= c_maxClusters && "Too many clusters to dispatch a group per cluster!");
+
+  const uint64_t boundsSize = static_cast<uint64_t>(grid.NumClusters()) * sizeof(ClusterBounds);
+  if (!m_clusterBoundsBuffer || m_clusterBoundsBuffer->GetDesc().Width < boundsSize)
+  {
+    m_clusterBoundsBufferState = D3D12_RESOURCE_STATE_COPY_DEST;
+    m_clusterRangeBufferState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    m_clusterBoundsBuffer = CreateBuffer(boundsSize, D3D12_RESOURCE_FLAG_NONE, m_clusterBoundsBufferState,
+      m_clusterBoundsBufferMemory);
+    m_clusterRangeBuffer = CreateBuffer(static_cast<uint64_t>(grid.NumClusters()) * sizeof(ClusterRange),
+      D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, m_clusterRangeBufferState, m_clusterRangeBufferMemory);
+  }
+  m_numClusters = grid.NumClusters();
+
+  const UploadBuffer::Allocation allocation = uploadBuffer.Allocate(boundsSize);
+  memcpy(allocation.cpuAddress, grid.GetClusterBounds(), boundsSize);
+
+  Transition(commandList, m_clusterBoundsBuffer.Get(), m_clusterBoundsBufferState, D3D12_RESOURCE_STATE_COPY_DEST);
+  commandList.CopyBufferRegion(m_clusterBoundsBuffer.Get(), 0, uploadBuffer.Resource(), allocation.offset, boundsSize);
+}
+
+void ClusteredLightCuller::UpdateLights(FilteredCommandList& commandList, UploadBuffer& uploadBuffer,
+  const ClusterLight* lights, uint32_t count)
+{
+  assert(count <= m_maxLights);
+  m_numLights = count;
+  if (count == 0)
+    return;
+
+  const uint64_t size = static_cast<uint64_t>(count) * sizeof(ClusterLight);
+  const UploadBuffer::Allocation allocation = uploadBuffer.Allocate(size);
+  memcpy(allocation.cpuAddress, lights, size);
+
+  Transition(commandList, m_lightBuffer.Get(), m_lightBufferState, D3D12_RESOURCE_STATE_COPY_DEST);
+  commandList.CopyBufferRegion(m_lightBuffer.Get(), 0, uploadBuffer.Resource(), allocation.offset, size);
+}
+
+void ClusteredLightCuller::Cull(FilteredCommandList& commandList, UploadBuffer& uploadBuffer)
+{
+  assert(m_clusterBoundsBuffer && "SetGrid() has to be called before culling!");
+
+  ClusterConstants constants = {};
+  constants.numLights = m_numLights;
+  constants.numClusters = m_numClusters;
+  constants.maxLightIndices = m_maxLightIndices;
+
+  const UploadBuffer::Allocation constantsAllocation = uploadBuffer.Allocate(sizeof(constants),
+    D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+  memcpy(constantsAllocation.cpuAddress, &constants, sizeof(constants));
+
+  Transition(commandList, m_lightBuffer.Get(), m_lightBufferState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+  Transition(commandList, m_clusterBoundsBuffer.Get(), m_clusterBoundsBufferState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+  Transition(commandList, m_clusterRangeBuffer.Get(), m_clusterRangeBufferState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+  Transition(commandList, m_lightIndexBuffer.Get(), m_lightIndexBufferState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+  // Each pass reads what the previous one wrote to the ranges, hence the UAV barriers in between:
+  SetPass(commandList, m_countPass, constantsAllocation.gpuAddress);
+  commandList.Dispatch(m_numClusters, 1, 1);
+
+  Transition(commandList, m_clusterRangeBuffer.Get(), m_clusterRangeBufferState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+  SetPass(commandList, m_scanPass, constantsAllocation.gpuAddress);
+  commandList.Dispatch(1, 1, 1);
+
+  Transition(commandList, m_clusterRangeBuffer.Get(), m_clusterRangeBufferState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+  SetPass(commandList, m_writePass, constantsAllocation.gpuAddress);
+  commandList.Dispatch(m_numClusters, 1, 1);
+}
+
+void ClusteredLightCuller::UploadLists(FilteredCommandList& commandList, UploadBuffer& uploadBuffer,
+  const LightClusterBuilder& builder)
+{
+  assert(builder.GetRanges().size() == m_numClusters && "Lists were built for a different grid!");
+  assert(builder.GetLightIndices().size() <= m_maxLightIndices);
+
+  const uint64_t rangesSize = builder.GetRanges().size() * sizeof(ClusterRange);
+  const UploadBuffer::Allocation ranges = uploadBuffer.Allocate(rangesSize);
+  memcpy(ranges.cpuAddress, builder.GetRanges().data(), rangesSize);
+
+  Transition(commandList, m_clusterRangeBuffer.Get(), m_clusterRangeBufferState, D3D12_RESOURCE_STATE_COPY_DEST);
+  commandList.CopyBufferRegion(m_clusterRangeBuffer.Get(), 0, uploadBuffer.Resource(), ranges.offset, rangesSize);
+
+  const uint64_t indicesSize = builder.GetLightIndices().size() * sizeof(uint32_t);
+  if (indicesSize > 0)
+  {
+    const UploadBuffer::Allocation indices = uploadBuffer.Allocate(indicesSize);
+    memcpy(indices.cpuAddress, builder.GetLightIndices().data(), indicesSize);
+
+    Transition(commandList, m_lightIndexBuffer.Get(), m_lightIndexBufferState, D3D12_RESOURCE_STATE_COPY_DEST);
+    commandList.CopyBufferRegion(m_lightIndexBuffer.Get(), 0, uploadBuffer.Resource(), indices.offset, indicesSize);
+  }
+}
+
+void ClusteredLightCuller::PrepareForShading(FilteredCommandList& commandList)
+{
+  const D3D12_RESOURCE_STATES shaderResource = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
+    | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+  Transition(commandList, m_lightBuffer.Get(), m_lightBufferState, shaderResource);
+  Transition(commandList, m_clusterRangeBuffer.Get(), m_clusterRangeBufferState, shaderResource);
+  Transition(commandList, m_lightIndexBuffer.Get(), m_lightIndexBufferState, shaderResource);
+}
+
+ClusteredLightCuller::Pass ClusteredLightCuller::CreatePass(ShaderCompiler& shaderCompiler, const char* entryPoint)
+{
+  const ShaderSourceDesc source = { c_clusteredLightingShaderFile, entryPoint, "cs_5_1" };
+  Microsoft::WRL::ComPtr<ID3DBlob> shader = shaderCompiler.CompileOrLoad(source, 0, {});
+
+  Pass pass;
+  pass.rootSignatureId = m_rootSignatures.GetOrCreate({ ReflectShaderBindings(shader.Get(), ShaderStage::Compute) });
+
+  const RootSignatureLayout& layout = m_rootSignatures.GetLayout(pass.rootSignatureId);
+  pass.constantsRootIndex = layout.FindRootIndex("ClusterConstants");
+  pass.lightsRootIndex = layout.FindRootIndex("g_lights");
+  pass.clusterBoundsRootIndex = layout.FindRootIndex("g_clusterBounds");
+  pass.clusterRangesRootIndex = layout.FindRootIndex("g_clusterRanges");
+  pass.lightIndicesRootIndex = layout.FindRootIndex("g_lightIndices");
+
+  D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc = {};
+  pipelineDesc.pRootSignature = m_rootSignatures.GetRootSignature(pass.rootSignatureId);
+  pipelineDesc.CS = CD3DX12_SHADER_BYTECODE(shader.Get());
+  DX12_CHECK(m_device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(&pass.pipelineState)),
+    "Failed to create light culling pipeline!");
+
+  return pass;
+}
+
+void ClusteredLightCuller::SetPass(FilteredCommandList& commandList, const Pass& pass,
+  D3D12_GPU_VIRTUAL_ADDRESS constants)
+{
+  commandList.SetComputeRootSignature(m_rootSignatures.GetRootSignature(pass.rootSignatureId));
+  commandList.SetPipelineState(pass.pipelineState.Get());
+
+  if (pass.constantsRootIndex >= 0)
+    commandList.SetComputeRootConstantBufferView(pass.constantsRootIndex, constants);
+  if (pass.lightsRootIndex >= 0)
+    commandList.SetComputeRootShaderResourceView(pass.lightsRootIndex, m_lightBuffer->GetGPUVirtualAddress());
+  if (pass.clusterBoundsRootIndex >= 0)
+    commandList.SetComputeRootShaderResourceView(pass.clusterBoundsRootIndex, m_clusterBoundsBuffer->GetGPUVirtualAddress());
+  if (pass.clusterRangesRootIndex >= 0)
+    commandList.SetComputeRootUnorderedAccessView(pass.clusterRangesRootIndex, m_clusterRangeBuffer->GetGPUVirtualAddress());
+  if (pass.lightIndicesRootIndex >= 0)
+    commandList.SetComputeRootUnorderedAccessView(pass.lightIndicesRootIndex, m_lightIndexBuffer->GetGPUVirtualAddress());
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> ClusteredLightCuller::CreateBuffer(uint64_t size, D3D12_RESOURCE_FLAGS flags,
+  D3D12_RESOURCE_STATES initialState, TrackedAllocation& memory)
+{
+  const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+  const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(std::max<uint64_t>(size, 1), flags);
+
+  memory.Reset();
+  Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+  DX12_CHECK(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, initialState,
+    nullptr, IID_PPV_ARGS(&buffer)), "Failed to create clustered lighting buffer!");
+  memory = TrackResource(m_device, buffer.Get(), MemoryCategory::Buffers);
+
+  return buffer;
+}
+
+void ClusteredLightCuller::Transition(FilteredCommandList& commandList, ID3D12Resource* resource,
+  D3D12_RESOURCE_STATES& state, D3D12_RESOURCE_STATES newState)
+{
+  if (state == newState)
+  {
+    // Passes writing the same UAV back to back still have to be ordered:
+    if (newState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+    {
+      const CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(resource);
+      commandList.ResourceBarrier(1, &barrier);
+    }
+    return;
+  }
+
+  const CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource, state, newState);
+  commandList.ResourceBarrier(1, &barrier);
+  state = newState;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+
+#include "ClusteredLighting.h"
+#include "MemoryTracker.h"
+#include "RootSignatureCache.h"
+
+class FilteredCommandList;
+class ShaderCompiler;
+class UploadBuffer;
+
+// GPU side of clustered lighting: owns the light, cluster bounds, cluster range and light index buffers
+// shading reads, and fills the lists either with the compute passes in Shaders/ClusteredLighting.hlsl or
+// by uploading the ones a LightClusterBuilder made on the CPU. Both give the same lists, so which one
+// runs is purely a question of where there's time to spare.
+class ClusteredLightCuller
+{
+public:
+	ClusteredLightCuller(ID3D12Device2* device, ShaderCompiler& shaderCompiler, RootSignatureCache& rootSignatures,
+		uint32_t maxLights, uint32_t maxLightIndices);
+
+	// Uploads the grid's cluster bounds, only needed when the projection or grid size changes. May
+	// reallocate the cluster buffers, so the GPU mustn't be using them:
+	void SetGrid(FilteredCommandList& commandList, UploadBuffer& uploadBuffer, const LightClusterGrid& grid);
+
+	// This frame's lights, in view space:
+	void UpdateLights(FilteredCommandList& commandList, UploadBuffer& uploadBuffer, const ClusterLight* lights,
+		uint32_t count);
+
+	// Builds the lists on the GPU:
+	void Cull(FilteredCommandList& commandList, UploadBuffer& uploadBuffer);
+
+	// Or uploads the lists built on the CPU from the same grid and lights:
+	void UploadLists(FilteredCommandList& commandList, UploadBuffer& uploadBuffer, const LightClusterBuilder& builder);
+
+	// Transitions the buffers for reading while shading, after Cull() or UploadLists():
+	void PrepareForShading(FilteredCommandList& commandList);
+
+	D3D12_GPU_VIRTUAL_ADDRESS GetLightBuffer() const { return m_lightBuffer->GetGPUVirtualAddress(); }
+	D3D12_GPU_VIRTUAL_ADDRESS GetClusterRangeBuffer() const { return m_clusterRangeBuffer->GetGPUVirtualAddress(); }
+	D3D12_GPU_VIRTUAL_ADDRESS GetLightIndexBuffer() const { return m_lightIndexBuffer->GetGPUVirtualAddress(); }
+
+	uint32_t NumLights() const { return m_numLights; }
+	uint32_t NumClusters() const { return m_numClusters; }
+
+private:
+	// One of the compute passes and its reflected root signature, bindings it doesn't use are -1:
+	struct Pass
+	{
+		Microsoft::WRL::ComPtr<ID3D12PipelineState>	pipelineState;
+		RootSignatureId								rootSignatureId;
+		int32_t										constantsRootIndex;
+		int32_t										lightsRootIndex;
+		int32_t										clusterBoundsRootIndex;
+		int32_t										clusterRangesRootIndex;
+		int32_t										lightIndicesRootIndex;
+	};
+
+	Pass CreatePass(ShaderCompiler& shaderCompiler, const char* entryPoint);
+	void SetPass(FilteredCommandList& commandList, const Pass& pass, D3D12_GPU_VIRTUAL_ADDRESS constants);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(uint64_t size, D3D12_RESOURCE_FLAGS flags,
+		D3D12_RESOURCE_STATES initialState, TrackedAllocation& memory);
+
+	void Transition(FilteredCommandList& commandList, ID3D12Resource* resource, D3D12_RESOURCE_STATES& state,
+		D3D12_RESOURCE_STATES newState);
+
+	ID3D12Device2*									m_device;
+	RootSignatureCache&								m_rootSignatures;
+	uint32_t										m_maxLights;
+	uint32_t										m_maxLightIndices;
+	uint32_t										m_numLights;
+	uint32_t										m_numClusters;
+
+	Pass											m_countPass;
+	Pass											m_scanPass;
+	Pass											m_writePass;
+
+	// GPU buffers, their current states and memory, the cluster buffers are created by SetGrid():
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_lightBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_clusterBoundsBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_clusterRangeBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_lightIndexBuffer;
+	D3D12_RESOURCE_STATES							m_lightBufferState;
+	D3D12_RESOURCE_STATES							m_clusterBoundsBufferState;
+	D3D12_RESOURCE_STATES							m_clusterRangeBufferState;
+	D3D12_RESOURCE_STATES							m_lightIndexBufferState;
+	TrackedAllocation								m_lightBufferMemory;
+	TrackedAllocation								m_clusterBoundsBufferMemory;
+	TrackedAllocation								m_clusterRangeBufferMemory;
+	TrackedAllocation								m_lightIndexBufferMemory;
+};
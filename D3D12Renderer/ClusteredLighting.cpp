@@ -0,0 +1,361 @@
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX12_LIGHTS_X86 1
+#include <immintrin.h>
+#else
+#define DX12_LIGHTS_X86 0
+#endif
+
+// See FrustumCulling.cpp, GCC/Clang need AVX2 enabled per function:
+#if DX12_LIGHTS_X86 && !defined(_MSC_VER)
+#define DX12_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DX12_TARGET_AVX2
+#endif
+
+namespace
+{
+  const uint32_t c_blockSize = CullingBounds::c_blockSize;
+
+  uint32_t AlignUp(uint32_t value, uint32_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  // Depth of the near side of slice z, exponentially spaced so a slice's depth grows with its distance
+  // like a tile's width does:
+  float GetSliceDepth(const LightClusterGridDesc& desc, uint32_t z)
+  {
+    return desc.nearZ * std::pow(desc.farZ / desc.nearZ, static_cast<float>(z) / desc.sizeZ);
+  }
+
+  void Union(ClusterBounds& bounds, const ClusterBounds& other)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      bounds.min[i] = std::min(bounds.min[i], other.min[i]);
+      bounds.max[i] = std::max(bounds.max[i], other.max[i]);
+    }
+  }
+
+  ClusterBounds EmptyBounds()
+  {
+    const float infinity = std::numeric_limits<float>::infinity();
+    return { { infinity, infinity, infinity }, 0.0f, { -infinity, -infinity, -infinity }, 0.0f };
+  }
+
+  // The test has to match IntersectsCluster() in ClusteredLighting.hlsl operation for operation,
+  // including the order the squared distances are summed in and no multiply-adds (the shader's are kept
+  // apart with precise). Padding lights have a NaN radius, which fails the compare:
+  bool IntersectsScalar(float x, float y, float z, float radius, const ClusterBounds& bounds)
+  {
+    const float dx = std::max(std::max(bounds.min[0] - x, x - bounds.max[0]), 0.0f);
+    const float dy = std::max(std::max(bounds.min[1] - y, y - bounds.max[1]), 0.0f);
+    const float dz = std::max(std::max(bounds.min[2] - z, z - bounds.max[2]), 0.0f);
+    return (dx * dx + dy * dy) + dz * dz <= radius * radius;
+  }
+
+#if DX12_LIGHTS_X86
+  uint32_t IntersectSSE(const float* lightX, const float* lightY, const float* lightZ, const float* lightRadius,
+    uint32_t count, const ClusterBounds& bounds, uint32_t* hits)
+  {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 minX = _mm_set1_ps(bounds.min[0]), maxX = _mm_set1_ps(bounds.max[0]);
+    const __m128 minY = _mm_set1_ps(bounds.min[1]), maxY = _mm_set1_ps(bounds.max[1]);
+    const __m128 minZ = _mm_set1_ps(bounds.min[2]), maxZ = _mm_set1_ps(bounds.max[2]);
+
+    uint32_t numHits = 0;
+    for (uint32_t i = 0; i < count; i += 4)
+    {
+      const __m128 x = _mm_loadu_ps(lightX + i);
+      const __m128 y = _mm_loadu_ps(lightY + i);
+      const __m128 z = _mm_loadu_ps(lightZ + i);
+      const __m128 radius = _mm_loadu_ps(lightRadius + i);
+
+      const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)), zero);
+      const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)), zero);
+      const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)), zero);
+      const __m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+      // Branchless compaction, as in CullSSE():
+      const int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSq, _mm_mul_ps(radius, radius)));
+      for (uint32_t lane = 0; lane < 4; ++lane)
+      {
+        hits[numHits] = i + lane;
+        numHits += (mask >> lane) & 1;
+      }
+    }
+    return numHits;
+  }
+
+  DX12_TARGET_AVX2 uint32_t IntersectAVX2(const float* lightX, const float* lightY, const float* lightZ,
+    const float* lightRadius, uint32_t count, const ClusterBounds& bounds, uint32_t* hits)
+  {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 minX = _mm256_set1_ps(bounds.min[0]), maxX = _mm256_set1_ps(bounds.max[0]);
+    const __m256 minY = _mm256_set1_ps(bounds.min[1]), maxY = _mm256_set1_ps(bounds.max[1]);
+    const __m256 minZ = _mm256_set1_ps(bounds.min[2]), maxZ = _mm256_set1_ps(bounds.max[2]);
+
+    uint32_t numHits = 0;
+    for (uint32_t i = 0; i < count; i += 8)
+    {
+      const __m256 x = _mm256_loadu_ps(lightX + i);
+      const __m256 y = _mm256_loadu_ps(lightY + i);
+      const __m256 z = _mm256_loadu_ps(lightZ + i);
+      const __m256 radius = _mm256_loadu_ps(lightRadius + i);
+
+      const __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minX, x), _mm256_sub_ps(x, maxX)), zero);
+      const __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minY, y), _mm256_sub_ps(y, maxY)), zero);
+      const __m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minZ, z), _mm256_sub_ps(z, maxZ)), zero);
+      const __m256 distanceSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+        _mm256_mul_ps(dz, dz));
+
+      const int mask = _mm256_movemask_ps(_mm256_cmp_ps(distanceSq, _mm256_mul_ps(radius, radius), _CMP_LE_OQ));
+      for (uint32_t lane = 0; lane < 8; ++lane)
+      {
+        hits[numHits] = i + lane;
+        numHits += (mask >> lane) & 1;
+      }
+    }
+    return numHits;
+  }
+#endif
+}
+
+void LightClusterGrid::Build(const LightClusterGridDesc& desc)
+{
+  assert(desc.sizeX > 0 && desc.sizeY > 0 && desc.sizeZ > 0 && desc.nearZ > 0.0f && desc.farZ > desc.nearZ);
+
+  m_desc = desc;
+  m_clusters.resize(static_cast<size_t>(desc.sizeX) * desc.sizeY * desc.sizeZ);
+  m_slices.assign(desc.sizeZ, EmptyBounds());
+  m_rows.assign(static_cast<size_t>(desc.sizeY) * desc.sizeZ, EmptyBounds());
+
+  for (uint32_t z = 0; z < desc.sizeZ; ++z)
+  {
+    const float nearDepth = GetSliceDepth(desc, z);
+    const float farDepth = (z + 1 == desc.sizeZ) ? desc.farZ : GetSliceDepth(desc, z + 1);
+
+    for (uint32_t y = 0; y < desc.sizeY; ++y)
+    {
+      // Tile edges in NDC, rows going top to bottom like the viewport. A view-space point at depth d
+      // projects to ndc = x / (d * tanHalfFov), so each edge is a line through the eye and the box is
+      // bounded by its values at both depths:
+      const float ndcTop = 1.0f - 2.0f * y / desc.sizeY;
+      const float ndcBottom = 1.0f - 2.0f * (y + 1) / desc.sizeY;
+
+      for (uint32_t x = 0; x < desc.sizeX; ++x)
+      {
+        const float ndcLeft = -1.0f + 2.0f * x / desc.sizeX;
+        const float ndcRight = -1.0f + 2.0f * (x + 1) / desc.sizeX;
+
+        ClusterBounds& bounds = m_clusters[GetClusterIndex(x, y, z)];
+        bounds.min[0] = std::min(ndcLeft * nearDepth, ndcLeft * farDepth) * desc.tanHalfFovX;
+        bounds.max[0] = std::max(ndcRight * nearDepth, ndcRight * farDepth) * desc.tanHalfFovX;
+        bounds.min[1] = std::min(ndcBottom * nearDepth, ndcBottom * farDepth) * desc.tanHalfFovY;
+        bounds.max[1] = std::max(ndcTop * nearDepth, ndcTop * farDepth) * desc.tanHalfFovY;
+        bounds.min[2] = nearDepth;
+        bounds.max[2] = farDepth;
+        bounds.padding0 = 0.0f;
+        bounds.padding1 = 0.0f;
+
+        // Exact unions, so a light missing a slice or row provably misses every cluster in it:
+        Union(m_rows[z * desc.sizeY + y], bounds);
+        Union(m_slices[z], bounds);
+      }
+    }
+  }
+}
+
+uint32_t LightClusterGrid::FindCluster(float viewportX, float viewportY, float viewZ) const
+{
+  const float sliceScale = m_desc.sizeZ / std::log(m_desc.farZ / m_desc.nearZ);
+  const float slice = std::floor(std::log(std::max(viewZ, m_desc.nearZ) / m_desc.nearZ) * sliceScale);
+
+  const uint32_t x = std::min(static_cast<uint32_t>(std::max(viewportX, 0.0f) * m_desc.sizeX), m_desc.sizeX - 1);
+  const uint32_t y = std::min(static_cast<uint32_t>(std::max(viewportY, 0.0f) * m_desc.sizeY), m_desc.sizeY - 1);
+  const uint32_t z = std::min(static_cast<uint32_t>(slice), m_desc.sizeZ - 1);
+  return GetClusterIndex(x, y, z);
+}
+
+void LightClusterBuilder::LightSet::Resize(uint32_t newCount)
+{
+  // Padding sits at the origin with a NaN radius, so it never intersects:
+  const uint32_t paddedCount = AlignUp(newCount, c_blockSize);
+  x.resize(paddedCount);
+  y.resize(paddedCount);
+  z.resize(paddedCount);
+  radius.resize(paddedCount);
+  index.resize(paddedCount);
+  count = newCount;
+
+  for (uint32_t i = newCount; i < paddedCount; ++i)
+  {
+    x[i] = y[i] = z[i] = 0.0f;
+    radius[i] = std::numeric_limits<float>::quiet_NaN();
+    index[i] = 0;
+  }
+}
+
+LightClusterBuilder::LightClusterBuilder(uint32_t maxLightIndices)
+  : m_maxLightIndices(maxLightIndices)
+{
+}
+
+bool LightClusterBuilder::IntersectsCluster(const ClusterLight& light, const ClusterBounds& bounds)
+{
+  return IntersectsScalar(light.position[0], light.position[1], light.position[2], light.radius, bounds);
+}
+
+void LightClusterBuilder::Build(const LightClusterGrid& grid, const ClusterLight* lights, uint32_t numLights,
+  CullingPath path)
+{
+  BeginBuild(grid, lights, numLights);
+  for (uint32_t z = 0; z < grid.GetDesc().sizeZ; ++z)
+    BuildSlice(grid, z, path);
+  EndBuild(grid);
+}
+
+void LightClusterBuilder::BuildParallel(JobSystem& jobSystem, const LightClusterGrid& grid,
+  const ClusterLight* lights, uint32_t numLights, CullingPath path)
+{
+  // Slices write disjoint cluster counts and their own index lists, so need no synchronisation:
+  BeginBuild(grid, lights, numLights);
+  jobSystem.ParallelFor(grid.GetDesc().sizeZ, 1, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t z = begin; z < end; ++z)
+      BuildSlice(grid, z, path);
+    });
+  EndBuild(grid);
+}
+
+void LightClusterBuilder::BeginBuild(const LightClusterGrid& grid, const ClusterLight* lights, uint32_t numLights)
+{
+  m_lights.Resize(numLights);
+  for (uint32_t i = 0; i < numLights; ++i)
+  {
+    m_lights.x[i] = lights[i].position[0];
+    m_lights.y[i] = lights[i].position[1];
+    m_lights.z[i] = lights[i].position[2];
+    m_lights.radius[i] = lights[i].radius;
+    m_lights.index[i] = i;
+  }
+
+  m_slices.resize(grid.GetDesc().sizeZ);
+  m_clusterCounts.resize(grid.NumClusters());
+}
+
+void LightClusterBuilder::BuildSlice(const LightClusterGrid& grid, uint32_t z, CullingPath path)
+{
+  const LightClusterGridDesc& desc = grid.GetDesc();
+  SliceState& slice = m_slices[z];
+  slice.lightIndices.clear();
+
+  // Lights are narrowed down slice, then row, then cluster, each level only testing the lights that
+  // touched the level above. Hits index into the set being tested, the SIMD paths write whole blocks:
+  slice.hits.resize(m_lights.x.size() + c_blockSize);
+
+  auto intersect = [&](const LightSet& lights, const ClusterBounds& bounds) -> uint32_t {
+    switch (path)
+    {
+#if DX12_LIGHTS_X86
+    case CullingPath::SSE:
+      return IntersectSSE(lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(),
+        static_cast<uint32_t>(lights.x.size()), bounds, slice.hits.data());
+
+    case CullingPath::AVX2:
+      return IntersectAVX2(lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(),
+        static_cast<uint32_t>(lights.x.size()), bounds, slice.hits.data());
+#endif
+
+    default:
+    {
+      uint32_t numHits = 0;
+      for (uint32_t i = 0; i < lights.count; ++i)
+      {
+        if (IntersectsScalar(lights.x[i], lights.y[i], lights.z[i], lights.radius[i], bounds))
+          slice.hits[numHits++] = i;
+      }
+      return numHits;
+    }
+    }
+  };
+
+  auto gather = [&](const LightSet& from, uint32_t numHits, LightSet& to) {
+    to.Resize(numHits);
+    for (uint32_t i = 0; i < numHits; ++i)
+    {
+      const uint32_t hit = slice.hits[i];
+      to.x[i] = from.x[hit];
+      to.y[i] = from.y[hit];
+      to.z[i] = from.z[hit];
+      to.radius[i] = from.radius[hit];
+      to.index[i] = from.index[hit];
+    }
+  };
+
+  gather(m_lights, intersect(m_lights, grid.GetSliceBounds(z)), slice.sliceLights);
+
+  for (uint32_t y = 0; y < desc.sizeY; ++y)
+  {
+    const uint32_t firstCluster = grid.GetClusterIndex(0, y, z);
+    if (slice.sliceLights.count == 0)
+    {
+      std::fill_n(m_clusterCounts.begin() + firstCluster, desc.sizeX, 0u);
+      continue;
+    }
+
+    gather(slice.sliceLights, intersect(slice.sliceLights, grid.GetRowBounds(y, z)), slice.rowLights);
+
+    for (uint32_t x = 0; x < desc.sizeX; ++x)
+    {
+      uint32_t numHits = 0;
+      if (slice.rowLights.count > 0)
+        numHits = intersect(slice.rowLights, grid.GetClusterBounds()[firstCluster + x]);
+
+      // Hits come out in ascending set order, and every set keeps the lights' original order:
+      for (uint32_t i = 0; i < numHits; ++i)
+        slice.lightIndices.push_back(slice.rowLights.index[slice.hits[i]]);
+      m_clusterCounts[firstCluster + x] = numHits;
+    }
+  }
+}
+
+void LightClusterBuilder::EndBuild(const LightClusterGrid& grid)
+{
+  const LightClusterGridDesc& desc = grid.GetDesc();
+  const uint32_t clustersPerSlice = desc.sizeX * desc.sizeY;
+
+  m_stats = {};
+  m_stats.numLights = m_lights.count;
+
+  // Offsets are the clusters' prefix sum, clamped to the list's capacity (CSScanClusters does the same):
+  m_ranges.resize(grid.NumClusters());
+  m_lightIndices.clear();
+
+  uint32_t prefix = 0;
+  for (uint32_t z = 0; z < desc.sizeZ; ++z)
+  {
+    const uint32_t* sliceIndices = m_slices[z].lightIndices.data();
+    for (uint32_t cluster = z * clustersPerSlice; cluster < (z + 1) * clustersPerSlice; ++cluster)
+    {
+      const uint32_t count = m_clusterCounts[cluster];
+      ClusterRange& range = m_ranges[cluster];
+      range.offset = std::min(prefix, m_maxLightIndices);
+      range.count = std::min(count, m_maxLightIndices - range.offset);
+      m_lightIndices.insert(m_lightIndices.end(), sliceIndices, sliceIndices + range.count);
+
+      sliceIndices += count;
+      prefix += count;
+      m_stats.numNonEmptyClusters += (count > 0) ? 1 : 0;
+      m_stats.maxLightsPerCluster = std::max(m_stats.maxLightsPerCluster, count);
+    }
+  }
+  m_stats.numLightIndices = prefix;
+}
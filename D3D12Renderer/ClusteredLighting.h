@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+class JobSystem;
+
+// Clustered light culling: the view frustum is split into a grid of froxels (screen tiles by depth
+// slices, spaced exponentially so clusters stay roughly cubic), and each cluster gets a compact list of
+// the lights touching it. Shading then only loops over its pixel's cluster instead of every light.
+//
+// LightClusterBuilder is the CPU path, Shaders/ClusteredLighting.hlsl the compute path. Both test the
+// same cluster bounds (built here and uploaded) with the same sphere/box test, its intermediates marked
+// precise in the shader so it isn't fused into mads, and list each cluster's lights in ascending order,
+// so they produce the same lists. Keep them in sync.
+
+// Point light's extent in view space (+z forward), matches ClusterLight in ClusteredLighting.hlsl:
+struct ClusterLight
+{
+	float	position[3];
+	float	radius;
+};
+
+// View-space box of a cluster, matches ClusterBounds in ClusteredLighting.hlsl:
+struct ClusterBounds
+{
+	float	min[3];
+	float	padding0;
+	float	max[3];
+	float	padding1;
+};
+
+// A cluster's lights, lightIndices[offset, offset + count), matches ClusterRange in ClusteredLighting.hlsl:
+struct ClusterRange
+{
+	uint32_t	offset;
+	uint32_t	count;
+};
+
+struct LightClusterGridDesc
+{
+	uint32_t	sizeX = 16;
+	uint32_t	sizeY = 9;
+	uint32_t	sizeZ = 24;
+
+	// Symmetric perspective projection the grid covers:
+	float			tanHalfFovX = 1.0f;
+	float			tanHalfFovY = 1.0f;
+	float			nearZ = 0.1f;
+	float			farZ = 1000.0f;
+};
+
+// Cluster bounds of a projection, only needs rebuilding when the projection or grid size changes.
+// Clusters are indexed x-fastest, then y (top to bottom), then z (near to far):
+class LightClusterGrid
+{
+public:
+	void Build(const LightClusterGridDesc& desc);
+
+	const LightClusterGridDesc&	GetDesc() const { return m_desc; }
+	uint32_t										NumClusters() const { return static_cast<uint32_t>(m_clusters.size()); }
+	const ClusterBounds*				GetClusterBounds() const { return m_clusters.data(); }
+
+	uint32_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t z) const { return (z * m_desc.sizeY + y) * m_desc.sizeX + x; }
+
+	// Cluster containing a pixel (in [0, 1] viewport coordinates) at a view-space depth, the same
+	// mapping GetClusterIndex() in ClusteredLighting.hlsl uses:
+	uint32_t FindCluster(float viewportX, float viewportY, float viewZ) const;
+
+	// Unions of the clusters in a slice, and in a row of a slice, used to cull lights hierarchically:
+	const ClusterBounds& GetSliceBounds(uint32_t z) const { return m_slices[z]; }
+	const ClusterBounds& GetRowBounds(uint32_t y, uint32_t z) const { return m_rows[z * m_desc.sizeY + y]; }
+
+private:
+	LightClusterGridDesc				m_desc;
+	std::vector<ClusterBounds>	m_clusters;
+	std::vector<ClusterBounds>	m_slices;
+	std::vector<ClusterBounds>	m_rows;
+};
+
+struct LightClusterStats
+{
+	uint32_t	numLights;
+	uint32_t	numLightIndices;			// Before clamping to the maximum.
+	uint32_t	numNonEmptyClusters;
+	uint32_t	maxLightsPerCluster;
+};
+
+// Assigns lights to clusters on the CPU. The index list is capped at maxLightIndices, the size of the
+// GPU buffer it's uploaded to; clusters past the cap lose their lights in cluster order, the same way
+// the compute path clamps them.
+class LightClusterBuilder
+{
+public:
+	explicit LightClusterBuilder(uint32_t maxLightIndices);
+
+	void Build(const LightClusterGrid& grid, const ClusterLight* lights, uint32_t numLights, CullingPath path);
+
+	// Slices are spread across the job system, with the same results as Build():
+	void BuildParallel(JobSystem& jobSystem, const LightClusterGrid& grid, const ClusterLight* lights,
+		uint32_t numLights, CullingPath path);
+
+	const std::vector<ClusterRange>&	GetRanges() const { return m_ranges; }
+	const std::vector<uint32_t>&			GetLightIndices() const { return m_lightIndices; }
+	const LightClusterStats&					GetStats() const { return m_stats; }
+
+	// Lights touching a box, for tests and comparison against the compute path:
+	static bool IntersectsCluster(const ClusterLight& light, const ClusterBounds& bounds);
+
+private:
+	// Lights stored structure-of-arrays, padded to CullingBounds::c_blockSize with lights that never
+	// intersect anything:
+	struct LightSet
+	{
+		std::vector<float>		x;
+		std::vector<float>		y;
+		std::vector<float>		z;
+		std::vector<float>		radius;
+		std::vector<uint32_t>	index;
+		uint32_t							count = 0;
+
+		void Resize(uint32_t newCount);
+	};
+
+	// Per slice working data, so slices can be processed in parallel:
+	struct SliceState
+	{
+		LightSet							sliceLights;
+		LightSet							rowLights;
+		std::vector<uint32_t>	hits;
+		std::vector<uint32_t>	lightIndices;		// Every cluster of the slice, one after another.
+	};
+
+	void BeginBuild(const LightClusterGrid& grid, const ClusterLight* lights, uint32_t numLights);
+	void BuildSlice(const LightClusterGrid& grid, uint32_t z, CullingPath path);
+	void EndBuild(const LightClusterGrid& grid);
+
+	uint32_t								m_maxLightIndices;
+	LightSet								m_lights;
+	std::vector<SliceState>	m_slices;
+	std::vector<uint32_t>		m_clusterCounts;
+	std::vector<ClusterRange>	m_ranges;
+	std::vector<uint32_t>		m_lightIndices;
+	LightClusterStats				m_stats = {};
+};
@@ -1,17 +1,26 @@
 #include "CommandQueue.h"
+#include "GpuMemoryTracking.h"
 #include "Helpers.h"
+#include "Tracing.h"
 #include <cassert>
 
-CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
+namespace
+{
+  // Submitted lists executed per call to the driver, more than a frame's worth of recording threads:
+  const uint32_t c_maxListsPerExecute = 16;
+}
+
+CommandQueue::CommandQueue(ID3D12Device2* device, D3D12_COMMAND_LIST_TYPE type, uint32_t nodeMask)
   : m_fenceValue(0)
   , m_commandListType(type)
+  , m_nodeMask(nodeMask)
   , m_device(device)
 {
   D3D12_COMMAND_QUEUE_DESC desc = {};
   desc.Type = type;
   desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
   desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-  desc.NodeMask = 0;
+  desc.NodeMask = nodeMask;
 
   DX12_CHECK(m_device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_commandQueue)));
   DX12_CHECK(m_device->CreateFence(m_fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
@@ -22,21 +31,19 @@ CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_C
 
 CommandQueue::~CommandQueue()
 {
+  ::CloseHandle(m_fenceEvent);
 }
 
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandQueue::GetCommandList()
+Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::GetCommandList()
 {
+  DX12_TRACE_SCOPE("CommandQueue::GetCommandList");
+
   Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
   Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList;
 
-  if (m_commandAllocatorQueue.empty()
-    && IsFenceComplete(m_commandAllocatorQueue.front().fenceVal))
-  {
-    commandAllocator = m_commandAllocatorQueue.front().commandAllocator;
-    m_commandAllocatorQueue.pop();
-
+  // Reuses the oldest allocator once the GPU is done with it, only creating another when it isn't:
+  if (m_commandAllocatorPool.TryAcquire(m_fence->GetCompletedValue(), commandAllocator))
     DX12_CHECK(commandAllocator->Reset());
-  }
   else
     commandAllocator = CreateCommandAllocator();
 
@@ -48,7 +55,7 @@ Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandQueue::GetCommandList()
     DX12_CHECK(commandList->Reset(commandAllocator.Get(), nullptr));
   }
   else
-    commandList = CreateCommandList(commandAllocator);
+    commandList = CreateCommandList(commandAllocator.Get());
 
   DX12_CHECK(commandList->SetPrivateDataInterface(
     __uuidof(ID3D12CommandAllocator), commandAllocator.Get()));
@@ -56,66 +63,135 @@ Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandQueue::GetCommandList()
   return commandList;
 }
 
-uint64_t CommandQueue::ExecuteCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList)
+uint64_t CommandQueue::ExecuteCommandList(ID3D12GraphicsCommandList2* commandList)
 {
-  commandList->Close();
+  DX12_TRACE_SCOPE("CommandQueue::ExecuteCommandList");
 
-  ID3D12CommandAllocator* commandAllocator;
-  UINT dataSize = sizeof(commandAllocator);
-  DX12_CHECK(commandList->GetPrivateData(
-    __uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
+  commandList->Close();
 
   ID3D12CommandList* const ppCommandLists[] = {
-    commandList.Get(),
+    commandList,
   };
 
   m_commandQueue->ExecuteCommandLists(1, ppCommandLists);
   uint64_t fenceVal = Signal();
 
-  m_commandAllocatorQueue.emplace(
-    CommandAllocatorEntry{ fenceVal, commandAllocator });
-  m_commandListQueue.push(commandList);
+  Recycle(commandList, fenceVal);
 
-  commandAllocator->Release();
+  return fenceVal;
+}
+
+uint64_t CommandQueue::ReserveSubmission()
+{
+  return m_submissions.ReserveKey();
+}
+
+void CommandQueue::Submit(uint64_t key, ID3D12GraphicsCommandList2* commandList)
+{
+  DX12_TRACE_SCOPE("CommandQueue::Submit");
+
+  // The queue holds on to the list until it's executed, the recording thread may well drop it first:
+  if (commandList)
+    commandList->AddRef();
+  m_submissions.Push(key, commandList);
+}
+
+uint64_t CommandQueue::ExecuteSubmissions()
+{
+  DX12_TRACE_SCOPE("CommandQueue::ExecuteSubmissions");
+
+  uint64_t fenceVal = 0;
+  ID3D12GraphicsCommandList2* submitted[c_maxListsPerExecute];
+  ID3D12CommandList* commandLists[c_maxListsPerExecute];
+  while (uint32_t numSubmitted = m_submissions.TryPop(submitted, c_maxListsPerExecute))
+  {
+    uint32_t numCommandLists = 0;
+    for (uint32_t i = 0; i < numSubmitted; ++i)
+    {
+      if (submitted[i])
+        commandLists[numCommandLists++] = submitted[i];
+    }
+
+    if (numCommandLists == 0)
+      continue;
+
+    m_commandQueue->ExecuteCommandLists(numCommandLists, commandLists);
+    fenceVal = Signal();
+
+    for (uint32_t i = 0; i < numSubmitted; ++i)
+    {
+      if (submitted[i])
+      {
+        Recycle(submitted[i], fenceVal);
+        submitted[i]->Release();
+      }
+    }
+  }
 
   return fenceVal;
 }
 
 uint64_t CommandQueue::Signal()
 {
-  return 0;
+  const uint64_t fenceVal = ++m_fenceValue;
+  DX12_CHECK(m_commandQueue->Signal(m_fence.Get(), fenceVal));
+  return fenceVal;
 }
 
 bool CommandQueue::IsFenceComplete(uint64_t fenceVal)
 {
-  return false;
+  return m_fence->GetCompletedValue() >= fenceVal;
 }
 
 void CommandQueue::WaitForFenceValue(uint64_t fenceVal)
 {
+  // Traced only when it blocks, so the trace shows real stalls rather than every check:
+  if (!IsFenceComplete(fenceVal))
+  {
+    DX12_TRACE_SCOPE("CommandQueue::WaitForFenceValue");
+    DX12_CHECK(m_fence->SetEventOnCompletion(fenceVal, m_fenceEvent));
+    ::WaitForSingleObject(m_fenceEvent, INFINITE);
+  }
 }
 
 void CommandQueue::Flush()
 {
+  DX12_TRACE_SCOPE("CommandQueue::Flush");
+
+  WaitForFenceValue(Signal());
 }
 
 Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue() const
 {
-  return Microsoft::WRL::ComPtr<ID3D12CommandQueue>();
+  return m_commandQueue;
 }
 
 Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandQueue::CreateCommandAllocator()
 {
   Microsoft::WRL::ComPtr<ID3D12CommandAllocator> newCommandAllocator;
   DX12_CHECK(m_device->CreateCommandAllocator(m_commandListType, IID_PPV_ARGS(&newCommandAllocator)));
+  m_commandAllocatorMemory.push_back(TrackCommandAllocator());
   
   return newCommandAllocator;
 }
 
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::CreateCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator)
+Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::CreateCommandList(ID3D12CommandAllocator* allocator)
 {
   Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> newCommandList;
-  DX12_CHECK(m_device->CreateCommandList(0, m_commandListType, allocator.Get(), nullptr, IID_PPV_ARGS(&newCommandList)));
+  DX12_CHECK(m_device->CreateCommandList(m_nodeMask, m_commandListType, allocator, nullptr, IID_PPV_ARGS(&newCommandList)));
 
   return newCommandList;
 }
+
+void CommandQueue::Recycle(ID3D12GraphicsCommandList2* commandList, uint64_t fenceVal)
+{
+  ID3D12CommandAllocator* commandAllocator;
+  UINT dataSize = sizeof(commandAllocator);
+  DX12_CHECK(commandList->GetPrivateData(
+    __uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
+
+  m_commandAllocatorPool.Release(commandAllocator, fenceVal);
+  m_commandListQueue.push(commandList);
+
+  commandAllocator->Release();
+}
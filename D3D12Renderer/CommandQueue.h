@@ -5,15 +5,29 @@
 
 #include <cstdint>
 #include <queue>
+#include <vector>
+
+#include "FencedPool.h"
+#include "MemoryTracker.h"
+#include "SubmissionQueue.h"
 
 class CommandQueue
 {
 public:
-	CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
+	// nodeMask picks the GPU of a linked adapter the queue and its command lists run on, 0 otherwise:
+	CommandQueue(ID3D12Device2* device, D3D12_COMMAND_LIST_TYPE type, uint32_t nodeMask = 0);
 	virtual ~CommandQueue();
 
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> GetCommandList();
-	uint64_t ExecuteCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList);
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetCommandList();
+	uint64_t ExecuteCommandList(ID3D12GraphicsCommandList2* commandList);
+
+	// Recording on other threads: the submission thread gets their command lists and reserves a key for each,
+	// in the order they're to execute, and the recording threads submit them under those keys once closed
+	// (or null if they recorded nothing). Only Submit() is thread-safe. ExecuteSubmissions() executes them in
+	// key order, as many per call to the driver as are ready, returning the last one's fence value (or 0):
+	uint64_t	ReserveSubmission();
+	void			Submit(uint64_t key, ID3D12GraphicsCommandList2* commandList);
+	uint64_t	ExecuteSubmissions();
 
 	uint64_t	Signal();
 	bool			IsFenceComplete(uint64_t fenceVal);
@@ -24,26 +38,25 @@ public:
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator>			CreateCommandAllocator();
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>	CreateCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>	CreateCommandList(ID3D12CommandAllocator* allocator);
+	void																								Recycle(ID3D12GraphicsCommandList2* commandList, uint64_t fenceVal);
 
 private:
-	struct CommandAllocatorEntry
-	{
-		uint64_t fenceVal;
-		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-	};
-
-	using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
-	using CommandListQueue			= std::queue < Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> >;
+	using CommandAllocatorPool		= FencedPool<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>;
+	using CommandListQueue				= std::queue < Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> >;
+	using CommandListSubmissions	= SubmissionQueue<ID3D12GraphicsCommandList2*, 256>;
 
 	D3D12_COMMAND_LIST_TYPE											m_commandListType;
+	uint32_t																		m_nodeMask;
 	Microsoft::WRL::ComPtr<ID3D12Device2>				m_device;
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue>	m_commandQueue;
 	Microsoft::WRL::ComPtr<ID3D12Fence>					m_fence;
 	HANDLE																			m_fenceEvent;
 	uint64_t																		m_fenceValue;
 
-	CommandAllocatorQueue												m_commandAllocatorQueue;
+	CommandAllocatorPool												m_commandAllocatorPool;
 	CommandListQueue														m_commandListQueue;
+	CommandListSubmissions											m_submissions;		// Each list holds a reference until executed.
+	std::vector<TrackedAllocation>							m_commandAllocatorMemory;		// One per allocator ever created, they're all kept.
 };
 
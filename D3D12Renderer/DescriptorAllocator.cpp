@@ -0,0 +1,73 @@
+#include "DescriptorAllocator.h"
+
+#include <cassert>
+#include <iterator>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t numDescriptors)
+  : m_numDescriptors(numDescriptors)
+  , m_numFree(numDescriptors)
+{
+  if (numDescriptors > 0)
+    AddFreeRange(0, numDescriptors);
+}
+
+uint32_t DescriptorAllocator::Allocate(uint32_t count)
+{
+  assert(count > 0);
+
+  // Of the smallest ranges that fit, the one with the lowest index:
+  const FreeBySize::iterator bestFit = m_freeBySize.lower_bound(std::make_pair(count, 0u));
+  if (bestFit == m_freeBySize.end())
+    return c_invalidIndex;
+
+  // Allocated from the start of the range, what's left of it stays free:
+  const uint32_t index = bestFit->second;
+  const uint32_t rangeCount = bestFit->first;
+  RemoveFreeRange(m_freeByIndex.find(index));
+  if (rangeCount > count)
+    AddFreeRange(index + count, rangeCount - count);
+
+  m_numFree -= count;
+  return index;
+}
+
+void DescriptorAllocator::Free(uint32_t index, uint32_t count)
+{
+  assert(count > 0 && index + count <= m_numDescriptors);
+  m_numFree += count;
+
+  // Merged with the free ranges either side if it touches them:
+  FreeByIndex::iterator next = m_freeByIndex.lower_bound(index);
+  assert((next == m_freeByIndex.end() || index + count <= next->first) && "Freeing descriptors that are already free!");
+  if (next != m_freeByIndex.end() && index + count == next->first)
+  {
+    count += next->second;
+    RemoveFreeRange(next++);
+  }
+
+  if (next != m_freeByIndex.begin())
+  {
+    const FreeByIndex::iterator previous = std::prev(next);
+    assert(previous->first + previous->second <= index && "Freeing descriptors that are already free!");
+    if (previous->first + previous->second == index)
+    {
+      index = previous->first;
+      count += previous->second;
+      RemoveFreeRange(previous);
+    }
+  }
+
+  AddFreeRange(index, count);
+}
+
+void DescriptorAllocator::AddFreeRange(uint32_t index, uint32_t count)
+{
+  m_freeByIndex.emplace(index, count);
+  m_freeBySize.emplace(count, index);
+}
+
+void DescriptorAllocator::RemoveFreeRange(FreeByIndex::iterator range)
+{
+  m_freeBySize.erase(std::make_pair(range->second, range->first));
+  m_freeByIndex.erase(range);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+// Allocates ranges of descriptors out of a heap of a fixed size, by index: the caller turns indices into
+// handles with the heap's start and increment size, so it can be exercised without a device. Ranges are
+// the best fit of the free ranges, which are kept both by size and by index so that freed ranges merge
+// with their neighbours and the heap doesn't fragment into ranges too small to use, both in O(log n).
+//
+// Not thread-safe. Descriptors may still be in use by the GPU when they're freed, so like other GPU
+// resources they should only be freed once the frames using them are complete.
+class DescriptorAllocator
+{
+public:
+	static const uint32_t c_invalidIndex = ~0u;
+
+	explicit DescriptorAllocator(uint32_t numDescriptors);
+
+	// First index of count contiguous descriptors, c_invalidIndex if there's no range that long:
+	uint32_t Allocate(uint32_t count);
+	void Free(uint32_t index, uint32_t count);
+
+	uint32_t NumDescriptors() const { return m_numDescriptors; }
+	uint32_t NumFree() const { return m_numFree; }
+	uint32_t NumFreeRanges() const { return static_cast<uint32_t>(m_freeByIndex.size()); }
+
+private:
+	using FreeByIndex = std::map<uint32_t, uint32_t>;
+	using FreeBySize = std::set<std::pair<uint32_t, uint32_t>>;
+
+	void AddFreeRange(uint32_t index, uint32_t count);
+	void RemoveFreeRange(FreeByIndex::iterator range);
+
+	FreeByIndex		m_freeByIndex;			// Index to count, never adjacent.
+	FreeBySize		m_freeBySize;			// Count and index, the same ranges.
+	uint32_t		m_numDescriptors;
+	uint32_t		m_numFree;
+};
@@ -0,0 +1,130 @@
+#include "DrawBatcher.h"
+#include "DrawPacket.h"
+
+#include <algorithm>
+
+namespace
+{
+  // Groups up to this size are cheaper to sort without the radix sort's histogram passes:
+  const uint32_t c_maxInsertionSortSize = 64;
+
+  // Whether two packets can be drawn as instances of one draw:
+  bool IsSameDraw(const DrawPacket& a, const DrawPacket& b)
+  {
+    return a.meshId == b.meshId && a.startIndex == b.startIndex && a.indexCount == b.indexCount &&
+      a.baseVertex == b.baseVertex && a.pipelineId == b.pipelineId && a.rootSignatureId == b.rootSignatureId &&
+      a.materialId == b.materialId;
+  }
+
+  // Stable, values move with their keys:
+  void InsertionSort(uint64_t* keys, uint32_t* values, uint32_t count)
+  {
+    for (uint32_t i = 1; i < count; ++i)
+    {
+      const uint64_t key = keys[i];
+      const uint32_t value = values[i];
+
+      uint32_t j = i;
+      for (; j > 0 && keys[j - 1] > key; --j)
+      {
+        keys[j] = keys[j - 1];
+        values[j] = values[j - 1];
+      }
+
+      keys[j] = key;
+      values[j] = value;
+    }
+  }
+}
+
+void DrawBatcher::Clear()
+{
+  m_batches.clear();
+  m_instanceData.clear();
+  m_stats = {};
+}
+
+void DrawBatcher::Build(const DrawPacketQueue& queue)
+{
+  Clear();
+
+  const uint32_t numPackets = queue.Size();
+  m_stats.numPackets = numPackets;
+
+  uint32_t i = 0;
+  while (i < numPackets)
+  {
+    const uint64_t key = queue.GetSortedKey(i);
+    uint32_t end = i + 1;
+
+    if (DrawSortKey::GetLayer(key) == DrawLayer_Transparent)
+    {
+      // Only neighbours, anything else would change the blending order:
+      const DrawPacket& first = queue.GetSortedPacket(i);
+      while (end < numPackets && DrawSortKey::GetLayer(queue.GetSortedKey(end)) == DrawLayer_Transparent &&
+        IsSameDraw(first, queue.GetSortedPacket(end)))
+        ++end;
+    }
+    else
+    {
+      // Everything above the depth bits matches for a pipeline/material group:
+      const uint64_t groupKey = key >> DrawSortKey::c_depthBits;
+      while (end < numPackets && (queue.GetSortedKey(end) >> DrawSortKey::c_depthBits) == groupKey)
+        ++end;
+    }
+
+    // Brings same-mesh draws together, stably so each batch's instances stay front to back. Sorts on mesh
+    // and start index only, keeping packet loads out of the sort, draws differing in anything else are
+    // split apart again by IsSameDraw() below:
+    m_groupKeys.clear();
+    m_groupPackets.clear();
+    for (uint32_t j = i; j < end; ++j)
+    {
+      const uint32_t packetIndex = queue.GetSortedIndex(j);
+      const DrawPacket& packet = queue.GetPacket(packetIndex);
+      m_groupKeys.push_back((static_cast<uint64_t>(packet.meshId) << 32) | packet.startIndex);
+      m_groupPackets.push_back(packetIndex);
+    }
+
+    const uint32_t groupSize = static_cast<uint32_t>(m_groupPackets.size());
+    if (groupSize > c_maxInsertionSortSize)
+      RadixSort(m_groupKeys.data(), m_groupPackets.data(), groupSize, m_sortScratch);
+    else
+      InsertionSort(m_groupKeys.data(), m_groupPackets.data(), groupSize);
+
+    uint32_t runStart = 0;
+    for (uint32_t j = 1; j <= groupSize; ++j)
+    {
+      if (j == groupSize || !IsSameDraw(queue.GetPacket(m_groupPackets[runStart]), queue.GetPacket(m_groupPackets[j])))
+      {
+        AddBatch(queue, m_groupPackets.data() + runStart, j - runStart);
+        runStart = j;
+      }
+    }
+
+    i = end;
+  }
+
+  m_stats.numBatches = static_cast<uint32_t>(m_batches.size());
+  m_stats.numMergedDraws = m_stats.numPackets - m_stats.numBatches;
+}
+
+void DrawBatcher::AddBatch(const DrawPacketQueue& queue, const uint32_t* packetIndices, uint32_t count)
+{
+  DrawBatch batch;
+  batch.packetIndex = packetIndices[0];
+  batch.firstInstance = static_cast<uint32_t>(m_instanceData.size());
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const DrawPacket& packet = queue.GetPacket(packetIndices[i]);
+    for (uint32_t instance = 0; instance < packet.instanceCount; ++instance)
+      m_instanceData.push_back(packet.objectIndex + instance);
+  }
+
+  batch.instanceCount = static_cast<uint32_t>(m_instanceData.size()) - batch.firstInstance;
+
+  // Packets drawing no instances don't need a draw either:
+  if (batch.instanceCount > 0)
+    m_batches.push_back(batch);
+}
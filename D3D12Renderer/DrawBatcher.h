@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RadixSort.h"
+
+class DrawPacketQueue;
+
+// One instanced draw, standing in for every sorted packet drawing the same mesh range with the same
+// state. Its instances' data starts firstInstance entries into the batcher's instance data:
+struct DrawBatch
+{
+	uint32_t	packetIndex;			// Packet the state and geometry are taken from.
+	uint32_t	firstInstance;
+	uint32_t	instanceCount;
+};
+
+struct DrawBatchStats
+{
+	uint32_t	numPackets;
+	uint32_t	numBatches;
+	uint32_t	numMergedDraws;		// Draw calls saved, numPackets - numBatches.
+};
+
+// Sits between sorting and recording, collapsing draws that share PSO, root signature, material and
+// mesh range into instanced draws. Per-instance data is each packet's object index (objectIndex + i for
+// a packet's i-th instance), laid out batch by batch for uploading as-is.
+//
+// Opaque and alpha-tested draws are merged across a whole pipeline/material group, giving up front to
+// back order within it, which draw count matters more than on dense scenes. Transparent draws only merge
+// with their sorted neighbours so blending order is kept.
+class DrawBatcher
+{
+public:
+	void Clear();
+
+	// Batches a queue, which has to have been sorted:
+	void Build(const DrawPacketQueue& queue);
+
+	const std::vector<DrawBatch>&	GetBatches() const { return m_batches; }
+	const std::vector<uint32_t>&	GetInstanceData() const { return m_instanceData; }
+	const DrawBatchStats&					GetStats() const { return m_stats; }
+
+private:
+	void AddBatch(const DrawPacketQueue& queue, const uint32_t* packetIndices, uint32_t count);
+
+	std::vector<DrawBatch>	m_batches;
+	std::vector<uint32_t>		m_instanceData;
+	std::vector<uint64_t>		m_groupKeys;			// Mesh and start index of each draw in the group being merged.
+	std::vector<uint32_t>		m_groupPackets;		// Packet indices of the group, in batch order once sorted.
+	RadixSortScratch				m_sortScratch;
+	DrawBatchStats					m_stats = {};
+};
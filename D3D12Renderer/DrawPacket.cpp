@@ -0,0 +1,67 @@
+#include "DrawPacket.h"
+
+#include <cassert>
+#include <numeric>
+
+uint64_t DrawSortKey::Make(DrawLayer layer, uint32_t pipelineId, uint32_t materialId, uint32_t depthBucket)
+{
+  assert(pipelineId <= c_maxPipelineId && materialId <= c_maxMaterialId && depthBucket <= c_maxDepth);
+
+  const uint64_t layerBits = static_cast<uint64_t>(layer) << (64 - c_layerBits);
+
+  if (layer == DrawLayer_Transparent)
+  {
+    // Back to front, so the furthest (largest) depth has to sort first:
+    const uint64_t invertedDepth = c_maxDepth - depthBucket;
+    return layerBits | (invertedDepth << (c_pipelineBits + c_materialBits)) |
+      (static_cast<uint64_t>(pipelineId) << c_materialBits) | materialId;
+  }
+
+  return layerBits | (static_cast<uint64_t>(pipelineId) << (c_materialBits + c_depthBits)) |
+    (static_cast<uint64_t>(materialId) << c_depthBits) | depthBucket;
+}
+
+uint32_t DrawSortKey::QuantiseDepth(float viewDepth, float nearZ, float farZ)
+{
+  const float normalised = (viewDepth - nearZ) / (farZ - nearZ);
+  if (!(normalised > 0.0f))   // Also catches NaN.
+    return 0;
+  if (normalised >= 1.0f)
+    return c_maxDepth;
+
+  return static_cast<uint32_t>(normalised * static_cast<float>(c_maxDepth));
+}
+
+void DrawPacketQueue::Clear()
+{
+  m_packets.clear();
+  m_keys.clear();
+  m_sortedKeys.clear();
+  m_order.clear();
+}
+
+void DrawPacketQueue::Reserve(uint32_t count)
+{
+  m_packets.reserve(count);
+  m_keys.reserve(count);
+  m_sortedKeys.reserve(count);
+  m_order.reserve(count);
+}
+
+uint32_t DrawPacketQueue::Add(uint64_t sortKey, const DrawPacket& packet)
+{
+  const uint32_t index = Size();
+  m_packets.push_back(packet);
+  m_keys.push_back(sortKey);
+  return index;
+}
+
+void DrawPacketQueue::Sort(JobSystem* jobSystem)
+{
+  // Sorts a copy, so packets can still be looked up by index (and re-sorted) afterwards:
+  m_sortedKeys.assign(m_keys.begin(), m_keys.end());
+  m_order.resize(m_packets.size());
+  std::iota(m_order.begin(), m_order.end(), 0u);
+
+  RadixSort(m_sortedKeys.data(), m_order.data(), Size(), m_scratch, jobSystem);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RadixSort.h"
+
+class JobSystem;
+
+// Render layers, in submission order:
+enum DrawLayer : uint32_t
+{
+	DrawLayer_Opaque,
+	DrawLayer_AlphaTested,
+	DrawLayer_Transparent,
+	DrawLayer_Overlay,
+	DrawLayer_Count,
+};
+
+// Packs what a draw needs bound into a 64-bit key that sorts into submission order, most significant
+// bits first:
+//
+//	Opaque:				layer (4) | pipeline (16) | material (20) | depth (24), front to back
+//	Transparent:	layer (4) | depth (24), back to front | pipeline (16) | material (20)
+//
+// so opaque draws are grouped by PSO (and with it root signature) then material, minimising state
+// changes, with nearer draws first within a group for early-z. Transparent draws have to blend in depth
+// order, which wins over state.
+namespace DrawSortKey
+{
+	static const uint32_t c_layerBits			= 4;
+	static const uint32_t c_pipelineBits	= 16;
+	static const uint32_t c_materialBits	= 20;
+	static const uint32_t c_depthBits			= 24;
+
+	static const uint32_t c_maxPipelineId	= (1u << c_pipelineBits) - 1;
+	static const uint32_t c_maxMaterialId	= (1u << c_materialBits) - 1;
+	static const uint32_t c_maxDepth			= (1u << c_depthBits) - 1;
+
+	uint64_t Make(DrawLayer layer, uint32_t pipelineId, uint32_t materialId, uint32_t depthBucket);
+
+	// Linear depth between the near and far planes to a depth bucket, clamped:
+	uint32_t QuantiseDepth(float viewDepth, float nearZ, float farZ);
+
+	inline DrawLayer GetLayer(uint64_t key)
+	{
+		return static_cast<DrawLayer>(key >> (64 - c_layerBits));
+	}
+}
+
+// Everything needed to record a draw, referring to GPU objects by id so packets stay small and
+// platform-independent. Ids are resolved at record time (see RecordDrawBatches()).
+struct DrawPacket
+{
+	uint32_t	pipelineId;
+	uint32_t	rootSignatureId;
+	uint32_t	materialId;
+	uint32_t	meshId;
+	uint32_t	objectIndex;			// Per-instance data, instance i gets objectIndex + i (see DrawBatcher).
+	uint32_t	indexCount;
+	uint32_t	startIndex;
+	int32_t		baseVertex;
+	uint32_t	instanceCount;
+};
+
+// Collects a frame's visible draws and sorts them by key. Packets are never moved, sorting produces an
+// order to record them in.
+class DrawPacketQueue
+{
+public:
+	void			Clear();
+	void			Reserve(uint32_t count);
+	uint32_t	Add(uint64_t sortKey, const DrawPacket& packet);
+
+	// Sorts with the radix sort, spread across the job system if given:
+	void Sort(JobSystem* jobSystem = nullptr);
+
+	uint32_t					Size() const { return static_cast<uint32_t>(m_packets.size()); }
+	const DrawPacket&	GetPacket(uint32_t index) const { return m_packets[index]; }
+
+	// After Sort(), the i-th packet to record and its key:
+	const DrawPacket&	GetSortedPacket(uint32_t i) const { return m_packets[m_order[i]]; }
+	uint32_t					GetSortedIndex(uint32_t i) const { return m_order[i]; }
+	uint64_t					GetSortedKey(uint32_t i) const { return m_sortedKeys[i]; }
+
+private:
+	std::vector<DrawPacket>	m_packets;
+	std::vector<uint64_t>		m_keys;				// By packet index.
+	std::vector<uint64_t>		m_sortedKeys;
+	std::vector<uint32_t>		m_order;			// Packet index for each sorted key.
+	RadixSortScratch				m_scratch;
+};
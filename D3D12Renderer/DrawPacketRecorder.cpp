@@ -0,0 +1,54 @@
+#include "DrawPacketRecorder.h"
+#include "DrawBatcher.h"
+#include "DrawPacket.h"
+#include "FilteredCommandList.h"
+#include "RootSignatureCache.h"
+
+#include <cassert>
+
+void RecordDrawBatches(FilteredCommandList& commandList, const DrawPacketQueue& queue, const DrawBatcher& batcher,
+  const DrawPacketResources& resources, D3D12_GPU_VIRTUAL_ADDRESS instanceData)
+{
+  uint32_t currentRootSignatureId = g_invalidRootSignatureId;
+  int32_t materialRootIndex = -1;
+  int32_t instanceDataRootIndex = -1;
+  int32_t instanceOffsetRootIndex = -1;
+
+  for (const DrawBatch& batch : batcher.GetBatches())
+  {
+    const DrawPacket& packet = queue.GetPacket(batch.packetIndex);
+
+    // Root indices only need looking up again when the root signature changes, which sorting by
+    // pipeline keeps rare:
+    if (packet.rootSignatureId != currentRootSignatureId)
+    {
+      currentRootSignatureId = packet.rootSignatureId;
+      const RootSignatureLayout& layout = resources.rootSignatures->GetLayout(currentRootSignatureId);
+      materialRootIndex = layout.FindRootIndex(resources.materialTableBinding);
+      instanceDataRootIndex = layout.FindRootIndex(resources.instanceDataBinding);
+      instanceOffsetRootIndex = layout.FindRootIndex(resources.instanceOffsetBinding);
+
+      commandList.SetGraphicsRootSignature(resources.rootSignatures->GetRootSignature(currentRootSignatureId));
+    }
+
+    assert(packet.pipelineId < resources.pipelineStates.size() && packet.meshId < resources.meshes.size());
+    commandList.SetPipelineState(resources.pipelineStates[packet.pipelineId]);
+
+    if (materialRootIndex >= 0)
+      commandList.SetGraphicsRootDescriptorTable(materialRootIndex, resources.materialTables[packet.materialId]);
+
+    if (instanceDataRootIndex >= 0)
+      commandList.SetGraphicsRootShaderResourceView(instanceDataRootIndex, instanceData);
+
+    if (instanceOffsetRootIndex >= 0)
+      commandList.SetGraphicsRoot32BitConstant(instanceOffsetRootIndex, batch.firstInstance, 0);
+
+    const DrawMesh& mesh = resources.meshes[packet.meshId];
+    commandList.IASetPrimitiveTopology(mesh.topology);
+    commandList.IASetVertexBuffers(0, 1, &mesh.vertexBuffer);
+    commandList.IASetIndexBuffer(&mesh.indexBuffer);
+
+    commandList.DrawIndexedInstanced(packet.indexCount, batch.instanceCount, packet.startIndex, packet.baseVertex,
+      batch.firstInstance);
+  }
+}
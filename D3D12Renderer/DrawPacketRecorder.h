@@ -0,0 +1,38 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <vector>
+
+class DrawBatcher;
+class DrawPacketQueue;
+class FilteredCommandList;
+class RootSignatureCache;
+
+struct DrawMesh
+{
+	D3D12_VERTEX_BUFFER_VIEW	vertexBuffer;
+	D3D12_INDEX_BUFFER_VIEW		indexBuffer;
+	D3D12_PRIMITIVE_TOPOLOGY	topology;
+};
+
+// What DrawPacket ids refer to. Root parameters are found by shader binding name in each root signature's
+// layout, since where they land depends on the shaders a PSO was built from:
+struct DrawPacketResources
+{
+	std::vector<ID3D12PipelineState*>					pipelineStates;			// By pipelineId.
+	const RootSignatureCache*									rootSignatures;			// rootSignatureId is a RootSignatureId.
+	std::vector<D3D12_GPU_DESCRIPTOR_HANDLE>	materialTables;			// By materialId.
+	std::vector<DrawMesh>											meshes;							// By meshId.
+
+	const char*																materialTableBinding;	// Descriptor table the material is bound to.
+	const char*																instanceDataBinding;	// Root SRV for the batches' instance data (StructuredBuffer<uint>).
+	const char*																instanceOffsetBinding;	// Root constant receiving DrawBatch::firstInstance.
+};
+
+// Records a batched queue's draws, one DrawIndexedInstanced per batch. The instance data is read from
+// instanceData[instanceOffset + SV_InstanceID] (SV_InstanceID doesn't include the start instance, hence
+// the root constant). All state goes through the FilteredCommandList, so consecutive batches sharing a
+// PSO, root signature, material or mesh only pay for binding it once.
+void RecordDrawBatches(FilteredCommandList& commandList, const DrawPacketQueue& queue, const DrawBatcher& batcher,
+	const DrawPacketResources& resources, D3D12_GPU_VIRTUAL_ADDRESS instanceData);
@@ -0,0 +1,122 @@
+#include "DxgiAdapterProbe.h"
+#include "Helpers.h"
+
+#include <d3d12.h>
+
+#include <cassert>
+
+namespace
+{
+  uint64_t ToUint64(const LUID& luid)
+  {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(luid.HighPart)) << 32) | luid.LowPart;
+  }
+
+  // Adapters the OS gave no preference order for (no IDXGIFactory6) all tie:
+  const uint32_t c_unranked = 0xffffffff;
+}
+
+DxgiAdapterProbe::DxgiAdapterProbe(IDXGIFactory4* factory)
+{
+  Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
+  for (UINT i = 0; factory->EnumAdapters1(i, &adapter) != DXGI_ERROR_NOT_FOUND; ++i)
+    m_adapters.push_back(adapter);
+
+  bool hasSoftwareAdapter = false;
+  for (const Microsoft::WRL::ComPtr<IDXGIAdapter1>& enumeratedAdapter : m_adapters)
+  {
+    DXGI_ADAPTER_DESC1 desc;
+    DX12_CHECK(enumeratedAdapter->GetDesc1(&desc), "Failed to get adapter description!");
+    hasSoftwareAdapter |= (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0;
+  }
+
+  // WARP is normally listed as the Microsoft Basic Render Driver, but not everywhere:
+  if (!hasSoftwareAdapter && SUCCEEDED(factory->EnumWarpAdapter(IID_PPV_ARGS(&adapter))))
+    m_adapters.push_back(adapter);
+
+  for (const Microsoft::WRL::ComPtr<IDXGIAdapter1>& enumeratedAdapter : m_adapters)
+  {
+    DXGI_ADAPTER_DESC1 desc;
+    DX12_CHECK(enumeratedAdapter->GetDesc1(&desc), "Failed to get adapter description!");
+
+    AdapterInfo info = {};
+    info.luid = ToUint64(desc.AdapterLuid);
+    info.vendorId = desc.VendorId;
+    info.deviceId = desc.DeviceId;
+    info.dedicatedVideoMemory = desc.DedicatedVideoMemory;
+    info.isSoftware = (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0;
+    info.highPerformanceRank = c_unranked;
+    info.minimumPowerRank = c_unranked;
+
+    // The user-mode driver version, which DXGI only reports through this (IDXGIDevice being the one
+    // interface it still answers for):
+    LARGE_INTEGER driverVersion = {};
+    if (SUCCEEDED(enumeratedAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+      info.driverVersion = static_cast<uint64_t>(driverVersion.QuadPart);
+
+    m_adapterInfos.push_back(info);
+  }
+
+  RankByGpuPreference(factory, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, &AdapterInfo::highPerformanceRank);
+  RankByGpuPreference(factory, DXGI_GPU_PREFERENCE_MINIMUM_POWER, &AdapterInfo::minimumPowerRank);
+}
+
+AdapterCapabilities DxgiAdapterProbe::ProbeCapabilities(uint32_t adapterIndex)
+{
+  assert(adapterIndex < m_adapters.size());
+
+  AdapterCapabilities capabilities = {};
+  Microsoft::WRL::ComPtr<ID3D12Device> device;
+  if (FAILED(D3D12CreateDevice(m_adapters[adapterIndex].Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device))))
+    return capabilities;
+
+  static const D3D_FEATURE_LEVEL featureLevels[] = {
+    D3D_FEATURE_LEVEL_12_1,
+    D3D_FEATURE_LEVEL_12_0,
+    D3D_FEATURE_LEVEL_11_1,
+    D3D_FEATURE_LEVEL_11_0,
+  };
+
+  D3D12_FEATURE_DATA_FEATURE_LEVELS featureLevelData = {};
+  featureLevelData.NumFeatureLevels = _countof(featureLevels);
+  featureLevelData.pFeatureLevelsRequested = featureLevels;
+
+  capabilities.supportsD3D12 = true;
+  capabilities.maxFeatureLevel = D3D_FEATURE_LEVEL_11_0;
+  if (SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_FEATURE_LEVELS, &featureLevelData, sizeof(featureLevelData))))
+    capabilities.maxFeatureLevel = featureLevelData.MaxSupportedFeatureLevel;
+
+  return capabilities;
+}
+
+Microsoft::WRL::ComPtr<IDXGIAdapter4> DxgiAdapterProbe::GetAdapter(uint32_t adapterIndex) const
+{
+  assert(adapterIndex < m_adapters.size());
+
+  Microsoft::WRL::ComPtr<IDXGIAdapter4> adapter;
+  DX12_CHECK(m_adapters[adapterIndex].As(&adapter));
+  return adapter;
+}
+
+void DxgiAdapterProbe::RankByGpuPreference(IDXGIFactory4* factory, DXGI_GPU_PREFERENCE preference,
+  uint32_t AdapterInfo::*rank)
+{
+  Microsoft::WRL::ComPtr<IDXGIFactory6> factory6;
+  if (FAILED(factory->QueryInterface(IID_PPV_ARGS(&factory6))))
+    return;
+
+  // Matched up by LUID, the adapter objects this hands out being different ones:
+  Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
+  for (UINT i = 0; factory6->EnumAdapterByGpuPreference(i, preference, IID_PPV_ARGS(&adapter)) != DXGI_ERROR_NOT_FOUND; ++i)
+  {
+    DXGI_ADAPTER_DESC1 desc;
+    DX12_CHECK(adapter->GetDesc1(&desc), "Failed to get adapter description!");
+
+    const uint64_t luid = ToUint64(desc.AdapterLuid);
+    for (AdapterInfo& info : m_adapterInfos)
+    {
+      if (info.luid == luid)
+        info.*rank = i;
+    }
+  }
+}
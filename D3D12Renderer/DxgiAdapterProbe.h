@@ -0,0 +1,27 @@
+#pragma once
+
+#include <dxgi1_6.h>
+#include <wrl.h>
+
+#include <vector>
+
+#include "AdapterSelection.h"
+
+// IAdapterProbe over a DXGI factory's adapters, plus WARP if the factory doesn't list it. Performance
+// and power ranks come from IDXGIFactory6::EnumAdapterByGpuPreference where available.
+class DxgiAdapterProbe : public IAdapterProbe
+{
+public:
+	explicit DxgiAdapterProbe(IDXGIFactory4* factory);
+
+	const std::vector<AdapterInfo>& GetAdapters() override { return m_adapterInfos; }
+	AdapterCapabilities ProbeCapabilities(uint32_t adapterIndex) override;
+
+	Microsoft::WRL::ComPtr<IDXGIAdapter4> GetAdapter(uint32_t adapterIndex) const;
+
+private:
+	void RankByGpuPreference(IDXGIFactory4* factory, DXGI_GPU_PREFERENCE preference, uint32_t AdapterInfo::*rank);
+
+	std::vector<Microsoft::WRL::ComPtr<IDXGIAdapter1>>	m_adapters;
+	std::vector<AdapterInfo>														m_adapterInfos;
+};
@@ -0,0 +1,105 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+  // Scale changes smaller than this aren't worth a visible resolution change:
+  const float c_minScaleChange = 0.01f;
+}
+
+DynamicResolutionController::DynamicResolutionController(const DynamicResolutionSettings& settings)
+  : m_settings(settings)
+  , m_scale(settings.maxScale)
+  , m_smoothedFrameTime(0.0f)
+  , m_framesUnderThreshold(0)
+  , m_framesToIgnore(0)
+  , m_numAdjustments(0)
+{
+  assert(settings.minScale > 0.0f && settings.minScale <= settings.maxScale);
+}
+
+float DynamicResolutionController::Update(float gpuFrameTime)
+{
+  // Still measuring frames rendered at the previous scale:
+  if (m_framesToIgnore > 0)
+  {
+    --m_framesToIgnore;
+    return m_scale;
+  }
+
+  if (m_smoothedFrameTime <= 0.0f)
+    m_smoothedFrameTime = gpuFrameTime;
+  else
+    m_smoothedFrameTime += m_settings.smoothing * (gpuFrameTime - m_smoothedFrameTime);
+
+  const float frameTime = (gpuFrameTime > m_settings.targetFrameTime)
+    ? std::max(gpuFrameTime, m_smoothedFrameTime) : m_smoothedFrameTime;
+  const float aimedFrameTime = m_settings.targetFrameTime * m_settings.headroom;
+
+  // Scale that would bring the frame time to the aim, if cost is proportional to pixel count:
+  const float idealScale = m_scale * std::sqrt(aimedFrameTime / std::max(frameTime, 1e-3f));
+
+  if (frameTime > aimedFrameTime)
+  {
+    m_framesUnderThreshold = 0;
+    SetScale(std::max(idealScale, m_scale - m_settings.maxDecreaseStep));
+  }
+  else if (frameTime < aimedFrameTime * m_settings.increaseThreshold)
+  {
+    if (++m_framesUnderThreshold >= m_settings.increaseDelayFrames)
+    {
+      m_framesUnderThreshold = 0;
+      SetScale(std::min(idealScale, m_scale + m_settings.maxIncreaseStep));
+    }
+  }
+  else
+  {
+    // Within the hysteresis band, close enough to the aim to hold:
+    m_framesUnderThreshold = 0;
+  }
+
+  return m_scale;
+}
+
+void DynamicResolutionController::Reset()
+{
+  m_smoothedFrameTime = 0.0f;
+  m_framesUnderThreshold = 0;
+  m_framesToIgnore = 0;
+}
+
+void DynamicResolutionController::SetSettings(const DynamicResolutionSettings& settings)
+{
+  assert(settings.minScale > 0.0f && settings.minScale <= settings.maxScale);
+
+  m_settings = settings;
+  m_scale = std::min(std::max(m_scale, settings.minScale), settings.maxScale);
+  Reset();
+}
+
+void DynamicResolutionController::GetRenderSize(uint32_t outputWidth, uint32_t outputHeight, uint32_t& width,
+  uint32_t& height) const
+{
+  width = std::min(std::max(static_cast<uint32_t>(outputWidth * m_scale + 0.5f), 1u), std::max(outputWidth, 1u));
+  height = std::min(std::max(static_cast<uint32_t>(outputHeight * m_scale + 0.5f), 1u), std::max(outputHeight, 1u));
+}
+
+void DynamicResolutionController::SetScale(float scale)
+{
+  scale = std::min(std::max(scale, m_settings.minScale), m_settings.maxScale);
+
+  // Small corrections are skipped, except to land exactly on a limit:
+  const bool isAtLimit = (scale == m_settings.minScale || scale == m_settings.maxScale);
+  if (std::fabs(scale - m_scale) < c_minScaleChange && !(isAtLimit && scale != m_scale))
+    return;
+
+  // The smoothed time is carried over as the prediction at the new scale, so the history isn't thrown
+  // away and the next adjustment doesn't act on stale timings:
+  m_smoothedFrameTime *= (scale * scale) / (m_scale * m_scale);
+  m_scale = scale;
+  m_framesToIgnore = m_settings.latencyFrames;
+  ++m_numAdjustments;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+struct DynamicResolutionSettings
+{
+	float			targetFrameTime = 1000.0f / 60.0f;	// GPU budget per frame, in milliseconds.
+	float			headroom = 0.9f;										// Fraction of the budget aimed for, leaving room for spikes.
+	float			minScale = 0.5f;										// Per axis, of the output resolution.
+	float			maxScale = 1.0f;
+
+	// Damping: weight of each new sample in the smoothed frame time. Samples over budget skip the
+	// smoothing so overload is reacted to straight away:
+	float			smoothing = 0.2f;
+
+	// Hysteresis: the scale only grows once the smoothed time has been below increaseThreshold of the
+	// aimed time for increaseDelayFrames frames in a row, and holds anywhere between that and the aim:
+	float			increaseThreshold = 0.85f;
+	uint32_t	increaseDelayFrames = 30;
+
+	// Largest change of the scale per adjustment. Dropping is faster than growing, a missed frame is
+	// worse than a slightly soft one:
+	float			maxIncreaseStep = 0.05f;
+	float			maxDecreaseStep = 0.2f;
+
+	// GPU timings arrive this many frames late, so samples from frames recorded before a change are
+	// ignored rather than reacted to twice:
+	uint32_t	latencyFrames = 3;
+};
+
+// Picks the render resolution each frame from measured GPU frame times, to hold the frame rate on
+// content whose cost varies. Cost is assumed to scale with pixel count (scale squared), which only has
+// to be roughly right since the controller corrects itself every adjustment.
+class DynamicResolutionController
+{
+public:
+	explicit DynamicResolutionController(const DynamicResolutionSettings& settings = DynamicResolutionSettings());
+
+	// Feeds in the GPU time of a completed frame, in milliseconds, returning the scale to render the
+	// next frame at:
+	float Update(float gpuFrameTime);
+
+	// Forgets the timing history (e.g. when the output size changes), keeping the current scale:
+	void Reset();
+
+	void SetSettings(const DynamicResolutionSettings& settings);
+	const DynamicResolutionSettings& GetSettings() const { return m_settings; }
+
+	float			GetScale() const { return m_scale; }
+	float			GetSmoothedFrameTime() const { return m_smoothedFrameTime; }
+	uint32_t	NumAdjustments() const { return m_numAdjustments; }
+
+	// Render resolution for an output resolution at the current scale, at least 1x1:
+	void GetRenderSize(uint32_t outputWidth, uint32_t outputHeight, uint32_t& width, uint32_t& height) const;
+
+private:
+	void SetScale(float scale);
+
+	DynamicResolutionSettings	m_settings;
+	float											m_scale;
+	float											m_smoothedFrameTime;		// 0 until the first sample.
+	uint32_t									m_framesUnderThreshold;
+	uint32_t									m_framesToIgnore;
+	uint32_t									m_numAdjustments;
+};
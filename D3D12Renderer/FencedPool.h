@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Recycles objects the GPU uses until a fence value is reached, e.g. command allocators: each is handed
+// back with the fence value of the work using it, and can be acquired again once the fence has reached
+// it. A queue's fence values complete in order, so only the oldest object ever needs checking.
+//
+// Objects are opaque here, so it can be exercised without a device.
+template<typename T>
+class FencedPool
+{
+public:
+	void Release(T object, uint64_t fenceValue)
+	{
+		m_entries.push_back(Entry{ fenceValue, std::move(object) });
+	}
+
+	// The oldest object, if the GPU is done with it:
+	bool TryAcquire(uint64_t completedFenceValue, T& object)
+	{
+		if (m_entries.empty() || m_entries.front().fenceValue > completedFenceValue)
+			return false;
+
+		object = std::move(m_entries.front().object);
+		m_entries.pop_front();
+		return true;
+	}
+
+	size_t Size() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint64_t	fenceValue;
+		T			object;
+	};
+
+	std::deque<Entry>	m_entries;		// Oldest first.
+};
@@ -0,0 +1,435 @@
+#include "FilteredCommandList.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+  bool operator==(const D3D12_VERTEX_BUFFER_VIEW& a, const D3D12_VERTEX_BUFFER_VIEW& b)
+  {
+    return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.StrideInBytes == b.StrideInBytes;
+  }
+
+  bool operator==(const D3D12_INDEX_BUFFER_VIEW& a, const D3D12_INDEX_BUFFER_VIEW& b)
+  {
+    return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.Format == b.Format;
+  }
+
+  const UINT c_unknownCount = ~0u;
+}
+
+void FilteredCommandList::RootArguments::InvalidateArguments()
+{
+  for (UINT i = 0; i < c_maxRootParameters; ++i)
+  {
+    types[i] = RootArgumentType::Unset;
+    constantsValidMask[i] = 0;
+  }
+}
+
+void FilteredCommandList::RootArguments::InvalidateDescriptorTables()
+{
+  for (UINT i = 0; i < c_maxRootParameters; ++i)
+  {
+    if (types[i] == RootArgumentType::DescriptorTable)
+      types[i] = RootArgumentType::Unset;
+  }
+}
+
+FilteredCommandList::FilteredCommandList()
+  : m_commandList(nullptr)
+  , m_stats()
+{
+  InvalidateState();
+}
+
+void FilteredCommandList::Begin(ID3D12GraphicsCommandList2* commandList, ID3D12PipelineState* initialPso)
+{
+  assert(m_barrierBatcher.IsEmpty() && "Barriers left unissued, FlushBarriers() wasn't called before closing!");
+  m_barrierBatcher.Clear();
+
+  m_commandList = commandList;
+  InvalidateState();
+  m_pipelineState = initialPso;
+}
+
+void FilteredCommandList::InvalidateState()
+{
+  m_pipelineState = nullptr;
+  m_numDescriptorHeaps = c_unknownCount;
+  m_primitiveTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+  m_vertexBuffersValidMask = 0;
+  m_isIndexBufferValid = false;
+  m_numViewports = c_unknownCount;
+  m_numScissorRects = c_unknownCount;
+
+  m_graphicsArgs.rootSignature = nullptr;
+  m_graphicsArgs.InvalidateArguments();
+  m_computeArgs.rootSignature = nullptr;
+  m_computeArgs.InvalidateArguments();
+}
+
+void FilteredCommandList::SetPipelineState(ID3D12PipelineState* pipelineState)
+{
+  if (Issue(pipelineState == m_pipelineState))
+  {
+    m_commandList->SetPipelineState(pipelineState);
+    m_pipelineState = pipelineState;
+  }
+}
+
+void FilteredCommandList::SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps)
+{
+  assert(numHeaps <= _countof(m_descriptorHeaps) && "Only one heap per heap type can be bound!");
+
+  bool isRedundant = numHeaps == m_numDescriptorHeaps;
+  for (UINT i = 0; isRedundant && i < numHeaps; ++i)
+    isRedundant = heaps[i] == m_descriptorHeaps[i];
+
+  if (Issue(isRedundant))
+  {
+    m_commandList->SetDescriptorHeaps(numHeaps, heaps);
+
+    m_numDescriptorHeaps = numHeaps;
+    for (UINT i = 0; i < numHeaps; ++i)
+      m_descriptorHeaps[i] = heaps[i];
+
+    // Tables bound before a heap change point into the old heaps:
+    m_graphicsArgs.InvalidateDescriptorTables();
+    m_computeArgs.InvalidateDescriptorTables();
+  }
+}
+
+void FilteredCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+  if (Issue(topology == m_primitiveTopology && topology != D3D_PRIMITIVE_TOPOLOGY_UNDEFINED))
+  {
+    m_commandList->IASetPrimitiveTopology(topology);
+    m_primitiveTopology = topology;
+  }
+}
+
+void FilteredCommandList::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+  assert(startSlot + numViews <= c_maxVertexBuffers);
+
+  // Unbinding, nothing worth caching:
+  if (!views)
+  {
+    Issue(false);
+    m_commandList->IASetVertexBuffers(startSlot, numViews, nullptr);
+
+    for (UINT slot = startSlot; slot < startSlot + numViews; ++slot)
+      m_vertexBuffersValidMask &= ~(1u << slot);
+    return;
+  }
+
+  // Only forward the span of slots that actually changed:
+  UINT firstChanged = numViews;
+  UINT lastChanged = 0;
+
+  for (UINT i = 0; i < numViews; ++i)
+  {
+    const UINT slot = startSlot + i;
+    const bool isCached = (m_vertexBuffersValidMask & (1u << slot)) != 0;
+
+    if (!isCached || !(m_vertexBuffers[slot] == views[i]))
+    {
+      firstChanged = firstChanged == numViews ? i : firstChanged;
+      lastChanged = i;
+
+      m_vertexBuffers[slot] = views[i];
+      m_vertexBuffersValidMask |= 1u << slot;
+    }
+  }
+
+  if (Issue(firstChanged == numViews))
+    m_commandList->IASetVertexBuffers(startSlot + firstChanged, lastChanged - firstChanged + 1, views + firstChanged);
+}
+
+void FilteredCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+  if (!view)
+  {
+    Issue(false);
+    m_commandList->IASetIndexBuffer(nullptr);
+    m_isIndexBufferValid = false;
+    return;
+  }
+
+  if (Issue(m_isIndexBufferValid && m_indexBuffer == *view))
+  {
+    m_commandList->IASetIndexBuffer(view);
+    m_indexBuffer = *view;
+    m_isIndexBufferValid = true;
+  }
+}
+
+void FilteredCommandList::RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports)
+{
+  assert(numViewports <= c_maxViewports);
+
+  const bool isRedundant = numViewports == m_numViewports
+    && std::memcmp(viewports, m_viewports, numViewports * sizeof(D3D12_VIEWPORT)) == 0;
+
+  if (Issue(isRedundant))
+  {
+    m_commandList->RSSetViewports(numViewports, viewports);
+    m_numViewports = numViewports;
+    std::memcpy(m_viewports, viewports, numViewports * sizeof(D3D12_VIEWPORT));
+  }
+}
+
+void FilteredCommandList::RSSetScissorRects(UINT numRects, const D3D12_RECT* rects)
+{
+  assert(numRects <= c_maxViewports);
+
+  const bool isRedundant = numRects == m_numScissorRects
+    && std::memcmp(rects, m_scissorRects, numRects * sizeof(D3D12_RECT)) == 0;
+
+  if (Issue(isRedundant))
+  {
+    m_commandList->RSSetScissorRects(numRects, rects);
+    m_numScissorRects = numRects;
+    std::memcpy(m_scissorRects, rects, numRects * sizeof(D3D12_RECT));
+  }
+}
+
+void FilteredCommandList::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+  if (Issue(FilterRootSignature(m_graphicsArgs, rootSignature)))
+    m_commandList->SetGraphicsRootSignature(rootSignature);
+}
+
+void FilteredCommandList::SetGraphicsRoot32BitConstant(UINT rootIndex, UINT value, UINT destOffset)
+{
+  SetGraphicsRoot32BitConstants(rootIndex, 1, &value, destOffset);
+}
+
+void FilteredCommandList::SetGraphicsRoot32BitConstants(UINT rootIndex, UINT num32BitValues, const void* data, UINT destOffset)
+{
+  // FilterRootConstants issues whichever subrange of the constants changed:
+  FilterRootConstants(m_graphicsArgs, rootIndex, num32BitValues, data, destOffset);
+}
+
+void FilteredCommandList::SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+  if (Issue(FilterRootArgument(m_graphicsArgs, rootIndex, RootArgumentType::CBV, address)))
+    m_commandList->SetGraphicsRootConstantBufferView(rootIndex, address);
+}
+
+void FilteredCommandList::SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+  if (Issue(FilterRootArgument(m_graphicsArgs, rootIndex, RootArgumentType::SRV, address)))
+    m_commandList->SetGraphicsRootShaderResourceView(rootIndex, address);
+}
+
+void FilteredCommandList::SetGraphicsRootUnorderedAccessView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+  if (Issue(FilterRootArgument(m_graphicsArgs, rootIndex, RootArgumentType::UAV, address)))
+    m_commandList->SetGraphicsRootUnorderedAccessView(rootIndex, address);
+}
+
+void FilteredCommandList::SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+  if (Issue(FilterRootArgument(m_graphicsArgs, rootIndex, RootArgumentType::DescriptorTable, baseDescriptor.ptr)))
+    m_commandList->SetGraphicsRootDescriptorTable(rootIndex, baseDescriptor);
+}
+
+void FilteredCommandList::SetComputeRootSignature(ID3D12RootSignature* rootSignature)
+{
+  if (Issue(FilterRootSignature(m_computeArgs, rootSignature)))
+    m_commandList->SetComputeRootSignature(rootSignature);
+}
+
+void FilteredCommandList::SetComputeRoot32BitConstant(UINT rootIndex, UINT value, UINT destOffset)
+{
+  SetComputeRoot32BitConstants(rootIndex, 1, &value, destOffset);
+}
+
+void FilteredCommandList::SetComputeRoot32BitConstants(UINT rootIndex, UINT num32BitValues, const void* data, UINT destOffset)
+{
+  FilterRootConstants(m_computeArgs, rootIndex, num32BitValues, data, destOffset);
+}
+
+void FilteredCommandList::SetComputeRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+  if (Issue(FilterRootArgument(m_computeArgs, rootIndex, RootArgumentType::CBV, address)))
+    m_commandList->SetComputeRootConstantBufferView(rootIndex, address);
+}
+
+void FilteredCommandList::SetComputeRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+  if (Issue(FilterRootArgument(m_computeArgs, rootIndex, RootArgumentType::SRV, address)))
+    m_commandList->SetComputeRootShaderResourceView(rootIndex, address);
+}
+
+void FilteredCommandList::SetComputeRootUnorderedAccessView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+  if (Issue(FilterRootArgument(m_computeArgs, rootIndex, RootArgumentType::UAV, address)))
+    m_commandList->SetComputeRootUnorderedAccessView(rootIndex, address);
+}
+
+void FilteredCommandList::SetComputeRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+  if (Issue(FilterRootArgument(m_computeArgs, rootIndex, RootArgumentType::DescriptorTable, baseDescriptor.ptr)))
+    m_commandList->SetComputeRootDescriptorTable(rootIndex, baseDescriptor);
+}
+
+void FilteredCommandList::ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+  for (UINT i = 0; i < numBarriers; ++i)
+  {
+    const D3D12_RESOURCE_BARRIER& barrier = barriers[i];
+    BatchedBarrier batched = {};
+    batched.flags = barrier.Flags;
+    switch (barrier.Type)
+    {
+    case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+      batched.type = BarrierType::Transition;
+      batched.resource = barrier.Transition.pResource;
+      batched.subresource = barrier.Transition.Subresource;
+      batched.stateBefore = barrier.Transition.StateBefore;
+      batched.stateAfter = barrier.Transition.StateAfter;
+      break;
+
+    case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+      batched.type = BarrierType::Aliasing;
+      batched.resource = barrier.Aliasing.pResourceBefore;
+      batched.resourceAfter = barrier.Aliasing.pResourceAfter;
+      break;
+
+    default:
+      batched.type = BarrierType::Uav;
+      batched.resource = barrier.UAV.pResource;
+      break;
+    }
+    m_barrierBatcher.Add(batched);
+  }
+}
+
+void FilteredCommandList::IssueBarriers()
+{
+  m_barrierBatcher.Flush([this](const BatchedBarrier* batched, uint32_t numBarriers) {
+    m_barriers.resize(numBarriers);
+    for (uint32_t i = 0; i < numBarriers; ++i)
+    {
+      D3D12_RESOURCE_BARRIER& barrier = m_barriers[i];
+      barrier.Flags = static_cast<D3D12_RESOURCE_BARRIER_FLAGS>(batched[i].flags);
+      switch (batched[i].type)
+      {
+      case BarrierType::Transition:
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Transition.pResource = static_cast<ID3D12Resource*>(const_cast<void*>(batched[i].resource));
+        barrier.Transition.Subresource = batched[i].subresource;
+        barrier.Transition.StateBefore = static_cast<D3D12_RESOURCE_STATES>(batched[i].stateBefore);
+        barrier.Transition.StateAfter = static_cast<D3D12_RESOURCE_STATES>(batched[i].stateAfter);
+        break;
+
+      case BarrierType::Aliasing:
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+        barrier.Aliasing.pResourceBefore = static_cast<ID3D12Resource*>(const_cast<void*>(batched[i].resource));
+        barrier.Aliasing.pResourceAfter = static_cast<ID3D12Resource*>(const_cast<void*>(batched[i].resourceAfter));
+        break;
+
+      case BarrierType::Uav:
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+        barrier.UAV.pResource = static_cast<ID3D12Resource*>(const_cast<void*>(batched[i].resource));
+        break;
+      }
+    }
+    m_commandList->ResourceBarrier(numBarriers, m_barriers.data());
+    });
+}
+
+void FilteredCommandList::ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+  ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset, ID3D12Resource* countBuffer, UINT64 countBufferOffset)
+{
+  FlushBarriers();
+  m_commandList->ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer, argumentBufferOffset,
+    countBuffer, countBufferOffset);
+
+  // Which arguments the signature changes isn't known here, so every one it could have is forgotten
+  // (root signatures and PSOs can't be changed by commands):
+  m_graphicsArgs.InvalidateArguments();
+  m_computeArgs.InvalidateArguments();
+  m_vertexBuffersValidMask = 0;
+  m_isIndexBufferValid = false;
+}
+
+bool FilteredCommandList::FilterRootSignature(RootArguments& args, ID3D12RootSignature* rootSignature)
+{
+  if (args.rootSignature == rootSignature)
+    return true;
+
+  // Changing root signature leaves every previously bound root argument undefined:
+  args.rootSignature = rootSignature;
+  args.InvalidateArguments();
+  return false;
+}
+
+bool FilteredCommandList::FilterRootArgument(RootArguments& args, UINT rootIndex, RootArgumentType type, uint64_t value)
+{
+  if (rootIndex >= c_maxRootParameters)
+    return false;
+
+  if (args.types[rootIndex] == type && args.values[rootIndex] == value)
+    return true;
+
+  args.types[rootIndex] = type;
+  args.values[rootIndex] = value;
+  return false;
+}
+
+bool FilteredCommandList::FilterRootConstants(RootArguments& args, UINT rootIndex, UINT num32BitValues,
+  const void* data, UINT destOffset)
+{
+  const uint32_t* values = static_cast<const uint32_t*>(data);
+
+  // Out of the cached range, forward unfiltered but forget anything cached for the overlapping constants:
+  if (rootIndex >= c_maxRootParameters || destOffset + num32BitValues > c_maxCachedConstants)
+  {
+    if (rootIndex < c_maxRootParameters)
+    {
+      for (UINT i = destOffset; i < c_maxCachedConstants && i < destOffset + num32BitValues; ++i)
+        args.constantsValidMask[rootIndex] &= ~(1u << i);
+    }
+
+    Issue(false);
+    if (&args == &m_graphicsArgs)
+      m_commandList->SetGraphicsRoot32BitConstants(rootIndex, num32BitValues, data, destOffset);
+    else
+      m_commandList->SetComputeRoot32BitConstants(rootIndex, num32BitValues, data, destOffset);
+    return false;
+  }
+
+  // Only forward the span of constants that actually changed:
+  UINT firstChanged = num32BitValues;
+  UINT lastChanged = 0;
+
+  for (UINT i = 0; i < num32BitValues; ++i)
+  {
+    const UINT dword = destOffset + i;
+    const bool isCached = (args.constantsValidMask[rootIndex] & (1u << dword)) != 0;
+
+    if (!isCached || args.constants[rootIndex][dword] != values[i])
+    {
+      firstChanged = firstChanged == num32BitValues ? i : firstChanged;
+      lastChanged = i;
+
+      args.constants[rootIndex][dword] = values[i];
+      args.constantsValidMask[rootIndex] |= 1u << dword;
+    }
+  }
+
+  if (!Issue(firstChanged == num32BitValues))
+    return true;
+
+  const UINT numChanged = lastChanged - firstChanged + 1;
+  if (&args == &m_graphicsArgs)
+    m_commandList->SetGraphicsRoot32BitConstants(rootIndex, numChanged, values + firstChanged, destOffset + firstChanged);
+  else
+    m_commandList->SetComputeRoot32BitConstants(rootIndex, numChanged, values + firstChanged, destOffset + firstChanged);
+
+  return false;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "BarrierBatcher.h"
+
+struct CommandListStats
+{
+	uint64_t	stateCallsIssued;			// State-setting calls forwarded to the command list.
+	uint64_t	stateCallsFiltered;		// State-setting calls dropped because the state was already bound.
+};
+
+// Thin recording wrapper around ID3D12GraphicsCommandList2 that remembers the currently bound state and
+// drops state-setting calls which wouldn't change anything before they reach the driver. Only state
+// is filtered, everything else (draws, barriers, clears...) is forwarded as-is, and the raw command
+// list remains available through Get() for anything not wrapped here.
+//
+// Mirrors the D3D12 rules for state inheritance: setting a root signature invalidates every root
+// argument bound for it, and setting descriptor heaps invalidates bound descriptor tables.
+//
+// Barriers are batched rather than forwarded, and issued together before the next command that could
+// depend on them, so FlushBarriers() has to be called before closing the command list (or recording into
+// it directly).
+class FilteredCommandList
+{
+public:
+	FilteredCommandList();
+
+	// Starts filtering a command list that has just been reset (i.e. has default state), initialPso
+	// being the pipeline state the list was reset with:
+	void Begin(ID3D12GraphicsCommandList2* commandList, ID3D12PipelineState* initialPso = nullptr);
+
+	// Forgets all cached state, call after recording state changes through the raw command list
+	// (e.g. executing a bundle) so the next calls aren't wrongly filtered:
+	void InvalidateState();
+
+	ID3D12GraphicsCommandList2*	Get() const { return m_commandList; }
+	const CommandListStats&			GetStats() const { return m_stats; }
+	void												ResetStats() { m_stats = {}; }
+
+	// Filtered state:
+	void SetPipelineState(ID3D12PipelineState* pipelineState);
+	void SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps);
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+	void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views);
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view);
+	void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports);
+	void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects);
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature);
+	void SetGraphicsRoot32BitConstant(UINT rootIndex, UINT value, UINT destOffset);
+	void SetGraphicsRoot32BitConstants(UINT rootIndex, UINT num32BitValues, const void* data, UINT destOffset);
+	void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetGraphicsRootUnorderedAccessView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+
+	void SetComputeRootSignature(ID3D12RootSignature* rootSignature);
+	void SetComputeRoot32BitConstant(UINT rootIndex, UINT value, UINT destOffset);
+	void SetComputeRoot32BitConstants(UINT rootIndex, UINT num32BitValues, const void* data, UINT destOffset);
+	void SetComputeRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetComputeRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetComputeRootUnorderedAccessView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetComputeRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+
+	// Batched:
+	void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers);
+
+	void FlushBarriers()
+	{
+		if (!m_barrierBatcher.IsEmpty())
+			IssueBarriers();
+	}
+
+	const BarrierBatchStats&		GetBarrierStats() const { return m_barrierBatcher.GetStats(); }
+	void												ResetBarrierStats() { m_barrierBatcher.ResetStats(); }
+
+	// Forwarded unfiltered, after any batched barriers:
+	void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colour[4], UINT numRects, const D3D12_RECT* rects)
+	{
+		FlushBarriers();
+		m_commandList->ClearRenderTargetView(rtv, colour, numRects, rects);
+	}
+
+	void OMSetRenderTargets(UINT numRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, BOOL singleHandleToRange,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+	{
+		m_commandList->OMSetRenderTargets(numRTVs, rtvs, singleHandleToRange, dsv);
+	}
+
+	void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)
+	{
+		FlushBarriers();
+		m_commandList->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+	}
+
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+	{
+		FlushBarriers();
+		m_commandList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	void Dispatch(UINT x, UINT y, UINT z)
+	{
+		FlushBarriers();
+		m_commandList->Dispatch(x, y, z);
+	}
+
+	void CopyBufferRegion(ID3D12Resource* dest, UINT64 destOffset, ID3D12Resource* source, UINT64 sourceOffset, UINT64 numBytes)
+	{
+		FlushBarriers();
+		m_commandList->CopyBufferRegion(dest, destOffset, source, sourceOffset, numBytes);
+	}
+
+	void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dest, UINT destX, UINT destY, UINT destZ,
+		const D3D12_TEXTURE_COPY_LOCATION* source, const D3D12_BOX* sourceBox)
+	{
+		FlushBarriers();
+		m_commandList->CopyTextureRegion(dest, destX, destY, destZ, source, sourceBox);
+	}
+
+	void EndQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT index)
+	{
+		FlushBarriers();
+		m_commandList->EndQuery(queryHeap, type, index);
+	}
+
+	void ResolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT startIndex, UINT numQueries,
+		ID3D12Resource* dest, UINT64 destOffset)
+	{
+		FlushBarriers();
+		m_commandList->ResolveQueryData(queryHeap, type, startIndex, numQueries, dest, destOffset);
+	}
+
+	// Commands can set root arguments and vertex/index buffers, which are left undefined afterwards, so
+	// those are forgotten:
+	void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount, ID3D12Resource* argumentBuffer,
+		UINT64 argumentBufferOffset, ID3D12Resource* countBuffer, UINT64 countBufferOffset);
+
+private:
+	static const UINT c_maxRootParameters				= 64;
+	static const UINT c_maxCachedConstants			= 16;		// Larger root constant ranges are forwarded unfiltered.
+	static const UINT c_maxVertexBuffers				= D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+	static const UINT c_maxViewports						= D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+
+	enum class RootArgumentType : uint8_t
+	{
+		Unset,
+		CBV,
+		SRV,
+		UAV,
+		DescriptorTable,
+	};
+
+	// Root arguments are tracked separately for the graphics and compute bind points:
+	struct RootArguments
+	{
+		ID3D12RootSignature*	rootSignature;
+		RootArgumentType			types[c_maxRootParameters];
+		uint64_t							values[c_maxRootParameters];		// GPU virtual address or descriptor handle.
+		uint16_t							constantsValidMask[c_maxRootParameters];
+		uint32_t							constants[c_maxRootParameters][c_maxCachedConstants];
+
+		void InvalidateArguments();
+		void InvalidateDescriptorTables();
+	};
+
+	void IssueBarriers();
+
+	bool FilterRootSignature(RootArguments& args, ID3D12RootSignature* rootSignature);
+	bool FilterRootArgument(RootArguments& args, UINT rootIndex, RootArgumentType type, uint64_t value);
+	bool FilterRootConstants(RootArguments& args, UINT rootIndex, UINT num32BitValues, const void* data, UINT destOffset);
+
+	// Returns whether the call should be issued, updating stats accordingly:
+	bool Issue(bool isRedundant)
+	{
+		if (isRedundant)
+			++m_stats.stateCallsFiltered;
+		else
+			++m_stats.stateCallsIssued;
+
+		return !isRedundant;
+	}
+
+	ID3D12GraphicsCommandList2*	m_commandList;
+	CommandListStats						m_stats;
+
+	BarrierBatcher											m_barrierBatcher;
+	std::vector<D3D12_RESOURCE_BARRIER>	m_barriers;				// Scratch for issuing a batch.
+
+	ID3D12PipelineState*				m_pipelineState;
+	UINT												m_numDescriptorHeaps;
+	ID3D12DescriptorHeap*				m_descriptorHeaps[2];		// At most one CBV/SRV/UAV heap and one sampler heap.
+	D3D12_PRIMITIVE_TOPOLOGY		m_primitiveTopology;
+
+	uint32_t										m_vertexBuffersValidMask;
+	D3D12_VERTEX_BUFFER_VIEW		m_vertexBuffers[c_maxVertexBuffers];
+	bool												m_isIndexBufferValid;
+	D3D12_INDEX_BUFFER_VIEW			m_indexBuffer;
+
+	UINT												m_numViewports;					// ~0u when unknown.
+	D3D12_VIEWPORT							m_viewports[c_maxViewports];
+	UINT												m_numScissorRects;			// As above.
+	D3D12_RECT									m_scissorRects[c_maxViewports];
+
+	RootArguments								m_graphicsArgs;
+	RootArguments								m_computeArgs;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash map keyed by 64-bit integers. Slots live in a single contiguous array
+// with a power-of-two capacity and linear probing, so a lookup is a hash, a mask and (usually)
+// a single cache line read. Intended for hot-path lookups keyed by packed bits, e.g. shader
+// permutation keys or root signature hashes. Entries are never erased, only cleared in bulk.
+template<typename Value>
+class FlatHashMap
+{
+public:
+	explicit FlatHashMap(size_t initialCapacity = 16)
+		: m_size(0)
+	{
+		size_t capacity = 16;
+		while (capacity < initialCapacity)
+			capacity <<= 1;
+
+		m_slots.resize(capacity);
+		m_mask = capacity - 1;
+	}
+
+	Value* Find(uint64_t key)
+	{
+		for (size_t i = Hash(key) & m_mask; ; i = (i + 1) & m_mask)
+		{
+			Slot& slot = m_slots[i];
+			if (!slot.occupied)
+				return nullptr;
+			if (slot.key == key)
+				return &slot.value;
+		}
+	}
+
+	const Value* Find(uint64_t key) const
+	{
+		return const_cast<FlatHashMap*>(this)->Find(key);
+	}
+
+	// Inserts value under key, overwriting any existing entry:
+	Value& Insert(uint64_t key, Value value)
+	{
+		// Keep load factor at or below 50% so probe sequences stay short:
+		if ((m_size + 1) * 2 > m_slots.size())
+			Grow();
+
+		Slot& slot = FindSlot(key);
+		if (!slot.occupied)
+		{
+			slot.occupied = true;
+			slot.key = key;
+			++m_size;
+		}
+		slot.value = std::move(value);
+
+		return slot.value;
+	}
+
+	void Clear()
+	{
+		for (Slot& slot : m_slots)
+			slot = Slot();
+		m_size = 0;
+	}
+
+	size_t Size() const { return m_size; }
+	size_t Capacity() const { return m_slots.size(); }
+
+	template<typename Func>
+	void ForEach(Func&& func)
+	{
+		for (Slot& slot : m_slots)
+		{
+			if (slot.occupied)
+				func(slot.key, slot.value);
+		}
+	}
+
+private:
+	struct Slot
+	{
+		uint64_t	key = 0;
+		Value			value = Value();
+		bool			occupied = false;
+	};
+
+	// SplitMix64 finaliser, packed keys tend to have most of their entropy in the low bits:
+	static uint64_t Hash(uint64_t key)
+	{
+		key ^= key >> 30;
+		key *= 0xbf58476d1ce4e5b9ull;
+		key ^= key >> 27;
+		key *= 0x94d049bb133111ebull;
+		key ^= key >> 31;
+		return key;
+	}
+
+	Slot& FindSlot(uint64_t key)
+	{
+		for (size_t i = Hash(key) & m_mask; ; i = (i + 1) & m_mask)
+		{
+			Slot& slot = m_slots[i];
+			if (!slot.occupied || slot.key == key)
+				return slot;
+		}
+	}
+
+	void Grow()
+	{
+		std::vector<Slot> oldSlots(m_slots.size() * 2);
+		oldSlots.swap(m_slots);
+		m_mask = m_slots.size() - 1;
+
+		for (Slot& oldSlot : oldSlots)
+		{
+			if (oldSlot.occupied)
+				FindSlot(oldSlot.key) = std::move(oldSlot);
+		}
+	}
+
+	std::vector<Slot>	m_slots;
+	size_t						m_size;
+	size_t						m_mask;
+};
@@ -0,0 +1,115 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cassert>
+
+LinearArena::LinearArena(size_t chunkSize)
+  : m_chunkSize(chunkSize)
+  , m_currentChunk(0)
+  , m_current(nullptr)
+  , m_end(nullptr)
+  , m_bytesAllocated(0)
+  , m_highWaterMark(0)
+  , m_bytesReserved(0)
+{
+}
+
+void LinearArena::Reset()
+{
+  m_highWaterMark = std::max(m_highWaterMark, m_bytesAllocated);
+  m_bytesAllocated = 0;
+  m_currentChunk = 0;
+  m_current = m_chunks.empty() ? nullptr : m_chunks[0].memory.get();
+  m_end = m_chunks.empty() ? nullptr : m_current + m_chunks[0].size;
+}
+
+LinearArenaStats LinearArena::GetStats() const
+{
+  LinearArenaStats stats;
+  stats.bytesAllocated = m_bytesAllocated;
+  stats.highWaterMark = std::max(m_highWaterMark, m_bytesAllocated);
+  stats.bytesReserved = m_bytesReserved;
+  stats.numChunks = static_cast<uint32_t>(m_chunks.size());
+  return stats;
+}
+
+void* LinearArena::AllocateFromNextChunk(size_t size, size_t alignment)
+{
+  assert((alignment & (alignment - 1)) == 0 && "Alignment must be a power of two!");
+
+  // Whatever's left of the current chunk goes unused until the next Reset(). Chunks kept from earlier
+  // frames are reused in order, skipping any too small for this allocation:
+  m_bytesAllocated += m_end - m_current;
+  const size_t worstCaseSize = size + alignment - 1;
+  size_t next = m_current ? m_currentChunk + 1 : 0;
+  while (next < m_chunks.size() && m_chunks[next].size < worstCaseSize)
+  {
+    m_bytesAllocated += m_chunks[next].size;
+    ++next;
+  }
+
+  // Only grows until the arena has seen its biggest frame. Oversized allocations get a chunk to
+  // themselves, which is kept for next time too:
+  if (next == m_chunks.size())
+  {
+    Chunk chunk;
+    chunk.size = std::max(m_chunkSize, worstCaseSize);
+    chunk.memory.reset(new uint8_t[chunk.size]);
+    chunk.tracked = TrackedAllocation(MemoryCategory::CpuArenas, chunk.size);
+    m_bytesReserved += chunk.size;
+    m_chunks.push_back(std::move(chunk));
+  }
+
+  m_currentChunk = next;
+  m_current = m_chunks[next].memory.get();
+  m_end = m_current + m_chunks[next].size;
+
+  void* allocation = Allocate(size, alignment);
+  assert(allocation && "A fresh chunk always fits the allocation!");
+  return allocation;
+}
+
+FrameArenas::FrameArenas(uint32_t numFrames, uint32_t numThreads, size_t chunkSize)
+  : m_numFrames(numFrames)
+  , m_numThreads(numThreads)
+  , m_currentFrame(0)
+  , m_highWaterMark(0)
+{
+  m_arenas.reserve(numFrames * numThreads);
+  for (uint32_t i = 0; i < numFrames * numThreads; ++i)
+    m_arenas.push_back(std::make_unique<LinearArena>(chunkSize));
+}
+
+void FrameArenas::BeginFrame(uint32_t frameIndex)
+{
+  assert(frameIndex < m_numFrames);
+
+  // The frame that last used this slot is complete, so it's the one that can have set a new peak:
+  m_highWaterMark = std::max(m_highWaterMark, GetBytesAllocated(frameIndex));
+
+  m_currentFrame = frameIndex;
+  for (uint32_t thread = 0; thread < m_numThreads; ++thread)
+    m_arenas[frameIndex * m_numThreads + thread]->Reset();
+}
+
+FrameArenaStats FrameArenas::GetStats() const
+{
+  FrameArenaStats stats = {};
+  stats.bytesAllocated = GetBytesAllocated(m_currentFrame);
+  stats.highWaterMark = std::max(m_highWaterMark, stats.bytesAllocated);
+  for (const std::unique_ptr<LinearArena>& arena : m_arenas)
+  {
+    const LinearArenaStats arenaStats = arena->GetStats();
+    stats.bytesReserved += arenaStats.bytesReserved;
+    stats.numChunks += arenaStats.numChunks;
+  }
+  return stats;
+}
+
+uint64_t FrameArenas::GetBytesAllocated(uint32_t frameIndex) const
+{
+  uint64_t bytesAllocated = 0;
+  for (uint32_t thread = 0; thread < m_numThreads; ++thread)
+    bytesAllocated += m_arenas[frameIndex * m_numThreads + thread]->GetStats().bytesAllocated;
+  return bytesAllocated;
+}
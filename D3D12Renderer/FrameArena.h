@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MemoryTracker.h"
+
+struct LinearArenaStats
+{
+	uint64_t	bytesAllocated;		// Since the last Reset(), alignment padding included.
+	uint64_t	highWaterMark;		// Most bytes allocated between two Reset()s.
+	uint64_t	bytesReserved;		// Held in chunks, which are kept across Reset()s.
+	uint32_t	numChunks;
+};
+
+// Bump allocator for data that all dies at once. Allocations are carved out of chunks in order and
+// never freed individually, Reset() frees everything by rewinding to the first chunk. Chunks are kept,
+// so once an arena has grown to fit the biggest workload it sees, it stops touching the heap.
+//
+// Not thread-safe, use one per thread.
+class LinearArena
+{
+public:
+	static const size_t c_defaultChunkSize = 256 * 1024;
+
+	explicit LinearArena(size_t chunkSize = c_defaultChunkSize);
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	// alignment must be a power of two:
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template<typename T>
+	T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+	// O(1), invalidates everything allocated so far:
+	void Reset();
+
+	LinearArenaStats GetStats() const;
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<uint8_t[]>	memory;
+		size_t						size;
+		TrackedAllocation			tracked;		// As MemoryCategory::CpuArenas.
+	};
+
+	void* AllocateFromNextChunk(size_t size, size_t alignment);
+
+	std::vector<Chunk>	m_chunks;
+	size_t				m_chunkSize;
+	size_t				m_currentChunk;
+	uint8_t*			m_current;				// Next free byte in m_chunks[m_currentChunk]...
+	uint8_t*			m_end;					// ...and the end of it.
+	uint64_t			m_bytesAllocated;
+	uint64_t			m_highWaterMark;		// Of previous Reset()s.
+	uint64_t			m_bytesReserved;
+};
+
+inline void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	const uintptr_t current = reinterpret_cast<uintptr_t>(m_current);
+	const uintptr_t aligned = (current + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+	if (m_current && aligned + size <= reinterpret_cast<uintptr_t>(m_end))
+	{
+		m_bytesAllocated += aligned + size - current;
+		m_current = reinterpret_cast<uint8_t*>(aligned + size);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	return AllocateFromNextChunk(size, alignment);
+}
+
+// Standard allocator over a LinearArena, so STL containers can live in one. Deallocation does nothing,
+// the memory comes back when the arena is reset, so containers must not outlive that. Without an arena
+// it falls back to the heap, which lets functions take an optional arena for their scratch containers.
+template<typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	ArenaAllocator(LinearArena* arena = nullptr) noexcept : m_arena(arena) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.GetArena()) {}
+
+	T* allocate(size_t count)
+	{
+		if (!m_arena)
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		return m_arena->AllocateArray<T>(count);
+	}
+
+	void deallocate(T* pointer, size_t /*count*/) noexcept
+	{
+		if (!m_arena)
+			::operator delete(pointer);
+	}
+
+	LinearArena* GetArena() const { return m_arena; }
+
+private:
+	LinearArena*	m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() == b.GetArena(); }
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() != b.GetArena(); }
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+struct FrameArenaStats
+{
+	uint64_t	bytesAllocated;		// By the current frame so far, all threads together.
+	uint64_t	highWaterMark;		// Most bytes allocated by a single frame.
+	uint64_t	bytesReserved;		// Held by every arena.
+	uint32_t	numChunks;
+};
+
+// Per-frame, per-thread arenas for transient CPU data (draw lists, barriers, culling output, strings),
+// so a frame doesn't go through the global heap. There's a set of arenas per frame in flight, reset
+// when its slot comes round again, so data allocated in a frame stays valid until g_numFrames frames
+// later, e.g. while the GPU may still be reading from the frame.
+class FrameArenas
+{
+public:
+	FrameArenas(uint32_t numFrames, uint32_t numThreads, size_t chunkSize = LinearArena::c_defaultChunkSize);
+
+	// At the start of a frame, once everything from the frame that last used this slot is done with:
+	void BeginFrame(uint32_t frameIndex);
+
+	// The current frame's arena for a thread, threadIndex being JobSystem::CurrentThreadIndex():
+	LinearArena& Get(uint32_t threadIndex) { return *m_arenas[m_currentFrame * m_numThreads + threadIndex]; }
+
+	uint32_t NumThreads() const { return m_numThreads; }
+
+	FrameArenaStats GetStats() const;
+
+private:
+	uint64_t GetBytesAllocated(uint32_t frameIndex) const;
+
+	std::vector<std::unique_ptr<LinearArena>>	m_arenas;			// m_numThreads per frame.
+	uint32_t									m_numFrames;
+	uint32_t									m_numThreads;
+	uint32_t									m_currentFrame;
+	uint64_t									m_highWaterMark;	// Of the frames already recycled.
+};
@@ -0,0 +1,87 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+
+namespace
+{
+  // Frames submitted without ever hearing back, e.g. while timings aren't available, are forgotten
+  // past this many rather than growing the model forever:
+  const size_t c_maxSubmittedFrames = 8;
+}
+
+FramePacer::FramePacer(const FramePacerSettings& settings)
+  : m_settings(settings)
+{
+  Reset();
+}
+
+void FramePacer::OnFrameStart(uint64_t frameId, uint64_t timeUs)
+{
+  m_frameId = frameId;
+  m_frameStartUs = timeUs;
+}
+
+void FramePacer::OnFrameSubmitted(uint64_t frameId, uint64_t timeUs)
+{
+  if (frameId == m_frameId && timeUs >= m_frameStartUs)
+    Smooth(m_cpuFrameTimeUs, static_cast<float>(timeUs - m_frameStartUs));
+
+  if (m_submittedFrames.size() == c_maxSubmittedFrames)
+    m_submittedFrames.pop_front();
+  m_submittedFrames.push_back({ frameId, timeUs });
+}
+
+void FramePacer::OnGpuFrameCompleted(uint64_t frameId, uint64_t gpuStartUs, uint64_t gpuEndUs)
+{
+  if (gpuEndUs >= gpuStartUs)
+    Smooth(m_gpuFrameTimeUs, static_cast<float>(gpuEndUs - gpuStartUs));
+
+  // Completions can be reported out of order, only ever move forwards:
+  if (!m_hasCompletedFrame || frameId > m_lastCompletedFrameId)
+  {
+    m_hasCompletedFrame = true;
+    m_lastCompletedFrameId = frameId;
+    m_lastGpuEndUs = std::max(m_lastGpuEndUs, gpuEndUs);
+  }
+
+  while (!m_submittedFrames.empty() && m_submittedFrames.front().frameId <= frameId)
+    m_submittedFrames.pop_front();
+}
+
+uint64_t FramePacer::PredictGpuIdleTime(uint64_t nowUs) const
+{
+  // The oldest outstanding frame can't have started before the last measured one ended, and when it's
+  // been running for longer than predicted it's still assumed to be a moment from done:
+  uint64_t idleUs = m_lastGpuEndUs;
+  for (const SubmittedFrame& frame : m_submittedFrames)
+    idleUs = std::max(idleUs, frame.submitUs) + static_cast<uint64_t>(m_gpuFrameTimeUs);
+
+  return std::max(idleUs, nowUs);
+}
+
+uint64_t FramePacer::GetFrameStartTime(uint64_t nowUs) const
+{
+  if (m_gpuFrameTimeUs <= 0.0f)
+    return nowUs;
+
+  const uint64_t idleUs = PredictGpuIdleTime(nowUs);
+  const uint64_t leadUs = static_cast<uint64_t>(m_cpuFrameTimeUs) + m_settings.safetyMarginUs;
+  return (idleUs > nowUs + leadUs) ? idleUs - leadUs : nowUs;
+}
+
+void FramePacer::Reset()
+{
+  m_submittedFrames.clear();
+  m_frameId = 0;
+  m_frameStartUs = 0;
+  m_lastGpuEndUs = 0;
+  m_lastCompletedFrameId = 0;
+  m_hasCompletedFrame = false;
+  m_cpuFrameTimeUs = 0.0f;
+  m_gpuFrameTimeUs = 0.0f;
+}
+
+void FramePacer::Smooth(float& smoothed, float sample) const
+{
+  smoothed = (smoothed <= 0.0f) ? sample : smoothed + m_settings.smoothing * (sample - smoothed);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+struct FramePacerSettings
+{
+	uint32_t	safetyMarginUs = 1000;		// Slack left so a slightly slow CPU frame doesn't starve the GPU.
+	float			smoothing = 0.1f;					// Weight of each new sample in the smoothed CPU/GPU frame times.
+};
+
+// Low-latency pacing: predicts when the GPU will have finished everything submitted so far, and starts
+// the next frame just early enough for its submission to land then. Frames started any earlier only
+// wait in the GPU's queue, so the input they sampled is older by the time it's shown; started later,
+// the GPU sits idle.
+//
+// The prediction runs the submitted frames through a model of the GPU: each starts once it's been
+// submitted and the frame before it is done, and takes the smoothed GPU frame time. Measured GPU
+// completions replace the model's guesses as they come in.
+//
+// Times are microseconds on one clock, GPU timestamps having to be converted to it.
+class FramePacer
+{
+public:
+	explicit FramePacer(const FramePacerSettings& settings = FramePacerSettings());
+
+	void OnFrameStart(uint64_t frameId, uint64_t timeUs);
+	void OnFrameSubmitted(uint64_t frameId, uint64_t timeUs);
+	void OnGpuFrameCompleted(uint64_t frameId, uint64_t gpuStartUs, uint64_t gpuEndUs);
+
+	// When the GPU is expected to go idle, nowUs if it already has:
+	uint64_t PredictGpuIdleTime(uint64_t nowUs) const;
+
+	// When to start the next frame, never before nowUs. Until there are timings to go on, that's now:
+	uint64_t GetFrameStartTime(uint64_t nowUs) const;
+
+	float GetCpuFrameTimeUs() const { return m_cpuFrameTimeUs; }
+	float GetGpuFrameTimeUs() const { return m_gpuFrameTimeUs; }
+
+	void Reset();
+
+private:
+	struct SubmittedFrame
+	{
+		uint64_t	frameId;
+		uint64_t	submitUs;
+	};
+
+	void Smooth(float& smoothed, float sample) const;
+
+	FramePacerSettings			m_settings;
+	std::deque<SubmittedFrame>	m_submittedFrames;		// Not yet known to have completed, oldest first.
+	uint64_t					m_frameId;
+	uint64_t					m_frameStartUs;
+	uint64_t					m_lastGpuEndUs;				// Latest measured completion.
+	uint64_t					m_lastCompletedFrameId;
+	bool						m_hasCompletedFrame;
+	float						m_cpuFrameTimeUs;			// 0 until measured.
+	float						m_gpuFrameTimeUs;
+};
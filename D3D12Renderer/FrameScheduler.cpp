@@ -0,0 +1,104 @@
+#include "FrameScheduler.h"
+
+#include <cassert>
+
+FrameScheduler::FrameScheduler(IWaitableSet& waitableSet, Callbacks callbacks)
+  : m_waitableSet(waitableSet)
+  , m_callbacks(std::move(callbacks))
+  , m_frameLatencyWaitable(nullptr)
+  , m_pacingWaitable(nullptr)
+  , m_isPaused(false)
+  , m_pausePollIntervalMs(g_waitInfinite)
+  , m_isContinuous(true)
+  , m_isFrameRequested(false)
+  , m_isFramePaced(false)
+  , m_stats()
+{
+  assert(m_callbacks.pumpMessages && m_callbacks.renderFrame);
+}
+
+void FrameScheduler::SetPaused(bool isPaused, uint32_t pollIntervalMs)
+{
+  m_isPaused = isPaused;
+  m_pausePollIntervalMs = pollIntervalMs;
+}
+
+bool FrameScheduler::RunOnce()
+{
+  // Frame gates are always waited on. The frame latency waitable is only added once there's a frame to
+  // render and every gate has been signalled, since waiting on it consumes the frame it signals. A paced
+  // frame has been through all of that already and only waits for its start time:
+  m_waitHandles.assign(m_frameGates.begin(), m_frameGates.end());
+
+  const bool canStartFrame = !m_isFramePaced && WantsFrame() && m_frameGates.empty();
+  const bool waitsForLatency = canStartFrame && m_frameLatencyWaitable;
+
+  if (m_isFramePaced)
+    m_waitHandles.push_back(m_pacingWaitable);
+  else if (waitsForLatency)
+    m_waitHandles.push_back(m_frameLatencyWaitable);
+
+  // Sleep until woken unless a frame can start right away (or we need to poll whether to unpause):
+  uint32_t timeoutMs = g_waitInfinite;
+  if (m_isPaused && !m_isFramePaced)
+    timeoutMs = m_pausePollIntervalMs;
+  else if (canStartFrame && !waitsForLatency)
+    timeoutMs = 0;
+
+  uint32_t signalledIndex = 0;
+  const WaitResult result = m_waitableSet.Wait(m_waitHandles.data(), static_cast<uint32_t>(m_waitHandles.size()),
+    timeoutMs, signalledIndex);
+
+  switch (result)
+  {
+  case WaitResult::Messages:
+    ++m_stats.messageWakeups;
+    return m_callbacks.pumpMessages();
+
+  case WaitResult::Signalled:
+    if (signalledIndex < m_frameGates.size())
+    {
+      ++m_stats.gateWakeups;
+      m_frameGates.erase(m_frameGates.begin() + signalledIndex);
+    }
+    else if (m_isFramePaced)
+    {
+      m_isFramePaced = false;
+      RenderFrame();
+    }
+    else
+      StartFrame();
+    break;
+
+  case WaitResult::Timeout:
+    if (m_isPaused)
+    {
+      ++m_stats.timeoutWakeups;
+      if (m_callbacks.pollPaused && m_callbacks.pollPaused())
+        m_isPaused = false;
+    }
+    else if (canStartFrame)
+      StartFrame();
+    break;
+  }
+
+  return true;
+}
+
+void FrameScheduler::StartFrame()
+{
+  if (m_pacingWaitable && m_callbacks.paceFrame && m_callbacks.paceFrame())
+  {
+    ++m_stats.pacedFrames;
+    m_isFramePaced = true;
+  }
+  else
+    RenderFrame();
+}
+
+void FrameScheduler::RenderFrame()
+{
+  m_isFrameRequested = false;
+  ++m_stats.framesRendered;
+  m_callbacks.renderFrame();
+}
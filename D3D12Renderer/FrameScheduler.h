@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "WaitableSet.h"
+
+struct FrameSchedulerStats
+{
+	uint64_t	framesRendered;
+	uint64_t	messageWakeups;
+	uint64_t	gateWakeups;			// Wakeups caused by a frame gate (e.g. a fence event) being signalled.
+	uint64_t	timeoutWakeups;
+	uint64_t	pacedFrames;			// Frames held back by pacing before they started.
+};
+
+// Event-driven replacement for a PeekMessage busy loop. Each RunOnce() blocks until there's something to
+// do, waiting on window messages, the swap chain's frame latency waitable and any frame gates together:
+//  - Frames are only started once every frame gate has been signalled and the swap chain reports it can
+//    accept another frame, so the thread sleeps instead of spinning on the GPU.
+//  - While paused (minimised/occluded) only messages are waited on, with an optional poll interval to
+//    check whether rendering can resume.
+//  - With continuous rendering off, frames are only rendered on RequestFrame(), e.g. after input or
+//    WM_PAINT, so an idle window costs no CPU at all.
+//  - With pacing, a frame that could start is first offered to paceFrame, which can hold it back until
+//    the pacing waitable (e.g. a timer) is signalled. Messages are still handled meanwhile, so the frame
+//    samples the latest input when it does start.
+class FrameScheduler
+{
+public:
+	struct Callbacks
+	{
+		std::function<bool()>	pumpMessages;		// Processes pending messages, returns false once the app should quit.
+		std::function<void()>	renderFrame;
+		std::function<bool()>	pollPaused;			// Optional, called every pause poll interval, returns true to resume.
+		std::function<bool()>	paceFrame;			// Optional, returns true once it's armed the pacing waitable to delay the frame.
+	};
+
+	FrameScheduler(IWaitableSet& waitableSet, Callbacks callbacks);
+
+	// Signalled by the swap chain whenever it can accept another frame (IDXGISwapChain2::GetFrameLatencyWaitableObject).
+	// Without one, frames start as soon as the gates allow:
+	void SetFrameLatencyWaitable(WaitableHandle waitable) { m_frameLatencyWaitable = waitable; }
+
+	// Holds back the next frame until the waitable is signalled, e.g. a fence event set to fire when the
+	// GPU has finished with the next back buffer:
+	void AddFrameGate(WaitableHandle waitable) { m_frameGates.push_back(waitable); }
+
+	// Waited on by frames paceFrame holds back. The frame latency waitable has already been consumed by
+	// then, so a paced frame is rendered once it's signalled even if paused in the meantime:
+	void SetPacingWaitable(WaitableHandle waitable) { m_pacingWaitable = waitable; }
+
+	void SetPaused(bool isPaused, uint32_t pollIntervalMs = g_waitInfinite);
+	void SetContinuousRendering(bool isContinuous) { m_isContinuous = isContinuous; }
+	void RequestFrame() { m_isFrameRequested = true; }
+
+	bool IsPaused() const { return m_isPaused; }
+	const FrameSchedulerStats& GetStats() const { return m_stats; }
+
+	// Waits for and handles a single event, returns false once the app should quit:
+	bool RunOnce();
+	void Run() { while (RunOnce()) {} }
+
+private:
+	bool WantsFrame() const { return !m_isPaused && (m_isContinuous || m_isFrameRequested); }
+	void StartFrame();
+	void RenderFrame();
+
+	IWaitableSet&								m_waitableSet;
+	Callbacks										m_callbacks;
+	WaitableHandle							m_frameLatencyWaitable;
+	WaitableHandle							m_pacingWaitable;
+	std::vector<WaitableHandle>	m_frameGates;
+	std::vector<WaitableHandle>	m_waitHandles;					// Scratch, reused every RunOnce().
+
+	bool												m_isPaused;
+	uint32_t										m_pausePollIntervalMs;
+	bool												m_isContinuous;
+	bool												m_isFrameRequested;
+	bool												m_isFramePaced;					// A frame is waiting on the pacing waitable.
+	FrameSchedulerStats					m_stats;
+};
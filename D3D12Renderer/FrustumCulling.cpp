@@ -0,0 +1,383 @@
+#include "FrustumCulling.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX12_CULLING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define DX12_CULLING_X86 0
+#endif
+
+// MSVC lets any function use any intrinsic, GCC/Clang need AVX2 enabled per function so the rest of the
+// file still runs on CPUs without it:
+#if DX12_CULLING_X86 && !defined(_MSC_VER)
+#define DX12_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DX12_TARGET_AVX2
+#endif
+
+namespace
+{
+  // Objects per job in CullFrustumParallel, big enough to amortise scheduling, small enough to balance:
+  const uint32_t c_parallelChunkSize = 16 * 1024;
+
+  uint32_t AlignUp(uint32_t value, uint32_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  void NormalisePlane(float plane[4])
+  {
+    const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    const float invLength = (length > 0.0f) ? 1.0f / length : 0.0f;
+    for (int i = 0; i < 4; ++i)
+      plane[i] *= invLength;
+  }
+
+  // A box is visible unless it's entirely behind one of the planes. Its projected radius onto a plane's
+  // normal is dot(|n|, extents):
+  uint32_t CullScalar(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end,
+    uint32_t* visibleIndices)
+  {
+    uint32_t numVisible = 0;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+      bool isVisible = true;
+      for (const float* plane : frustum.planes)
+      {
+        const float distance = plane[0] * bounds.CenterX()[i] + plane[1] * bounds.CenterY()[i] +
+          plane[2] * bounds.CenterZ()[i] + plane[3];
+        const float radius = std::fabs(plane[0]) * bounds.ExtentX()[i] + std::fabs(plane[1]) * bounds.ExtentY()[i] +
+          std::fabs(plane[2]) * bounds.ExtentZ()[i];
+
+        if (distance + radius < 0.0f)
+        {
+          isVisible = false;
+          break;
+        }
+      }
+
+      if (isVisible)
+        visibleIndices[numVisible++] = i;
+    }
+    return numVisible;
+  }
+
+#if DX12_CULLING_X86
+  uint32_t CullSSE(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end,
+    uint32_t* visibleIndices)
+  {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    __m128 planeX[Frustum::Plane_Count], planeY[Frustum::Plane_Count], planeZ[Frustum::Plane_Count];
+    __m128 planeD[Frustum::Plane_Count];
+    __m128 absX[Frustum::Plane_Count], absY[Frustum::Plane_Count], absZ[Frustum::Plane_Count];
+    for (int p = 0; p < Frustum::Plane_Count; ++p)
+    {
+      planeX[p] = _mm_set1_ps(frustum.planes[p][0]);
+      planeY[p] = _mm_set1_ps(frustum.planes[p][1]);
+      planeZ[p] = _mm_set1_ps(frustum.planes[p][2]);
+      planeD[p] = _mm_set1_ps(frustum.planes[p][3]);
+      absX[p] = _mm_andnot_ps(signMask, planeX[p]);
+      absY[p] = _mm_andnot_ps(signMask, planeY[p]);
+      absZ[p] = _mm_andnot_ps(signMask, planeZ[p]);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const uint32_t paddedEnd = AlignUp(end, 4);
+    uint32_t numVisible = 0;
+
+    for (uint32_t i = begin; i < paddedEnd; i += 4)
+    {
+      const __m128 centerX = _mm_loadu_ps(bounds.CenterX() + i);
+      const __m128 centerY = _mm_loadu_ps(bounds.CenterY() + i);
+      const __m128 centerZ = _mm_loadu_ps(bounds.CenterZ() + i);
+      const __m128 extentX = _mm_loadu_ps(bounds.ExtentX() + i);
+      const __m128 extentY = _mm_loadu_ps(bounds.ExtentY() + i);
+      const __m128 extentZ = _mm_loadu_ps(bounds.ExtentZ() + i);
+
+      // All lanes start visible, every plane can only clear them. NaN padding fails the compare:
+      __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (int p = 0; p < Frustum::Plane_Count; ++p)
+      {
+        __m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], centerX), planeD[p]);
+        distance = _mm_add_ps(distance, _mm_mul_ps(planeY[p], centerY));
+        distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[p], centerZ));
+
+        __m128 radius = _mm_mul_ps(absX[p], extentX);
+        radius = _mm_add_ps(radius, _mm_mul_ps(absY[p], extentY));
+        radius = _mm_add_ps(radius, _mm_mul_ps(absZ[p], extentZ));
+
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+      }
+
+      // Branchless compaction, every lane's index is written but only visible ones advance the cursor:
+      const int mask = _mm_movemask_ps(visible);
+      for (uint32_t lane = 0; lane < 4; ++lane)
+      {
+        visibleIndices[numVisible] = i + lane;
+        numVisible += (mask >> lane) & 1;
+      }
+    }
+    return numVisible;
+  }
+
+  // For each 8-bit lane mask, the indices of its set lanes packed into the low bytes plus how many there are:
+  struct CompactionTable
+  {
+    uint64_t	lanes[256];
+    uint8_t		counts[256];
+
+    constexpr CompactionTable()
+      : lanes()
+      , counts()
+    {
+      for (uint32_t mask = 0; mask < 256; ++mask)
+      {
+        uint32_t count = 0;
+        for (uint32_t lane = 0; lane < 8; ++lane)
+        {
+          if (mask & (1u << lane))
+            lanes[mask] |= static_cast<uint64_t>(lane) << (8 * count++);
+        }
+        counts[mask] = static_cast<uint8_t>(count);
+      }
+    }
+  };
+
+  constexpr CompactionTable c_compactionTable;
+
+  DX12_TARGET_AVX2 uint32_t CullAVX2(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin,
+    uint32_t end, uint32_t* visibleIndices)
+  {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    __m256 planeX[Frustum::Plane_Count], planeY[Frustum::Plane_Count], planeZ[Frustum::Plane_Count];
+    __m256 planeD[Frustum::Plane_Count];
+    __m256 absX[Frustum::Plane_Count], absY[Frustum::Plane_Count], absZ[Frustum::Plane_Count];
+    for (int p = 0; p < Frustum::Plane_Count; ++p)
+    {
+      planeX[p] = _mm256_set1_ps(frustum.planes[p][0]);
+      planeY[p] = _mm256_set1_ps(frustum.planes[p][1]);
+      planeZ[p] = _mm256_set1_ps(frustum.planes[p][2]);
+      planeD[p] = _mm256_set1_ps(frustum.planes[p][3]);
+      absX[p] = _mm256_andnot_ps(signMask, planeX[p]);
+      absY[p] = _mm256_andnot_ps(signMask, planeY[p]);
+      absZ[p] = _mm256_andnot_ps(signMask, planeZ[p]);
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    const uint32_t paddedEnd = AlignUp(end, CullingBounds::c_blockSize);
+    uint32_t numVisible = 0;
+
+    for (uint32_t i = begin; i < paddedEnd; i += 8)
+    {
+      const __m256 centerX = _mm256_loadu_ps(bounds.CenterX() + i);
+      const __m256 centerY = _mm256_loadu_ps(bounds.CenterY() + i);
+      const __m256 centerZ = _mm256_loadu_ps(bounds.CenterZ() + i);
+      const __m256 extentX = _mm256_loadu_ps(bounds.ExtentX() + i);
+      const __m256 extentY = _mm256_loadu_ps(bounds.ExtentY() + i);
+      const __m256 extentZ = _mm256_loadu_ps(bounds.ExtentZ() + i);
+
+      __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+      for (int p = 0; p < Frustum::Plane_Count; ++p)
+      {
+        __m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], centerX), planeD[p]);
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(planeY[p], centerY));
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(planeZ[p], centerZ));
+
+        __m256 radius = _mm256_mul_ps(absX[p], extentX);
+        radius = _mm256_add_ps(radius, _mm256_mul_ps(absY[p], extentY));
+        radius = _mm256_add_ps(radius, _mm256_mul_ps(absZ[p], extentZ));
+
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+      }
+
+      // Widen the packed lane indices of the visible objects, offset them to object indices and store all
+      // 8 at the cursor, only the first count of them are kept:
+      const int mask = _mm256_movemask_ps(visible);
+      const __m128i packedLanes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&c_compactionTable.lanes[mask]));
+      const __m256i indices = _mm256_add_epi32(_mm256_cvtepu8_epi32(packedLanes), _mm256_set1_epi32(static_cast<int>(i)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(visibleIndices + numVisible), indices);
+      numVisible += c_compactionTable.counts[mask];
+    }
+    return numVisible;
+  }
+
+  bool IsAVX2Supported()
+  {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+      return false;
+
+    // The OS has to save the YMM registers on context switches too:
+    __cpuid(info, 1);
+    const bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+    if (!hasOSXSave || (_xgetbv(0) & 0x6) != 0x6)
+      return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+  }
+#endif
+}
+
+Frustum Frustum::FromViewProjection(const float matrix[16])
+{
+  // Gribb/Hartmann: with clip = v * M each clip coordinate is v dotted with a column of M, and the planes
+  // are sums/differences of those columns:
+  float columns[4][4];
+  for (int column = 0; column < 4; ++column)
+  {
+    for (int row = 0; row < 4; ++row)
+      columns[column][row] = matrix[row * 4 + column];
+  }
+
+  Frustum frustum;
+  for (int i = 0; i < 4; ++i)
+  {
+    frustum.planes[Plane_Left][i] = columns[3][i] + columns[0][i];
+    frustum.planes[Plane_Right][i] = columns[3][i] - columns[0][i];
+    frustum.planes[Plane_Bottom][i] = columns[3][i] + columns[1][i];
+    frustum.planes[Plane_Top][i] = columns[3][i] - columns[1][i];
+    frustum.planes[Plane_Near][i] = columns[2][i];
+    frustum.planes[Plane_Far][i] = columns[3][i] - columns[2][i];
+  }
+
+  for (float* plane : frustum.planes)
+    NormalisePlane(plane);
+
+  return frustum;
+}
+
+uint32_t CullingBounds::Add(const float center[3], const float extents[3])
+{
+  // Grow a whole block at a time, filling it with padding that's culled by every plane:
+  if (m_count == PaddedSize())
+  {
+    const float padding = std::numeric_limits<float>::quiet_NaN();
+    const size_t paddedSize = m_count + c_blockSize;
+    m_centerX.resize(paddedSize, padding);
+    m_centerY.resize(paddedSize, padding);
+    m_centerZ.resize(paddedSize, padding);
+    m_extentX.resize(paddedSize, padding);
+    m_extentY.resize(paddedSize, padding);
+    m_extentZ.resize(paddedSize, padding);
+  }
+
+  const uint32_t index = m_count++;
+  Set(index, center, extents);
+  return index;
+}
+
+void CullingBounds::Set(uint32_t index, const float center[3], const float extents[3])
+{
+  assert(index < m_count);
+
+  m_centerX[index] = center[0];
+  m_centerY[index] = center[1];
+  m_centerZ[index] = center[2];
+  m_extentX[index] = extents[0];
+  m_extentY[index] = extents[1];
+  m_extentZ[index] = extents[2];
+}
+
+void CullingBounds::Clear()
+{
+  m_count = 0;
+  m_centerX.clear();
+  m_centerY.clear();
+  m_centerZ.clear();
+  m_extentX.clear();
+  m_extentY.clear();
+  m_extentZ.clear();
+}
+
+void CullingBounds::Reserve(uint32_t count)
+{
+  const size_t paddedCount = AlignUp(count, c_blockSize);
+  m_centerX.reserve(paddedCount);
+  m_centerY.reserve(paddedCount);
+  m_centerZ.reserve(paddedCount);
+  m_extentX.reserve(paddedCount);
+  m_extentY.reserve(paddedCount);
+  m_extentZ.reserve(paddedCount);
+}
+
+CullingPath GetBestCullingPath()
+{
+#if DX12_CULLING_X86
+  // SSE2 is part of x64, so always there:
+  static const CullingPath s_bestPath = IsAVX2Supported() ? CullingPath::AVX2 : CullingPath::SSE;
+  return s_bestPath;
+#else
+  return CullingPath::Scalar;
+#endif
+}
+
+uint32_t CullFrustum(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end,
+  uint32_t* visibleIndices, CullingPath path)
+{
+  assert(begin % CullingBounds::c_blockSize == 0 && "Culling ranges must start on a block boundary!");
+  assert((end % CullingBounds::c_blockSize == 0 || end == bounds.Size()) && end <= bounds.Size());
+
+  switch (path)
+  {
+#if DX12_CULLING_X86
+  case CullingPath::SSE:
+    return CullSSE(frustum, bounds, begin, end, visibleIndices);
+
+  case CullingPath::AVX2:
+    return CullAVX2(frustum, bounds, begin, end, visibleIndices);
+#endif
+
+  default:
+    return CullScalar(frustum, bounds, begin, end, visibleIndices);
+  }
+}
+
+void CullFrustumParallel(JobSystem& jobSystem, const Frustum& frustum, const CullingBounds& bounds,
+  std::vector<uint32_t>& visibleIndices, CullingPath path, LinearArena* scratchArena)
+{
+  const uint32_t numObjects = bounds.Size();
+  const uint32_t numChunks = (numObjects + c_parallelChunkSize - 1) / c_parallelChunkSize;
+
+  // Each chunk writes its visible indices in place at its own offset, then they're packed together in
+  // order. Only visible indices get moved, so the packing is cheap next to the culling itself:
+  visibleIndices.resize(bounds.PaddedSize());
+  ArenaVector<uint32_t> chunkCounts(numChunks, 0u, scratchArena);
+
+  jobSystem.ParallelFor(numChunks, 1, [&](uint32_t beginChunk, uint32_t endChunk) {
+    for (uint32_t chunk = beginChunk; chunk < endChunk; ++chunk)
+    {
+      const uint32_t begin = chunk * c_parallelChunkSize;
+      const uint32_t end = (numObjects - begin < c_parallelChunkSize) ? numObjects : begin + c_parallelChunkSize;
+      chunkCounts[chunk] = CullFrustum(frustum, bounds, begin, end, visibleIndices.data() + begin, path);
+    }
+    });
+
+  uint32_t numVisible = 0;
+  for (uint32_t chunk = 0; chunk < numChunks; ++chunk)
+  {
+    const uint32_t* chunkIndices = visibleIndices.data() + chunk * c_parallelChunkSize;
+    if (chunkIndices != visibleIndices.data() + numVisible)
+      std::memmove(visibleIndices.data() + numVisible, chunkIndices, chunkCounts[chunk] * sizeof(uint32_t));
+    numVisible += chunkCounts[chunk];
+  }
+
+  visibleIndices.resize(numVisible);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+class LinearArena;
+
+// View frustum as six inward-facing planes (nx, ny, nz, d), a point p is inside a plane when
+// dot(n, p) + d >= 0.
+struct Frustum
+{
+	enum PlaneIndex
+	{
+		Plane_Left,
+		Plane_Right,
+		Plane_Bottom,
+		Plane_Top,
+		Plane_Near,
+		Plane_Far,
+		Plane_Count,
+	};
+
+	float planes[Plane_Count][4];
+
+	// Extracts the planes from a row-major view-projection matrix using the row-vector convention
+	// (i.e. an XMMATRIX, clip = v * M) and D3D's [0, 1] clip space depth:
+	static Frustum FromViewProjection(const float matrix[16]);
+};
+
+// Object bounds as axis-aligned boxes (center and half extents), stored structure-of-arrays so SIMD
+// paths can load 4/8 objects' worth of each component at once. Arrays are padded to a multiple of
+// c_blockSize with NaN entries, which compare as outside every plane, so culling never needs a scalar
+// tail loop.
+class CullingBounds
+{
+public:
+	static const uint32_t c_blockSize = 8;		// Widest SIMD path.
+
+	uint32_t	Add(const float center[3], const float extents[3]);
+	void			Set(uint32_t index, const float center[3], const float extents[3]);
+	void			Clear();
+	void			Reserve(uint32_t count);
+
+	uint32_t	Size() const { return m_count; }
+	uint32_t	PaddedSize() const { return static_cast<uint32_t>(m_centerX.size()); }
+
+	const float* CenterX() const { return m_centerX.data(); }
+	const float* CenterY() const { return m_centerY.data(); }
+	const float* CenterZ() const { return m_centerZ.data(); }
+	const float* ExtentX() const { return m_extentX.data(); }
+	const float* ExtentY() const { return m_extentY.data(); }
+	const float* ExtentZ() const { return m_extentZ.data(); }
+
+private:
+	uint32_t						m_count = 0;
+	std::vector<float>	m_centerX;
+	std::vector<float>	m_centerY;
+	std::vector<float>	m_centerZ;
+	std::vector<float>	m_extentX;
+	std::vector<float>	m_extentY;
+	std::vector<float>	m_extentZ;
+};
+
+enum class CullingPath
+{
+	Scalar,
+	SSE,		// 4 objects per instruction.
+	AVX2,		// 8 objects per instruction.
+};
+
+// Widest path the CPU supports, checked once:
+CullingPath GetBestCullingPath();
+
+// Tests objects [begin, end) against the frustum, writing the indices of the visible ones to
+// visibleIndices in ascending order and returning how many there were. begin must be a multiple of
+// CullingBounds::c_blockSize, and so must end unless it's bounds.Size(). SIMD paths store whole blocks,
+// so visibleIndices needs room for (end - begin) rounded up to a block.
+uint32_t CullFrustum(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end,
+	uint32_t* visibleIndices, CullingPath path);
+
+// Culls all objects in chunks spread across the job system, visibleIndices is resized to fit and
+// returns in ascending order. Per-call scratch comes from scratchArena if there is one (e.g. the
+// calling thread's frame arena), the heap otherwise:
+void CullFrustumParallel(JobSystem& jobSystem, const Frustum& frustum, const CullingBounds& bounds,
+	std::vector<uint32_t>& visibleIndices, CullingPath path, LinearArena* scratchArena = nullptr);
@@ -0,0 +1,271 @@
+#include "GpuDrivenRenderer.h"
+#include "DrawPacketRecorder.h"
+#include "FilteredCommandList.h"
+#include "GpuMemoryTracking.h"
+#include "FrustumCulling.h"
+#include "Helpers.h"
+#include "ShaderCompiler.h"
+#include "UploadBuffer.h"
+
+#include "Dx12Headers/d3dx12.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+static_assert(static_cast<int>(IndirectArgumentType::DrawIndexed) == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED
+  && static_cast<int>(IndirectArgumentType::Constant) == D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT
+  && static_cast<int>(IndirectArgumentType::UAV) == D3D12_INDIRECT_ARGUMENT_TYPE_UNORDERED_ACCESS_VIEW,
+  "IndirectArgumentType must match D3D12_INDIRECT_ARGUMENT_TYPE!");
+static_assert(sizeof(IndirectDrawArguments) == sizeof(D3D12_DRAW_ARGUMENTS)
+  && sizeof(IndirectDrawIndexedArguments) == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS)
+  && sizeof(IndirectDispatchArguments) == sizeof(D3D12_DISPATCH_ARGUMENTS),
+  "Indirect arguments must match their D3D12 layouts!");
+
+namespace
+{
+  const ShaderSourceDesc c_instanceCullingShader = { L"InstanceCulling.hlsl", "CSMain", "cs_5_1" };
+  const uint32_t c_cullingThreadGroupSize = 64;   // THREAD_GROUP_SIZE in InstanceCulling.hlsl.
+  const uint32_t c_notWritten = 0xffffffff;
+
+  // CullingConstants in InstanceCulling.hlsl:
+  struct CullingConstants
+  {
+    float     frustumPlanes[Frustum::Plane_Count][4];
+    uint32_t  numInstances;
+    uint32_t  maxCommands;
+    uint32_t  commandStride;
+    uint32_t  objectIndexOffset;
+    uint32_t  drawArgumentsOffset;
+  };
+
+  Microsoft::WRL::ComPtr<ID3D12CommandSignature> CreateCommandSignature(ID3D12Device2* device,
+    const IndirectCommandLayout& layout, ID3D12RootSignature* rootSignature)
+  {
+    std::vector<D3D12_INDIRECT_ARGUMENT_DESC> arguments(layout.arguments.size());
+    for (size_t i = 0; i < layout.arguments.size(); ++i)
+    {
+      const IndirectArgumentDesc& argument = layout.arguments[i];
+      arguments[i].Type = static_cast<D3D12_INDIRECT_ARGUMENT_TYPE>(argument.type);
+
+      switch (argument.type)
+      {
+      case IndirectArgumentType::Constant:
+        arguments[i].Constant.RootParameterIndex = argument.rootIndex;
+        arguments[i].Constant.DestOffsetIn32BitValues = 0;
+        arguments[i].Constant.Num32BitValuesToSet = argument.num32BitValues;
+        break;
+      case IndirectArgumentType::CBV:
+        arguments[i].ConstantBufferView.RootParameterIndex = argument.rootIndex;
+        break;
+      case IndirectArgumentType::SRV:
+        arguments[i].ShaderResourceView.RootParameterIndex = argument.rootIndex;
+        break;
+      case IndirectArgumentType::UAV:
+        arguments[i].UnorderedAccessView.RootParameterIndex = argument.rootIndex;
+        break;
+      default:
+        break;
+      }
+    }
+
+    D3D12_COMMAND_SIGNATURE_DESC desc = {};
+    desc.ByteStride = layout.byteStride;
+    desc.NumArgumentDescs = static_cast<UINT>(arguments.size());
+    desc.pArgumentDescs = arguments.data();
+
+    // The root signature is only allowed (and required) when commands change root arguments:
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature> commandSignature;
+    DX12_CHECK(device->CreateCommandSignature(&desc, layout.ChangesRootArguments() ? rootSignature : nullptr,
+      IID_PPV_ARGS(&commandSignature)), "Failed to create command signature!");
+
+    return commandSignature;
+  }
+}
+
+GpuDrivenRenderer::GpuDrivenRenderer(ID3D12Device2* device, ShaderCompiler& shaderCompiler,
+  RootSignatureCache& rootSignatures, uint32_t maxInstances, uint32_t maxMeshDraws)
+  : m_device(device)
+  , m_rootSignatures(rootSignatures)
+  , m_maxInstances(maxInstances)
+  , m_maxMeshDraws(maxMeshDraws)
+  , m_numInstances(0)
+  , m_drawPipelineState(nullptr)
+  , m_drawRootSignatureId(g_invalidRootSignatureId)
+{
+  // Culling pipeline, its root signature generated from the shader's bindings like any other:
+  Microsoft::WRL::ComPtr<ID3DBlob> cullingShader = shaderCompiler.CompileOrLoad(c_instanceCullingShader, 0, {});
+  m_cullingRootSignatureId = m_rootSignatures.GetOrCreate({ ReflectShaderBindings(cullingShader.Get(), ShaderStage::Compute) });
+
+  const RootSignatureLayout& cullingLayout = m_rootSignatures.GetLayout(m_cullingRootSignatureId);
+  m_constantsRootIndex = cullingLayout.FindRootIndex("CullingConstants");
+  m_instancesRootIndex = cullingLayout.FindRootIndex("g_instances");
+  m_meshDrawsRootIndex = cullingLayout.FindRootIndex("g_meshDraws");
+  m_commandsRootIndex = cullingLayout.FindRootIndex("g_commands");
+  m_commandCountRootIndex = cullingLayout.FindRootIndex("g_commandCount");
+
+  D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc = {};
+  pipelineDesc.pRootSignature = m_rootSignatures.GetRootSignature(m_cullingRootSignatureId);
+  pipelineDesc.CS = CD3DX12_SHADER_BYTECODE(cullingShader.Get());
+  DX12_CHECK(m_device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(&m_cullingPipelineState)),
+    "Failed to create instance culling pipeline!");
+
+  // Persistent buffers, the command buffer depends on the draw pipeline's command layout so is created by
+  // SetDrawPipeline():
+  m_instanceBufferState = D3D12_RESOURCE_STATE_COPY_DEST;
+  m_meshDrawBufferState = D3D12_RESOURCE_STATE_COPY_DEST;
+  m_commandBufferState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+  m_commandCountBufferState = D3D12_RESOURCE_STATE_COPY_DEST;
+
+  m_instanceBuffer = CreateBuffer(static_cast<uint64_t>(maxInstances) * sizeof(IndirectInstance),
+    D3D12_RESOURCE_FLAG_NONE, m_instanceBufferState, m_instanceBufferMemory);
+  m_meshDrawBuffer = CreateBuffer(static_cast<uint64_t>(maxMeshDraws) * sizeof(IndirectMeshDraw),
+    D3D12_RESOURCE_FLAG_NONE, m_meshDrawBufferState, m_meshDrawBufferMemory);
+  m_commandCountBuffer = CreateBuffer(sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+    m_commandCountBufferState, m_commandCountBufferMemory);
+}
+
+void GpuDrivenRenderer::SetDrawPipeline(ID3D12PipelineState* pipelineState, RootSignatureId rootSignatureId,
+  const char* objectBinding)
+{
+  m_drawPipelineState = pipelineState;
+  m_drawRootSignatureId = rootSignatureId;
+
+  m_commandLayout = BuildIndirectCommandLayout(m_rootSignatures.GetLayout(rootSignatureId), { objectBinding },
+    IndirectArgumentType::DrawIndexed);
+  m_commandSignature = CreateCommandSignature(m_device, m_commandLayout, m_rootSignatures.GetRootSignature(rootSignatureId));
+
+  // Room for every instance being visible:
+  const uint64_t commandBufferSize = static_cast<uint64_t>(m_maxInstances) * m_commandLayout.byteStride;
+  if (!m_commandBuffer || m_commandBuffer->GetDesc().Width < commandBufferSize)
+  {
+    m_commandBufferState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    m_commandBuffer = CreateBuffer(commandBufferSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, m_commandBufferState,
+      m_commandBufferMemory);
+  }
+}
+
+void GpuDrivenRenderer::UpdateInstances(FilteredCommandList& commandList, UploadBuffer& uploadBuffer,
+  uint32_t firstInstance, const IndirectInstance* instances, uint32_t count)
+{
+  assert(firstInstance + count <= m_maxInstances);
+
+  const uint64_t size = static_cast<uint64_t>(count) * sizeof(IndirectInstance);
+  const UploadBuffer::Allocation allocation = uploadBuffer.Allocate(size);
+  memcpy(allocation.cpuAddress, instances, size);
+
+  Transition(commandList, m_instanceBuffer.Get(), m_instanceBufferState, D3D12_RESOURCE_STATE_COPY_DEST);
+  commandList.CopyBufferRegion(m_instanceBuffer.Get(), firstInstance * sizeof(IndirectInstance),
+    uploadBuffer.Resource(), allocation.offset, size);
+}
+
+void GpuDrivenRenderer::UpdateMeshDraws(FilteredCommandList& commandList, UploadBuffer& uploadBuffer,
+  uint32_t firstMeshDraw, const IndirectMeshDraw* meshDraws, uint32_t count)
+{
+  assert(firstMeshDraw + count <= m_maxMeshDraws);
+
+  const uint64_t size = static_cast<uint64_t>(count) * sizeof(IndirectMeshDraw);
+  const UploadBuffer::Allocation allocation = uploadBuffer.Allocate(size);
+  memcpy(allocation.cpuAddress, meshDraws, size);
+
+  Transition(commandList, m_meshDrawBuffer.Get(), m_meshDrawBufferState, D3D12_RESOURCE_STATE_COPY_DEST);
+  commandList.CopyBufferRegion(m_meshDrawBuffer.Get(), firstMeshDraw * sizeof(IndirectMeshDraw),
+    uploadBuffer.Resource(), allocation.offset, size);
+}
+
+void GpuDrivenRenderer::SetNumInstances(uint32_t numInstances)
+{
+  assert(numInstances <= m_maxInstances);
+  m_numInstances = numInstances;
+}
+
+void GpuDrivenRenderer::Cull(FilteredCommandList& commandList, UploadBuffer& uploadBuffer, const Frustum& frustum)
+{
+  assert(m_commandSignature && "SetDrawPipeline() has to be called before culling!");
+
+  // The count is accumulated into, so starts each frame at 0:
+  const UploadBuffer::Allocation zero = uploadBuffer.Allocate(sizeof(uint32_t), sizeof(uint32_t));
+  memset(zero.cpuAddress, 0, sizeof(uint32_t));
+
+  Transition(commandList, m_commandCountBuffer.Get(), m_commandCountBufferState, D3D12_RESOURCE_STATE_COPY_DEST);
+  commandList.CopyBufferRegion(m_commandCountBuffer.Get(), 0, uploadBuffer.Resource(), zero.offset, sizeof(uint32_t));
+
+  Transition(commandList, m_instanceBuffer.Get(), m_instanceBufferState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+  Transition(commandList, m_meshDrawBuffer.Get(), m_meshDrawBufferState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+  Transition(commandList, m_commandBuffer.Get(), m_commandBufferState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+  Transition(commandList, m_commandCountBuffer.Get(), m_commandCountBufferState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+  CullingConstants constants = {};
+  memcpy(constants.frustumPlanes, frustum.planes, sizeof(constants.frustumPlanes));
+  constants.numInstances = m_numInstances;
+  constants.maxCommands = m_maxInstances;
+  constants.commandStride = m_commandLayout.byteStride;
+  constants.objectIndexOffset = m_commandLayout.bindingArguments[0] == IndirectCommandLayout::c_notBound
+    ? c_notWritten : static_cast<uint32_t>(m_commandLayout.GetBindingOffset(0));
+  constants.drawArgumentsOffset = m_commandLayout.GetOperationOffset();
+
+  const UploadBuffer::Allocation constantsAllocation = uploadBuffer.Allocate(sizeof(constants),
+    D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+  memcpy(constantsAllocation.cpuAddress, &constants, sizeof(constants));
+
+  commandList.SetComputeRootSignature(m_rootSignatures.GetRootSignature(m_cullingRootSignatureId));
+  commandList.SetPipelineState(m_cullingPipelineState.Get());
+  commandList.SetComputeRootConstantBufferView(m_constantsRootIndex, constantsAllocation.gpuAddress);
+  commandList.SetComputeRootShaderResourceView(m_instancesRootIndex, m_instanceBuffer->GetGPUVirtualAddress());
+  commandList.SetComputeRootShaderResourceView(m_meshDrawsRootIndex, m_meshDrawBuffer->GetGPUVirtualAddress());
+  commandList.SetComputeRootUnorderedAccessView(m_commandsRootIndex, m_commandBuffer->GetGPUVirtualAddress());
+  commandList.SetComputeRootUnorderedAccessView(m_commandCountRootIndex, m_commandCountBuffer->GetGPUVirtualAddress());
+
+  if (m_numInstances > 0)
+    commandList.Dispatch((m_numInstances + c_cullingThreadGroupSize - 1) / c_cullingThreadGroupSize, 1, 1);
+}
+
+void GpuDrivenRenderer::Draw(FilteredCommandList& commandList, const DrawMesh& mesh)
+{
+  Transition(commandList, m_commandBuffer.Get(), m_commandBufferState, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+  Transition(commandList, m_commandCountBuffer.Get(), m_commandCountBufferState, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+
+  commandList.SetGraphicsRootSignature(m_rootSignatures.GetRootSignature(m_drawRootSignatureId));
+  commandList.SetPipelineState(m_drawPipelineState);
+  commandList.IASetPrimitiveTopology(mesh.topology);
+  commandList.IASetVertexBuffers(0, 1, &mesh.vertexBuffer);
+  commandList.IASetIndexBuffer(&mesh.indexBuffer);
+
+  // However many commands culling wrote, up to one per instance:
+  commandList.ExecuteIndirect(m_commandSignature.Get(), m_maxInstances, m_commandBuffer.Get(), 0,
+    m_commandCountBuffer.Get(), 0);
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> GpuDrivenRenderer::CreateBuffer(uint64_t size, D3D12_RESOURCE_FLAGS flags,
+  D3D12_RESOURCE_STATES initialState, TrackedAllocation& memory)
+{
+  const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+  const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(std::max<uint64_t>(size, 1), flags);
+
+  memory.Reset();
+  Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+  DX12_CHECK(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, initialState,
+    nullptr, IID_PPV_ARGS(&buffer)), "Failed to create GPU-driven rendering buffer!");
+  memory = TrackResource(m_device, buffer.Get(), MemoryCategory::Buffers);
+
+  return buffer;
+}
+
+void GpuDrivenRenderer::Transition(FilteredCommandList& commandList, ID3D12Resource* resource,
+  D3D12_RESOURCE_STATES& state, D3D12_RESOURCE_STATES newState)
+{
+  if (state == newState)
+  {
+    // Back to back culling passes writing the same UAV still have to be ordered:
+    if (newState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+    {
+      const CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(resource);
+      commandList.ResourceBarrier(1, &barrier);
+    }
+    return;
+  }
+
+  const CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource, state, newState);
+  commandList.ResourceBarrier(1, &barrier);
+  state = newState;
+}
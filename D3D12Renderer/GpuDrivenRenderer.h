@@ -0,0 +1,89 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+
+#include "IndirectCommands.h"
+#include "MemoryTracker.h"
+#include "RootSignatureCache.h"
+
+class FilteredCommandList;
+class ShaderCompiler;
+class UploadBuffer;
+struct DrawMesh;
+struct Frustum;
+
+// GPU-driven rendering of one pipeline's instances: instance bounds live in a persistent GPU buffer, a
+// compute pass culls them and writes a DrawIndexed command per visible instance (plus the command
+// count), and a single ExecuteIndirect draws them all. Every instance's mesh has to live in the same
+// vertex/index buffers, meshes being index ranges within them (see IndirectMeshDraw).
+//
+// The command signature is built from the draw pipeline's root signature layout: each command sets the
+// root constant named by objectBinding to the instance's objectIndex, then draws.
+class GpuDrivenRenderer
+{
+public:
+	GpuDrivenRenderer(ID3D12Device2* device, ShaderCompiler& shaderCompiler, RootSignatureCache& rootSignatures,
+		uint32_t maxInstances, uint32_t maxMeshDraws);
+
+	// Pipeline the instances are drawn with, objectBinding being the name of the root constant receiving
+	// each instance's objectIndex. May reallocate the command buffer, so the GPU mustn't be using it:
+	void SetDrawPipeline(ID3D12PipelineState* pipelineState, RootSignatureId rootSignatureId, const char* objectBinding);
+
+	// Copies instances/mesh draws into the persistent buffers, staged through this frame's upload buffer:
+	void UpdateInstances(FilteredCommandList& commandList, UploadBuffer& uploadBuffer, uint32_t firstInstance,
+		const IndirectInstance* instances, uint32_t count);
+	void UpdateMeshDraws(FilteredCommandList& commandList, UploadBuffer& uploadBuffer, uint32_t firstMeshDraw,
+		const IndirectMeshDraw* meshDraws, uint32_t count);
+	void SetNumInstances(uint32_t numInstances);
+
+	// Records the culling pass, which has to come before Draw() in the same frame:
+	void Cull(FilteredCommandList& commandList, UploadBuffer& uploadBuffer, const Frustum& frustum);
+	void Draw(FilteredCommandList& commandList, const DrawMesh& mesh);
+
+	const IndirectCommandLayout& GetCommandLayout() const { return m_commandLayout; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(uint64_t size, D3D12_RESOURCE_FLAGS flags,
+		D3D12_RESOURCE_STATES initialState, TrackedAllocation& memory);
+
+	void Transition(FilteredCommandList& commandList, ID3D12Resource* resource, D3D12_RESOURCE_STATES& state,
+		D3D12_RESOURCE_STATES newState);
+
+	ID3D12Device2*									m_device;
+	RootSignatureCache&								m_rootSignatures;
+	uint32_t										m_maxInstances;
+	uint32_t										m_maxMeshDraws;
+	uint32_t										m_numInstances;
+
+	// Culling pass:
+	Microsoft::WRL::ComPtr<ID3D12PipelineState>		m_cullingPipelineState;
+	RootSignatureId									m_cullingRootSignatureId;
+	int32_t											m_constantsRootIndex;
+	int32_t											m_instancesRootIndex;
+	int32_t											m_meshDrawsRootIndex;
+	int32_t											m_commandsRootIndex;
+	int32_t											m_commandCountRootIndex;
+
+	// Draw pass:
+	ID3D12PipelineState*							m_drawPipelineState;
+	RootSignatureId									m_drawRootSignatureId;
+	IndirectCommandLayout							m_commandLayout;
+	Microsoft::WRL::ComPtr<ID3D12CommandSignature>	m_commandSignature;
+
+	// GPU buffers, their current states and memory:
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_instanceBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_meshDrawBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_commandBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_commandCountBuffer;
+	D3D12_RESOURCE_STATES							m_instanceBufferState;
+	D3D12_RESOURCE_STATES							m_meshDrawBufferState;
+	D3D12_RESOURCE_STATES							m_commandBufferState;
+	D3D12_RESOURCE_STATES							m_commandCountBufferState;
+	TrackedAllocation								m_instanceBufferMemory;
+	TrackedAllocation								m_meshDrawBufferMemory;
+	TrackedAllocation								m_commandBufferMemory;
+	TrackedAllocation								m_commandCountBufferMemory;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstdint>
+
+#include "MemoryTracker.h"
+
+// What a resource takes up in its heap, alignment included, as a tracked allocation:
+inline TrackedAllocation TrackResource(ID3D12Device* device, ID3D12Resource* resource, MemoryCategory category)
+{
+	const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	return TrackedAllocation(category, device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes);
+}
+
+inline TrackedAllocation TrackHeap(ID3D12Heap* heap, MemoryCategory category)
+{
+	return TrackedAllocation(category, heap->GetDesc().SizeInBytes);
+}
+
+inline TrackedAllocation TrackDescriptorHeap(ID3D12Device* device, ID3D12DescriptorHeap* heap)
+{
+	const D3D12_DESCRIPTOR_HEAP_DESC desc = heap->GetDesc();
+	return TrackedAllocation(MemoryCategory::DescriptorHeaps,
+		static_cast<uint64_t>(desc.NumDescriptors) * device->GetDescriptorHandleIncrementSize(desc.Type));
+}
+
+// Timestamp and occlusion results are 8 bytes each:
+inline TrackedAllocation TrackQueryHeap(uint32_t numQueries)
+{
+	return TrackedAllocation(MemoryCategory::QueryHeaps, static_cast<uint64_t>(numQueries) * sizeof(uint64_t));
+}
+
+// D3D12 doesn't report how much an allocator has grown to, so they're only counted:
+inline TrackedAllocation TrackCommandAllocator()
+{
+	return TrackedAllocation(MemoryCategory::CommandAllocators, 0);
+}
@@ -0,0 +1,102 @@
+#include "GpuTimer.h"
+#include "FilteredCommandList.h"
+#include "GpuMemoryTracking.h"
+#include "Helpers.h"
+
+#include "Dx12Headers/d3dx12.h"
+
+#include <algorithm>
+#include <cassert>
+
+GpuTimer::GpuTimer(ID3D12Device2* device, ID3D12CommandQueue* commandQueue, uint32_t numFrames, uint32_t nodeMask)
+  : m_commandQueue(commandQueue)
+  , m_timestamps(nullptr)
+  , m_numFrames(numFrames)
+  , m_timedFrames(0)
+{
+  assert(numFrames <= 32 && "Timed frames are tracked in a 32-bit mask!");
+
+  uint64_t frequency = 0;
+  DX12_CHECK(commandQueue->GetTimestampFrequency(&frequency), "Failed to get GPU timestamp frequency!");
+  m_millisecondsPerTick = 1000.0 / static_cast<double>(frequency);
+  Calibrate();
+
+  D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+  queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+  queryHeapDesc.Count = numFrames * 2;
+  queryHeapDesc.NodeMask = nodeMask;
+  DX12_CHECK(device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap)), "Failed to create timestamp query heap!");
+  m_queryHeapMemory = TrackQueryHeap(queryHeapDesc.Count);
+
+  const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_READBACK, nodeMask, nodeMask);
+  const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(queryHeapDesc.Count * sizeof(uint64_t));
+  DX12_CHECK(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+    D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readbackBuffer)), "Failed to create timestamp readback buffer!");
+  m_readbackMemory = TrackResource(device, m_readbackBuffer.Get(), MemoryCategory::Buffers);
+
+  // Readback buffers can stay mapped, reads just have to wait for the GPU to have written them:
+  void* data = nullptr;
+  DX12_CHECK(m_readbackBuffer->Map(0, nullptr, &data), "Failed to map timestamp readback buffer!");
+  m_timestamps = static_cast<const uint64_t*>(data);
+}
+
+GpuTimer::~GpuTimer()
+{
+  if (m_readbackBuffer)
+  {
+    const D3D12_RANGE writtenRange = { 0, 0 };
+    m_readbackBuffer->Unmap(0, &writtenRange);
+  }
+}
+
+void GpuTimer::BeginFrame(FilteredCommandList& commandList, uint32_t frameIndex)
+{
+  assert(frameIndex < m_numFrames);
+  commandList.EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2);
+}
+
+void GpuTimer::EndFrame(FilteredCommandList& commandList, uint32_t frameIndex)
+{
+  assert(frameIndex < m_numFrames);
+  commandList.EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2 + 1);
+  commandList.ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2, 2,
+    m_readbackBuffer.Get(), frameIndex * 2 * sizeof(uint64_t));
+
+  m_timedFrames |= 1u << frameIndex;
+}
+
+float GpuTimer::GetFrameTime(uint32_t frameIndex) const
+{
+  assert(frameIndex < m_numFrames);
+  if ((m_timedFrames & (1u << frameIndex)) == 0)
+    return -1.0f;
+
+  const uint64_t begin = m_timestamps[frameIndex * 2];
+  const uint64_t end = m_timestamps[frameIndex * 2 + 1];
+  return (end > begin) ? static_cast<float>((end - begin) * m_millisecondsPerTick) : 0.0f;
+}
+
+bool GpuTimer::GetFrameInterval(uint32_t frameIndex, uint64_t& beginUs, uint64_t& endUs) const
+{
+  assert(frameIndex < m_numFrames);
+  if ((m_timedFrames & (1u << frameIndex)) == 0)
+    return false;
+
+  // Relative to the calibration point, which timestamps can be either side of:
+  auto toMicroseconds = [this](uint64_t timestamp) {
+    const int64_t ticks = static_cast<int64_t>(timestamp - m_calibrationTimestamp);
+    return m_calibrationUs + static_cast<int64_t>(static_cast<double>(ticks) * m_millisecondsPerTick * 1000.0);
+  };
+
+  beginUs = toMicroseconds(m_timestamps[frameIndex * 2]);
+  endUs = std::max(toMicroseconds(m_timestamps[frameIndex * 2 + 1]), beginUs);
+  return true;
+}
+
+void GpuTimer::Calibrate()
+{
+  uint64_t cpuTimestamp = 0;
+  DX12_CHECK(m_commandQueue->GetClockCalibration(&m_calibrationTimestamp, &cpuTimestamp),
+    "Failed to calibrate GPU timestamps!");
+  m_calibrationUs = QpcToMicroseconds(static_cast<int64_t>(cpuTimestamp));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+
+#include "MemoryTracker.h"
+
+class FilteredCommandList;
+
+// Measures how long the GPU spends on each frame with a pair of timestamp queries per frame in flight.
+// Results are resolved into a persistently mapped readback buffer, and can be read once the frame's
+// fence has completed, i.e. when its slot comes round again.
+class GpuTimer
+{
+public:
+	// nodeMask picks the node of a linked adapter whose queue is timed, 0 for single GPU adapters:
+	GpuTimer(ID3D12Device2* device, ID3D12CommandQueue* commandQueue, uint32_t numFrames, uint32_t nodeMask = 0);
+	~GpuTimer();
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// Bracket the work to time in the frame's command list:
+	void BeginFrame(FilteredCommandList& commandList, uint32_t frameIndex);
+	void EndFrame(FilteredCommandList& commandList, uint32_t frameIndex);
+
+	// GPU time in milliseconds of the frame last timed in this slot, which the GPU must have finished.
+	// Returns a negative value if nothing has been timed in it yet:
+	float GetFrameTime(uint32_t frameIndex) const;
+
+	// When the GPU began and ended the frame last timed in this slot, in microseconds on the
+	// QueryPerformanceCounter clock (QpcToMicroseconds()). Returns false if nothing has been timed in it yet:
+	bool GetFrameInterval(uint32_t frameIndex, uint64_t& beginUs, uint64_t& endUs) const;
+
+	// Re-reads how GPU timestamps line up with QueryPerformanceCounter, the two clocks drift apart so this
+	// should be called every so often:
+	void Calibrate();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue>	m_commandQueue;
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap>			m_queryHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_readbackBuffer;
+	TrackedAllocation														m_queryHeapMemory;
+	TrackedAllocation														m_readbackMemory;
+	const uint64_t*															m_timestamps;						// Mapped readback buffer, begin and end per frame.
+	double																			m_millisecondsPerTick;
+	uint64_t																		m_calibrationTimestamp;	// GPU timestamp of the last Calibrate()...
+	uint64_t																		m_calibrationUs;				// ...and the CPU time it matches.
+	uint32_t																		m_numFrames;
+	uint32_t																		m_timedFrames;					// Bit per slot, set once it's been timed.
+};
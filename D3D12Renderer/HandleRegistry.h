@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// 32-bit generational handle: the low bits index a slot in a HandleRegistry, the high bits hold the
+// slot's generation when the handle was created. Releasing an object bumps its slot's generation, so
+// stale handles are detected on lookup instead of aliasing whatever reuses the slot. Tag keeps handles
+// to different kinds of object from being mixed up.
+template<typename Tag>
+class Handle
+{
+public:
+	static const uint32_t c_indexBits				= 20;
+	static const uint32_t c_generationBits	= 32 - c_indexBits;
+	static const uint32_t c_maxIndex				= (1u << c_indexBits) - 1;
+	static const uint32_t c_maxGeneration		= (1u << c_generationBits) - 1;
+
+	constexpr Handle() : m_value(0) {}		// Generation 0 is never handed out, so this is always invalid.
+	constexpr Handle(uint32_t index, uint32_t generation) : m_value((generation << c_indexBits) | index) {}
+
+	constexpr uint32_t	Index() const { return m_value & c_maxIndex; }
+	constexpr uint32_t	Generation() const { return m_value >> c_indexBits; }
+	constexpr uint32_t	Value() const { return m_value; }
+	constexpr bool			IsNull() const { return m_value == 0; }
+
+	constexpr bool operator==(Handle other) const { return m_value == other.m_value; }
+	constexpr bool operator!=(Handle other) const { return m_value != other.m_value; }
+
+private:
+	uint32_t m_value;
+};
+
+// Owns objects (typically ComPtrs) in a dense slot array and hands out Handles to them, so hot paths
+// can pass 32-bit handles around rather than copying reference-counted pointers (each copy of which is
+// an interlocked AddRef/Release pair).
+//
+// Ownership is only ever given up at deferred-destruction points: Release() invalidates the handle
+// immediately, but the object stays alive until CollectGarbage() is called with a completed fence value
+// at or beyond the one it was released with, i.e. once the GPU can no longer be using it.
+template<typename T, typename Tag = T>
+class HandleRegistry
+{
+public:
+	using HandleType = Handle<Tag>;
+
+	HandleType Add(T object)
+	{
+		uint32_t index;
+		if (!m_freeSlots.empty())
+		{
+			index = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			m_objects[index] = std::move(object);
+		}
+		else
+		{
+			index = static_cast<uint32_t>(m_objects.size());
+			assert(index <= HandleType::c_maxIndex && "HandleRegistry is full!");
+
+			m_objects.push_back(std::move(object));
+			m_generations.push_back(1);
+		}
+
+		++m_numLive;
+		return HandleType(index, m_generations[index]);
+	}
+
+	// Returns nullptr if the handle is null, stale or has been released:
+	T* Get(HandleType handle)
+	{
+		const uint32_t index = handle.Index();
+		if (index >= m_generations.size() || m_generations[index] != handle.Generation())
+			return nullptr;
+
+		return &m_objects[index];
+	}
+
+	const T* Get(HandleType handle) const
+	{
+		return const_cast<HandleRegistry*>(this)->Get(handle);
+	}
+
+	bool IsValid(HandleType handle) const { return Get(handle) != nullptr; }
+
+	// Invalidates the handle straight away, but defers destroying the object until the GPU has passed
+	// fenceValue (see CollectGarbage):
+	void Release(HandleType handle, uint64_t fenceValue)
+	{
+		if (!IsValid(handle))
+		{
+			assert(handle.IsNull() && "Releasing a stale handle!");
+			return;
+		}
+
+		const uint32_t index = handle.Index();
+
+		// Skip generation 0 on wrap-around, so null handles stay invalid:
+		uint16_t& generation = m_generations[index];
+		generation = generation == HandleType::c_maxGeneration ? 1 : generation + 1;
+
+		m_pendingReleases.push(PendingRelease{ fenceValue, index });
+		--m_numLive;
+	}
+
+	// Destroys released objects whose fence value has completed and recycles their slots. Fence values
+	// are expected to be released in increasing order, as they are when taken from a single queue:
+	void CollectGarbage(uint64_t completedFenceValue)
+	{
+		while (!m_pendingReleases.empty() && m_pendingReleases.front().fenceValue <= completedFenceValue)
+		{
+			const uint32_t index = m_pendingReleases.front().index;
+			m_pendingReleases.pop();
+
+			m_objects[index] = T();
+			m_freeSlots.push_back(index);
+		}
+	}
+
+	size_t NumLive() const { return m_numLive; }
+	size_t NumPendingRelease() const { return m_pendingReleases.size(); }
+
+private:
+	struct PendingRelease
+	{
+		uint64_t	fenceValue;
+		uint32_t	index;
+	};
+
+	std::vector<T>							m_objects;					// Indexed by slot, released objects stay here until collected.
+	std::vector<uint16_t>				m_generations;			// Current generation of each slot.
+	std::vector<uint32_t>				m_freeSlots;
+	std::queue<PendingRelease>	m_pendingReleases;
+	size_t											m_numLive = 0;
+};
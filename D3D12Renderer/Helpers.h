@@ -2,6 +2,7 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include <cstdint>
 #include <exception>
 
 inline void DX12_CHECK(HRESULT hr)
@@ -14,4 +15,24 @@ inline void DX12_CHECK(HRESULT hr, const char* msg)
 {
   if (FAILED(hr))
     throw std::exception(msg);
-}
\ No newline at end of file
+}
+
+// QueryPerformanceCounter ticks in microseconds, the clock frame and input timings are compared on:
+inline uint64_t QpcToMicroseconds(int64_t ticks)
+{
+  static const int64_t frequency = []() {
+    LARGE_INTEGER qpcFrequency;
+    ::QueryPerformanceFrequency(&qpcFrequency);
+    return qpcFrequency.QuadPart;
+  }();
+
+  // Split so the multiply can't overflow however long the machine has been up:
+  return static_cast<uint64_t>((ticks / frequency) * 1000000 + (ticks % frequency) * 1000000 / frequency);
+}
+
+inline uint64_t GetTimeMicroseconds()
+{
+  LARGE_INTEGER now;
+  ::QueryPerformanceCounter(&now);
+  return QpcToMicroseconds(now.QuadPart);
+}
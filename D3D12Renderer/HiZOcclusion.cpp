@@ -0,0 +1,283 @@
+#include "HiZOcclusion.h"
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// Defined as 0 to build the scalar path on x86 too, which the tests do to check both cull the same:
+#ifndef DX12_HIZ_X86
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX12_HIZ_X86 1
+#else
+#define DX12_HIZ_X86 0
+#endif
+#endif
+
+#if DX12_HIZ_X86
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  // Farthest depth of each 2x2 block of a level, clamped at odd edges:
+  void DownsampleMax(const float* source, uint32_t sourceWidth, uint32_t sourceHeight, float* dest,
+    uint32_t destWidth, uint32_t destHeight)
+  {
+    for (uint32_t y = 0; y < destHeight; ++y)
+    {
+      const float* row0 = source + static_cast<size_t>(2 * y) * sourceWidth;
+      const float* row1 = source + static_cast<size_t>(std::min(2 * y + 1, sourceHeight - 1)) * sourceWidth;
+      float* destRow = dest + static_cast<size_t>(y) * destWidth;
+
+      // Blocks with both columns inside the level, 4 at a time where possible:
+      const uint32_t numFullBlocks = sourceWidth / 2;
+      uint32_t x = 0;
+
+#if DX12_HIZ_X86
+      for (; x + 4 <= numFullBlocks; x += 4)
+      {
+        const __m128 max0 = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x), _mm_loadu_ps(row1 + 2 * x));
+        const __m128 max1 = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x + 4), _mm_loadu_ps(row1 + 2 * x + 4));
+        const __m128 even = _mm_shuffle_ps(max0, max1, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 odd = _mm_shuffle_ps(max0, max1, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(destRow + x, _mm_max_ps(even, odd));
+      }
+#endif
+
+      for (; x < numFullBlocks; ++x)
+      {
+        destRow[x] = std::max(std::max(row0[2 * x], row0[2 * x + 1]), std::max(row1[2 * x], row1[2 * x + 1]));
+      }
+
+      // Odd width, the last block only has the one column:
+      if (x < destWidth)
+        destRow[x] = std::max(row0[2 * x], row1[2 * x]);
+    }
+  }
+
+  // Screen-space bounds (NDC) and nearest depth of a world-space box, false if it crosses the near plane
+  // and the projection isn't meaningful. Corners are the projected center plus or minus each projected
+  // half extent axis (clip = v * M), which is a lot cheaper than projecting all 8:
+  bool ProjectBox(const float center[3], const float extents[3], const float viewProjection[16],
+    float& minX, float& maxX, float& minY, float& maxY, float& minZ)
+  {
+    const float* m = viewProjection;
+
+#if DX12_HIZ_X86
+    const __m128 row0 = _mm_loadu_ps(m), row1 = _mm_loadu_ps(m + 4), row2 = _mm_loadu_ps(m + 8);
+    const __m128 clipCenter = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(center[0]), row0), _mm_mul_ps(_mm_set1_ps(center[1]), row1)),
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(center[2]), row2), _mm_loadu_ps(m + 12)));
+    const __m128 axisX = _mm_mul_ps(_mm_set1_ps(extents[0]), row0);
+    const __m128 axisY = _mm_mul_ps(_mm_set1_ps(extents[1]), row1);
+    const __m128 axisZ = _mm_mul_ps(_mm_set1_ps(extents[2]), row2);
+
+    const __m128 cornersX[2] = { _mm_sub_ps(clipCenter, axisX), _mm_add_ps(clipCenter, axisX) };
+    const __m128 cornersXY[4] = {
+      _mm_sub_ps(cornersX[0], axisY), _mm_add_ps(cornersX[0], axisY),
+      _mm_sub_ps(cornersX[1], axisY), _mm_add_ps(cornersX[1], axisY),
+    };
+
+    __m128 minClip = _mm_set1_ps(1e30f);
+    __m128 minNdc = minClip;
+    __m128 maxNdc = _mm_set1_ps(-1e30f);
+    for (int i = 0; i < 4; ++i)
+    {
+      const __m128 corners[2] = { _mm_sub_ps(cornersXY[i], axisZ), _mm_add_ps(cornersXY[i], axisZ) };
+      for (const __m128& corner : corners)
+      {
+        const __m128 ndc = _mm_div_ps(corner, _mm_shuffle_ps(corner, corner, _MM_SHUFFLE(3, 3, 3, 3)));
+        minClip = _mm_min_ps(minClip, corner);
+        minNdc = _mm_min_ps(minNdc, ndc);
+        maxNdc = _mm_max_ps(maxNdc, ndc);
+      }
+    }
+
+    alignas(16) float minClipValues[4], minNdcValues[4], maxNdcValues[4];
+    _mm_store_ps(minClipValues, minClip);
+    _mm_store_ps(minNdcValues, minNdc);
+    _mm_store_ps(maxNdcValues, maxNdc);
+
+    if (!(minClipValues[3] > 0.0f) || minClipValues[2] < 0.0f)
+      return false;
+
+    minX = minNdcValues[0];
+    maxX = maxNdcValues[0];
+    minY = minNdcValues[1];
+    maxY = maxNdcValues[1];
+    minZ = minNdcValues[2];
+    return true;
+#else
+    float clipCenter[4], axisX[4], axisY[4], axisZ[4];
+    for (int i = 0; i < 4; ++i)
+    {
+      clipCenter[i] = center[0] * m[i] + center[1] * m[4 + i] + center[2] * m[8 + i] + m[12 + i];
+      axisX[i] = extents[0] * m[i];
+      axisY[i] = extents[1] * m[4 + i];
+      axisZ[i] = extents[2] * m[8 + i];
+    }
+
+    minX = minY = minZ = 1e30f;
+    maxX = maxY = -1e30f;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+      const float signX = (corner & 1) ? 1.0f : -1.0f;
+      const float signY = (corner & 2) ? 1.0f : -1.0f;
+      const float signZ = (corner & 4) ? 1.0f : -1.0f;
+
+      float clip[4];
+      for (int i = 0; i < 4; ++i)
+        clip[i] = clipCenter[i] + signX * axisX[i] + signY * axisY[i] + signZ * axisZ[i];
+
+      if (!(clip[3] > 0.0f) || clip[2] < 0.0f)
+        return false;
+
+      const float invW = 1.0f / clip[3];
+      minX = std::min(minX, clip[0] * invW);
+      maxX = std::max(maxX, clip[0] * invW);
+      minY = std::min(minY, clip[1] * invW);
+      maxY = std::max(maxY, clip[1] * invW);
+      minZ = std::min(minZ, clip[2] * invW);
+    }
+    return true;
+#endif
+  }
+}
+
+void HiZPyramid::Build(const float* depth, uint32_t width, uint32_t height)
+{
+  assert(width > 0 && height > 0);
+
+  m_levels.clear();
+  size_t totalSize = 0;
+  for (uint32_t levelWidth = width, levelHeight = height; ; )
+  {
+    m_levels.push_back(Level{ levelWidth, levelHeight, totalSize });
+    totalSize += static_cast<size_t>(levelWidth) * levelHeight;
+
+    if (levelWidth == 1 && levelHeight == 1)
+      break;
+
+    levelWidth = (levelWidth + 1) / 2;
+    levelHeight = (levelHeight + 1) / 2;
+  }
+
+  m_depth.resize(totalSize);
+  std::memcpy(m_depth.data(), depth, static_cast<size_t>(width) * height * sizeof(float));
+
+  for (size_t i = 1; i < m_levels.size(); ++i)
+  {
+    const Level& source = m_levels[i - 1];
+    const Level& dest = m_levels[i];
+    DownsampleMax(m_depth.data() + source.offset, source.width, source.height, m_depth.data() + dest.offset,
+      dest.width, dest.height);
+  }
+}
+
+bool HiZPyramid::IsOccluded(const float center[3], const float extents[3], const float viewProjection[16]) const
+{
+  if (m_levels.empty())
+    return false;
+
+  float minX, maxX, minY, maxY, minZ;
+  if (!ProjectBox(center, extents, viewProjection, minX, maxX, minY, maxY, minZ))
+    return false;
+
+  // NDC to level 0 pixels (y pointing down):
+  const Level& base = m_levels[0];
+  const float left = (minX * 0.5f + 0.5f) * base.width;
+  const float right = (maxX * 0.5f + 0.5f) * base.width;
+  const float top = (0.5f - maxY * 0.5f) * base.height;
+  const float bottom = (0.5f - minY * 0.5f) * base.height;
+
+  if (right < 0.0f || bottom < 0.0f || left >= base.width || top >= base.height)
+    return false;
+
+  const uint32_t x0 = static_cast<uint32_t>(std::max(left, 0.0f));
+  const uint32_t y0 = static_cast<uint32_t>(std::max(top, 0.0f));
+  const uint32_t x1 = std::min(static_cast<uint32_t>(right), base.width - 1);
+  const uint32_t y1 = std::min(static_cast<uint32_t>(bottom), base.height - 1);
+
+  // Coarsest needed level where the rect covers at most 2x2 texels:
+  uint32_t level = 0;
+  while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+    ++level;
+
+  const Level& hiZ = m_levels[level];
+  const float* depth = m_depth.data() + hiZ.offset;
+
+  float maxDepth = 0.0f;
+  for (uint32_t y = y0 >> level; y <= (y1 >> level); ++y)
+  {
+    for (uint32_t x = x0 >> level; x <= (x1 >> level); ++x)
+      maxDepth = std::max(maxDepth, depth[static_cast<size_t>(y) * hiZ.width + x]);
+  }
+
+  return minZ > maxDepth;
+}
+
+uint32_t CullOcclusion(const HiZPyramid& pyramid, const float viewProjection[16], const CullingBounds& bounds,
+  const uint32_t* indices, uint32_t count, uint32_t* visible, uint32_t* occluded, uint32_t& numOccluded)
+{
+  uint32_t numVisible = 0;
+  numOccluded = 0;
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const uint32_t index = indices[i];
+    const float center[3] = { bounds.CenterX()[index], bounds.CenterY()[index], bounds.CenterZ()[index] };
+    const float extents[3] = { bounds.ExtentX()[index], bounds.ExtentY()[index], bounds.ExtentZ()[index] };
+
+    if (pyramid.IsOccluded(center, extents, viewProjection))
+      occluded[numOccluded++] = index;
+    else
+      visible[numVisible++] = index;
+  }
+  return numVisible;
+}
+
+const std::vector<uint32_t>& OcclusionCuller::CullPhase1(const CullingBounds& bounds, const uint32_t* candidates,
+  uint32_t count)
+{
+  m_phase1Visible.resize(count);
+  m_phase1Occluded.resize(count);
+
+  uint32_t numOccluded = 0;
+  const uint32_t numVisible = CullOcclusion(m_pyramid, m_pyramidViewProjection, bounds, candidates, count,
+    m_phase1Visible.data(), m_phase1Occluded.data(), numOccluded);
+
+  m_phase1Visible.resize(numVisible);
+  m_phase1Occluded.resize(numOccluded);
+  return m_phase1Visible;
+}
+
+const std::vector<uint32_t>& OcclusionCuller::CullPhase2(const CullingBounds& bounds, const float viewProjection[16],
+  const float* depth, uint32_t width, uint32_t height)
+{
+  // Only phase 1's objects are in this depth, so the pyramid kept for next frame is missing phase 2's
+  // occluders. That only makes next frame's phase 1 reject less, never wrongly:
+  m_pyramid.Build(depth, width, height);
+  std::memcpy(m_pyramidViewProjection, viewProjection, sizeof(m_pyramidViewProjection));
+
+  const uint32_t count = static_cast<uint32_t>(m_phase1Occluded.size());
+  m_phase2Visible.resize(count);
+
+  // What's still occluded isn't needed, so it's written over the list being read (never ahead of it):
+  uint32_t numOccluded = 0;
+  const uint32_t numVisible = CullOcclusion(m_pyramid, viewProjection, bounds, m_phase1Occluded.data(), count,
+    m_phase2Visible.data(), m_phase1Occluded.data(), numOccluded);
+
+  m_phase2Visible.resize(numVisible);
+  m_phase1Occluded.clear();
+  return m_phase2Visible;
+}
+
+void OcclusionCuller::Reset()
+{
+  m_pyramid = HiZPyramid();
+  m_phase1Visible.clear();
+  m_phase1Occluded.clear();
+  m_phase2Visible.clear();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CullingBounds;
+
+// Hierarchical depth pyramid for occlusion culling. Level 0 is the depth buffer itself, every further
+// level halves the resolution (rounding up) keeping the farthest depth of the 2x2 texels below it, so a
+// texel at level L conservatively covers the level 0 pixels [x << L, (x + 1) << L). Depth follows D3D's
+// [0, 1] convention, 0 being the near plane. Shaders/HiZ.hlsl is the GPU version of Build() and
+// IsOccluded(), keep them in sync.
+class HiZPyramid
+{
+public:
+	void Build(const float* depth, uint32_t width, uint32_t height);
+
+	// Whether a world-space box (center and half extents) is entirely behind the depth in the pyramid,
+	// projected with the (row-major, row-vector) view-projection matrix the depth was rendered with.
+	// Boxes crossing the near plane or off screen are never occluded:
+	bool IsOccluded(const float center[3], const float extents[3], const float viewProjection[16]) const;
+
+	bool					IsEmpty() const { return m_levels.empty(); }
+	uint32_t			NumLevels() const { return static_cast<uint32_t>(m_levels.size()); }
+	uint32_t			GetWidth(uint32_t level) const { return m_levels[level].width; }
+	uint32_t			GetHeight(uint32_t level) const { return m_levels[level].height; }
+	const float*	GetLevel(uint32_t level) const { return m_depth.data() + m_levels[level].offset; }
+
+private:
+	struct Level
+	{
+		uint32_t	width;
+		uint32_t	height;
+		size_t		offset;			// Into m_depth.
+	};
+
+	std::vector<Level>	m_levels;
+	std::vector<float>	m_depth;		// Every level, one after another.
+};
+
+// Two-phase occlusion culling, which avoids both popping and a dependency on the current frame's depth
+// before anything is drawn:
+//
+//	1. Objects are tested against the previous frame's pyramid, projected with the previous frame's
+//		 camera. Objects that passed are drawn.
+//	2. The pyramid is rebuilt from the resulting depth, and the objects phase 1 rejected are retested
+//		 against it with the current camera. Those that turned out visible (disoccluded this frame) are
+//		 drawn too, and the pyramid is kept for the next frame's phase 1.
+//
+// Phase 1 only ever rejects based on last frame, so anything it wrongly rejects is caught in phase 2 of
+// the same frame rather than appearing a frame late.
+class OcclusionCuller
+{
+public:
+	// Phase 1, candidates being the indices of the objects that passed frustum culling. Returns those to
+	// draw first, everything passes without a previous frame:
+	const std::vector<uint32_t>& CullPhase1(const CullingBounds& bounds, const uint32_t* candidates, uint32_t count);
+
+	// Phase 2, after phase 1's objects have been drawn to depth. Returns the objects to draw in addition:
+	const std::vector<uint32_t>& CullPhase2(const CullingBounds& bounds, const float viewProjection[16],
+		const float* depth, uint32_t width, uint32_t height);
+
+	const HiZPyramid& GetPyramid() const { return m_pyramid; }
+
+	// Forgets the previous frame, e.g. after a camera cut where it would only reject wrongly:
+	void Reset();
+
+private:
+	HiZPyramid						m_pyramid;
+	float									m_pyramidViewProjection[16] = {};
+	std::vector<uint32_t>	m_phase1Visible;
+	std::vector<uint32_t>	m_phase1Occluded;
+	std::vector<uint32_t>	m_phase2Visible;
+};
+
+// Splits objects into those occluded by the pyramid and those that aren't, returning how many were
+// visible. visible and occluded both need room for count indices:
+uint32_t CullOcclusion(const HiZPyramid& pyramid, const float viewProjection[16], const CullingBounds& bounds,
+	const uint32_t* indices, uint32_t count, uint32_t* visible, uint32_t* occluded, uint32_t& numOccluded);
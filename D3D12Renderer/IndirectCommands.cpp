@@ -0,0 +1,182 @@
+#include "IndirectCommands.h"
+#include "FrustumCulling.h"
+#include "RootSignatureLayout.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+  uint32_t GetOperationSize(IndirectArgumentType operation)
+  {
+    switch (operation)
+    {
+    case IndirectArgumentType::Draw:        return sizeof(IndirectDrawArguments);
+    case IndirectArgumentType::DrawIndexed: return sizeof(IndirectDrawIndexedArguments);
+    case IndirectArgumentType::Dispatch:    return sizeof(IndirectDispatchArguments);
+    default:
+      assert(!"Commands have to end in a draw or dispatch!");
+      return 0;
+    }
+  }
+
+  bool ToIndirectArgumentType(RootParameterType type, IndirectArgumentType& argumentType)
+  {
+    switch (type)
+    {
+    case RootParameterType::Constants:  argumentType = IndirectArgumentType::Constant; return true;
+    case RootParameterType::CBV:        argumentType = IndirectArgumentType::CBV; return true;
+    case RootParameterType::SRV:        argumentType = IndirectArgumentType::SRV; return true;
+    case RootParameterType::UAV:        argumentType = IndirectArgumentType::UAV; return true;
+    default:                            return false;   // Descriptor tables can't be set per command.
+    }
+  }
+
+  bool IsInsideFrustum(const Frustum& frustum, const IndirectInstance& instance)
+  {
+    for (const float* plane : frustum.planes)
+    {
+      const float distance = plane[0] * instance.center[0] + plane[1] * instance.center[1] +
+        plane[2] * instance.center[2] + plane[3];
+      const float radius = std::fabs(plane[0]) * instance.extents[0] + std::fabs(plane[1]) * instance.extents[1] +
+        std::fabs(plane[2]) * instance.extents[2];
+
+      if (distance + radius < 0.0f)
+        return false;
+    }
+    return true;
+  }
+}
+
+int32_t IndirectCommandLayout::GetBindingOffset(uint32_t binding) const
+{
+  const int32_t argument = bindingArguments[binding];
+  return argument == c_notBound ? c_notBound : static_cast<int32_t>(arguments[argument].offsetInBytes);
+}
+
+void IndirectCommandLayout::WriteConstants(uint8_t* command, uint32_t binding, const uint32_t* values,
+  uint32_t num32BitValues) const
+{
+  const int32_t argument = bindingArguments[binding];
+  if (argument == c_notBound)
+    return;
+
+  const IndirectArgumentDesc& desc = arguments[argument];
+  assert(desc.type == IndirectArgumentType::Constant && num32BitValues <= desc.num32BitValues);
+  std::memcpy(command + desc.offsetInBytes, values, num32BitValues * sizeof(uint32_t));
+}
+
+void IndirectCommandLayout::WriteAddress(uint8_t* command, uint32_t binding, uint64_t address) const
+{
+  const int32_t argument = bindingArguments[binding];
+  if (argument == c_notBound)
+    return;
+
+  const IndirectArgumentDesc& desc = arguments[argument];
+  assert(desc.type == IndirectArgumentType::CBV || desc.type == IndirectArgumentType::SRV ||
+    desc.type == IndirectArgumentType::UAV);
+  std::memcpy(command + desc.offsetInBytes, &address, sizeof(address));
+}
+
+void IndirectCommandLayout::WriteDraw(uint8_t* command, const IndirectDrawArguments& drawArguments) const
+{
+  assert(Operation() == IndirectArgumentType::Draw);
+  std::memcpy(command + GetOperationOffset(), &drawArguments, sizeof(drawArguments));
+}
+
+void IndirectCommandLayout::WriteDrawIndexed(uint8_t* command, const IndirectDrawIndexedArguments& drawArguments) const
+{
+  assert(Operation() == IndirectArgumentType::DrawIndexed);
+  std::memcpy(command + GetOperationOffset(), &drawArguments, sizeof(drawArguments));
+}
+
+void IndirectCommandLayout::WriteDispatch(uint8_t* command, const IndirectDispatchArguments& dispatchArguments) const
+{
+  assert(Operation() == IndirectArgumentType::Dispatch);
+  std::memcpy(command + GetOperationOffset(), &dispatchArguments, sizeof(dispatchArguments));
+}
+
+IndirectCommandLayout BuildIndirectCommandLayout(const RootSignatureLayout& rootLayout,
+  const std::vector<const char*>& bindings, IndirectArgumentType operation)
+{
+  IndirectCommandLayout layout;
+  layout.bindingArguments.assign(bindings.size(), IndirectCommandLayout::c_notBound);
+
+  uint32_t offset = 0;
+  for (size_t i = 0; i < bindings.size(); ++i)
+  {
+    const RootBindingLocation* location = rootLayout.FindBinding(bindings[i]);
+    if (!location)
+      continue;
+
+    // Several bindings can't share a root parameter (each root constant range or root descriptor is one
+    // binding), but the same name may have been asked for twice:
+    int32_t existing = IndirectCommandLayout::c_notBound;
+    for (size_t j = 0; j < layout.arguments.size(); ++j)
+    {
+      if (layout.arguments[j].rootIndex == location->rootIndex)
+        existing = static_cast<int32_t>(j);
+    }
+
+    if (existing != IndirectCommandLayout::c_notBound)
+    {
+      layout.bindingArguments[i] = existing;
+      continue;
+    }
+
+    const RootParameterDesc& parameter = rootLayout.parameters[location->rootIndex];
+
+    IndirectArgumentDesc argument = {};
+    const bool isSupported = ToIndirectArgumentType(parameter.type, argument.type);
+    assert(isSupported && "Only root constants and root descriptors can be set by indirect commands!");
+    if (!isSupported)
+      continue;
+
+    argument.rootIndex = location->rootIndex;
+    argument.offsetInBytes = offset;
+
+    if (argument.type == IndirectArgumentType::Constant)
+    {
+      argument.num32BitValues = parameter.num32BitValues;
+      argument.sizeInBytes = parameter.num32BitValues * sizeof(uint32_t);
+    }
+    else
+    {
+      argument.sizeInBytes = sizeof(uint64_t);    // GPU virtual address.
+    }
+
+    layout.bindingArguments[i] = static_cast<int32_t>(layout.arguments.size());
+    layout.arguments.push_back(argument);
+    offset += argument.sizeInBytes;
+  }
+
+  IndirectArgumentDesc operationArgument = {};
+  operationArgument.type = operation;
+  operationArgument.offsetInBytes = offset;
+  operationArgument.sizeInBytes = GetOperationSize(operation);
+  layout.arguments.push_back(operationArgument);
+
+  layout.byteStride = offset + operationArgument.sizeInBytes;
+  return layout;
+}
+
+uint32_t GenerateIndirectDraws(const IndirectCommandLayout& layout, uint32_t objectBinding, const Frustum& frustum,
+  const IndirectInstance* instances, uint32_t count, const IndirectMeshDraw* meshDraws, uint8_t* commands)
+{
+  uint32_t numCommands = 0;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const IndirectInstance& instance = instances[i];
+    if (!IsInsideFrustum(frustum, instance))
+      continue;
+
+    const IndirectMeshDraw& meshDraw = meshDraws[instance.meshDrawIndex];
+    uint8_t* command = commands + static_cast<size_t>(numCommands++) * layout.byteStride;
+
+    layout.WriteConstants(command, objectBinding, &instance.objectIndex, 1);
+    layout.WriteDrawIndexed(command, IndirectDrawIndexedArguments{ meshDraw.indexCount, 1, meshDraw.startIndex,
+      meshDraw.baseVertex, 0 });
+  }
+  return numCommands;
+}
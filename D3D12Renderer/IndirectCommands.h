@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct Frustum;
+struct RootSignatureLayout;
+
+// Platform-independent description of ExecuteIndirect command signatures and the packing of their
+// arguments, so argument buffers can be written (and checked) on the CPU exactly as the GPU-driven
+// culling pass writes them. Like RootSignatureLayout, enum values match their D3D12 counterparts
+// (D3D12_INDIRECT_ARGUMENT_TYPE) so a layout converts to a D3D12 command signature with plain casts.
+
+enum class IndirectArgumentType : uint8_t
+{
+	Draw,
+	DrawIndexed,
+	Dispatch,
+	VertexBufferView,
+	IndexBufferView,
+	Constant,
+	CBV,
+	SRV,
+	UAV,
+};
+
+// Same layouts as D3D12_DRAW_ARGUMENTS, D3D12_DRAW_INDEXED_ARGUMENTS and D3D12_DISPATCH_ARGUMENTS:
+struct IndirectDrawArguments
+{
+	uint32_t	vertexCountPerInstance;
+	uint32_t	instanceCount;
+	uint32_t	startVertexLocation;
+	uint32_t	startInstanceLocation;
+};
+
+struct IndirectDrawIndexedArguments
+{
+	uint32_t	indexCountPerInstance;
+	uint32_t	instanceCount;
+	uint32_t	startIndexLocation;
+	int32_t		baseVertexLocation;
+	uint32_t	startInstanceLocation;
+};
+
+struct IndirectDispatchArguments
+{
+	uint32_t	threadGroupCountX;
+	uint32_t	threadGroupCountY;
+	uint32_t	threadGroupCountZ;
+};
+
+struct IndirectArgumentDesc
+{
+	IndirectArgumentType	type;
+	uint32_t							rootIndex;				// Root arguments only.
+	uint32_t							num32BitValues;		// Constants only.
+	uint32_t							offsetInBytes;		// Within a command.
+	uint32_t							sizeInBytes;
+};
+
+// One command is a fixed size record of root arguments followed by the draw or dispatch. Arguments are
+// packed tightly at 4 byte alignment (GPU addresses included), which is all ExecuteIndirect requires and
+// keeps commands writable from a RWByteAddressBuffer.
+struct IndirectCommandLayout
+{
+	static constexpr int32_t c_notBound = -1;
+
+	std::vector<IndirectArgumentDesc>	arguments;					// In command order, the draw/dispatch last.
+	std::vector<int32_t>							bindingArguments;		// Argument index of each requested binding, c_notBound if the shaders don't use it.
+	uint32_t													byteStride = 0;
+
+	IndirectArgumentType Operation() const { return arguments.back().type; }
+
+	// Whether commands change root arguments, in which case the command signature needs the root signature:
+	bool ChangesRootArguments() const { return arguments.size() > 1; }
+
+	// Byte offset of a binding's argument (by its index in the requested bindings) within a command,
+	// c_notBound as above:
+	int32_t		GetBindingOffset(uint32_t binding) const;
+	uint32_t	GetOperationOffset() const { return arguments.back().offsetInBytes; }
+
+	// Packing of one command's arguments, command pointing at its first byte. Writes to bindings the
+	// shaders don't use are dropped:
+	void WriteConstants(uint8_t* command, uint32_t binding, const uint32_t* values, uint32_t num32BitValues) const;
+	void WriteAddress(uint8_t* command, uint32_t binding, uint64_t address) const;
+	void WriteDraw(uint8_t* command, const IndirectDrawArguments& drawArguments) const;
+	void WriteDrawIndexed(uint8_t* command, const IndirectDrawIndexedArguments& drawArguments) const;
+	void WriteDispatch(uint8_t* command, const IndirectDispatchArguments& dispatchArguments) const;
+};
+
+// Builds the layout of commands that set the named shader bindings (root constants or root descriptors,
+// looked up in the root signature's layout) then draw or dispatch. Bindings in descriptor tables can't
+// be changed by ExecuteIndirect and are a programming error.
+IndirectCommandLayout BuildIndirectCommandLayout(const RootSignatureLayout& rootLayout,
+	const std::vector<const char*>& bindings, IndirectArgumentType operation);
+
+// Persistent per-instance data of the GPU-driven path, matching IndirectInstance in InstanceCulling.hlsl:
+struct IndirectInstance
+{
+	float			center[3];
+	uint32_t	meshDrawIndex;		// Into the IndirectMeshDraw table.
+	float			extents[3];
+	uint32_t	objectIndex;			// Written to the command's instance binding.
+};
+
+// The index range an instance's mesh is drawn with, matching IndirectMeshDraw in InstanceCulling.hlsl:
+struct IndirectMeshDraw
+{
+	uint32_t	indexCount;
+	uint32_t	startIndex;
+	int32_t		baseVertex;
+	uint32_t	padding;
+};
+
+// CPU reference of InstanceCulling.hlsl: culls instances against the frustum and writes a DrawIndexed
+// command (setting the layout's objectBinding constant to the instance's objectIndex) for each visible
+// one, returning how many were written. The GPU writes the same commands, though in no particular order.
+// commands needs room for count commands.
+uint32_t GenerateIndirectDraws(const IndirectCommandLayout& layout, uint32_t objectBinding, const Frustum& frustum,
+	const IndirectInstance* instances, uint32_t count, const IndirectMeshDraw* meshDraws, uint8_t* commands);
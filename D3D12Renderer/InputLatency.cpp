@@ -0,0 +1,129 @@
+#include "InputLatency.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+  // Frames waiting to be reported displayed, older ones were never going to be and are dropped:
+  const size_t c_maxTrackedFrames = 16;
+
+  // Bounds the inputs a single frame holds on to, e.g. if frames stop while input keeps coming:
+  const size_t c_maxInputsPerFrame = 256;
+
+  float ToMilliseconds(uint64_t timeUs)
+  {
+    return static_cast<float>(timeUs) * 0.001f;
+  }
+}
+
+LatencyHistory::LatencyHistory(uint32_t capacity)
+  : m_samples(capacity)
+  , m_next(0)
+  , m_count(0)
+{
+  assert(capacity > 0);
+}
+
+void LatencyHistory::Add(uint64_t latencyUs)
+{
+  m_samples[m_next] = latencyUs;
+  m_next = (m_next + 1) % static_cast<uint32_t>(m_samples.size());
+  m_count = std::min(m_count + 1, static_cast<uint32_t>(m_samples.size()));
+}
+
+void LatencyHistory::Clear()
+{
+  m_next = 0;
+  m_count = 0;
+}
+
+LatencyPercentiles LatencyHistory::GetPercentiles() const
+{
+  LatencyPercentiles percentiles = {};
+  percentiles.numSamples = m_count;
+  if (m_count == 0)
+    return percentiles;
+
+  // Nearest-rank percentiles, the history being small enough to just sort:
+  m_sorted.assign(m_samples.begin(), m_samples.begin() + m_count);
+  std::sort(m_sorted.begin(), m_sorted.end());
+
+  auto percentile = [&](uint32_t percent) {
+    const uint32_t rank = (percent * m_count + 99) / 100;
+    return ToMilliseconds(m_sorted[std::max(rank, 1u) - 1]);
+  };
+
+  percentiles.p50 = percentile(50);
+  percentiles.p90 = percentile(90);
+  percentiles.p99 = percentile(99);
+  percentiles.max = ToMilliseconds(m_sorted.back());
+  return percentiles;
+}
+
+void InputLatencyTracker::RecordInput(uint64_t timeUs)
+{
+  if (m_pendingInputs.size() < c_maxInputsPerFrame)
+    m_pendingInputs.push_back(timeUs);
+}
+
+void InputLatencyTracker::OnFrameStart(uint64_t frameId, uint64_t timeUs)
+{
+  if (m_frames.size() == c_maxTrackedFrames)
+    m_frames.pop_front();
+
+  Frame frame;
+  frame.frameId = frameId;
+  frame.isPresented = false;
+  frame.inputTimes.swap(m_pendingInputs);
+
+  for (uint64_t inputTime : frame.inputTimes)
+    m_inputToFrameStart.Add(timeUs - std::min(inputTime, timeUs));
+
+  m_frames.push_back(std::move(frame));
+}
+
+void InputLatencyTracker::OnPresent(uint64_t frameId, uint64_t timeUs)
+{
+  Frame* frame = FindFrame(frameId);
+  if (!frame || frame->isPresented)
+    return;
+
+  frame->isPresented = true;
+  for (uint64_t inputTime : frame->inputTimes)
+    m_inputToPresent.Add(timeUs - std::min(inputTime, timeUs));
+}
+
+void InputLatencyTracker::OnDisplayed(uint64_t frameId, uint64_t timeUs)
+{
+  Frame* frame = FindFrame(frameId);
+  if (!frame || !frame->isPresented)
+    return;
+
+  for (uint64_t inputTime : frame->inputTimes)
+    m_inputToDisplay.Add(timeUs - std::min(inputTime, timeUs));
+
+  // Displayed in order, so anything older has been shown (or replaced) by now:
+  while (m_frames.front().frameId != frameId)
+    m_frames.pop_front();
+  m_frames.pop_front();
+}
+
+void InputLatencyTracker::Clear()
+{
+  m_pendingInputs.clear();
+  m_frames.clear();
+  m_inputToFrameStart.Clear();
+  m_inputToPresent.Clear();
+  m_inputToDisplay.Clear();
+}
+
+InputLatencyTracker::Frame* InputLatencyTracker::FindFrame(uint64_t frameId)
+{
+  for (Frame& frame : m_frames)
+  {
+    if (frame.frameId == frameId)
+      return &frame;
+  }
+  return nullptr;
+}
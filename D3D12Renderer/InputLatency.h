@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct LatencyPercentiles
+{
+	uint32_t	numSamples;
+	float			p50;			// Milliseconds.
+	float			p90;
+	float			p99;
+	float			max;
+};
+
+// Fixed-size history of latency samples, percentiles are over the most recent ones:
+class LatencyHistory
+{
+public:
+	explicit LatencyHistory(uint32_t capacity = 1024);
+
+	void Add(uint64_t latencyUs);
+	void Clear();
+
+	LatencyPercentiles GetPercentiles() const;
+
+private:
+	std::vector<uint64_t>			m_samples;
+	uint32_t						m_next;
+	uint32_t						m_count;
+	mutable std::vector<uint64_t>	m_sorted;				// Scratch for GetPercentiles().
+};
+
+// Correlates input events with the frame that consumed them and the Present that showed them. Each
+// input is timestamped as it's handled, frames consume every input that arrived before they started,
+// and once a frame is presented (and later, displayed) each of its inputs adds a latency sample:
+//
+//	input -> frame start:	how long input waited to be sampled, what pacing aims to cut.
+//	input -> present:			including the CPU's work on the frame.
+//	input -> display:			the latency the user sees, when the swap chain reports when frames hit the screen.
+//
+// Times are microseconds on one clock, chosen by the caller.
+class InputLatencyTracker
+{
+public:
+	void RecordInput(uint64_t timeUs);
+
+	void OnFrameStart(uint64_t frameId, uint64_t timeUs);
+	void OnPresent(uint64_t frameId, uint64_t timeUs);
+
+	// The frame was scanned out at timeUs (e.g. from the swap chain's frame statistics). Frames that
+	// never get one, e.g. without statistics, just don't contribute display samples:
+	void OnDisplayed(uint64_t frameId, uint64_t timeUs);
+
+	const LatencyHistory& GetInputToFrameStart() const { return m_inputToFrameStart; }
+	const LatencyHistory& GetInputToPresent() const { return m_inputToPresent; }
+	const LatencyHistory& GetInputToDisplay() const { return m_inputToDisplay; }
+
+	void Clear();
+
+private:
+	struct Frame
+	{
+		uint64_t							frameId;
+		bool									isPresented;
+		std::vector<uint64_t>	inputTimes;
+	};
+
+	Frame* FindFrame(uint64_t frameId);
+
+	std::vector<uint64_t>			m_pendingInputs;
+	std::deque<Frame>				m_frames;						// Started but not yet displayed, oldest first.
+	LatencyHistory					m_inputToFrameStart;
+	LatencyHistory					m_inputToPresent;
+	LatencyHistory					m_inputToDisplay;
+};
@@ -0,0 +1,322 @@
+#include "JobSystem.h"
+#include "Tracing.h"
+
+#include <cassert>
+#include <cstdio>
+
+namespace
+{
+  // How many times an idle worker looks for work before going to sleep, sleeping and waking a thread
+  // costs far more than a few failed steal attempts when jobs arrive in bursts:
+  const uint32_t c_idleSpinCount = 64;
+
+  thread_local const JobSystem* t_jobSystem = nullptr;
+  thread_local uint32_t t_threadIndex = 0;
+
+  uint32_t NextRandom(uint32_t& state)
+  {
+    // xorshift32, only used to spread steal attempts across victims:
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+}
+
+JobSystem::JobSystem(uint32_t numWorkers)
+  : m_numThreads(0)
+  , m_mainThreadId(std::this_thread::get_id())
+  , m_numMainThreadJobs(0)
+  , m_numQueuedJobs(0)
+  , m_numSleepingWorkers(0)
+  , m_isShuttingDown(false)
+{
+  if (numWorkers == c_defaultNumWorkers)
+  {
+    const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    numWorkers = (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+  }
+
+  m_numThreads = numWorkers + 1;
+  m_threads.reset(new ThreadState[m_numThreads]);
+
+  for (uint32_t i = 0; i < m_numThreads; ++i)
+    m_threads[i].randomState = i + 1;
+
+  // Thread 0 is the main thread, which only takes part when it calls Wait():
+  m_workers.reserve(numWorkers);
+  for (uint32_t i = 1; i < m_numThreads; ++i)
+    m_workers.emplace_back(&JobSystem::WorkerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_sleepLock);
+    m_isShuttingDown.store(true);
+  }
+  m_sleepCondition.notify_all();
+
+  for (std::thread& worker : m_workers)
+    worker.join();
+}
+
+void JobSystem::Run(JobFunc func, void* data, JobCounter* counter, JobAffinity affinity)
+{
+  if (counter)
+    AddPending(*counter);
+
+  Schedule(AllocateJob(func, data, counter, affinity));
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, JobFunc func, void* data, JobCounter* counter,
+  JobAffinity affinity)
+{
+  if (counter)
+    AddPending(*counter);
+
+  Job* job = AllocateJob(func, data, counter, affinity);
+
+  {
+    std::lock_guard<std::mutex> lock(dependency.m_continuationLock);
+    if (!dependency.m_hasReleasedContinuations && !dependency.IsDone())
+    {
+      dependency.m_continuations.push_back(job);
+      return;
+    }
+  }
+
+  Schedule(job);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+  const bool isMainThread = std::this_thread::get_id() == m_mainThreadId;
+  ThreadState& thread = CurrentThread();
+
+  // Help out rather than block, the jobs being waited on may well be sitting in our own deque:
+  while (!counter.IsDone())
+  {
+    if (!TryRunJob(thread, isMainThread))
+      std::this_thread::yield();
+  }
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+  assert(std::this_thread::get_id() == m_mainThreadId && "Main-thread jobs run on the main thread only!");
+
+  if (m_numMainThreadJobs.load(std::memory_order_acquire) == 0)
+    return;
+
+  std::vector<Job*> jobs;
+  {
+    std::lock_guard<std::mutex> lock(m_mainThreadLock);
+    jobs.swap(m_mainThreadJobs);
+    m_numMainThreadJobs.store(0, std::memory_order_relaxed);
+  }
+
+  ThreadState& thread = m_threads[0];
+  for (Job* job : jobs)
+    Execute(thread, job);
+}
+
+uint32_t JobSystem::CurrentThreadIndex() const
+{
+  if (t_jobSystem == this)
+    return t_threadIndex;
+
+  assert(std::this_thread::get_id() == m_mainThreadId && "Only the main thread and workers have an index!");
+  return 0;
+}
+
+JobSystemStats JobSystem::GetStats() const
+{
+  JobSystemStats stats = {};
+  for (uint32_t i = 0; i < m_numThreads; ++i)
+  {
+    stats.jobsRun += m_threads[i].jobsRun.load(std::memory_order_relaxed);
+    stats.jobsStolen += m_threads[i].jobsStolen.load(std::memory_order_relaxed);
+    stats.workerSleeps += m_threads[i].workerSleeps.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+JobSystem::ThreadState& JobSystem::CurrentThread()
+{
+  if (t_jobSystem == this)
+    return m_threads[t_threadIndex];
+
+  assert(std::this_thread::get_id() == m_mainThreadId && "Jobs can only be scheduled from the main thread or from jobs!");
+  return m_threads[0];
+}
+
+Job* JobSystem::AllocateJob(JobFunc func, void* data, JobCounter* counter, JobAffinity affinity)
+{
+  // The pool is a ring, a slot is only reused after c_maxJobsPerThread more jobs have been allocated on
+  // this thread, by which time the job it held must have finished:
+  ThreadState& thread = CurrentThread();
+  Job* job = &thread.jobPool[thread.nextJob++ & (c_maxJobsPerThread - 1)];
+
+  job->func = func;
+  job->data = data;
+  job->counter = counter;
+  job->affinity = affinity;
+  return job;
+}
+
+void JobSystem::AddPending(JobCounter& counter)
+{
+  // Starting a new round of work on a counter whose continuations were already released:
+  if (counter.m_pending.fetch_add(1, std::memory_order_relaxed) == 0)
+  {
+    std::lock_guard<std::mutex> lock(counter.m_continuationLock);
+    counter.m_hasReleasedContinuations = false;
+  }
+}
+
+void JobSystem::Schedule(Job* job)
+{
+  if (job->affinity == JobAffinity::MainThread)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mainThreadLock);
+      m_mainThreadJobs.push_back(job);
+      m_numMainThreadJobs.fetch_add(1, std::memory_order_release);
+    }
+
+    if (m_mainThreadWakeup && std::this_thread::get_id() != m_mainThreadId)
+      m_mainThreadWakeup();
+    return;
+  }
+
+  CurrentThread().deque.Push(job);
+  m_numQueuedJobs.fetch_add(1);
+
+  // Sleeping workers register themselves (under m_sleepLock) before checking m_numQueuedJobs, so either
+  // they see the job above or we see them here:
+  if (m_numSleepingWorkers.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(m_sleepLock);
+    m_sleepCondition.notify_one();
+  }
+}
+
+void JobSystem::Execute(ThreadState& thread, Job* job)
+{
+  job->func(job->data);
+  thread.jobsRun.store(thread.jobsRun.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  JobCounter* counter = job->counter;
+  if (!counter)
+    return;
+
+  // Only the last job of the group touches the continuation lock. It must not let the counter reach zero
+  // until it's done with it, as a waiter is free to destroy the counter from then on:
+  uint32_t pending = counter->m_pending.load(std::memory_order_relaxed);
+  while (pending > 1)
+  {
+    if (counter->m_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel,
+      std::memory_order_relaxed))
+      return;
+  }
+
+  std::vector<Job*> continuations;
+  {
+    std::lock_guard<std::mutex> lock(counter->m_continuationLock);
+    continuations.swap(counter->m_continuations);
+    counter->m_hasReleasedContinuations = true;
+  }
+
+  counter->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+
+  for (Job* continuation : continuations)
+    Schedule(continuation);
+}
+
+bool JobSystem::TryRunJob(ThreadState& thread, bool isMainThread)
+{
+  Job* job = nullptr;
+  if (!TryGetJob(thread, isMainThread, job))
+    return false;
+
+  Execute(thread, job);
+  return true;
+}
+
+bool JobSystem::TryGetJob(ThreadState& thread, bool isMainThread, Job*& job)
+{
+  if (isMainThread && m_numMainThreadJobs.load(std::memory_order_acquire) > 0)
+  {
+    std::lock_guard<std::mutex> lock(m_mainThreadLock);
+    if (!m_mainThreadJobs.empty())
+    {
+      job = m_mainThreadJobs.back();
+      m_mainThreadJobs.pop_back();
+      m_numMainThreadJobs.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  if (thread.deque.Pop(job))
+  {
+    m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Our own deque is empty, go through everyone else's starting from a random victim:
+  const uint32_t start = NextRandom(thread.randomState) % m_numThreads;
+  for (uint32_t i = 0; i < m_numThreads; ++i)
+  {
+    ThreadState& victim = m_threads[(start + i) % m_numThreads];
+    if (&victim == &thread || victim.deque.IsEmpty())
+      continue;
+
+    if (victim.deque.Steal(job))
+    {
+      m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+      thread.jobsStolen.store(thread.jobsStolen.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void JobSystem::WorkerMain(uint32_t threadIndex)
+{
+  t_jobSystem = this;
+  t_threadIndex = threadIndex;
+
+  char threadName[32];
+  snprintf(threadName, sizeof(threadName), "Job worker %u", threadIndex);
+  GetTracer().SetThreadName(threadName);
+
+  ThreadState& thread = m_threads[threadIndex];
+  uint32_t idleCount = 0;
+
+  while (!m_isShuttingDown.load(std::memory_order_relaxed))
+  {
+    if (TryRunJob(thread, false))
+    {
+      idleCount = 0;
+      continue;
+    }
+
+    if (++idleCount < c_idleSpinCount)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    idleCount = 0;
+    thread.workerSleeps.store(thread.workerSleeps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(m_sleepLock);
+    m_numSleepingWorkers.fetch_add(1);
+    m_sleepCondition.wait(lock, [this]() { return m_numQueuedJobs.load() > 0 || m_isShuttingDown.load(); });
+    m_numSleepingWorkers.fetch_sub(1);
+  }
+
+  t_jobSystem = nullptr;
+}
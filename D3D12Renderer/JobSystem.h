@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WorkStealingDeque.h"
+
+class JobSystem;
+struct Job;
+
+using JobFunc = void(*)(void* data);
+
+// Where a job may run. Window and swap chain work has to stay on the thread that created the window,
+// such jobs are only run by the main thread (from Wait() or RunMainThreadJobs()):
+enum class JobAffinity
+{
+	Any,
+	MainThread,
+};
+
+// Tracks a group of jobs. Every job scheduled against a counter increments it and decrements it once
+// finished, so it reaches zero once the whole group is done. Jobs can also be scheduled to run after a
+// counter reaches zero (JobSystem::RunAfter()), which is how dependencies between jobs are expressed.
+// Must outlive all jobs referencing it.
+class JobCounter
+{
+public:
+	JobCounter() : m_pending(0), m_hasReleasedContinuations(false) {}
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t>	m_pending;
+	std::mutex						m_continuationLock;
+	std::vector<Job*>			m_continuations;					// Waiting for m_pending to reach zero.
+	bool									m_hasReleasedContinuations;	// Guarded by m_continuationLock.
+};
+
+struct Job
+{
+	JobFunc			func;
+	void*				data;
+	JobCounter*	counter;
+	JobAffinity	affinity;
+};
+
+struct JobSystemStats
+{
+	uint64_t	jobsRun;
+	uint64_t	jobsStolen;
+	uint64_t	workerSleeps;
+};
+
+// Work-stealing job system. Every thread (the main thread plus the workers) has its own lock-free
+// deque: jobs are pushed to the scheduling thread's deque and popped LIFO by it, idle threads steal FIFO
+// from random victims. Workers sleep on a condition variable once there's nothing left to steal.
+//
+// Jobs may only be scheduled from the thread that created the JobSystem or from within jobs. Wait()
+// runs other jobs while waiting instead of blocking, so it's safe to wait from inside a job.
+class JobSystem
+{
+public:
+	// Each thread allocates jobs from a ring of this size, which bounds how many jobs a single thread can
+	// have in flight at once:
+	static const uint32_t c_maxJobsPerThread = 4096;
+
+	// One worker per hardware thread besides the main one:
+	static const uint32_t c_defaultNumWorkers = 0xffffffff;
+
+	// With no workers at all, every job runs on the main thread when it waits:
+	explicit JobSystem(uint32_t numWorkers = c_defaultNumWorkers);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	uint32_t NumThreads() const { return m_numThreads; }		// Including the main thread.
+
+	// 0 on the main thread, from 1 up on workers, for indexing per-thread data:
+	uint32_t CurrentThreadIndex() const;
+
+	void Run(JobFunc func, void* data, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::Any);
+
+	// Schedules the job once dependency reaches zero (immediately if it already has):
+	void RunAfter(JobCounter& dependency, JobFunc func, void* data, JobCounter* counter = nullptr,
+		JobAffinity affinity = JobAffinity::Any);
+
+	// Runs jobs until counter reaches zero:
+	void Wait(JobCounter& counter);
+
+	// Main thread only, runs any queued main-thread jobs, e.g. from the message loop:
+	void RunMainThreadJobs();
+
+	// Called whenever a main-thread job is queued, so a main thread sleeping in its message loop can be
+	// woken up (e.g. by posting it a message):
+	void SetMainThreadWakeup(std::function<void()> wakeup) { m_mainThreadWakeup = std::move(wakeup); }
+
+	// Calls func(begin, end) over [0, count) in chunks of at most grainSize, returns once all are done.
+	// One job is spawned per thread and each claims chunks from a shared atomic index, so uneven chunks
+	// balance out without spawning a job per chunk:
+	template<typename Func>
+	void ParallelFor(uint32_t count, uint32_t grainSize, const Func& func);
+
+	JobSystemStats GetStats() const;
+
+private:
+	struct alignas(64) ThreadState
+	{
+		WorkStealingDeque<Job*, c_maxJobsPerThread>	deque;
+		Job																					jobPool[c_maxJobsPerThread];
+		uint32_t																		nextJob = 0;
+		uint32_t																		randomState = 0;
+
+		// Only ever written by the owning thread, atomic so GetStats() can read them from another:
+		std::atomic<uint64_t>												jobsRun{ 0 };
+		std::atomic<uint64_t>												jobsStolen{ 0 };
+		std::atomic<uint64_t>												workerSleeps{ 0 };
+	};
+
+	template<typename Func>
+	struct ParallelForData
+	{
+		const Func*						func;
+		uint32_t							count;
+		uint32_t							grainSize;
+		std::atomic<uint32_t>	nextIndex;
+	};
+
+	template<typename Func>
+	static void ParallelForJob(void* data);
+
+	ThreadState& CurrentThread();
+	Job* AllocateJob(JobFunc func, void* data, JobCounter* counter, JobAffinity affinity);
+	void AddPending(JobCounter& counter);
+	void Schedule(Job* job);
+	void Execute(ThreadState& thread, Job* job);
+	bool TryRunJob(ThreadState& thread, bool isMainThread);
+	bool TryGetJob(ThreadState& thread, bool isMainThread, Job*& job);
+	void WorkerMain(uint32_t threadIndex);
+
+	uint32_t											m_numThreads;
+	std::unique_ptr<ThreadState[]>	m_threads;
+	std::vector<std::thread>			m_workers;
+	std::thread::id								m_mainThreadId;
+
+	// Main-thread jobs are rare (window work), a locked queue is plenty:
+	std::mutex										m_mainThreadLock;
+	std::vector<Job*>							m_mainThreadJobs;
+	std::atomic<uint32_t>					m_numMainThreadJobs;
+	std::function<void()>					m_mainThreadWakeup;
+
+	// Number of jobs sitting in deques, lets workers decide when to go to sleep:
+	std::atomic<int32_t>					m_numQueuedJobs;
+	std::atomic<uint32_t>					m_numSleepingWorkers;
+	std::mutex										m_sleepLock;
+	std::condition_variable				m_sleepCondition;
+	std::atomic<bool>							m_isShuttingDown;
+};
+
+template<typename Func>
+void JobSystem::ParallelForJob(void* data)
+{
+	ParallelForData<Func>& loop = *static_cast<ParallelForData<Func>*>(data);
+
+	for (;;)
+	{
+		const uint32_t begin = loop.nextIndex.fetch_add(loop.grainSize, std::memory_order_relaxed);
+		if (begin >= loop.count)
+			break;
+
+		const uint32_t end = (loop.count - begin < loop.grainSize) ? loop.count : begin + loop.grainSize;
+		(*loop.func)(begin, end);
+	}
+}
+
+template<typename Func>
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const Func& func)
+{
+	if (count == 0)
+		return;
+
+	if (grainSize == 0)
+		grainSize = 1;
+
+	const uint32_t numChunks = (count + grainSize - 1) / grainSize;
+	if (numChunks == 1)
+	{
+		func(0u, count);
+		return;
+	}
+
+	ParallelForData<Func> loop;
+	loop.func = &func;
+	loop.count = count;
+	loop.grainSize = grainSize;
+	loop.nextIndex.store(0, std::memory_order_relaxed);
+
+	// The calling thread takes part too, so spawn one job fewer than there are threads to run them:
+	const uint32_t numJobs = ((numChunks < m_numThreads) ? numChunks : m_numThreads) - 1;
+
+	JobCounter counter;
+	for (uint32_t i = 0; i < numJobs; ++i)
+		Run(&ParallelForJob<Func>, &loop, &counter);
+
+	ParallelForJob<Func>(&loop);
+	Wait(counter);
+}
@@ -0,0 +1,206 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+  const char* const c_categoryNames[] = {
+    "SwapChain",
+    "RenderTargets",
+    "Buffers",
+    "CrossAdapterHeaps",
+    "DescriptorHeaps",
+    "QueryHeaps",
+    "CommandAllocators",
+    "CpuArenas",
+  };
+
+  static_assert(sizeof(c_categoryNames) / sizeof(c_categoryNames[0]) == static_cast<size_t>(MemoryCategory::Count),
+    "Every memory category needs a name!");
+
+  double ToMegabytes(uint64_t bytes)
+  {
+    return bytes / (1024.0 * 1024.0);
+  }
+
+  // snprintf after the length characters already in text, which keeps counting once text is full:
+  template<typename... Args>
+  void Append(char* text, size_t size, size_t& length, const char* format, Args... args)
+  {
+    const size_t offset = size > 0 ? std::min(length, size - 1) : 0;
+    const int numChars = snprintf(text + offset, size - offset, format, args...);
+    if (numChars > 0)
+      length += numChars;
+  }
+}
+
+const char* GetMemoryCategoryName(MemoryCategory category)
+{
+  assert(category < MemoryCategory::Count);
+  return c_categoryNames[static_cast<size_t>(category)];
+}
+
+size_t MemorySnapshot::FormatSummary(char* text, size_t size) const
+{
+  size_t length = 0;
+  Append(text, size, length, "Memory: %.1fMB (peak %.1fMB)", ToMegabytes(currentBytes), ToMegabytes(peakBytes));
+
+  // Only what's in use, command allocators by count as that's all there is:
+  for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); ++i)
+  {
+    const MemoryCategoryStats& category = categories[i];
+    if (category.numAllocations == 0)
+      continue;
+
+    if (category.currentBytes > 0)
+      Append(text, size, length, ", %s %.1fMB", c_categoryNames[i], ToMegabytes(category.currentBytes));
+    else
+    {
+      Append(text, size, length, ", %s x%llu", c_categoryNames[i],
+        static_cast<unsigned long long>(category.numAllocations));
+    }
+  }
+  return length;
+}
+
+std::string MemorySnapshot::FormatJson() const
+{
+  char text[256];
+  snprintf(text, sizeof(text), "{\n  \"currentBytes\": %llu,\n  \"peakBytes\": %llu,\n  \"categories\": {\n",
+    static_cast<unsigned long long>(currentBytes), static_cast<unsigned long long>(peakBytes));
+  std::string json = text;
+
+  for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); ++i)
+  {
+    const MemoryCategoryStats& category = categories[i];
+    const bool isLast = i + 1 == static_cast<size_t>(MemoryCategory::Count);
+    snprintf(text, sizeof(text),
+      "    \"%s\": { \"currentBytes\": %llu, \"peakBytes\": %llu, \"numAllocations\": %llu, "
+      "\"totalAllocations\": %llu }%s\n",
+      c_categoryNames[i], static_cast<unsigned long long>(category.currentBytes),
+      static_cast<unsigned long long>(category.peakBytes), static_cast<unsigned long long>(category.numAllocations),
+      static_cast<unsigned long long>(category.totalAllocations), isLast ? "" : ",");
+    json += text;
+  }
+
+  json += "  }\n}\n";
+  return json;
+}
+
+bool MemorySnapshot::SaveJson(const std::string& path) const
+{
+  std::ofstream file(path, std::ios::trunc);
+  if (!file)
+    return false;
+
+  file << FormatJson();
+  return static_cast<bool>(file);
+}
+
+MemoryTracker::MemoryTracker()
+  : m_currentBytes(0)
+  , m_peakBytes(0)
+{
+  for (Category& category : m_categories)
+  {
+    category.currentBytes.store(0, std::memory_order_relaxed);
+    category.peakBytes.store(0, std::memory_order_relaxed);
+    category.numAllocations.store(0, std::memory_order_relaxed);
+    category.totalAllocations.store(0, std::memory_order_relaxed);
+  }
+}
+
+void MemoryTracker::OnAllocate(MemoryCategory category, uint64_t bytes)
+{
+  assert(category < MemoryCategory::Count);
+  Category& stats = m_categories[static_cast<size_t>(category)];
+
+  UpdatePeak(stats.peakBytes, stats.currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+  stats.numAllocations.fetch_add(1, std::memory_order_relaxed);
+  stats.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+  UpdatePeak(m_peakBytes, m_currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void MemoryTracker::OnFree(MemoryCategory category, uint64_t bytes)
+{
+  assert(category < MemoryCategory::Count);
+  Category& stats = m_categories[static_cast<size_t>(category)];
+
+  assert(stats.currentBytes.load(std::memory_order_relaxed) >= bytes && "Freeing more than was allocated!");
+  stats.currentBytes.fetch_sub(bytes, std::memory_order_relaxed);
+  stats.numAllocations.fetch_sub(1, std::memory_order_relaxed);
+  m_currentBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemorySnapshot MemoryTracker::GetSnapshot() const
+{
+  MemorySnapshot snapshot = {};
+  for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); ++i)
+  {
+    const Category& category = m_categories[i];
+    snapshot.categories[i].currentBytes = category.currentBytes.load(std::memory_order_relaxed);
+    snapshot.categories[i].peakBytes = category.peakBytes.load(std::memory_order_relaxed);
+    snapshot.categories[i].numAllocations = category.numAllocations.load(std::memory_order_relaxed);
+    snapshot.categories[i].totalAllocations = category.totalAllocations.load(std::memory_order_relaxed);
+  }
+  snapshot.currentBytes = m_currentBytes.load(std::memory_order_relaxed);
+  snapshot.peakBytes = m_peakBytes.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+void MemoryTracker::UpdatePeak(std::atomic<uint64_t>& peak, uint64_t value)
+{
+  uint64_t previous = peak.load(std::memory_order_relaxed);
+  while (previous < value && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+  {
+  }
+}
+
+MemoryTracker& GetMemoryTracker()
+{
+  // Never destroyed, globals holding tracked allocations may well be released after it otherwise:
+  static MemoryTracker* s_tracker = new MemoryTracker();
+  return *s_tracker;
+}
+
+TrackedAllocation::TrackedAllocation(MemoryCategory category, uint64_t bytes)
+  : m_category(category)
+  , m_bytes(bytes)
+{
+  GetMemoryTracker().OnAllocate(category, bytes);
+}
+
+TrackedAllocation::TrackedAllocation(TrackedAllocation&& other) noexcept
+  : m_category(other.m_category)
+  , m_bytes(other.m_bytes)
+{
+  other.m_category = MemoryCategory::Count;
+  other.m_bytes = 0;
+}
+
+TrackedAllocation& TrackedAllocation::operator=(TrackedAllocation&& other) noexcept
+{
+  if (this != &other)
+  {
+    Reset();
+    m_category = other.m_category;
+    m_bytes = other.m_bytes;
+    other.m_category = MemoryCategory::Count;
+    other.m_bytes = 0;
+  }
+  return *this;
+}
+
+void TrackedAllocation::Reset()
+{
+  if (m_category == MemoryCategory::Count)
+    return;
+
+  GetMemoryTracker().OnFree(m_category, m_bytes);
+  m_category = MemoryCategory::Count;
+  m_bytes = 0;
+}
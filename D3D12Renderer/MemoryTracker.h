@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// What memory is for. GPU categories count what resources take up in their heaps (or, for heaps
+// without resources, what their descriptors/queries take), CPU ones the heap memory behind them:
+enum class MemoryCategory
+{
+	SwapChain,				// Back buffers.
+	RenderTargets,			// Textures rendered to, besides the back buffers.
+	Buffers,				// Upload, readback and default heap buffers.
+	CrossAdapterHeaps,		// Shared between GPUs.
+	DescriptorHeaps,
+	QueryHeaps,
+	CommandAllocators,		// Only counted, D3D12 doesn't say how much memory they hold.
+	CpuArenas,				// LinearArena chunks.
+	Count,
+};
+
+const char* GetMemoryCategoryName(MemoryCategory category);
+
+struct MemoryCategoryStats
+{
+	uint64_t	currentBytes;
+	uint64_t	peakBytes;
+	uint64_t	numAllocations;			// Live right now...
+	uint64_t	totalAllocations;		// ...and ever made, which keeps climbing if something's churning.
+};
+
+struct MemorySnapshot
+{
+	MemoryCategoryStats	categories[static_cast<size_t>(MemoryCategory::Count)];
+	uint64_t			currentBytes;		// All categories together...
+	uint64_t			peakBytes;			// ...and their peak, which isn't the sum of theirs.
+
+	const MemoryCategoryStats& Get(MemoryCategory category) const { return categories[static_cast<size_t>(category)]; }
+
+	// One line, e.g. for a once a second debug print, into a caller's buffer so printing it every frame
+	// doesn't touch the heap. Truncated to fit like snprintf, and likewise returns the untruncated length:
+	size_t FormatSummary(char* text, size_t size) const;
+
+	std::string FormatJson() const;
+	bool SaveJson(const std::string& path) const;
+};
+
+// Process-wide accounting of memory by category, with current, peak and count figures per category.
+// Thread-safe, resources get created on startup workers as well as the main thread. Allocation sites
+// report through TrackedAllocation rather than calling this directly, so nothing is forgotten on
+// release and whatever leaks shows up as live allocations.
+class MemoryTracker
+{
+public:
+	MemoryTracker();
+
+	MemoryTracker(const MemoryTracker&) = delete;
+	MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+	void OnAllocate(MemoryCategory category, uint64_t bytes);
+	void OnFree(MemoryCategory category, uint64_t bytes);
+
+	// Categories are read one counter at a time, so figures can be off by allocations made meanwhile:
+	MemorySnapshot GetSnapshot() const;
+
+private:
+	struct Category
+	{
+		std::atomic<uint64_t>	currentBytes;
+		std::atomic<uint64_t>	peakBytes;
+		std::atomic<uint64_t>	numAllocations;
+		std::atomic<uint64_t>	totalAllocations;
+	};
+
+	static void UpdatePeak(std::atomic<uint64_t>& peak, uint64_t value);
+
+	Category				m_categories[static_cast<size_t>(MemoryCategory::Count)];
+	std::atomic<uint64_t>	m_currentBytes;
+	std::atomic<uint64_t>	m_peakBytes;
+};
+
+MemoryTracker& GetMemoryTracker();
+
+// One tracked allocation, reported to GetMemoryTracker() for as long as it's alive. Kept next to what
+// it accounts for (a resource, a heap, a chunk), so it's released along with it.
+class TrackedAllocation
+{
+public:
+	TrackedAllocation() : m_category(MemoryCategory::Count), m_bytes(0) {}
+	TrackedAllocation(MemoryCategory category, uint64_t bytes);
+	~TrackedAllocation() { Reset(); }
+
+	TrackedAllocation(TrackedAllocation&& other) noexcept;
+	TrackedAllocation& operator=(TrackedAllocation&& other) noexcept;
+
+	TrackedAllocation(const TrackedAllocation&) = delete;
+	TrackedAllocation& operator=(const TrackedAllocation&) = delete;
+
+	void Reset();
+
+	uint64_t GetBytes() const { return m_bytes; }
+
+private:
+	MemoryCategory	m_category;		// Count when there's nothing tracked.
+	uint64_t		m_bytes;
+};
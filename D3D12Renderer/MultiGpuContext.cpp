@@ -0,0 +1,419 @@
+#include "MultiGpuContext.h"
+#include "GpuMemoryTracking.h"
+#include "GpuTimer.h"
+#include "Helpers.h"
+
+#include "Dx12Headers/d3dx12.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+  // Opens an object created on one device (with a shared flag) on another, e.g. a fence on both ends of
+  // a cross-adapter copy:
+  template<typename T>
+  Microsoft::WRL::ComPtr<T> OpenOnDevice(ID3D12Device2* owner, ID3D12DeviceChild* object, ID3D12Device2* device)
+  {
+    HANDLE handle = nullptr;
+    DX12_CHECK(owner->CreateSharedHandle(object, nullptr, GENERIC_ALL, nullptr, &handle),
+      "Failed to create cross-adapter shared handle!");
+
+    Microsoft::WRL::ComPtr<T> opened;
+    const HRESULT hr = device->OpenSharedHandle(handle, IID_PPV_ARGS(&opened));
+    ::CloseHandle(handle);
+    DX12_CHECK(hr, "Failed to open cross-adapter shared handle!");
+
+    return opened;
+  }
+}
+
+MultiGpuContext::MultiGpuContext(ID3D12Device2* displayDevice, ID3D12CommandQueue* displayQueue,
+  const std::vector<Microsoft::WRL::ComPtr<ID3D12Device2>>& secondaryDevices, DXGI_FORMAT format,
+  uint32_t numFramesInFlight, MultiGpuMode mode)
+  : m_displayDevice(displayDevice)
+  , m_displayQueue(displayQueue)
+  , m_format(format)
+  , m_numFramesInFlight(numFramesInFlight)
+  , m_isLinkedAdapter(secondaryDevices.empty())
+  , m_scheduler(m_isLinkedAdapter ? displayDevice->GetNodeCount() : 1 + static_cast<uint32_t>(secondaryDevices.size()),
+      numFramesInFlight, mode)
+  , m_displaySlotFenceValues(numFramesInFlight, 0)
+  , m_displaySlotBands(numFramesInFlight, MultiGpuBand{ 0, 0 })
+  , m_outputWidth(0)
+  , m_outputHeight(0)
+  , m_renderWidth(0)
+{
+  // Other adapters only see the composite fence if it's shared across adapters:
+  const D3D12_FENCE_FLAGS compositeFenceFlags = m_isLinkedAdapter ? D3D12_FENCE_FLAG_NONE :
+    D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER;
+  DX12_CHECK(m_displayDevice->CreateFence(0, compositeFenceFlags, IID_PPV_ARGS(&m_compositeFence)),
+    "Failed to create composite fence!");
+
+  m_compositeFenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+  assert(m_compositeFenceEvent && "Failed to create composite fence event!");
+
+  m_displayTimer = std::make_unique<GpuTimer>(displayDevice, displayQueue, numFramesInFlight);
+
+  // A linked adapter's nodes all share the display device, node 0 being the display GPU:
+  if (m_isLinkedAdapter)
+  {
+    for (uint32_t node = 1; node < displayDevice->GetNodeCount(); ++node)
+      CreateGpu(displayDevice, 1u << node);
+  }
+  else
+  {
+    for (const Microsoft::WRL::ComPtr<ID3D12Device2>& device : secondaryDevices)
+      CreateGpu(device.Get(), 0);
+  }
+}
+
+MultiGpuContext::~MultiGpuContext()
+{
+  Flush();
+
+  for (std::unique_ptr<Gpu>& gpu : m_gpus)
+    ::CloseHandle(gpu->fenceEvent);
+  ::CloseHandle(m_compositeFenceEvent);
+}
+
+void MultiGpuContext::Resize(uint32_t outputWidth, uint32_t outputHeight)
+{
+  outputWidth = std::max(outputWidth, 1u);
+  outputHeight = std::max(outputHeight, 1u);
+  if (outputWidth == m_outputWidth && outputHeight == m_outputHeight)
+    return;
+
+  Flush();
+
+  m_outputWidth = outputWidth;
+  m_outputHeight = outputHeight;
+  for (std::unique_ptr<Gpu>& gpu : m_gpus)
+    CreateTargets(*gpu);
+}
+
+const MultiGpuFramePlan& MultiGpuContext::BeginFrame(uint64_t frameId, uint32_t renderHeight)
+{
+  assert(m_outputWidth > 0 && "Resize() has to be called before rendering!");
+
+  CollectDisplayTimings();
+
+  const MultiGpuFramePlan& plan = m_scheduler.PlanFrame(frameId, std::min(renderHeight, m_outputHeight));
+  for (const MultiGpuWork& work : plan.work)
+  {
+    if (work.gpu == 0)
+      continue;
+
+    // The frame that last used this slot's allocator and timestamps has to have finished. Its timing
+    // is then ready, though it no longer affects this frame's bands, only the next ones':
+    Gpu& gpu = *m_gpus[work.gpu - 1];
+    WaitForFence(gpu.fence.Get(), work.slotFenceValue, gpu.fenceEvent);
+
+    const float gpuTime = gpu.timer->GetFrameTime(work.slot);
+    if (gpuTime >= 0.0f)
+      m_scheduler.ReportGpuTime(work.gpu, gpu.slotBands[work.slot], gpuTime);
+  }
+
+  return plan;
+}
+
+D3D12_RECT MultiGpuContext::GetDisplayBand(uint32_t renderWidth) const
+{
+  const MultiGpuFramePlan& plan = m_scheduler.GetPlan();
+  if (plan.work.empty() || plan.work[0].gpu != 0)
+    return CD3DX12_RECT(0, 0, 0, 0);
+
+  const MultiGpuBand& band = plan.work[0].band;
+  return CD3DX12_RECT(0, static_cast<LONG>(band.top), static_cast<LONG>(renderWidth), static_cast<LONG>(band.bottom));
+}
+
+void MultiGpuContext::BeginDisplayBand(FilteredCommandList& commandList)
+{
+  const MultiGpuFramePlan& plan = m_scheduler.GetPlan();
+  if (plan.work.empty() || plan.work[0].gpu != 0)
+    return;
+
+  const uint32_t slot = static_cast<uint32_t>(plan.compositeFenceValue % m_numFramesInFlight);
+
+  // Slots are reused in composite order, so the previous frame in this one has usually long finished:
+  if (m_displaySlotFenceValues[slot] != 0)
+  {
+    WaitForFence(m_compositeFence.Get(), m_displaySlotFenceValues[slot], m_compositeFenceEvent);
+    CollectDisplayTimings();
+  }
+
+  m_displayTimer->BeginFrame(commandList, slot);
+}
+
+void MultiGpuContext::EndDisplayBand(FilteredCommandList& commandList)
+{
+  const MultiGpuFramePlan& plan = m_scheduler.GetPlan();
+  if (plan.work.empty() || plan.work[0].gpu != 0)
+    return;
+
+  const uint32_t slot = static_cast<uint32_t>(plan.compositeFenceValue % m_numFramesInFlight);
+  m_displayTimer->EndFrame(commandList, slot);
+  m_displaySlotFenceValues[slot] = plan.compositeFenceValue;
+  m_displaySlotBands[slot] = plan.work[0].band;
+}
+
+void MultiGpuContext::RenderSecondaries(uint32_t renderWidth, uint32_t renderHeight, const RecordFunc& record)
+{
+  m_renderWidth = std::min(std::max(renderWidth, 1u), m_outputWidth);
+  renderHeight = std::min(std::max(renderHeight, 1u), m_outputHeight);
+
+  for (const MultiGpuWork& work : m_scheduler.GetPlan().work)
+  {
+    if (work.gpu == 0)
+      continue;
+
+    Gpu& gpu = *m_gpus[work.gpu - 1];
+    ID3D12CommandAllocator* allocator = gpu.allocators[work.slot].Get();
+    DX12_CHECK(allocator->Reset());
+
+    // Render the band:
+    {
+      DX12_CHECK(gpu.renderList->Reset(allocator, nullptr));
+      gpu.filteredList.Begin(gpu.renderList.Get());
+      gpu.timer->BeginFrame(gpu.filteredList, work.slot);
+
+      const D3D12_CPU_DESCRIPTOR_HANDLE rtv = gpu.rtvHeap->GetCPUDescriptorHandleForHeapStart();
+      const CD3DX12_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(m_renderWidth), static_cast<float>(renderHeight));
+      const CD3DX12_RECT band(0, static_cast<LONG>(work.band.top), static_cast<LONG>(m_renderWidth),
+        static_cast<LONG>(work.band.bottom));
+      gpu.filteredList.OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+      gpu.filteredList.RSSetViewports(1, &viewport);
+      gpu.filteredList.RSSetScissorRects(1, &band);
+
+      record(gpu.filteredList, rtv, band);
+
+      gpu.timer->EndFrame(gpu.filteredList, work.slot);
+      gpu.slotBands[work.slot] = work.band;
+
+      gpu.filteredList.FlushBarriers();
+      DX12_CHECK(gpu.renderList->Close());
+      ID3D12CommandList* const commandLists[] = { gpu.renderList.Get() };
+      gpu.queue->ExecuteCommandLists(_countof(commandLists), commandLists);
+    }
+
+    // Copy it out once the display GPU has read the last band copied, the GPU rendering meanwhile:
+    {
+      DX12_CHECK(gpu.queue->Wait(gpu.compositeFence.Get(), work.compositeWaitValue));
+      DX12_CHECK(gpu.copyList->Reset(allocator, nullptr));
+      gpu.filteredList.Begin(gpu.copyList.Get());
+
+      CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(gpu.renderTarget.Get(),
+        D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+      gpu.filteredList.ResourceBarrier(1, &barrier);
+
+      D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = gpu.footprint;
+      footprint.Footprint.Width = m_renderWidth;
+      footprint.Footprint.Height = work.band.bottom - work.band.top;
+      const CD3DX12_TEXTURE_COPY_LOCATION dest(gpu.sharedCopy.Get(), footprint);
+      const CD3DX12_TEXTURE_COPY_LOCATION source(gpu.renderTarget.Get(), 0);
+      const CD3DX12_BOX sourceBox(0, static_cast<LONG>(work.band.top), static_cast<LONG>(m_renderWidth),
+        static_cast<LONG>(work.band.bottom));
+      gpu.filteredList.CopyTextureRegion(&dest, 0, 0, 0, &source, &sourceBox);
+
+      barrier = CD3DX12_RESOURCE_BARRIER::Transition(gpu.renderTarget.Get(),
+        D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+      gpu.filteredList.ResourceBarrier(1, &barrier);
+      gpu.filteredList.FlushBarriers();
+
+      DX12_CHECK(gpu.copyList->Close());
+      ID3D12CommandList* const commandLists[] = { gpu.copyList.Get() };
+      gpu.queue->ExecuteCommandLists(_countof(commandLists), commandLists);
+      DX12_CHECK(gpu.queue->Signal(gpu.fence.Get(), work.fenceValue));
+      gpu.lastFenceValue = work.fenceValue;
+    }
+  }
+}
+
+void MultiGpuContext::WaitForSecondaries()
+{
+  for (const MultiGpuWork& work : m_scheduler.GetPlan().work)
+  {
+    if (work.gpu != 0)
+      DX12_CHECK(m_displayQueue->Wait(m_gpus[work.gpu - 1]->displayFence.Get(), work.fenceValue));
+  }
+}
+
+void MultiGpuContext::Composite(FilteredCommandList& commandList, ID3D12Resource* target)
+{
+  for (const MultiGpuWork& work : m_scheduler.GetPlan().work)
+  {
+    if (work.gpu == 0)
+      continue;
+
+    // Buffers are promoted to and decay from whatever state a copy needs, so the shared copy needs no barriers:
+    const Gpu& gpu = *m_gpus[work.gpu - 1];
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = gpu.footprint;
+    footprint.Footprint.Width = m_renderWidth;
+    footprint.Footprint.Height = work.band.bottom - work.band.top;
+
+    const CD3DX12_TEXTURE_COPY_LOCATION dest(target, 0);
+    const CD3DX12_TEXTURE_COPY_LOCATION source(gpu.displaySharedCopy.Get(), footprint);
+    commandList.CopyTextureRegion(&dest, 0, work.band.top, 0, &source, nullptr);
+  }
+}
+
+void MultiGpuContext::EndFrame()
+{
+  DX12_CHECK(m_displayQueue->Signal(m_compositeFence.Get(), m_scheduler.GetPlan().compositeFenceValue));
+}
+
+void MultiGpuContext::Flush()
+{
+  for (std::unique_ptr<Gpu>& gpu : m_gpus)
+    WaitForFence(gpu->fence.Get(), gpu->lastFenceValue, gpu->fenceEvent);
+}
+
+void MultiGpuContext::CreateGpu(ID3D12Device2* device, uint32_t nodeMask)
+{
+  std::unique_ptr<Gpu> gpu = std::make_unique<Gpu>();
+  gpu->device = device;
+  gpu->nodeMask = nodeMask;
+  gpu->lastFenceValue = 0;
+  gpu->slotBands.resize(m_numFramesInFlight, MultiGpuBand{ 0, 0 });
+
+  D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+  queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+  queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+  queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+  queueDesc.NodeMask = nodeMask;
+  DX12_CHECK(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&gpu->queue)), "Failed to create secondary GPU queue!");
+
+  gpu->allocators.resize(m_numFramesInFlight);
+  for (Microsoft::WRL::ComPtr<ID3D12CommandAllocator>& allocator : gpu->allocators)
+  {
+    DX12_CHECK(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)),
+      "Failed to create secondary GPU command allocator!");
+    gpu->memory.push_back(TrackCommandAllocator());
+  }
+
+  // Both lists are created closed and reset with the frame's allocator when recorded:
+  for (Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>* commandList : { &gpu->renderList, &gpu->copyList })
+  {
+    DX12_CHECK(device->CreateCommandList(nodeMask, D3D12_COMMAND_LIST_TYPE_DIRECT, gpu->allocators[0].Get(), nullptr,
+      IID_PPV_ARGS(commandList->GetAddressOf())), "Failed to create secondary GPU command list!");
+    DX12_CHECK((*commandList)->Close());
+  }
+
+  gpu->timer = std::make_unique<GpuTimer>(device, gpu->queue.Get(), m_numFramesInFlight, nodeMask);
+
+  // A linked adapter's fences are visible to all its nodes. Across adapters each fence is created on
+  // the device signalling it, and opened on the one waiting for it:
+  if (m_isLinkedAdapter)
+  {
+    DX12_CHECK(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&gpu->fence)),
+      "Failed to create secondary GPU fence!");
+    gpu->displayFence = gpu->fence;
+    gpu->compositeFence = m_compositeFence;
+  }
+  else
+  {
+    DX12_CHECK(device->CreateFence(0, D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER,
+      IID_PPV_ARGS(&gpu->fence)), "Failed to create secondary GPU fence!");
+    gpu->displayFence = OpenOnDevice<ID3D12Fence>(device, gpu->fence.Get(), m_displayDevice.Get());
+    gpu->compositeFence = OpenOnDevice<ID3D12Fence>(m_displayDevice.Get(), m_compositeFence.Get(), device);
+  }
+
+  gpu->fenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+  assert(gpu->fenceEvent && "Failed to create secondary GPU fence event!");
+
+  D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
+  rtvHeapDesc.NumDescriptors = 1;
+  rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+  rtvHeapDesc.NodeMask = nodeMask;
+  DX12_CHECK(device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&gpu->rtvHeap)),
+    "Failed to create secondary GPU RTV heap!");
+  gpu->memory.push_back(TrackDescriptorHeap(device, gpu->rtvHeap.Get()));
+
+  if (m_outputWidth > 0)
+    CreateTargets(*gpu);
+
+  m_gpus.push_back(std::move(gpu));
+}
+
+void MultiGpuContext::CreateTargets(Gpu& gpu)
+{
+  gpu.renderTarget.Reset();
+  gpu.sharedCopy.Reset();
+  gpu.displaySharedCopy.Reset();
+  gpu.targetMemory.clear();
+
+  // Output size like the display GPU's scene target, smaller render resolutions using its top-left region:
+  const CD3DX12_HEAP_PROPERTIES targetHeapProperties(D3D12_HEAP_TYPE_DEFAULT, gpu.nodeMask, gpu.nodeMask);
+  const CD3DX12_RESOURCE_DESC targetDesc = CD3DX12_RESOURCE_DESC::Tex2D(m_format, m_outputWidth, m_outputHeight, 1, 1, 1, 0,
+    D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+  D3D12_CLEAR_VALUE clearValue = {};
+  clearValue.Format = m_format;
+
+  DX12_CHECK(gpu.device->CreateCommittedResource(&targetHeapProperties, D3D12_HEAP_FLAG_NONE, &targetDesc,
+    D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue, IID_PPV_ARGS(&gpu.renderTarget)),
+    "Failed to create secondary GPU render target!");
+  gpu.targetMemory.push_back(TrackResource(gpu.device.Get(), gpu.renderTarget.Get(), MemoryCategory::RenderTargets));
+  gpu.device->CreateRenderTargetView(gpu.renderTarget.Get(), nullptr, gpu.rtvHeap->GetCPUDescriptorHandleForHeapStart());
+
+  // Bands are copied out as rows of a buffer, which unlike textures every adapter can share:
+  uint64_t sharedCopySize = 0;
+  gpu.device->GetCopyableFootprints(&targetDesc, 0, 1, 0, &gpu.footprint, nullptr, nullptr, &sharedCopySize);
+
+  if (m_isLinkedAdapter)
+  {
+    // Lives on the display GPU, which reads it every frame, and is written across the link:
+    const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT, 1, 1 | gpu.nodeMask);
+    const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sharedCopySize);
+    DX12_CHECK(gpu.device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+      D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&gpu.sharedCopy)), "Failed to create shared band copy!");
+    gpu.displaySharedCopy = gpu.sharedCopy;
+    gpu.targetMemory.push_back(TrackResource(gpu.device.Get(), gpu.sharedCopy.Get(), MemoryCategory::Buffers));
+  }
+  else
+  {
+    // A cross-adapter heap created on the display device and opened on the secondary one, with the
+    // buffer placed at the start of it on both:
+    const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sharedCopySize,
+      D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER);
+    const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_displayDevice->GetResourceAllocationInfo(0, 1, &bufferDesc);
+
+    const CD3DX12_HEAP_DESC heapDesc(allocationInfo.SizeInBytes, D3D12_HEAP_TYPE_DEFAULT, 0,
+      D3D12_HEAP_FLAG_SHARED | D3D12_HEAP_FLAG_SHARED_CROSS_ADAPTER);
+    Microsoft::WRL::ComPtr<ID3D12Heap> displayHeap;
+    DX12_CHECK(m_displayDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&displayHeap)), "Failed to create cross-adapter heap!");
+    gpu.targetMemory.push_back(TrackHeap(displayHeap.Get(), MemoryCategory::CrossAdapterHeaps));
+    Microsoft::WRL::ComPtr<ID3D12Heap> heap = OpenOnDevice<ID3D12Heap>(m_displayDevice.Get(), displayHeap.Get(),
+      gpu.device.Get());
+
+    DX12_CHECK(m_displayDevice->CreatePlacedResource(displayHeap.Get(), 0, &bufferDesc, D3D12_RESOURCE_STATE_COMMON,
+      nullptr, IID_PPV_ARGS(&gpu.displaySharedCopy)), "Failed to create shared band copy!");
+    DX12_CHECK(gpu.device->CreatePlacedResource(heap.Get(), 0, &bufferDesc, D3D12_RESOURCE_STATE_COMMON,
+      nullptr, IID_PPV_ARGS(&gpu.sharedCopy)), "Failed to create shared band copy!");
+  }
+}
+
+void MultiGpuContext::WaitForFence(ID3D12Fence* fence, uint64_t value, HANDLE event) const
+{
+  if (fence->GetCompletedValue() < value)
+  {
+    DX12_CHECK(fence->SetEventOnCompletion(value, event));
+    ::WaitForSingleObject(event, INFINITE);
+  }
+}
+
+// Passes the display GPU's time over its band of every frame composited since the last call to the scheduler:
+void MultiGpuContext::CollectDisplayTimings()
+{
+  const uint64_t completedValue = m_compositeFence->GetCompletedValue();
+  for (uint32_t slot = 0; slot < m_numFramesInFlight; ++slot)
+  {
+    if (m_displaySlotFenceValues[slot] == 0 || m_displaySlotFenceValues[slot] > completedValue)
+      continue;
+
+    const float gpuTime = m_displayTimer->GetFrameTime(slot);
+    if (gpuTime >= 0.0f)
+      m_scheduler.ReportGpuTime(0, m_displaySlotBands[slot], gpuTime);
+    m_displaySlotFenceValues[slot] = 0;
+  }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "FilteredCommandList.h"
+#include "MemoryTracker.h"
+#include "MultiGpuScheduler.h"
+
+class GpuTimer;
+
+// Explicit multi-adapter rendering: GPUs besides the display GPU render whole frames (alternate-frame)
+// or bands of every frame (split-frame) as the MultiGpuScheduler plans, and the display GPU copies
+// their results into its scene target before upscaling and presenting. The secondary GPUs are either
+// the other nodes of a linked adapter, sharing the display device, or devices on other adapters, which
+// hand their bands over through cross-adapter shared heaps and fences.
+//
+// Per frame, on the thread rendering it:
+//  - BeginFrame() plans the frame,
+//  - the display GPU's band (if any) is recorded between BeginDisplayBand() and EndDisplayBand(), and
+//    its command list executed,
+//  - RenderSecondaries() records and submits the other GPUs' parts,
+//  - WaitForSecondaries() makes the display queue wait for them, and Composite() records the copies
+//    into a command list executed after that,
+//  - EndFrame() signals that the copies have been made.
+class MultiGpuContext
+{
+public:
+	// Records a secondary GPU's part of the frame, with its render target bound, the viewport covering
+	// the render size and the scissor its band:
+	using RecordFunc = std::function<void(FilteredCommandList& commandList, D3D12_CPU_DESCRIPTOR_HANDLE rtv,
+		const D3D12_RECT& band)>;
+
+	// secondaryDevices are devices on other adapters to render on, if empty the display device's other
+	// nodes are used instead (i.e. it has to be a linked adapter for there to be any secondary GPUs):
+	MultiGpuContext(ID3D12Device2* displayDevice, ID3D12CommandQueue* displayQueue,
+		const std::vector<Microsoft::WRL::ComPtr<ID3D12Device2>>& secondaryDevices, DXGI_FORMAT format,
+		uint32_t numFramesInFlight, MultiGpuMode mode);
+	~MultiGpuContext();
+
+	MultiGpuContext(const MultiGpuContext&) = delete;
+	MultiGpuContext& operator=(const MultiGpuContext&) = delete;
+
+	uint32_t NumGpus() const { return m_scheduler.NumGpus(); }
+	bool IsLinkedAdapter() const { return m_isLinkedAdapter; }
+
+	void SetMode(MultiGpuMode mode) { m_scheduler.SetMode(mode); }
+	MultiGpuMode GetMode() const { return m_scheduler.GetMode(); }
+	const std::vector<float>& GetSplit() const { return m_scheduler.GetSplit(); }
+
+	// Recreates the secondaries' targets and shared copies for a new output size, waiting for them to be idle:
+	void Resize(uint32_t outputWidth, uint32_t outputHeight);
+
+	// Plans the frame, waiting for the secondary GPUs taking part to be done with the resources the frame
+	// reuses. Timings of the frames they were last used for feed the split-frame balance:
+	const MultiGpuFramePlan& BeginFrame(uint64_t frameId, uint32_t renderHeight);
+	const MultiGpuFramePlan& GetPlan() const { return m_scheduler.GetPlan(); }
+
+	// The display GPU's band of the frame, or an empty rect if it has none:
+	D3D12_RECT GetDisplayBand(uint32_t renderWidth) const;
+
+	// Time the display GPU's band, for balancing split frames:
+	void BeginDisplayBand(FilteredCommandList& commandList);
+	void EndDisplayBand(FilteredCommandList& commandList);
+
+	void RenderSecondaries(uint32_t renderWidth, uint32_t renderHeight, const RecordFunc& record);
+
+	// Makes the display queue wait for the secondaries' bands to have been copied out. Work already
+	// executed on it (e.g. the display GPU's own band) isn't held up:
+	void WaitForSecondaries();
+
+	// Copies the secondaries' bands into target, which must be in the copy dest state:
+	void Composite(FilteredCommandList& commandList, ID3D12Resource* target);
+
+	// Signals on the display queue that the bands have been read, once the composite has been executed:
+	void EndFrame();
+
+	// Waits for every secondary GPU to go idle:
+	void Flush();
+
+private:
+	struct Gpu
+	{
+		Microsoft::WRL::ComPtr<ID3D12Device2>						device;				// The display device for a linked adapter's nodes.
+		uint32_t													nodeMask;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue>					queue;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>	allocators;			// Per frame slot.
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>			renderList;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>			copyList;			// Executed after waiting for the last composite.
+		FilteredCommandList											filteredList;
+		std::unique_ptr<GpuTimer>									timer;
+		std::vector<MultiGpuBand>									slotBands;			// Band timed in each frame slot.
+
+		Microsoft::WRL::ComPtr<ID3D12Fence>							fence;				// Signalled once the GPU's band has been copied out...
+		Microsoft::WRL::ComPtr<ID3D12Fence>							displayFence;		// ...and the same fence on the display device.
+		Microsoft::WRL::ComPtr<ID3D12Fence>							compositeFence;		// The composite fence on this GPU's device.
+		uint64_t													lastFenceValue;
+		HANDLE														fenceEvent;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource>						renderTarget;
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>				rtvHeap;
+		Microsoft::WRL::ComPtr<ID3D12Resource>						sharedCopy;			// Band copied out by this GPU...
+		Microsoft::WRL::ComPtr<ID3D12Resource>						displaySharedCopy;	// ...and read by the display GPU, the same resource on a linked adapter.
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT							footprint;			// Layout of the output size in the shared copy.
+
+		std::vector<TrackedAllocation>								memory;				// Allocators and the RTV heap...
+		std::vector<TrackedAllocation>								targetMemory;		// ...and what CreateTargets() creates.
+	};
+
+	void CreateGpu(ID3D12Device2* device, uint32_t nodeMask);
+	void CreateTargets(Gpu& gpu);
+	void WaitForFence(ID3D12Fence* fence, uint64_t value, HANDLE event) const;
+	void CollectDisplayTimings();
+
+	Microsoft::WRL::ComPtr<ID3D12Device2>		m_displayDevice;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue>	m_displayQueue;
+	DXGI_FORMAT									m_format;
+	uint32_t									m_numFramesInFlight;
+	bool										m_isLinkedAdapter;
+	MultiGpuScheduler							m_scheduler;
+	std::vector<std::unique_ptr<Gpu>>			m_gpus;						// Secondary GPUs, GPU i + 1 in the plans.
+
+	Microsoft::WRL::ComPtr<ID3D12Fence>			m_compositeFence;			// Signalled by the display queue after each composite.
+	HANDLE										m_compositeFenceEvent;
+	std::unique_ptr<GpuTimer>					m_displayTimer;
+	std::vector<uint64_t>						m_displaySlotFenceValues;	// Per slot, composite fence value of the frame timed in it, 0 once collected...
+	std::vector<MultiGpuBand>					m_displaySlotBands;			// ...and the display GPU's band in it.
+
+	uint32_t									m_outputWidth;
+	uint32_t									m_outputHeight;
+	uint32_t									m_renderWidth;
+};
@@ -0,0 +1,134 @@
+#include "MultiGpuScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+  // Weight of each new timing in a GPU's smoothed time per row:
+  const float c_timingSmoothing = 0.2f;
+
+  // No GPU's band shrinks below this share, so a GPU that had a slow frame still gets measured again:
+  const float c_minSplitShare = 0.05f;
+}
+
+MultiGpuScheduler::MultiGpuScheduler(uint32_t numGpus, uint32_t numFramesInFlight, MultiGpuMode mode)
+  : m_numGpus(numGpus)
+  , m_numFramesInFlight(numFramesInFlight)
+  , m_mode(mode)
+  , m_frameCounts(numGpus, 0)
+  , m_slotFenceValues(numGpus * numFramesInFlight, 0)
+  , m_lastCompositeReads(numGpus, 0)
+  , m_compositeFenceValue(0)
+{
+  assert(numGpus > 0 && numFramesInFlight > 0);
+  m_plan.frameId = 0;
+  m_plan.compositeFenceValue = 0;
+  ResetSplit();
+}
+
+void MultiGpuScheduler::SetMode(MultiGpuMode mode)
+{
+  m_mode = mode;
+  ResetSplit();
+}
+
+const MultiGpuFramePlan& MultiGpuScheduler::PlanFrame(uint64_t frameId, uint32_t height)
+{
+  m_plan.frameId = frameId;
+  m_plan.work.clear();
+  m_plan.compositeFenceValue = ++m_compositeFenceValue;
+
+  switch (m_numGpus > 1 ? m_mode : MultiGpuMode::Single)
+  {
+  case MultiGpuMode::Single:
+    AddWork(0, 0, height);
+    break;
+
+  case MultiGpuMode::AlternateFrame:
+    AddWork(static_cast<uint32_t>(m_compositeFenceValue % m_numGpus), 0, height);
+    break;
+
+  case MultiGpuMode::SplitFrame:
+  {
+    // Band edges from the running total of the shares, so rounding never loses or doubles a row:
+    float total = 0.0f;
+    uint32_t top = 0;
+    for (uint32_t gpu = 0; gpu < m_numGpus; ++gpu)
+    {
+      total += m_split[gpu];
+      const uint32_t bottom = (gpu + 1 == m_numGpus) ? height :
+        std::min(static_cast<uint32_t>(total * static_cast<float>(height) + 0.5f), height);
+
+      if (bottom > top)
+        AddWork(gpu, top, bottom);
+      top = std::max(top, bottom);
+    }
+    break;
+  }
+  }
+
+  return m_plan;
+}
+
+void MultiGpuScheduler::ReportGpuTime(uint32_t gpu, const MultiGpuBand& band, float milliseconds)
+{
+  assert(gpu < m_numGpus);
+  if (m_mode != MultiGpuMode::SplitFrame || band.bottom <= band.top || milliseconds <= 0.0f)
+    return;
+
+  const float msPerRow = milliseconds / static_cast<float>(band.bottom - band.top);
+  float& smoothed = m_msPerRow[gpu];
+  smoothed = (smoothed <= 0.0f) ? msPerRow : smoothed + c_timingSmoothing * (msPerRow - smoothed);
+
+  // Once every GPU has been measured, give each rows in proportion to how fast it gets through them:
+  float totalSpeed = 0.0f;
+  for (float gpuMsPerRow : m_msPerRow)
+  {
+    if (gpuMsPerRow <= 0.0f)
+      return;
+    totalSpeed += 1.0f / gpuMsPerRow;
+  }
+
+  float totalShare = 0.0f;
+  for (uint32_t i = 0; i < m_numGpus; ++i)
+  {
+    m_split[i] = std::max(1.0f / (m_msPerRow[i] * totalSpeed), c_minSplitShare);
+    totalShare += m_split[i];
+  }
+
+  for (float& share : m_split)
+    share /= totalShare;
+}
+
+MultiGpuWork& MultiGpuScheduler::AddWork(uint32_t gpu, uint32_t top, uint32_t bottom)
+{
+  const uint64_t frameCount = ++m_frameCounts[gpu];
+  uint64_t& slotFenceValue = m_slotFenceValues[gpu * m_numFramesInFlight + (frameCount % m_numFramesInFlight)];
+
+  MultiGpuWork work = {};
+  work.gpu = gpu;
+  work.slot = static_cast<uint32_t>(frameCount % m_numFramesInFlight);
+  work.band = { top, bottom };
+
+  // The display GPU's frames are fenced by the swap chain's frame loop. Secondaries fence their own,
+  // counting frames, and hand their band over through a single shared copy:
+  if (gpu != 0)
+  {
+    work.slotFenceValue = slotFenceValue;
+    work.fenceValue = frameCount;
+    work.compositeWaitValue = m_lastCompositeReads[gpu];
+
+    slotFenceValue = frameCount;
+    m_lastCompositeReads[gpu] = m_plan.compositeFenceValue;
+  }
+
+  m_plan.work.push_back(work);
+  return m_plan.work.back();
+}
+
+void MultiGpuScheduler::ResetSplit()
+{
+  m_split.assign(m_numGpus, 1.0f / static_cast<float>(m_numGpus));
+  m_msPerRow.assign(m_numGpus, 0.0f);
+}
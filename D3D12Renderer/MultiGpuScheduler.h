@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class MultiGpuMode
+{
+	Single,						// Everything on the display GPU.
+	AlternateFrame,		// Whole frames round-robin across GPUs.
+	SplitFrame,				// Every GPU renders a horizontal band of each frame.
+};
+
+// Rows [top, bottom) of the frame:
+struct MultiGpuBand
+{
+	uint32_t	top;
+	uint32_t	bottom;
+};
+
+// One GPU's part of a frame. GPU 0 is the display GPU, every other GPU renders into its own target,
+// copies its band to memory the display GPU can read, then signals its fence:
+struct MultiGpuWork
+{
+	uint32_t			gpu;
+	uint32_t			slot;								// Which of the GPU's per-frame resources to use...
+	uint64_t			slotFenceValue;			// ...once its fence has reached this, i.e. it's done with their last use.
+	uint64_t			compositeWaitValue;	// Secondaries only, composite fence value to wait for before overwriting the shared copy.
+	uint64_t			fenceValue;					// Secondaries only, signalled on the GPU's fence once its band has been copied.
+	MultiGpuBand	band;
+};
+
+struct MultiGpuFramePlan
+{
+	uint64_t									frameId;
+	std::vector<MultiGpuWork>	work;								// The display GPU's first, when it renders part of the frame.
+	uint64_t									compositeFenceValue;	// Signalled by the display GPU once it's copied every band.
+};
+
+// Decides which GPU renders what for each frame, and the fence values the GPUs synchronise on, without
+// touching any D3D12 so it can be driven by simulated GPUs:
+//  - Each secondary GPU's fence counts its frames, the display GPU waits on it before compositing.
+//  - The composite fence counts composites, secondaries wait on it before overwriting the shared copy
+//    the last composite read.
+//  - Split-frame bands are balanced on measured GPU times, so each GPU's band takes about as long.
+class MultiGpuScheduler
+{
+public:
+	MultiGpuScheduler(uint32_t numGpus, uint32_t numFramesInFlight, MultiGpuMode mode);
+
+	// Fence values carry on across mode changes, only the split-frame balance starts over:
+	void SetMode(MultiGpuMode mode);
+	MultiGpuMode GetMode() const { return m_mode; }
+	uint32_t NumGpus() const { return m_numGpus; }
+
+	const MultiGpuFramePlan& PlanFrame(uint64_t frameId, uint32_t height);
+	const MultiGpuFramePlan& GetPlan() const { return m_plan; }
+
+	// How long the GPU took over its band of a split frame, for balancing the next ones:
+	void ReportGpuTime(uint32_t gpu, const MultiGpuBand& band, float milliseconds);
+
+	// Share of each split frame's rows given to each GPU, summing to 1:
+	const std::vector<float>& GetSplit() const { return m_split; }
+
+private:
+	MultiGpuWork& AddWork(uint32_t gpu, uint32_t top, uint32_t bottom);
+	void ResetSplit();
+
+	uint32_t								m_numGpus;
+	uint32_t								m_numFramesInFlight;
+	MultiGpuMode						m_mode;
+	MultiGpuFramePlan				m_plan;
+
+	std::vector<uint64_t>		m_frameCounts;					// Per GPU, frames it's taken part in.
+	std::vector<uint64_t>		m_slotFenceValues;			// Per GPU and slot, fence value of the slot's last use.
+	std::vector<uint64_t>		m_lastCompositeReads;		// Per GPU, composite that last read its shared copy.
+	uint64_t								m_compositeFenceValue;
+
+	std::vector<float>			m_split;
+	std::vector<float>			m_msPerRow;							// Per GPU, smoothed, 0 until measured.
+};
@@ -0,0 +1,147 @@
+#include "RadixSort.h"
+#include "JobSystem.h"
+
+#include <cstring>
+#include <utility>
+
+namespace
+{
+  const uint32_t c_digitBits = 8;
+  const uint32_t c_numBuckets = 1 << c_digitBits;
+  const uint32_t c_numDigits = 64 / c_digitBits;
+
+  // Below this, or per block, splitting the work costs more than it saves:
+  const uint32_t c_minKeysPerBlock = 16 * 1024;
+
+  uint32_t Digit(uint64_t key, uint32_t digit)
+  {
+    return static_cast<uint32_t>(key >> (digit * c_digitBits)) & (c_numBuckets - 1);
+  }
+
+  template<typename Func>
+  void ForEachBlock(JobSystem* jobSystem, uint32_t numBlocks, const Func& func)
+  {
+    if (numBlocks == 1)
+    {
+      func(0);
+      return;
+    }
+
+    jobSystem->ParallelFor(numBlocks, 1, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t block = begin; block < end; ++block)
+        func(block);
+      });
+  }
+}
+
+void RadixSort(uint64_t* keys, uint32_t* values, uint32_t count, RadixSortScratch& scratch, JobSystem* jobSystem)
+{
+  if (count <= 1)
+    return;
+
+  uint32_t numBlocks = 1;
+  if (jobSystem)
+  {
+    numBlocks = count / c_minKeysPerBlock;
+    if (numBlocks > jobSystem->NumThreads())
+      numBlocks = jobSystem->NumThreads();
+    if (numBlocks == 0)
+      numBlocks = 1;
+  }
+
+  const uint32_t blockSize = (count + numBlocks - 1) / numBlocks;
+  auto blockBegin = [&](uint32_t block) { return block * blockSize; };
+  auto blockEnd = [&](uint32_t block) { return (block + 1 == numBlocks) ? count : (block + 1) * blockSize; };
+
+  // Histogram every digit of every block in one read of the keys:
+  scratch.digitHistograms.assign(numBlocks * c_numDigits * c_numBuckets, 0);
+  ForEachBlock(jobSystem, numBlocks, [&](uint32_t block) {
+    uint32_t* histograms = scratch.digitHistograms.data() + block * c_numDigits * c_numBuckets;
+    for (uint32_t i = blockBegin(block); i < blockEnd(block); ++i)
+    {
+      const uint64_t key = keys[i];
+      for (uint32_t digit = 0; digit < c_numDigits; ++digit)
+        ++histograms[digit * c_numBuckets + Digit(key, digit)];
+    }
+    });
+
+  scratch.keys.resize(count);
+  scratch.values.resize(count);
+  scratch.passHistograms.resize(numBlocks * c_numBuckets);
+
+  uint64_t* srcKeys = keys;
+  uint32_t* srcValues = values;
+  uint64_t* dstKeys = scratch.keys.data();
+  uint32_t* dstValues = scratch.values.data();
+  bool isFirstPass = true;
+
+  for (uint32_t digit = 0; digit < c_numDigits; ++digit)
+  {
+    // A digit every key shares wouldn't move anything:
+    bool isTrivial = false;
+    for (uint32_t bucket = 0; bucket < c_numBuckets && !isTrivial; ++bucket)
+    {
+      uint32_t total = 0;
+      for (uint32_t block = 0; block < numBlocks; ++block)
+        total += scratch.digitHistograms[(block * c_numDigits + digit) * c_numBuckets + bucket];
+      isTrivial = (total == count);
+    }
+
+    if (isTrivial)
+      continue;
+
+    // The first pass sees the keys in their original blocks, so the up-front histograms still hold.
+    // After that keys have moved between blocks and each pass has to count its own:
+    uint32_t* passHistograms = scratch.passHistograms.data();
+    if (isFirstPass)
+    {
+      for (uint32_t block = 0; block < numBlocks; ++block)
+      {
+        std::memcpy(passHistograms + block * c_numBuckets,
+          scratch.digitHistograms.data() + (block * c_numDigits + digit) * c_numBuckets, c_numBuckets * sizeof(uint32_t));
+      }
+    }
+    else
+    {
+      ForEachBlock(jobSystem, numBlocks, [&](uint32_t block) {
+        uint32_t* histogram = passHistograms + block * c_numBuckets;
+        std::memset(histogram, 0, c_numBuckets * sizeof(uint32_t));
+        for (uint32_t i = blockBegin(block); i < blockEnd(block); ++i)
+          ++histogram[Digit(srcKeys[i], digit)];
+        });
+    }
+
+    // Turn counts into write offsets, bucket-major then block order so equal digits keep their order:
+    uint32_t offset = 0;
+    for (uint32_t bucket = 0; bucket < c_numBuckets; ++bucket)
+    {
+      for (uint32_t block = 0; block < numBlocks; ++block)
+      {
+        const uint32_t blockCount = passHistograms[block * c_numBuckets + bucket];
+        passHistograms[block * c_numBuckets + bucket] = offset;
+        offset += blockCount;
+      }
+    }
+
+    ForEachBlock(jobSystem, numBlocks, [&](uint32_t block) {
+      uint32_t* offsets = passHistograms + block * c_numBuckets;
+      for (uint32_t i = blockBegin(block); i < blockEnd(block); ++i)
+      {
+        const uint32_t destination = offsets[Digit(srcKeys[i], digit)]++;
+        dstKeys[destination] = srcKeys[i];
+        dstValues[destination] = srcValues[i];
+      }
+      });
+
+    std::swap(srcKeys, dstKeys);
+    std::swap(srcValues, dstValues);
+    isFirstPass = false;
+  }
+
+  // An odd number of passes leaves the result in the scratch buffers:
+  if (srcKeys != keys)
+  {
+    std::memcpy(keys, srcKeys, count * sizeof(uint64_t));
+    std::memcpy(values, srcValues, count * sizeof(uint32_t));
+  }
+}
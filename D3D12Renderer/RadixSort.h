@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Reusable buffers for RadixSort(), keeping one around avoids reallocating them every sort:
+struct RadixSortScratch
+{
+	std::vector<uint64_t>	keys;
+	std::vector<uint32_t>	values;
+	std::vector<uint32_t>	digitHistograms;		// Per block, every digit of the unsorted keys.
+	std::vector<uint32_t>	passHistograms;			// Per block, the digit being sorted on.
+};
+
+// Stable LSD radix sort of 64-bit keys, carrying a 32-bit value (typically an index) along with each,
+// one 8-bit digit per pass. A first pass histograms every digit at once, so passes over digits that are
+// the same in every key (e.g. unused high bits of a sort key) are skipped entirely.
+//
+// With a job system the keys are split into one block per thread: each pass histograms the blocks in
+// parallel, prefix sums them (in block order, which keeps the sort stable) and scatters them in parallel.
+void RadixSort(uint64_t* keys, uint32_t* values, uint32_t count, RadixSortScratch& scratch,
+	JobSystem* jobSystem = nullptr);
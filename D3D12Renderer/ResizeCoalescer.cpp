@@ -0,0 +1,60 @@
+#include "ResizeCoalescer.h"
+
+ResizeCoalescer::ResizeCoalescer(uint32_t width, uint32_t height, const ResizeCoalescerSettings& settings)
+  : m_settings(settings)
+  , m_width(width)
+  , m_height(height)
+  , m_pendingWidth(width)
+  , m_pendingHeight(height)
+  , m_firstEventUs(0)
+  , m_lastEventUs(0)
+  , m_isPending(false)
+  , m_isInteractive(false)
+{
+}
+
+void ResizeCoalescer::SetInteractive(bool isInteractive)
+{
+  m_isInteractive = isInteractive;
+}
+
+void ResizeCoalescer::OnResize(uint32_t width, uint32_t height, uint64_t nowUs)
+{
+  ++m_stats.numEvents;
+
+  // Dragged back to the size the swap chain already is, nothing to do after all:
+  if (width == m_width && height == m_height)
+  {
+    m_isPending = false;
+    return;
+  }
+
+  if (!m_isPending)
+    m_firstEventUs = nowUs;
+  if (!m_isPending || width != m_pendingWidth || height != m_pendingHeight)
+    m_lastEventUs = nowUs;
+
+  m_pendingWidth = width;
+  m_pendingHeight = height;
+  m_isPending = true;
+}
+
+bool ResizeCoalescer::TakeResize(uint64_t nowUs, uint32_t& width, uint32_t& height)
+{
+  if (!m_isPending)
+    return false;
+
+  // Outside of a drag (maximising, going fullscreen) the size won't change again right away:
+  if (m_isInteractive && nowUs - m_lastEventUs < m_settings.settleTimeUs &&
+      nowUs - m_firstEventUs < m_settings.maxDeferralUs)
+    return false;
+
+  m_width = m_pendingWidth;
+  m_height = m_pendingHeight;
+  m_isPending = false;
+  ++m_stats.numResizes;
+
+  width = m_width;
+  height = m_height;
+  return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+struct ResizeCoalescerSettings
+{
+	uint64_t	settleTimeUs = 100000;		// While dragging, how long the size has to hold still to be applied...
+	uint64_t	maxDeferralUs = 500000;		// ...or how long a drag can go on before it's applied regardless.
+};
+
+struct ResizeCoalescerStats
+{
+	uint64_t	numEvents;					// Size changes reported.
+	uint64_t	numResizes;					// Times the swap chain was actually resized.
+};
+
+// Decides when to resize the swap chain while the window size is changing. Every resize has to wait
+// for the GPU to finish with the back buffers, so instead of resizing on every WM_SIZE, sizes are only
+// recorded and the latest is applied at a frame boundary. During an interactive drag, resizing is held
+// back until the size settles (or the drag has gone on long enough), so a drag costs a handful of
+// resizes rather than one per mouse move.
+//
+// Times are microseconds on one clock.
+class ResizeCoalescer
+{
+public:
+	ResizeCoalescer(uint32_t width, uint32_t height, const ResizeCoalescerSettings& settings = ResizeCoalescerSettings());
+
+	// Between WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE:
+	void SetInteractive(bool isInteractive);
+	bool IsInteractive() const { return m_isInteractive; }
+
+	void OnResize(uint32_t width, uint32_t height, uint64_t nowUs);
+
+	// At a frame boundary, returns true with the size to resize to if it's time to apply one:
+	bool TakeResize(uint64_t nowUs, uint32_t& width, uint32_t& height);
+
+	bool IsPending() const { return m_isPending; }
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+
+	const ResizeCoalescerStats& GetStats() const { return m_stats; }
+
+private:
+	ResizeCoalescerSettings	m_settings;
+	ResizeCoalescerStats	m_stats = {};
+	uint32_t				m_width;				// Applied size.
+	uint32_t				m_height;
+	uint32_t				m_pendingWidth;
+	uint32_t				m_pendingHeight;
+	uint64_t				m_firstEventUs;			// When the pending size started to differ from the applied one...
+	uint64_t				m_lastEventUs;			// ...and last changed.
+	bool					m_isPending;
+	bool					m_isInteractive;
+};
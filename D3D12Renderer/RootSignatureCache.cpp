@@ -0,0 +1,219 @@
+#include "RootSignatureCache.h"
+#include "Helpers.h"
+
+#include "Dx12Headers/d3dx12.h"
+
+#include <d3d12shader.h>
+#include <d3dcompiler.h>
+
+#include <cassert>
+
+static_assert(static_cast<int>(ShaderVisibility::Pixel) == D3D12_SHADER_VISIBILITY_PIXEL,
+  "ShaderVisibility must match D3D12_SHADER_VISIBILITY!");
+static_assert(RootDataFlags_DescriptorsVolatile == D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE
+  && RootDataFlags_DataStatic == D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC
+  && RootDataFlags_DataStatic == D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+  "RootDataFlags must match D3D12_DESCRIPTOR_RANGE_FLAGS and D3D12_ROOT_DESCRIPTOR_FLAGS!");
+static_assert(RootSignatureFlags_DenyPixelShaderRootAccess == D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS,
+  "RootSignatureFlags must match D3D12_ROOT_SIGNATURE_FLAGS!");
+
+namespace
+{
+  bool ToShaderBindingType(D3D_SHADER_INPUT_TYPE inputType, ShaderBindingType& type, bool& isRawOrStructured)
+  {
+    isRawOrStructured = false;
+
+    switch (inputType)
+    {
+    case D3D_SIT_CBUFFER:
+      type = ShaderBindingType::ConstantBuffer;
+      return true;
+    case D3D_SIT_TBUFFER:
+    case D3D_SIT_TEXTURE:
+      type = ShaderBindingType::SRV;
+      return true;
+    case D3D_SIT_STRUCTURED:
+    case D3D_SIT_BYTEADDRESS:
+    case D3D_SIT_RTACCELERATIONSTRUCTURE:
+      type = ShaderBindingType::SRV;
+      isRawOrStructured = true;
+      return true;
+    case D3D_SIT_UAV_RWSTRUCTURED:
+    case D3D_SIT_UAV_RWBYTEADDRESS:
+      type = ShaderBindingType::UAV;
+      isRawOrStructured = true;
+      return true;
+    case D3D_SIT_UAV_RWTYPED:
+    case D3D_SIT_UAV_APPEND_STRUCTURED:   // Counters can't be bound through root descriptors.
+    case D3D_SIT_UAV_CONSUME_STRUCTURED:
+    case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+    case D3D_SIT_UAV_FEEDBACKTEXTURE:
+      type = ShaderBindingType::UAV;
+      return true;
+    case D3D_SIT_SAMPLER:
+      type = ShaderBindingType::Sampler;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  D3D12_DESCRIPTOR_RANGE_TYPE ToRangeType(ShaderBindingType type)
+  {
+    switch (type)
+    {
+    case ShaderBindingType::ConstantBuffer: return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+    case ShaderBindingType::SRV:            return D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    case ShaderBindingType::UAV:            return D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    default:                                return D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+    }
+  }
+}
+
+ShaderBindingSet ReflectShaderBindings(ID3DBlob* bytecode, ShaderStage stage)
+{
+  Microsoft::WRL::ComPtr<ID3D12ShaderReflection> reflection;
+  DX12_CHECK(D3DReflect(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), IID_PPV_ARGS(&reflection)),
+    "Failed to reflect shader bytecode!");
+
+  D3D12_SHADER_DESC shaderDesc;
+  DX12_CHECK(reflection->GetDesc(&shaderDesc));
+
+  ShaderBindingSet bindingSet;
+  bindingSet.stage = stage;
+  bindingSet.hasInputLayout = stage == ShaderStage::Vertex && shaderDesc.InputParameters > 0;
+  bindingSet.bindings.reserve(shaderDesc.BoundResources);
+
+  for (UINT i = 0; i < shaderDesc.BoundResources; ++i)
+  {
+    D3D12_SHADER_INPUT_BIND_DESC bindDesc;
+    DX12_CHECK(reflection->GetResourceBindingDesc(i, &bindDesc));
+
+    ShaderBinding binding;
+    if (!ToShaderBindingType(bindDesc.Type, binding.type, binding.isRawOrStructured))
+      continue;
+
+    binding.name = bindDesc.Name;
+    binding.shaderRegister = bindDesc.BindPoint;
+    binding.space = bindDesc.Space;
+    binding.count = bindDesc.BindCount;   // Reflection reports unbounded arrays as 0, same as g_unboundedDescriptorCount.
+    binding.sizeInBytes = 0;
+
+    if (binding.type == ShaderBindingType::ConstantBuffer)
+    {
+      D3D12_SHADER_BUFFER_DESC bufferDesc;
+      if (SUCCEEDED(reflection->GetConstantBufferByName(bindDesc.Name)->GetDesc(&bufferDesc)))
+        binding.sizeInBytes = bufferDesc.Size;
+    }
+
+    bindingSet.bindings.push_back(std::move(binding));
+  }
+
+  return bindingSet;
+}
+
+RootSignatureCache::RootSignatureCache(ID3D12Device2* device)
+  : m_device(device)
+  , m_highestVersion(D3D_ROOT_SIGNATURE_VERSION_1_1)
+{
+  // Root signature 1.1 (and with it the data static/volatile flags) needs the Anniversary Update,
+  // D3DX12SerializeVersionedRootSignature converts to 1.0 (dropping the flags) where it's missing:
+  D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+  featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+
+  if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+    m_highestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+}
+
+RootSignatureId RootSignatureCache::GetOrCreate(const RootSignatureLayout& layout)
+{
+  // Probe successive hashes on the (unlikely) event of two different layouts colliding:
+  uint64_t hash = layout.Hash();
+
+  for (RootSignatureId* id = m_lookup.Find(hash); id; id = m_lookup.Find(++hash))
+  {
+    if (m_entries[*id].layout.IsEquivalent(layout))
+      return *id;
+  }
+
+  const RootSignatureId newId = static_cast<RootSignatureId>(m_entries.size());
+  m_entries.push_back(Entry{ layout, CreateRootSignature(layout) });
+  m_lookup.Insert(hash, newId);
+
+  return newId;
+}
+
+RootSignatureId RootSignatureCache::GetOrCreate(const std::vector<ShaderBindingSet>& stages)
+{
+  return GetOrCreate(BuildRootSignatureLayout(stages));
+}
+
+ID3D12RootSignature* RootSignatureCache::GetRootSignature(RootSignatureId id) const
+{
+  assert(id < m_entries.size() && "Invalid root signature id!");
+  return m_entries[id].rootSignature.Get();
+}
+
+const RootSignatureLayout& RootSignatureCache::GetLayout(RootSignatureId id) const
+{
+  assert(id < m_entries.size() && "Invalid root signature id!");
+  return m_entries[id].layout;
+}
+
+Microsoft::WRL::ComPtr<ID3D12RootSignature> RootSignatureCache::CreateRootSignature(const RootSignatureLayout& layout)
+{
+  // Ranges have to stay alive until the root signature is serialised, as parameters point into them:
+  std::vector<std::vector<CD3DX12_DESCRIPTOR_RANGE1>> ranges(layout.parameters.size());
+  std::vector<CD3DX12_ROOT_PARAMETER1> parameters(layout.parameters.size());
+
+  for (size_t i = 0; i < layout.parameters.size(); ++i)
+  {
+    const RootParameterDesc& desc = layout.parameters[i];
+    const D3D12_SHADER_VISIBILITY visibility = static_cast<D3D12_SHADER_VISIBILITY>(desc.visibility);
+    const D3D12_ROOT_DESCRIPTOR_FLAGS flags = static_cast<D3D12_ROOT_DESCRIPTOR_FLAGS>(desc.flags);
+
+    switch (desc.type)
+    {
+    case RootParameterType::Constants:
+      parameters[i].InitAsConstants(desc.num32BitValues, desc.shaderRegister, desc.space, visibility);
+      break;
+    case RootParameterType::CBV:
+      parameters[i].InitAsConstantBufferView(desc.shaderRegister, desc.space, flags, visibility);
+      break;
+    case RootParameterType::SRV:
+      parameters[i].InitAsShaderResourceView(desc.shaderRegister, desc.space, flags, visibility);
+      break;
+    case RootParameterType::UAV:
+      parameters[i].InitAsUnorderedAccessView(desc.shaderRegister, desc.space, flags, visibility);
+      break;
+    case RootParameterType::DescriptorTable:
+      for (const DescriptorRangeDesc& range : desc.ranges)
+      {
+        const UINT count = range.count == g_unboundedDescriptorCount ? UINT_MAX : range.count;
+        ranges[i].emplace_back(ToRangeType(range.type), count, range.baseRegister, range.space,
+          static_cast<D3D12_DESCRIPTOR_RANGE_FLAGS>(range.flags), range.offsetInTable);
+      }
+      parameters[i].InitAsDescriptorTable(static_cast<UINT>(ranges[i].size()), ranges[i].data(), visibility);
+      break;
+    }
+  }
+
+  CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC desc;
+  desc.Init_1_1(static_cast<UINT>(parameters.size()), parameters.data(), 0, nullptr,
+    static_cast<D3D12_ROOT_SIGNATURE_FLAGS>(layout.flags));
+
+  Microsoft::WRL::ComPtr<ID3DBlob> serialised;
+  Microsoft::WRL::ComPtr<ID3DBlob> errors;
+  HRESULT hr = D3DX12SerializeVersionedRootSignature(&desc, m_highestVersion, &serialised, &errors);
+
+  if (errors)
+    ::OutputDebugStringA(static_cast<const char*>(errors->GetBufferPointer()));
+
+  DX12_CHECK(hr, "Failed to serialise root signature!");
+
+  Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature;
+  DX12_CHECK(m_device->CreateRootSignature(0, serialised->GetBufferPointer(), serialised->GetBufferSize(),
+    IID_PPV_ARGS(&rootSignature)));
+
+  return rootSignature;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "RootSignatureLayout.h"
+
+using RootSignatureId = uint32_t;
+static const RootSignatureId g_invalidRootSignatureId = ~0u;
+
+// Reads the resource bindings of a compiled shader (SM 5.1+, so register spaces are reported):
+ShaderBindingSet ReflectShaderBindings(ID3DBlob* bytecode, ShaderStage stage);
+
+// Owns every root signature in the renderer. Root signatures are generated from a RootSignatureLayout
+// and deduplicated, so pipelines whose shaders bind the same resources share one root signature
+// (and therefore don't need to rebind it between draws). Ids are dense and stable for the cache's
+// lifetime, which makes them cheap to compare and to pack into sort keys.
+class RootSignatureCache
+{
+public:
+	explicit RootSignatureCache(ID3D12Device2* device);
+
+	RootSignatureId GetOrCreate(const RootSignatureLayout& layout);
+	RootSignatureId GetOrCreate(const std::vector<ShaderBindingSet>& stages);
+
+	ID3D12RootSignature*				GetRootSignature(RootSignatureId id) const;
+	const RootSignatureLayout&	GetLayout(RootSignatureId id) const;
+	size_t											NumRootSignatures() const { return m_entries.size(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> CreateRootSignature(const RootSignatureLayout& layout);
+
+	struct Entry
+	{
+		RootSignatureLayout													layout;
+		Microsoft::WRL::ComPtr<ID3D12RootSignature>	rootSignature;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device2>	m_device;
+	D3D_ROOT_SIGNATURE_VERSION						m_highestVersion;
+	std::vector<Entry>										m_entries;
+	FlatHashMap<RootSignatureId>					m_lookup;		// Layout hash -> index into m_entries.
+};
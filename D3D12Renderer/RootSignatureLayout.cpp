@@ -0,0 +1,420 @@
+#include "RootSignatureLayout.h"
+
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+
+namespace
+{
+  struct MergedBinding
+  {
+    ShaderBinding binding;
+    uint32_t      stageMask;    // One bit per ShaderVisibility, all bits for compute.
+  };
+
+  struct PendingParameter
+  {
+    uint32_t                                        group;    // Lower groups change more frequently and are placed first.
+    RootParameterDesc                               desc;
+    std::vector<std::pair<std::string, uint32_t>>   bindings; // Binding names and their offsets within the parameter.
+  };
+
+  enum ParameterGroup : uint32_t
+  {
+    ParameterGroup_RootConstants,
+    ParameterGroup_RootDescriptors,
+    ParameterGroup_PerDrawTables,
+    ParameterGroup_PerMaterialTables,
+    ParameterGroup_PerPassTables,
+  };
+
+  const uint32_t c_allStagesMask = 0x3e;
+
+  uint32_t GetStageBit(ShaderStage stage)
+  {
+    switch (stage)
+    {
+    case ShaderStage::Vertex:   return 1u << static_cast<uint32_t>(ShaderVisibility::Vertex);
+    case ShaderStage::Hull:     return 1u << static_cast<uint32_t>(ShaderVisibility::Hull);
+    case ShaderStage::Domain:   return 1u << static_cast<uint32_t>(ShaderVisibility::Domain);
+    case ShaderStage::Geometry: return 1u << static_cast<uint32_t>(ShaderVisibility::Geometry);
+    case ShaderStage::Pixel:    return 1u << static_cast<uint32_t>(ShaderVisibility::Pixel);
+    default:                    return c_allStagesMask;   // Compute only has the one visibility.
+    }
+  }
+
+  // Bindings used by a single graphics stage are only made visible to that stage, which lets drivers
+  // skip pushing them to the others:
+  ShaderVisibility GetVisibility(uint32_t stageMask)
+  {
+    for (uint32_t vis = 1; vis <= static_cast<uint32_t>(ShaderVisibility::Pixel); ++vis)
+    {
+      if (stageMask == (1u << vis))
+        return static_cast<ShaderVisibility>(vis);
+    }
+    return ShaderVisibility::All;
+  }
+
+  uint32_t GetFrequency(uint32_t space)
+  {
+    return std::min<uint32_t>(space, BindingFrequency_PerPass);
+  }
+
+  uint32_t GetRangeFlags(ShaderBindingType type, uint32_t frequency, uint32_t count)
+  {
+    const bool isUnbounded = count == g_unboundedDescriptorCount;
+
+    // Samplers have no data, only their descriptors can be volatile:
+    if (type == ShaderBindingType::Sampler)
+      return isUnbounded ? RootDataFlags_DescriptorsVolatile : RootDataFlags_None;
+
+    uint32_t flags;
+    if (type == ShaderBindingType::UAV)
+      flags = RootDataFlags_DataVolatile;
+    else if (frequency == BindingFrequency_PerMaterial)
+      flags = RootDataFlags_DataStatic;     // Material textures/constants are never written once uploaded.
+    else
+      flags = RootDataFlags_DataStaticWhileSetAtExecute;
+
+    // Unbounded (bindless) tables get descriptors written after the table is set:
+    if (isUnbounded)
+      flags |= RootDataFlags_DescriptorsVolatile;
+
+    return flags;
+  }
+
+  uint32_t GetRootDescriptorFlags(ShaderBindingType type)
+  {
+    switch (type)
+    {
+    case ShaderBindingType::ConstantBuffer:
+      return RootDataFlags_DataStatic;    // Per-draw constants are written to upload memory before recording.
+    case ShaderBindingType::UAV:
+      return RootDataFlags_DataVolatile;
+    default:
+      return RootDataFlags_DataStaticWhileSetAtExecute;
+    }
+  }
+
+  std::vector<MergedBinding> MergeBindings(const std::vector<ShaderBindingSet>& stages)
+  {
+    std::vector<MergedBinding> merged;
+
+    for (const ShaderBindingSet& stage : stages)
+    {
+      for (const ShaderBinding& binding : stage.bindings)
+      {
+        auto it = std::find_if(merged.begin(), merged.end(), [&](const MergedBinding& m) {
+          return m.binding.type == binding.type
+            && m.binding.shaderRegister == binding.shaderRegister
+            && m.binding.space == binding.space;
+          });
+
+        if (it == merged.end())
+        {
+          merged.push_back(MergedBinding{ binding, GetStageBit(stage.stage) });
+          continue;
+        }
+
+        // Stages may declare differently sized views of the same binding, keep the largest:
+        it->stageMask |= GetStageBit(stage.stage);
+        it->binding.sizeInBytes = std::max(it->binding.sizeInBytes, binding.sizeInBytes);
+        if (it->binding.count != g_unboundedDescriptorCount)
+        {
+          it->binding.count = binding.count == g_unboundedDescriptorCount
+            ? g_unboundedDescriptorCount : std::max(it->binding.count, binding.count);
+        }
+      }
+    }
+
+    // Sort so the generated layout doesn't depend on the order reflection reported bindings in:
+    std::sort(merged.begin(), merged.end(), [](const MergedBinding& a, const MergedBinding& b) {
+      return std::make_tuple(a.binding.space, a.binding.type, a.binding.shaderRegister)
+        < std::make_tuple(b.binding.space, b.binding.type, b.binding.shaderRegister);
+      });
+
+    return merged;
+  }
+
+  PendingParameter MakeRootParameter(RootParameterType type, const MergedBinding& merged)
+  {
+    PendingParameter param;
+    param.desc.type = type;
+    param.desc.visibility = GetVisibility(merged.stageMask);
+    param.desc.shaderRegister = merged.binding.shaderRegister;
+    param.desc.space = merged.binding.space;
+    param.desc.num32BitValues = 0;
+    param.desc.flags = RootDataFlags_None;
+    param.bindings.emplace_back(merged.binding.name, 0);
+
+    if (type == RootParameterType::Constants)
+    {
+      param.group = ParameterGroup_RootConstants;
+      param.desc.num32BitValues = (merged.binding.sizeInBytes + 3) / 4;
+    }
+    else
+    {
+      param.group = ParameterGroup_RootDescriptors;
+      param.desc.flags = GetRootDescriptorFlags(merged.binding.type);
+    }
+
+    return param;
+  }
+
+  // Appends a binding to a table, extending the table's last range if the binding continues it:
+  void AddToTable(PendingParameter& table, const MergedBinding& merged, uint32_t frequency)
+  {
+    const ShaderBinding& binding = merged.binding;
+    const uint32_t flags = GetRangeFlags(binding.type, frequency, binding.count);
+
+    uint32_t offset = 0;
+    if (!table.desc.ranges.empty())
+    {
+      const DescriptorRangeDesc& last = table.desc.ranges.back();
+      offset = last.offsetInTable + last.count;
+    }
+
+    DescriptorRangeDesc* last = table.desc.ranges.empty() ? nullptr : &table.desc.ranges.back();
+    if (last && last->type == binding.type && last->space == binding.space && last->flags == flags
+      && last->baseRegister + last->count == binding.shaderRegister)
+    {
+      last->count += binding.count;
+    }
+    else
+    {
+      table.desc.ranges.push_back(DescriptorRangeDesc{
+        binding.type, binding.shaderRegister, binding.space, binding.count, flags, offset });
+    }
+
+    table.bindings.emplace_back(binding.name, offset);
+  }
+
+  void HashValue(uint64_t& hash, uint64_t value)
+  {
+    // FNV-1a, one byte at a time:
+    for (int i = 0; i < 8; ++i)
+    {
+      hash ^= (value >> (i * 8)) & 0xff;
+      hash *= 0x100000001b3ull;
+    }
+  }
+}
+
+bool DescriptorRangeDesc::operator==(const DescriptorRangeDesc& other) const
+{
+  return type == other.type && baseRegister == other.baseRegister && space == other.space
+    && count == other.count && flags == other.flags && offsetInTable == other.offsetInTable;
+}
+
+uint32_t RootParameterDesc::CostInDwords() const
+{
+  switch (type)
+  {
+  case RootParameterType::Constants:        return num32BitValues;
+  case RootParameterType::DescriptorTable:  return 1;
+  default:                                  return 2;   // Root descriptors are 64-bit GPU virtual addresses.
+  }
+}
+
+bool RootParameterDesc::operator==(const RootParameterDesc& other) const
+{
+  return type == other.type && visibility == other.visibility && shaderRegister == other.shaderRegister
+    && space == other.space && num32BitValues == other.num32BitValues && flags == other.flags
+    && ranges == other.ranges;
+}
+
+uint32_t RootSignatureLayout::CostInDwords() const
+{
+  uint32_t cost = 0;
+  for (const RootParameterDesc& param : parameters)
+    cost += param.CostInDwords();
+
+  return cost;
+}
+
+int32_t RootSignatureLayout::FindRootIndex(const char* bindingName) const
+{
+  const RootBindingLocation* location = FindBinding(bindingName);
+  return location ? static_cast<int32_t>(location->rootIndex) : -1;
+}
+
+const RootBindingLocation* RootSignatureLayout::FindBinding(const char* bindingName) const
+{
+  for (const RootBindingLocation& location : bindingLocations)
+  {
+    if (location.name == bindingName)
+      return &location;
+  }
+  return nullptr;
+}
+
+uint64_t RootSignatureLayout::Hash() const
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  HashValue(hash, flags);
+
+  for (const RootParameterDesc& param : parameters)
+  {
+    HashValue(hash, static_cast<uint64_t>(param.type) | (static_cast<uint64_t>(param.visibility) << 8));
+    HashValue(hash, param.shaderRegister | (static_cast<uint64_t>(param.space) << 32));
+    HashValue(hash, param.num32BitValues | (static_cast<uint64_t>(param.flags) << 32));
+
+    for (const DescriptorRangeDesc& range : param.ranges)
+    {
+      HashValue(hash, static_cast<uint64_t>(range.type) | (static_cast<uint64_t>(range.flags) << 32));
+      HashValue(hash, range.baseRegister | (static_cast<uint64_t>(range.space) << 32));
+      HashValue(hash, range.count | (static_cast<uint64_t>(range.offsetInTable) << 32));
+    }
+  }
+
+  return hash;
+}
+
+bool RootSignatureLayout::IsEquivalent(const RootSignatureLayout& other) const
+{
+  return flags == other.flags && parameters == other.parameters;
+}
+
+RootSignatureLayout BuildRootSignatureLayout(const std::vector<ShaderBindingSet>& stages)
+{
+  RootSignatureLayout layout;
+
+  // Root signature flags, deny root access to any graphics stage not in the pipeline:
+  uint32_t stageMask = 0;
+  bool isCompute = false;
+
+  for (const ShaderBindingSet& stage : stages)
+  {
+    isCompute |= stage.stage == ShaderStage::Compute;
+    stageMask |= GetStageBit(stage.stage);
+
+    if (stage.stage == ShaderStage::Vertex && stage.hasInputLayout)
+      layout.flags |= RootSignatureFlags_AllowInputAssemblerInputLayout;
+  }
+
+  if (!isCompute)
+  {
+    const uint32_t denyFlags[] = {
+      RootSignatureFlags_DenyVertexShaderRootAccess,
+      RootSignatureFlags_DenyHullShaderRootAccess,
+      RootSignatureFlags_DenyDomainShaderRootAccess,
+      RootSignatureFlags_DenyGeometryShaderRootAccess,
+      RootSignatureFlags_DenyPixelShaderRootAccess,
+    };
+
+    for (uint32_t vis = 1; vis <= static_cast<uint32_t>(ShaderVisibility::Pixel); ++vis)
+    {
+      if ((stageMask & (1u << vis)) == 0)
+        layout.flags |= denyFlags[vis - 1];
+    }
+  }
+
+  // Assign each binding to a root parameter:
+  std::vector<PendingParameter> pending;
+
+  for (const MergedBinding& merged : MergeBindings(stages))
+  {
+    const ShaderBinding& binding = merged.binding;
+    const uint32_t frequency = GetFrequency(binding.space);
+
+    if (frequency == BindingFrequency_PerDraw && binding.count == 1)
+    {
+      if (binding.type == ShaderBindingType::ConstantBuffer)
+      {
+        const bool fitsInRootConstants = binding.sizeInBytes > 0
+          && binding.sizeInBytes <= g_maxRootConstantDwords * 4;
+
+        pending.push_back(MakeRootParameter(fitsInRootConstants
+          ? RootParameterType::Constants : RootParameterType::CBV, merged));
+        continue;
+      }
+
+      if (binding.isRawOrStructured && binding.type != ShaderBindingType::Sampler)
+      {
+        pending.push_back(MakeRootParameter(binding.type == ShaderBindingType::SRV
+          ? RootParameterType::SRV : RootParameterType::UAV, merged));
+        continue;
+      }
+    }
+
+    // Descriptor tables are shared by bindings with the same frequency, visibility and heap type (samplers
+    // live in their own heap). Unbounded arrays get a table to themselves, since nothing can follow them:
+    const bool isSampler = binding.type == ShaderBindingType::Sampler;
+    const bool isUnbounded = binding.count == g_unboundedDescriptorCount;
+    const uint32_t group = ParameterGroup_PerDrawTables + frequency;
+    const ShaderVisibility visibility = GetVisibility(merged.stageMask);
+
+    auto table = std::find_if(pending.begin(), pending.end(), [&](const PendingParameter& param) {
+      if (param.group != group || param.desc.visibility != visibility)
+        return false;
+
+      const DescriptorRangeDesc& lastRange = param.desc.ranges.back();
+      return (lastRange.type == ShaderBindingType::Sampler) == isSampler
+        && lastRange.count != g_unboundedDescriptorCount && !isUnbounded;
+      });
+
+    if (table == pending.end())
+    {
+      PendingParameter newTable;
+      newTable.group = group;
+      newTable.desc.type = RootParameterType::DescriptorTable;
+      newTable.desc.visibility = visibility;
+      newTable.desc.shaderRegister = 0;
+      newTable.desc.space = 0;
+      newTable.desc.num32BitValues = 0;
+      newTable.desc.flags = RootDataFlags_None;
+
+      pending.push_back(std::move(newTable));
+      table = pending.end() - 1;
+    }
+
+    AddToTable(*table, merged, frequency);
+  }
+
+  // Demote the largest root constants to root CBVs until the signature fits the hardware limit:
+  auto costOf = [&pending]() {
+    uint32_t cost = 0;
+    for (const PendingParameter& param : pending)
+      cost += param.desc.CostInDwords();
+    return cost;
+  };
+
+  while (costOf() > g_maxRootSignatureDwords)
+  {
+    auto largest = pending.end();
+    for (auto it = pending.begin(); it != pending.end(); ++it)
+    {
+      if (it->desc.type == RootParameterType::Constants
+        && (largest == pending.end() || it->desc.num32BitValues > largest->desc.num32BitValues))
+        largest = it;
+    }
+
+    if (largest == pending.end())
+      break;
+
+    largest->group = ParameterGroup_RootDescriptors;
+    largest->desc.type = RootParameterType::CBV;
+    largest->desc.num32BitValues = 0;
+    largest->desc.flags = GetRootDescriptorFlags(ShaderBindingType::ConstantBuffer);
+  }
+
+  assert(costOf() <= g_maxRootSignatureDwords && "Root signature exceeds 64 DWORDs!");
+
+  // Most frequently changing parameters first, some hardware only keeps the start of the root
+  // signature in fast registers:
+  std::stable_sort(pending.begin(), pending.end(), [](const PendingParameter& a, const PendingParameter& b) {
+    return a.group < b.group;
+    });
+
+  for (PendingParameter& param : pending)
+  {
+    const uint32_t rootIndex = static_cast<uint32_t>(layout.parameters.size());
+
+    for (auto& binding : param.bindings)
+      layout.bindingLocations.push_back(RootBindingLocation{ std::move(binding.first), rootIndex, binding.second });
+
+    layout.parameters.push_back(std::move(param.desc));
+  }
+
+  return layout;
+}
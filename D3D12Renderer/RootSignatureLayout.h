@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Platform-independent description of a root signature, generated from the resource bindings that
+// shader reflection reports. The enum values below deliberately match their D3D12 counterparts
+// (D3D12_SHADER_VISIBILITY, D3D12_DESCRIPTOR_RANGE_FLAGS, D3D12_ROOT_SIGNATURE_FLAGS...) so the
+// layout can be converted to a D3D12 root signature with plain casts.
+
+enum class ShaderStage : uint8_t
+{
+	Vertex,
+	Hull,
+	Domain,
+	Geometry,
+	Pixel,
+	Compute,
+};
+
+enum class ShaderVisibility : uint8_t
+{
+	All				= 0,
+	Vertex		= 1,
+	Hull			= 2,
+	Domain		= 3,
+	Geometry	= 4,
+	Pixel			= 5,
+};
+
+enum class ShaderBindingType : uint8_t
+{
+	ConstantBuffer,
+	SRV,
+	UAV,
+	Sampler,
+};
+
+// Register spaces double as update frequency, so shaders declare how often each binding changes:
+//   space0 - per-draw (object transforms, draw IDs...)
+//   space1 - per-material (textures and material constants, immutable once loaded)
+//   space2 - per-pass (and anything above, e.g. the frame's camera and render targets)
+enum BindingFrequency : uint32_t
+{
+	BindingFrequency_PerDraw			= 0,
+	BindingFrequency_PerMaterial	= 1,
+	BindingFrequency_PerPass			= 2,
+};
+
+// Shared by root descriptors and descriptor ranges, same values as D3D12_DESCRIPTOR_RANGE_FLAGS:
+enum RootDataFlags : uint32_t
+{
+	RootDataFlags_None												= 0x0,
+	RootDataFlags_DescriptorsVolatile					= 0x1,	// Descriptor ranges only.
+	RootDataFlags_DataVolatile								= 0x2,
+	RootDataFlags_DataStaticWhileSetAtExecute	= 0x4,
+	RootDataFlags_DataStatic									= 0x8,
+};
+
+enum RootSignatureFlags : uint32_t
+{
+	RootSignatureFlags_None												= 0x0,
+	RootSignatureFlags_AllowInputAssemblerInputLayout	= 0x1,
+	RootSignatureFlags_DenyVertexShaderRootAccess			= 0x2,
+	RootSignatureFlags_DenyHullShaderRootAccess				= 0x4,
+	RootSignatureFlags_DenyDomainShaderRootAccess			= 0x8,
+	RootSignatureFlags_DenyGeometryShaderRootAccess		= 0x10,
+	RootSignatureFlags_DenyPixelShaderRootAccess			= 0x20,
+};
+
+static const uint32_t g_unboundedDescriptorCount	= 0;		// ShaderBinding::count of unbounded arrays, e.g. Texture2D t[] : register(t0).
+static const uint32_t g_maxRootSignatureDwords		= 64;		// Hardware limit on root signature size.
+static const uint32_t g_maxRootConstantDwords			= 16;		// Larger per-draw constant buffers become root CBVs instead.
+
+// A single resource binding as reported by shader reflection:
+struct ShaderBinding
+{
+	std::string				name;
+	ShaderBindingType	type;
+	uint32_t					shaderRegister;
+	uint32_t					space;
+	uint32_t					count;							// Number of descriptors, g_unboundedDescriptorCount for unbounded arrays.
+	uint32_t					sizeInBytes;				// Constant buffers only.
+	bool							isRawOrStructured;	// Raw/structured buffers are the only SRVs/UAVs that can be root descriptors.
+};
+
+struct ShaderBindingSet
+{
+	ShaderStage									stage;
+	bool												hasInputLayout;		// Vertex shaders only, whether any vertex attributes are consumed.
+	std::vector<ShaderBinding>	bindings;
+};
+
+enum class RootParameterType : uint8_t
+{
+	Constants,
+	CBV,
+	SRV,
+	UAV,
+	DescriptorTable,
+};
+
+struct DescriptorRangeDesc
+{
+	ShaderBindingType	type;
+	uint32_t					baseRegister;
+	uint32_t					space;
+	uint32_t					count;						// g_unboundedDescriptorCount for unbounded ranges.
+	uint32_t					flags;						// RootDataFlags.
+	uint32_t					offsetInTable;
+
+	bool operator==(const DescriptorRangeDesc& other) const;
+};
+
+struct RootParameterDesc
+{
+	RootParameterType									type;
+	ShaderVisibility									visibility;
+	uint32_t													shaderRegister;		// Root constants/descriptors only.
+	uint32_t													space;						// As above.
+	uint32_t													num32BitValues;		// Root constants only.
+	uint32_t													flags;						// RootDataFlags, root descriptors only.
+	std::vector<DescriptorRangeDesc>	ranges;						// Descriptor tables only.
+
+	uint32_t CostInDwords() const;
+
+	bool operator==(const RootParameterDesc& other) const;
+};
+
+// Where a named shader binding ended up in the root signature:
+struct RootBindingLocation
+{
+	std::string	name;
+	uint32_t		rootIndex;
+	uint32_t		offsetInTable;		// Descriptor offset within the table, 0 for root constants/descriptors.
+};
+
+struct RootSignatureLayout
+{
+	std::vector<RootParameterDesc>		parameters;
+	uint32_t													flags = RootSignatureFlags_None;
+	std::vector<RootBindingLocation>	bindingLocations;
+
+	uint32_t CostInDwords() const;
+
+	// Returns the root parameter index a binding was assigned to, or -1 if the shaders don't use it:
+	int32_t FindRootIndex(const char* bindingName) const;
+	const RootBindingLocation* FindBinding(const char* bindingName) const;
+
+	// Hash/equality only consider what affects the serialised root signature (not binding names),
+	// so layouts reflected from different shaders with the same bindings deduplicate:
+	uint64_t Hash() const;
+	bool IsEquivalent(const RootSignatureLayout& other) const;
+};
+
+// Builds a minimal root signature from the bindings of every stage in a pipeline:
+//  - Bindings used by several stages are merged and made visible to all stages.
+//  - Small per-draw constant buffers become root constants, larger ones and per-draw raw/structured
+//    buffers become root descriptors, so per-draw updates never touch a descriptor heap.
+//  - Everything else is grouped into one descriptor table per frequency, visibility and heap type.
+//  - Parameters are ordered from most to least frequently changing.
+//  - Root access is denied to stages that aren't part of the pipeline.
+RootSignatureLayout BuildRootSignatureLayout(const std::vector<ShaderBindingSet>& stages);
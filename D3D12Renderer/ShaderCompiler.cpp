@@ -0,0 +1,90 @@
+#include "ShaderCompiler.h"
+#include "Helpers.h"
+
+#include <d3dcompiler.h>
+
+#include <cwchar>
+
+namespace
+{
+  bool GetLastWriteTime(const std::wstring& path, FILETIME& lastWriteTime)
+  {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!::GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes))
+      return false;
+
+    lastWriteTime = attributes.ftLastWriteTime;
+    return true;
+  }
+
+  // A cached permutation is only reused if it's newer than its source file. (Included files aren't
+  // tracked, touch the top-level source or clear the cache directory after editing those.)
+  bool IsCacheUpToDate(const std::wstring& sourcePath, const std::wstring& cachePath)
+  {
+    FILETIME sourceTime, cacheTime;
+    if (!GetLastWriteTime(cachePath, cacheTime))
+      return false;
+    if (!GetLastWriteTime(sourcePath, sourceTime))
+      return true;  // Source isn't shipped, the cache is all there is.
+
+    return ::CompareFileTime(&cacheTime, &sourceTime) >= 0;
+  }
+}
+
+ShaderCompiler::ShaderCompiler(std::wstring sourceDir, std::wstring cacheDir)
+  : m_sourceDir(std::move(sourceDir))
+  , m_cacheDir(std::move(cacheDir))
+{
+  // Fails harmlessly if the directory already exists:
+  ::CreateDirectoryW(m_cacheDir.c_str(), NULL);
+}
+
+Microsoft::WRL::ComPtr<ID3DBlob> ShaderCompiler::CompileOrLoad(const ShaderSourceDesc& source,
+  uint64_t permutationBits, const std::vector<ShaderDefine>& defines)
+{
+  const std::wstring sourcePath = m_sourceDir + L"/" + source.file;
+  const std::wstring cachePath = GetCachePath(source, permutationBits);
+
+  Microsoft::WRL::ComPtr<ID3DBlob> blob;
+  if (IsCacheUpToDate(sourcePath, cachePath) && SUCCEEDED(D3DReadFileToBlob(cachePath.c_str(), &blob)))
+    return blob;
+
+  // D3DCompileFromFile expects a null-terminated array of macros:
+  std::vector<D3D_SHADER_MACRO> macros;
+  macros.reserve(defines.size() + 1);
+
+  for (const ShaderDefine& define : defines)
+    macros.push_back({ define.name, define.value.c_str() });
+  macros.push_back({ nullptr, nullptr });
+
+#if defined(_DEBUG)
+  UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+  UINT compileFlags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+  Microsoft::WRL::ComPtr<ID3DBlob> errors;
+  HRESULT hr = D3DCompileFromFile(sourcePath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+    source.entryPoint, source.target, compileFlags, 0, &blob, &errors);
+
+  if (errors)
+    ::OutputDebugStringA(static_cast<const char*>(errors->GetBufferPointer()));
+
+  DX12_CHECK(hr, "Failed to compile shader permutation!");
+
+  // Failing to write the cache only costs a recompile next run, so it isn't treated as an error:
+  D3DWriteBlobToFile(blob.Get(), cachePath.c_str(), TRUE);
+
+  return blob;
+}
+
+std::wstring ShaderCompiler::GetCachePath(const ShaderSourceDesc& source, uint64_t permutationBits) const
+{
+  // e.g. "<cacheDir>/Basic.hlsl_PSMain_ps_5_1_0000000000000005.cso", the target included so an entry point
+  // compiled for two profiles gets two blobs:
+  wchar_t fileName[MAX_PATH];
+  swprintf_s(fileName, MAX_PATH, L"%s_%S_%S_%016llx.cso", source.file, source.entryPoint, source.target,
+    static_cast<unsigned long long>(permutationBits));
+
+  return m_cacheDir + L"/" + fileName;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "ShaderPermutation.h"
+
+struct ShaderSourceDesc
+{
+	const wchar_t*	file;					// HLSL source file, relative to the compiler's source directory.
+	const char*			entryPoint;
+	const char*			target;				// Shader model target, e.g. "vs_5_1" or "cs_5_1".
+};
+
+// Compiles shader permutations, or fetches them if they've been compiled before. Compiled bytecode is
+// written to the cache directory as a .cso named after the source file, entry point, target and
+// permutation bits, so subsequent runs only have to read it back from disk.
+class ShaderCompiler
+{
+public:
+	ShaderCompiler(std::wstring sourceDir, std::wstring cacheDir);
+
+	Microsoft::WRL::ComPtr<ID3DBlob> CompileOrLoad(const ShaderSourceDesc& source, uint64_t permutationBits,
+		const std::vector<ShaderDefine>& defines);
+
+private:
+	std::wstring GetCachePath(const ShaderSourceDesc& source, uint64_t permutationBits) const;
+
+	std::wstring	m_sourceDir;
+	std::wstring	m_cacheDir;
+};
+
+// Lazily populated set of permutations for a single shader. Shader is the tag struct declaring the
+// shader's features (see ShaderPermutation.h), which must also declare a static constexpr
+// ShaderSourceDesc named Source. Nothing is compiled until a permutation is first requested.
+template<typename Shader>
+class ShaderPermutationSet
+{
+public:
+	explicit ShaderPermutationSet(ShaderCompiler& compiler) : m_compiler(compiler) {}
+
+	// Returns the bytecode of the requested permutation. After the first request for a key this is
+	// a single flat hash table lookup on the packed key bits:
+	ID3DBlob* Get(ShaderPermutationKey<Shader> key)
+	{
+		if (Microsoft::WRL::ComPtr<ID3DBlob>* blob = m_permutations.Find(key.Bits()))
+			return blob->Get();
+
+		Microsoft::WRL::ComPtr<ID3DBlob> newBlob = m_compiler.CompileOrLoad(Shader::Source, key.Bits(),
+			BuildShaderDefines(key, Shader::Features));
+
+		return m_permutations.Insert(key.Bits(), newBlob).Get();
+	}
+
+	size_t NumLoadedPermutations() const { return m_permutations.Size(); }
+
+private:
+	ShaderCompiler&																m_compiler;
+	FlatHashMap<Microsoft::WRL::ComPtr<ID3DBlob>>	m_permutations;
+};
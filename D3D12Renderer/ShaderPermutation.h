@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Shader permutations are described by typed feature fields packed into a 64-bit key. Each shader
+// declares a tag struct listing its features, e.g.:
+//
+//   struct BasicPassShader
+//   {
+//     static constexpr ShaderFeature<BasicPassShader> NormalMap  = { "USE_NORMAL_MAP", 0, 1 };
+//     static constexpr ShaderFeature<BasicPassShader> LightCount = { "MAX_LIGHTS",     1, 3 };
+//     static constexpr ShaderFeature<BasicPassShader> Features[] = { NormalMap, LightCount };
+//   };
+//   static_assert(ValidateShaderFeatures(BasicPassShader::Features), "Overlapping feature bits!");
+//
+//   constexpr auto key = ShaderPermutationKey<BasicPassShader>().With(BasicPassShader::NormalMap, 1);
+//
+// Keys are built entirely at compile time and are typed by shader, so a feature belonging to one
+// shader can't be used to build the key of another. Only the packed bits are used at runtime.
+
+template<typename Shader>
+struct ShaderFeature
+{
+	const char*	define;		// Preprocessor define the feature's value is passed to the shader as.
+	uint32_t		offset;		// First bit of the feature within the permutation key.
+	uint32_t		width;		// Number of bits, 1 for on/off features.
+
+	constexpr uint64_t MaxValue() const
+	{
+		return width >= 64 ? ~0ull : (1ull << width) - 1;
+	}
+
+	constexpr uint64_t Mask() const
+	{
+		return MaxValue() << offset;
+	}
+};
+
+template<typename Shader>
+class ShaderPermutationKey
+{
+public:
+	constexpr ShaderPermutationKey() : m_bits(0) {}
+	constexpr explicit ShaderPermutationKey(uint64_t bits) : m_bits(bits) {}
+
+	// Returns a copy of this key with the given feature set to value (truncated to the feature's width):
+	constexpr ShaderPermutationKey With(ShaderFeature<Shader> feature, uint64_t value) const
+	{
+		return ShaderPermutationKey((m_bits & ~feature.Mask()) | ((value << feature.offset) & feature.Mask()));
+	}
+
+	constexpr uint64_t Get(ShaderFeature<Shader> feature) const
+	{
+		return (m_bits & feature.Mask()) >> feature.offset;
+	}
+
+	constexpr uint64_t Bits() const { return m_bits; }
+
+	constexpr bool operator==(ShaderPermutationKey other) const { return m_bits == other.m_bits; }
+	constexpr bool operator!=(ShaderPermutationKey other) const { return m_bits != other.m_bits; }
+
+private:
+	uint64_t m_bits;
+};
+
+// Checks that every feature fits within 64 bits and that no two features share a bit, intended for
+// use in a static_assert next to the shader's feature list:
+template<typename Shader, size_t N>
+constexpr bool ValidateShaderFeatures(const ShaderFeature<Shader> (&features)[N])
+{
+	uint64_t usedBits = 0;
+
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (features[i].width == 0 || features[i].offset + features[i].width > 64)
+			return false;
+
+		if ((usedBits & features[i].Mask()) != 0)
+			return false;
+
+		usedBits |= features[i].Mask();
+	}
+	return true;
+}
+
+struct ShaderDefine
+{
+	const char*	name;
+	std::string	value;
+};
+
+// Expands a packed key back into the preprocessor defines it represents. Only needed when a
+// permutation is compiled for the first time, never on the draw path.
+template<typename Shader, size_t N>
+std::vector<ShaderDefine> BuildShaderDefines(ShaderPermutationKey<Shader> key,
+	const ShaderFeature<Shader> (&features)[N])
+{
+	std::vector<ShaderDefine> defines;
+	defines.reserve(N);
+
+	for (size_t i = 0; i < N; ++i)
+		defines.push_back(ShaderDefine{ features[i].define, std::to_string(key.Get(features[i])) });
+
+	return defines;
+}
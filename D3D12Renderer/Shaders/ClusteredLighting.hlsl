@@ -0,0 +1,173 @@
+// Clustered light culling in three passes, producing the same lists as LightClusterBuilder on the CPU
+// (ClusteredLighting.cpp), keep the two in sync:
+//
+//  CSCountLights:  one group per cluster counts the lights touching it.
+//  CSScanClusters: a single group turns the counts into offsets, clamped to the index list's capacity.
+//  CSWriteLights:  one group per cluster writes its lights' indices in ascending order.
+//
+// Counting first means lists are packed in cluster order without atomics deciding the layout, which is
+// what keeps the result deterministic and identical to the CPU path.
+
+struct ClusterLight
+{
+  float3  position;     // View space.
+  float   radius;
+};
+
+struct ClusterBounds
+{
+  float3  minBounds;
+  float   padding0;
+  float3  maxBounds;
+  float   padding1;
+};
+
+struct ClusterRange
+{
+  uint    offset;
+  uint    count;
+};
+
+cbuffer ClusterConstants : register(b0)
+{
+  uint    g_numLights;
+  uint    g_numClusters;
+  uint    g_maxLightIndices;
+};
+
+StructuredBuffer<ClusterLight>    g_lights          : register(t0);
+StructuredBuffer<ClusterBounds>   g_clusterBounds   : register(t1);
+RWStructuredBuffer<ClusterRange>  g_clusterRanges   : register(u0);
+RWStructuredBuffer<uint>          g_lightIndices    : register(u1);
+
+#define THREAD_GROUP_SIZE 64
+#define SCAN_GROUP_SIZE 1024
+
+groupshared uint gs_count;
+groupshared uint gs_hitMask[THREAD_GROUP_SIZE / 32];
+groupshared uint gs_scan[SCAN_GROUP_SIZE];
+
+// Same operations in the same order as IntersectsScalar() on the CPU, so both agree on edge cases. precise
+// stops the compiler fusing the squares and sums into mads, which round differently from the CPU's
+// separate multiplies and adds:
+bool IntersectsCluster(ClusterLight light, ClusterBounds bounds)
+{
+  precise float3 distance = max(max(bounds.minBounds - light.position, light.position - bounds.maxBounds), 0.0f);
+  precise float3 distanceSq = distance * distance;
+  precise float distanceSqSum = (distanceSq.x + distanceSq.y) + distanceSq.z;
+  precise float radiusSq = light.radius * light.radius;
+  return distanceSqSum <= radiusSq;
+}
+
+// Cluster of a pixel for shading, viewportPosition in [0, 1], matching LightClusterGrid::FindCluster().
+// sliceScale is clusterSize.z / log(farZ / nearZ):
+uint GetClusterIndex(float2 viewportPosition, float viewZ, uint3 clusterSize, float nearZ, float sliceScale)
+{
+  const uint3 cluster = min(uint3(max(viewportPosition, 0.0f) * clusterSize.xy,
+    floor(log(max(viewZ, nearZ) / nearZ) * sliceScale)), clusterSize - 1);
+  return (cluster.z * clusterSize.y + cluster.y) * clusterSize.x + cluster.x;
+}
+
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void CSCountLights(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+  if (groupIndex == 0)
+    gs_count = 0;
+  GroupMemoryBarrierWithGroupSync();
+
+  const uint cluster = groupId.x;
+  const ClusterBounds bounds = g_clusterBounds[cluster];
+
+  uint count = 0;
+  for (uint i = groupIndex; i < g_numLights; i += THREAD_GROUP_SIZE)
+    count += IntersectsCluster(g_lights[i], bounds) ? 1 : 0;
+
+  InterlockedAdd(gs_count, count);
+  GroupMemoryBarrierWithGroupSync();
+
+  if (groupIndex == 0)
+  {
+    ClusterRange range;
+    range.offset = 0;
+    range.count = gs_count;
+    g_clusterRanges[cluster] = range;
+  }
+}
+
+[numthreads(SCAN_GROUP_SIZE, 1, 1)]
+void CSScanClusters(uint groupIndex : SV_GroupIndex)
+{
+  // Each thread sums a contiguous run of clusters, then the runs are scanned in groupshared memory:
+  const uint clustersPerThread = (g_numClusters + SCAN_GROUP_SIZE - 1) / SCAN_GROUP_SIZE;
+  const uint firstCluster = groupIndex * clustersPerThread;
+  const uint endCluster = min(firstCluster + clustersPerThread, g_numClusters);
+
+  uint sum = 0;
+  for (uint cluster = firstCluster; cluster < endCluster; ++cluster)
+    sum += g_clusterRanges[cluster].count;
+
+  gs_scan[groupIndex] = sum;
+  GroupMemoryBarrierWithGroupSync();
+
+  [unroll]
+  for (uint stride = 1; stride < SCAN_GROUP_SIZE; stride <<= 1)
+  {
+    const uint value = (groupIndex >= stride) ? gs_scan[groupIndex - stride] : 0;
+    GroupMemoryBarrierWithGroupSync();
+    gs_scan[groupIndex] += value;
+    GroupMemoryBarrierWithGroupSync();
+  }
+
+  // Clamped like LightClusterBuilder::EndBuild(), clusters past the capacity lose their lights:
+  uint prefix = gs_scan[groupIndex] - sum;
+  for (uint cluster = firstCluster; cluster < endCluster; ++cluster)
+  {
+    ClusterRange range = g_clusterRanges[cluster];
+    const uint count = range.count;
+    range.offset = min(prefix, g_maxLightIndices);
+    range.count = min(count, g_maxLightIndices - range.offset);
+    g_clusterRanges[cluster] = range;
+    prefix += count;
+  }
+}
+
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void CSWriteLights(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+  const uint cluster = groupId.x;
+  const ClusterBounds bounds = g_clusterBounds[cluster];
+  const ClusterRange range = g_clusterRanges[cluster];
+  if (range.count == 0)
+    return;
+
+  if (groupIndex == 0)
+    gs_count = 0;
+
+  // Lights are taken a group's worth at a time, each hit's slot being the number of hits before it in
+  // the batch, which keeps the list in ascending order:
+  for (uint firstLight = 0; firstLight < g_numLights; firstLight += THREAD_GROUP_SIZE)
+  {
+    if (groupIndex < THREAD_GROUP_SIZE / 32)
+      gs_hitMask[groupIndex] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    const uint lightIndex = firstLight + groupIndex;
+    const bool isHit = lightIndex < g_numLights && IntersectsCluster(g_lights[lightIndex], bounds);
+    if (isHit)
+      InterlockedOr(gs_hitMask[groupIndex / 32], 1u << (groupIndex % 32));
+    GroupMemoryBarrierWithGroupSync();
+
+    const uint lowHits = gs_hitMask[0];
+    const uint highHits = gs_hitMask[1];
+    const uint hitsBefore = (groupIndex < 32) ? countbits(lowHits & ((1u << groupIndex) - 1))
+      : countbits(lowHits) + countbits(highHits & ((1u << (groupIndex - 32)) - 1));
+
+    const uint slot = gs_count + hitsBefore;
+    if (isHit && slot < range.count)
+      g_lightIndices[range.offset + slot] = lightIndex;
+    GroupMemoryBarrierWithGroupSync();
+
+    if (groupIndex == 0)
+      gs_count += countbits(lowHits) + countbits(highHits);
+  }
+}
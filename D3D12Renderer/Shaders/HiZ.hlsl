@@ -0,0 +1,82 @@
+// Hierarchical depth pyramid, the GPU version of HiZPyramid (HiZOcclusion.cpp), keep the two in sync.
+// CSDownsample builds one level from the one above it, dispatched once per level with a thread per
+// destination texel. IsOccludedHiZ() is the box test, for culling passes to include.
+
+cbuffer DownsampleConstants : register(b0)
+{
+  uint2   g_sourceSize;
+  uint2   g_destSize;
+};
+
+Texture2D<float>    g_sourceLevel : register(t0);
+RWTexture2D<float>  g_destLevel   : register(u0);
+
+// Farthest depth of the 2x2 block below each texel, clamped at odd edges:
+[numthreads(8, 8, 1)]
+void CSDownsample(uint3 dispatchId : SV_DispatchThreadID)
+{
+  if (any(dispatchId.xy >= g_destSize))
+    return;
+
+  const uint2 source0 = dispatchId.xy * 2;
+  const uint2 source1 = min(source0 + 1, g_sourceSize - 1);
+
+  const float depth = max(
+    max(g_sourceLevel[source0], g_sourceLevel[uint2(source1.x, source0.y)]),
+    max(g_sourceLevel[uint2(source0.x, source1.y)], g_sourceLevel[source1]));
+
+  g_destLevel[dispatchId.xy] = depth;
+}
+
+// Whether a world-space box is entirely behind the pyramid's depth. viewProjection is the row-major,
+// row-vector matrix the depth was rendered with (so mul(v, M)), pyramid level 0 being baseSize:
+bool IsOccludedHiZ(Texture2D<float> pyramid, uint numLevels, uint2 baseSize, float4x4 viewProjection,
+  float3 center, float3 extents)
+{
+  const float4 clipCenter = mul(float4(center, 1.0f), viewProjection);
+  const float4 clipAxisX = extents.x * viewProjection[0];
+  const float4 clipAxisY = extents.y * viewProjection[1];
+  const float4 clipAxisZ = extents.z * viewProjection[2];
+
+  float2 minXY = 1.0f, maxXY = -1.0f;
+  float minZ = 1.0f;
+
+  [unroll]
+  for (uint corner = 0; corner < 8; ++corner)
+  {
+    const float3 signs = float3((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+    const float4 clip = clipCenter + signs.x * clipAxisX + signs.y * clipAxisY + signs.z * clipAxisZ;
+
+    // Crossing the near plane, the projected bounds aren't meaningful:
+    if (!(clip.w > 0.0f) || clip.z < 0.0f)
+      return false;
+
+    const float3 ndc = clip.xyz / clip.w;
+    minXY = min(minXY, ndc.xy);
+    maxXY = max(maxXY, ndc.xy);
+    minZ = min(minZ, ndc.z);
+  }
+
+  // NDC to level 0 pixels (y pointing down):
+  const float2 topLeft = float2(minXY.x * 0.5f + 0.5f, 0.5f - maxXY.y * 0.5f) * baseSize;
+  const float2 bottomRight = float2(maxXY.x * 0.5f + 0.5f, 0.5f - minXY.y * 0.5f) * baseSize;
+
+  if (any(bottomRight < 0.0f) || any(topLeft >= (float2)baseSize))
+    return false;
+
+  const uint2 pixel0 = (uint2)max(topLeft, 0.0f);
+  const uint2 pixel1 = min((uint2)bottomRight, baseSize - 1);
+
+  // Coarsest needed level where the rect covers at most 2x2 texels:
+  uint level = 0;
+  while (level + 1 < numLevels && any((pixel1 >> level) - (pixel0 >> level) > 1))
+    ++level;
+
+  const uint2 texel0 = pixel0 >> level;
+  const uint2 texel1 = pixel1 >> level;
+  const float maxDepth = max(
+    max(pyramid.Load(int3(texel0, level)), pyramid.Load(int3(texel1.x, texel0.y, level))),
+    max(pyramid.Load(int3(texel0.x, texel1.y, level)), pyramid.Load(int3(texel1, level))));
+
+  return minZ > maxDepth;
+}
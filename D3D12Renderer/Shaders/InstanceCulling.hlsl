@@ -0,0 +1,95 @@
+// GPU-driven instance culling: one thread per instance, each visible instance appends a DrawIndexed
+// command to the argument buffer consumed by ExecuteIndirect. Command layout comes from
+// IndirectCommandLayout on the CPU, which passes the offsets to write at. GenerateIndirectDraws() in
+// IndirectCommands.cpp is the CPU reference, keep the two in sync.
+
+struct IndirectInstance
+{
+  float3  center;
+  uint    meshDrawIndex;
+  float3  extents;
+  uint    objectIndex;
+};
+
+struct IndirectMeshDraw
+{
+  uint    indexCount;
+  uint    startIndex;
+  int     baseVertex;
+  uint    padding;
+};
+
+// Everything is per-draw (space0), so it all ends up as root arguments and no descriptor heap is needed:
+cbuffer CullingConstants : register(b0)
+{
+  float4  g_frustumPlanes[6];
+  uint    g_numInstances;
+  uint    g_maxCommands;
+  uint    g_commandStride;
+  uint    g_objectIndexOffset;      // 0xffffffff when the draw shaders don't read the object index.
+  uint    g_drawArgumentsOffset;
+};
+
+StructuredBuffer<IndirectInstance>  g_instances     : register(t0);
+StructuredBuffer<IndirectMeshDraw>  g_meshDraws     : register(t1);
+RWByteAddressBuffer                 g_commands      : register(u0);
+RWByteAddressBuffer                 g_commandCount  : register(u1);    // Reset to 0 before dispatching.
+
+#define THREAD_GROUP_SIZE 64
+
+groupshared uint gs_numVisible;
+groupshared uint gs_firstCommand;
+
+bool IsInsideFrustum(float3 center, float3 extents)
+{
+  [unroll]
+  for (uint i = 0; i < 6; ++i)
+  {
+    const float4 plane = g_frustumPlanes[i];
+    if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extents) < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void CSMain(uint3 dispatchId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+  if (groupIndex == 0)
+    gs_numVisible = 0;
+  GroupMemoryBarrierWithGroupSync();
+
+  IndirectInstance instance = (IndirectInstance)0;
+  bool isVisible = false;
+  if (dispatchId.x < g_numInstances)
+  {
+    instance = g_instances[dispatchId.x];
+    isVisible = IsInsideFrustum(instance.center, instance.extents);
+  }
+
+  // Slots are claimed within the group first, so the global counter only sees one atomic per group:
+  uint groupSlot = 0;
+  if (isVisible)
+    InterlockedAdd(gs_numVisible, 1, groupSlot);
+  GroupMemoryBarrierWithGroupSync();
+
+  if (groupIndex == 0 && gs_numVisible > 0)
+    g_commandCount.InterlockedAdd(0, gs_numVisible, gs_firstCommand);
+  GroupMemoryBarrierWithGroupSync();
+
+  const uint slot = gs_firstCommand + groupSlot;
+  if (!isVisible || slot >= g_maxCommands)
+    return;
+
+  // ExecuteIndirect clamps the count to its maximum command count, so overflowing commands can just be
+  // dropped:
+  const IndirectMeshDraw meshDraw = g_meshDraws[instance.meshDrawIndex];
+  const uint address = slot * g_commandStride;
+
+  if (g_objectIndexOffset != 0xffffffff)
+    g_commands.Store(address + g_objectIndexOffset, instance.objectIndex);
+
+  g_commands.Store4(address + g_drawArgumentsOffset,
+    uint4(meshDraw.indexCount, 1, meshDraw.startIndex, asuint(meshDraw.baseVertex)));
+  g_commands.Store(address + g_drawArgumentsOffset + 16, 0);
+}
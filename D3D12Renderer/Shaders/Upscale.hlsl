@@ -0,0 +1,42 @@
+// Upscales the dynamic resolution scene to the back buffer: a fullscreen triangle bilinearly filtering
+// the rendered region in the top-left of the scene render target (see Upscaler).
+
+// Per-draw (space0) and small, so ends up as root constants:
+cbuffer UpscaleConstants : register(b0)
+{
+  float2  g_sourceSize;     // Rendered region of g_source, in texels.
+};
+
+Texture2D<float4> g_source : register(t0, space2);
+
+struct VSOutput
+{
+  float4  position  : SV_Position;
+  float2  uv        : TEXCOORD0;
+};
+
+VSOutput VSMain(uint vertexId : SV_VertexID)
+{
+  // Vertices (0, 0), (2, 0) and (0, 2) in uv cover the whole screen:
+  VSOutput output;
+  output.uv = float2((vertexId << 1) & 2, vertexId & 2);
+  output.position = float4(output.uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+  return output;
+}
+
+float4 PSMain(VSOutput input) : SV_Target
+{
+  // Bilinear by hand with Load(), clamped to the rendered region so texels outside it (left over from
+  // frames rendered at a higher resolution) never bleed in, and no sampler is needed:
+  const float2 position = input.uv * g_sourceSize - 0.5f;
+  const float2 base = floor(position);
+  const float2 weight = position - base;
+  const int2 maxTexel = int2(g_sourceSize) - 1;
+
+  const int2 texel0 = clamp(int2(base), 0, maxTexel);
+  const int2 texel1 = clamp(int2(base) + 1, 0, maxTexel);
+
+  const float4 top = lerp(g_source.Load(int3(texel0.x, texel0.y, 0)), g_source.Load(int3(texel1.x, texel0.y, 0)), weight.x);
+  const float4 bottom = lerp(g_source.Load(int3(texel0.x, texel1.y, 0)), g_source.Load(int3(texel1.x, texel1.y, 0)), weight.x);
+  return lerp(top, bottom, weight.y);
+}
@@ -0,0 +1,1024 @@
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+// Defined as 0 to build the scalar path on x86 too, which the tests do to check both render the same:
+#ifndef DX12_SW_X86
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX12_SW_X86 1
+#else
+#define DX12_SW_X86 0
+#endif
+#endif
+
+#if DX12_SW_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  const int32_t c_subpixelBits = 4;
+  const int32_t c_subpixelScale = 1 << c_subpixelBits;
+
+  // Pixels the guard band reaches past the viewport. Together with targets being at most c_maxTargetSize
+  // this keeps fixed point coordinates under 2^18, so edge functions stepped across a tile fit in 32 bits:
+  const float c_guardBand = 2048.0f;
+  const uint32_t c_maxTargetSize = 8192;
+
+  // Edge functions at a tile's first pixel are clamped to this, which can't change which pixels of the
+  // tile are covered since they change by less than it across one:
+  const int64_t c_maxEdgeValue = 1 << 30;
+
+  // Near, far, then the guard band's right, left, bottom and top, and the most vertices clipping to
+  // them can leave:
+  const uint32_t c_numClipPlanes = 6;
+  const uint32_t c_maxClippedVertices = 3 + c_numClipPlanes;
+
+  const uint32_t c_vertexGrainSize = 256;
+  const uint32_t c_clearGrainSize = 64;
+  const uint32_t c_laneMask = (1u << g_swNumLanes) - 1;
+
+  float PlaneDistance(const float position[4], uint32_t plane, float guardX, float guardY)
+  {
+    switch (plane)
+    {
+    case 0:
+      return position[2];
+    case 1:
+      return position[3] - position[2];
+    case 2:
+      return guardX * position[3] - position[0];
+    case 3:
+      return guardX * position[3] + position[0];
+    case 4:
+      return guardY * position[3] - position[1];
+    default:
+      return guardY * position[3] + position[1];
+    }
+  }
+
+  // Bit per plane the position is outside of:
+  uint32_t ClipCodes(const float position[4], float guardX, float guardY)
+  {
+    uint32_t codes = 0;
+    for (uint32_t plane = 0; plane < c_numClipPlanes; ++plane)
+    {
+      if (PlaneDistance(position, plane, guardX, guardY) < 0.0f)
+        codes |= 1u << plane;
+    }
+    return codes;
+  }
+
+  void Lerp(const SwVertexOutput& a, const SwVertexOutput& b, float t, uint32_t numVaryings, SwVertexOutput& result)
+  {
+    for (uint32_t i = 0; i < 4; ++i)
+      result.position[i] = a.position[i] + (b.position[i] - a.position[i]) * t;
+    for (uint32_t i = 0; i < numVaryings; ++i)
+      result.varyings[i] = a.varyings[i] + (b.varyings[i] - a.varyings[i]) * t;
+  }
+
+  uint32_t ToUnorm8(float value)
+  {
+    // Written so NaN comes out as 0:
+    return static_cast<uint32_t>(std::min(std::max(0.0f, value), 1.0f) * 255.0f + 0.5f);
+  }
+
+  uint32_t PackColour(float r, float g, float b, float a)
+  {
+    return ToUnorm8(r) | (ToUnorm8(g) << 8) | (ToUnorm8(b) << 16) | (ToUnorm8(a) << 24);
+  }
+
+  float UnpackChannel(uint32_t colour, uint32_t channel)
+  {
+    return static_cast<float>((colour >> (channel * 8)) & 0xff) * (1.0f / 255.0f);
+  }
+
+  // Bit per lane whose pixel is inside all three edges, laneOffsets being each lane's step from the first:
+  uint32_t CoverageMask(const int32_t edges[3], const int32_t laneOffsets[3][g_swNumLanes])
+  {
+#if DX12_SW_X86
+    // Any edge negative sets the sign bit:
+    __m128i outside = _mm_setzero_si128();
+    for (uint32_t edge = 0; edge < 3; ++edge)
+    {
+      const __m128i offsets = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneOffsets[edge]));
+      outside = _mm_or_si128(outside, _mm_add_epi32(_mm_set1_epi32(edges[edge]), offsets));
+    }
+    return ~static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(outside))) & c_laneMask;
+#else
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+    {
+      const int32_t outside = (edges[0] + laneOffsets[0][lane]) | (edges[1] + laneOffsets[1][lane]) |
+        (edges[2] + laneOffsets[2][lane]);
+      if (outside >= 0)
+        mask |= 1u << lane;
+    }
+    return mask;
+#endif
+  }
+
+  // plane at each lane, dx being the lanes' x and dy the row's y relative to the plane's origin:
+  void EvaluatePlane(const float plane[3], const float dx[g_swNumLanes], float dy, float result[g_swNumLanes])
+  {
+#if DX12_SW_X86
+    const __m128 rowValue = _mm_set1_ps(plane[0] + plane[2] * dy);
+    _mm_storeu_ps(result, _mm_add_ps(rowValue, _mm_mul_ps(_mm_set1_ps(plane[1]), _mm_loadu_ps(dx))));
+#else
+    const float rowValue = plane[0] + plane[2] * dy;
+    for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+      result[lane] = rowValue + plane[1] * dx[lane];
+#endif
+  }
+
+  void Multiply(const float a[g_swNumLanes], const float b[g_swNumLanes], float result[g_swNumLanes])
+  {
+#if DX12_SW_X86
+    _mm_storeu_ps(result, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+#else
+    for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+      result[lane] = a[lane] * b[lane];
+#endif
+  }
+
+  void Reciprocal(const float values[g_swNumLanes], float result[g_swNumLanes])
+  {
+#if DX12_SW_X86
+    // A real division rather than _mm_rcp_ps, which differs between CPUs:
+    _mm_storeu_ps(result, _mm_div_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(values)));
+#else
+    for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+      result[lane] = 1.0f / values[lane];
+#endif
+  }
+
+  // Bit per lane whose depth is less than what's in the depth buffer:
+  uint32_t DepthLessMask(const float depth[g_swNumLanes], const float* dest)
+  {
+#if DX12_SW_X86
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(depth), _mm_loadu_ps(dest))));
+#else
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+    {
+      if (depth[lane] < dest[lane])
+        mask |= 1u << lane;
+    }
+    return mask;
+#endif
+  }
+
+  uint32_t CountBits(uint32_t mask)
+  {
+    uint32_t count = 0;
+    for (; mask != 0; mask &= mask - 1)
+      ++count;
+    return count;
+  }
+}
+
+SwTexture::SwTexture(SwFormat format, uint32_t width, uint32_t height) :
+  m_format(format),
+  m_width(width),
+  m_height(height)
+{
+  assert(width <= c_maxTargetSize && height <= c_maxTargetSize);
+
+  if (format == SwFormat::RGBA8)
+    m_colour.resize(static_cast<size_t>(width) * height);
+  else
+    m_depth.resize(static_cast<size_t>(width) * height);
+}
+
+uint64_t SwTexture::Hash() const
+{
+  const uint8_t* bytes = m_format == SwFormat::RGBA8 ? reinterpret_cast<const uint8_t*>(m_colour.data()) :
+    reinterpret_cast<const uint8_t*>(m_depth.data());
+  const size_t numBytes = static_cast<size_t>(m_width) * m_height * 4;
+
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < numBytes; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+bool SwTexture::WritePpm(const std::string& path) const
+{
+  if (m_format != SwFormat::RGBA8)
+    return false;
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+    return false;
+
+  file << "P6\n" << m_width << ' ' << m_height << "\n255\n";
+
+  std::vector<char> row(static_cast<size_t>(m_width) * 3);
+  for (uint32_t y = 0; y < m_height; ++y)
+  {
+    const uint32_t* texels = m_colour.data() + static_cast<size_t>(y) * m_width;
+    for (uint32_t x = 0; x < m_width; ++x)
+    {
+      row[x * 3 + 0] = static_cast<char>(texels[x] & 0xff);
+      row[x * 3 + 1] = static_cast<char>((texels[x] >> 8) & 0xff);
+      row[x * 3 + 2] = static_cast<char>((texels[x] >> 16) & 0xff);
+    }
+    file.write(row.data(), row.size());
+  }
+  return static_cast<bool>(file);
+}
+
+uint32_t CountDifferingTexels(const SwTexture& a, const SwTexture& b, uint32_t tolerance)
+{
+  assert(a.GetFormat() == SwFormat::RGBA8 && b.GetFormat() == SwFormat::RGBA8);
+  assert(a.GetWidth() == b.GetWidth() && a.GetHeight() == b.GetHeight());
+
+  const size_t numTexels = static_cast<size_t>(a.GetWidth()) * a.GetHeight();
+  uint32_t numDiffering = 0;
+  for (size_t i = 0; i < numTexels; ++i)
+  {
+    for (uint32_t channel = 0; channel < 4; ++channel)
+    {
+      const int32_t difference = static_cast<int32_t>((a.GetColour()[i] >> (channel * 8)) & 0xff) -
+        static_cast<int32_t>((b.GetColour()[i] >> (channel * 8)) & 0xff);
+      if (static_cast<uint32_t>(std::abs(difference)) > tolerance)
+      {
+        ++numDiffering;
+        break;
+      }
+    }
+  }
+  return numDiffering;
+}
+
+void SwCommandList::Reset()
+{
+  m_commands.clear();
+  m_constants.clear();
+}
+
+SwCommandList::Command& SwCommandList::Add(CommandType type)
+{
+  m_commands.emplace_back();
+  Command& command = m_commands.back();
+  std::memset(&command, 0, sizeof(command));
+  command.type = type;
+  return command;
+}
+
+void SwCommandList::ClearRenderTargetView(SwTexture* target, const float colour[4])
+{
+  assert(target && target->GetFormat() == SwFormat::RGBA8);
+
+  Command& command = Add(CommandType::ClearColour);
+  command.objects[0] = target;
+  std::copy(colour, colour + 4, command.values);
+}
+
+void SwCommandList::ClearDepthStencilView(SwTexture* depth, float value)
+{
+  assert(depth && depth->GetFormat() == SwFormat::R32Float);
+
+  Command& command = Add(CommandType::ClearDepth);
+  command.objects[0] = depth;
+  command.values[0] = value;
+}
+
+void SwCommandList::OMSetRenderTargets(SwTexture* colour, SwTexture* depth)
+{
+  assert(!colour || colour->GetFormat() == SwFormat::RGBA8);
+  assert(!depth || depth->GetFormat() == SwFormat::R32Float);
+  assert(!colour || !depth || (colour->GetWidth() == depth->GetWidth() && colour->GetHeight() == depth->GetHeight()));
+
+  Command& command = Add(CommandType::SetRenderTargets);
+  command.objects[0] = colour;
+  command.objects[1] = depth;
+}
+
+void SwCommandList::RSSetViewports(const SwViewport& viewport)
+{
+  Command& command = Add(CommandType::SetViewport);
+  command.values[0] = viewport.x;
+  command.values[1] = viewport.y;
+  command.values[2] = viewport.width;
+  command.values[3] = viewport.height;
+  command.values[4] = viewport.minDepth;
+  command.values[5] = viewport.maxDepth;
+}
+
+void SwCommandList::RSSetScissorRects(const SwRect& rect)
+{
+  Command& command = Add(CommandType::SetScissorRect);
+  command.args[0] = static_cast<uint32_t>(rect.left);
+  command.args[1] = static_cast<uint32_t>(rect.top);
+  command.args[2] = static_cast<uint32_t>(rect.right);
+  command.args[3] = static_cast<uint32_t>(rect.bottom);
+}
+
+void SwCommandList::SetPipelineState(const SwPipelineState* pipelineState)
+{
+  assert(!pipelineState || pipelineState->numVaryings <= g_swMaxVaryings);
+
+  Command& command = Add(CommandType::SetPipelineState);
+  command.objects[0] = pipelineState;
+}
+
+void SwCommandList::IASetVertexBuffers(const void* vertices, uint32_t stride, uint32_t count)
+{
+  Command& command = Add(CommandType::SetVertexBuffer);
+  command.objects[0] = vertices;
+  command.args[0] = stride;
+  command.args[1] = count;
+}
+
+void SwCommandList::IASetIndexBuffer(const uint32_t* indices, uint32_t count)
+{
+  Command& command = Add(CommandType::SetIndexBuffer);
+  command.objects[0] = indices;
+  command.args[0] = count;
+}
+
+void SwCommandList::SetGraphicsRoot32BitConstants(uint32_t num32BitValues, const void* data)
+{
+  Command& command = Add(CommandType::SetGraphicsConstants);
+  command.args[0] = static_cast<uint32_t>(m_constants.size());
+  command.args[1] = num32BitValues;
+
+  m_constants.resize(m_constants.size() + num32BitValues);
+  std::memcpy(m_constants.data() + command.args[0], data, num32BitValues * sizeof(uint32_t));
+}
+
+void SwCommandList::SetComputeRoot32BitConstants(uint32_t num32BitValues, const void* data)
+{
+  Command& command = Add(CommandType::SetComputeConstants);
+  command.args[0] = static_cast<uint32_t>(m_constants.size());
+  command.args[1] = num32BitValues;
+
+  m_constants.resize(m_constants.size() + num32BitValues);
+  std::memcpy(m_constants.data() + command.args[0], data, num32BitValues * sizeof(uint32_t));
+}
+
+void SwCommandList::ResourceBarrier()
+{
+  Add(CommandType::Barrier);
+}
+
+void SwCommandList::DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex,
+  uint32_t startInstance)
+{
+  Command& command = Add(CommandType::Draw);
+  command.args[0] = vertexCount;
+  command.args[1] = instanceCount;
+  command.args[2] = startVertex;
+  command.args[3] = startInstance;
+}
+
+void SwCommandList::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex,
+  int32_t baseVertex, uint32_t startInstance)
+{
+  Command& command = Add(CommandType::DrawIndexed);
+  command.args[0] = indexCount;
+  command.args[1] = instanceCount;
+  command.args[2] = startIndex;
+  command.args[3] = static_cast<uint32_t>(baseVertex);
+  command.args[4] = startInstance;
+}
+
+void SwCommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+  Command& command = Add(CommandType::Dispatch);
+  command.args[0] = x;
+  command.args[1] = y;
+  command.args[2] = z;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(JobSystem* jobSystem) :
+  m_jobSystem(jobSystem),
+  m_colourTarget(nullptr),
+  m_depthTarget(nullptr),
+  m_viewport{},
+  m_scissorRect{},
+  m_pipelineState(nullptr),
+  m_graphicsConstants(nullptr),
+  m_computeConstants(nullptr),
+  m_numTilesX(0),
+  m_numTilesY(0)
+{
+}
+
+template<typename Func>
+void SoftwareRasterizer::ParallelFor(uint32_t count, uint32_t grainSize, const Func& func)
+{
+  if (m_jobSystem)
+    m_jobSystem->ParallelFor(count, grainSize, func);
+  else if (count > 0)
+    func(0u, count);
+}
+
+void SoftwareRasterizer::Execute(const SwCommandList& commandList)
+{
+  using CommandType = SwCommandList::CommandType;
+
+  // Every command list starts from the default state, like a D3D12 one, except that the scissor rect
+  // doesn't clip anything until set:
+  SetRenderTargets(nullptr, nullptr);
+  m_viewport = {};
+  m_scissorRect = { 0, 0, INT32_MAX, INT32_MAX };
+  m_pipelineState = nullptr;
+  m_graphicsConstants = nullptr;
+  m_computeConstants = nullptr;
+
+  const void* vertices = nullptr;
+  uint32_t vertexStride = 0;
+  uint32_t numVertices = 0;
+  const uint32_t* indices = nullptr;
+  uint32_t numIndices = 0;
+
+  for (const SwCommandList::Command& command : commandList.m_commands)
+  {
+    switch (command.type)
+    {
+    case CommandType::ClearColour:
+      Flush();
+      Clear(static_cast<SwTexture*>(const_cast<void*>(command.objects[0])),
+        PackColour(command.values[0], command.values[1], command.values[2], command.values[3]), 0.0f);
+      break;
+
+    case CommandType::ClearDepth:
+      Flush();
+      Clear(static_cast<SwTexture*>(const_cast<void*>(command.objects[0])), 0, command.values[0]);
+      break;
+
+    case CommandType::SetRenderTargets:
+      Flush();
+      SetRenderTargets(static_cast<SwTexture*>(const_cast<void*>(command.objects[0])),
+        static_cast<SwTexture*>(const_cast<void*>(command.objects[1])));
+      break;
+
+    case CommandType::SetViewport:
+      m_viewport = { command.values[0], command.values[1], command.values[2], command.values[3], command.values[4],
+        command.values[5] };
+      break;
+
+    case CommandType::SetScissorRect:
+      m_scissorRect = { static_cast<int32_t>(command.args[0]), static_cast<int32_t>(command.args[1]),
+        static_cast<int32_t>(command.args[2]), static_cast<int32_t>(command.args[3]) };
+      break;
+
+    case CommandType::SetPipelineState:
+      m_pipelineState = static_cast<const SwPipelineState*>(command.objects[0]);
+      break;
+
+    case CommandType::SetVertexBuffer:
+      vertices = command.objects[0];
+      vertexStride = command.args[0];
+      numVertices = command.args[1];
+      break;
+
+    case CommandType::SetIndexBuffer:
+      indices = static_cast<const uint32_t*>(command.objects[0]);
+      numIndices = command.args[0];
+      break;
+
+    case CommandType::SetGraphicsConstants:
+      m_graphicsConstants = commandList.m_constants.data() + command.args[0];
+      break;
+
+    case CommandType::SetComputeConstants:
+      m_computeConstants = commandList.m_constants.data() + command.args[0];
+      break;
+
+    case CommandType::Barrier:
+      Flush();
+      break;
+
+    case CommandType::Draw:
+      assert(vertices && command.args[2] + command.args[0] <= numVertices);
+      if (!vertices || command.args[2] + command.args[0] > numVertices)
+        break;
+      Draw(vertices, vertexStride, nullptr, command.args[0], command.args[1], command.args[2], 0, command.args[3]);
+      break;
+
+    case CommandType::DrawIndexed:
+      assert(vertices && indices && command.args[2] + command.args[0] <= numIndices);
+      if (!vertices || !indices || command.args[2] + command.args[0] > numIndices)
+        break;
+      Draw(vertices, vertexStride, indices, command.args[0], command.args[1], command.args[2],
+        static_cast<int32_t>(command.args[3]), command.args[4]);
+      break;
+
+    case CommandType::Dispatch:
+    {
+      Flush();
+
+      assert(m_pipelineState && m_pipelineState->computeKernel);
+      if (!m_pipelineState || !m_pipelineState->computeKernel)
+        break;
+
+      const SwComputeKernel kernel = m_pipelineState->computeKernel;
+      const void* constants = m_computeConstants;
+      const uint32_t x = command.args[0];
+      const uint32_t y = command.args[1];
+      ParallelFor(x * y * command.args[2], 1, [=](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+          kernel(constants, i % x, (i / x) % y, i / (x * y));
+      });
+      ++m_stats.numDispatches;
+      break;
+    }
+    }
+  }
+
+  Flush();
+}
+
+void SoftwareRasterizer::Draw(const void* vertices, uint32_t stride, const uint32_t* indices, uint32_t count,
+  uint32_t instanceCount, uint32_t start, int32_t baseVertex, uint32_t startInstance)
+{
+  const SwPipelineState* pipelineState = m_pipelineState;
+  assert(pipelineState && pipelineState->vertexShader);
+  assert(!m_colourTarget || pipelineState->pixelShader);
+  if (!pipelineState || !pipelineState->vertexShader || (!m_colourTarget && !m_depthTarget))
+    return;
+
+  ++m_stats.numDraws;
+
+  const uint32_t numTriangles = count / 3;
+  if (numTriangles == 0 || instanceCount == 0 || m_viewport.width <= 0.0f || m_viewport.height <= 0.0f)
+    return;
+
+  // Only the range of vertices the draw uses is shaded, once per instance:
+  int64_t firstVertex = start;
+  int64_t lastVertex = static_cast<int64_t>(start) + count - 1;
+  if (indices)
+  {
+    const auto range = std::minmax_element(indices + start, indices + start + count);
+    firstVertex = static_cast<int64_t>(*range.first) + baseVertex;
+    lastVertex = static_cast<int64_t>(*range.second) + baseVertex;
+  }
+  assert(firstVertex >= 0);
+
+  const uint32_t numVertices = static_cast<uint32_t>(lastVertex - firstVertex + 1);
+  m_shadedVertices.resize(numVertices);
+  m_drawStates.push_back({ pipelineState, m_graphicsConstants });
+
+  const uint8_t* vertexBytes = static_cast<const uint8_t*>(vertices) + static_cast<size_t>(firstVertex) * stride;
+  const void* constants = m_graphicsConstants;
+  for (uint32_t instance = startInstance; instance < startInstance + instanceCount; ++instance)
+  {
+    ParallelFor(numVertices, c_vertexGrainSize, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; ++i)
+      {
+        const uint8_t* vertex = vertexBytes + static_cast<size_t>(i) * stride;
+        pipelineState->vertexShader(constants, vertex, instance, m_shadedVertices[i]);
+      }
+    });
+
+    // Assembled in order, so tiles see triangles in submission order:
+    for (uint32_t i = 0; i < numTriangles; ++i)
+    {
+      const SwVertexOutput* triangle[3];
+      for (uint32_t corner = 0; corner < 3; ++corner)
+      {
+        const uint32_t index = start + i * 3 + corner;
+        const int64_t vertex = indices ? static_cast<int64_t>(indices[index]) + baseVertex : index;
+        triangle[corner] = &m_shadedVertices[static_cast<size_t>(vertex - firstVertex)];
+      }
+      AssembleTriangle(triangle, i);
+    }
+  }
+}
+
+void SoftwareRasterizer::AssembleTriangle(const SwVertexOutput* vertices[3], uint32_t primitiveId)
+{
+  ++m_stats.numTriangles;
+
+  // Off screen if all the vertices are outside the same plane of the view volume:
+  uint32_t rejectCodes = ~0u;
+  for (uint32_t i = 0; i < 3; ++i)
+    rejectCodes &= ClipCodes(vertices[i]->position, 1.0f, 1.0f);
+  if (rejectCodes != 0)
+  {
+    ++m_stats.numTrianglesCulled;
+    return;
+  }
+
+  const float guardX = 1.0f + c_guardBand / (m_viewport.width * 0.5f);
+  const float guardY = 1.0f + c_guardBand / (m_viewport.height * 0.5f);
+  uint32_t clipCodes = 0;
+  for (uint32_t i = 0; i < 3; ++i)
+    clipCodes |= ClipCodes(vertices[i]->position, guardX, guardY);
+
+  if (clipCodes == 0)
+  {
+    if (!SetupTriangle(vertices, primitiveId))
+      ++m_stats.numTrianglesCulled;
+    return;
+  }
+
+  // Sutherland-Hodgman against the planes crossed. Crossing points are always interpolated from the inside
+  // vertex, so triangles sharing a clipped edge get exactly the same points on it:
+  const uint32_t numVaryings = m_drawStates.back().pipelineState->numVaryings;
+  SwVertexOutput polygons[2][c_maxClippedVertices];
+  uint32_t numPolygonVertices = 3;
+  for (uint32_t i = 0; i < 3; ++i)
+    polygons[0][i] = *vertices[i];
+
+  uint32_t current = 0;
+  for (uint32_t plane = 0; plane < c_numClipPlanes && numPolygonVertices >= 3; ++plane)
+  {
+    if ((clipCodes & (1u << plane)) == 0)
+      continue;
+
+    const SwVertexOutput* input = polygons[current];
+    SwVertexOutput* output = polygons[current ^ 1];
+    uint32_t numOutput = 0;
+    for (uint32_t i = 0; i < numPolygonVertices; ++i)
+    {
+      const SwVertexOutput& a = input[i];
+      const SwVertexOutput& b = input[(i + 1) % numPolygonVertices];
+      const float distanceA = PlaneDistance(a.position, plane, guardX, guardY);
+      const float distanceB = PlaneDistance(b.position, plane, guardX, guardY);
+
+      if (distanceA >= 0.0f)
+        output[numOutput++] = a;
+      if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+      {
+        if (distanceA >= 0.0f)
+          Lerp(a, b, distanceA / (distanceA - distanceB), numVaryings, output[numOutput++]);
+        else
+          Lerp(b, a, distanceB / (distanceB - distanceA), numVaryings, output[numOutput++]);
+      }
+    }
+
+    numPolygonVertices = numOutput;
+    current ^= 1;
+  }
+
+  bool isVisible = false;
+  for (uint32_t i = 1; i + 1 < numPolygonVertices; ++i)
+  {
+    const SwVertexOutput* triangle[3] = { &polygons[current][0], &polygons[current][i], &polygons[current][i + 1] };
+    isVisible |= SetupTriangle(triangle, primitiveId);
+  }
+  if (!isVisible)
+    ++m_stats.numTrianglesCulled;
+}
+
+bool SoftwareRasterizer::SetupTriangle(const SwVertexOutput* vertices[3], uint32_t primitiveId)
+{
+  const DrawState& drawState = m_drawStates.back();
+  const uint32_t numVaryings = drawState.pipelineState->numVaryings;
+
+  int32_t fixedX[3];
+  int32_t fixedY[3];
+  float depth[3];
+  float invW[3];
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    const float* position = vertices[i]->position;
+    invW[i] = 1.0f / position[3];
+
+    const float screenX = m_viewport.x + (position[0] * invW[i] + 1.0f) * 0.5f * m_viewport.width;
+    const float screenY = m_viewport.y + (1.0f - position[1] * invW[i]) * 0.5f * m_viewport.height;
+    fixedX[i] = static_cast<int32_t>(std::floor(screenX * c_subpixelScale + 0.5f));
+    fixedY[i] = static_cast<int32_t>(std::floor(screenY * c_subpixelScale + 0.5f));
+    depth[i] = m_viewport.minDepth + position[2] * invW[i] * (m_viewport.maxDepth - m_viewport.minDepth);
+  }
+
+  // Twice the signed area, positive for clockwise triangles (y is down):
+  const int64_t area = static_cast<int64_t>(fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0]) -
+    static_cast<int64_t>(fixedX[2] - fixedX[0]) * (fixedY[1] - fixedY[0]);
+  if (area == 0 || (area < 0 && drawState.pipelineState->cullMode == SwCullMode::Back))
+    return false;
+
+  // Counter-clockwise triangles that aren't culled are flipped, so edge functions are positive inside:
+  uint32_t order[3] = { 0, 1, 2 };
+  if (area < 0)
+    std::swap(order[1], order[2]);
+
+  // Pixel bounds: pixel x is covered by the triangle's x range if its center (x * 16 + 8) is within it:
+  const int32_t half = c_subpixelScale / 2;
+  Triangle triangle;
+  triangle.minX = (std::min({ fixedX[0], fixedX[1], fixedX[2] }) - half + c_subpixelScale - 1) >> c_subpixelBits;
+  triangle.minY = (std::min({ fixedY[0], fixedY[1], fixedY[2] }) - half + c_subpixelScale - 1) >> c_subpixelBits;
+  triangle.maxX = ((std::max({ fixedX[0], fixedX[1], fixedX[2] }) - half) >> c_subpixelBits) + 1;
+  triangle.maxY = ((std::max({ fixedY[0], fixedY[1], fixedY[2] }) - half) >> c_subpixelBits) + 1;
+
+  const SwTexture* target = m_colourTarget ? m_colourTarget : m_depthTarget;
+  triangle.minX = std::max({ triangle.minX, m_scissorRect.left, static_cast<int32_t>(std::floor(m_viewport.x)), 0 });
+  triangle.minY = std::max({ triangle.minY, m_scissorRect.top, static_cast<int32_t>(std::floor(m_viewport.y)), 0 });
+  triangle.maxX = std::min({ triangle.maxX, m_scissorRect.right,
+    static_cast<int32_t>(std::ceil(m_viewport.x + m_viewport.width)), static_cast<int32_t>(target->GetWidth()) });
+  triangle.maxY = std::min({ triangle.maxY, m_scissorRect.bottom,
+    static_cast<int32_t>(std::ceil(m_viewport.y + m_viewport.height)), static_cast<int32_t>(target->GetHeight()) });
+  if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY)
+    return false;
+
+  // Edge a -> b is (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x), positive on its right. Pixels
+  // exactly on an edge belong to the triangle if it's a top edge (horizontal, with the triangle below it)
+  // or a left one (going up), so the others are biased to exclude them:
+  for (uint32_t edge = 0; edge < 3; ++edge)
+  {
+    const uint32_t a = order[edge];
+    const uint32_t b = order[(edge + 1) % 3];
+    const int32_t dx = fixedX[b] - fixedX[a];
+    const int32_t dy = fixedY[b] - fixedY[a];
+    const bool isTopLeft = (dy == 0 && dx > 0) || dy < 0;
+
+    const int64_t edgeA = -dy;
+    const int64_t edgeB = dx;
+    const int64_t edgeC = static_cast<int64_t>(dy) * fixedX[a] - static_cast<int64_t>(dx) * fixedY[a] -
+      (isTopLeft ? 0 : 1);
+
+    // In pixels, evaluated at their centers:
+    triangle.edgeA[edge] = static_cast<int32_t>(edgeA * c_subpixelScale);
+    triangle.edgeB[edge] = static_cast<int32_t>(edgeB * c_subpixelScale);
+    triangle.edgeC[edge] = edgeC + (edgeA + edgeB) * half;
+  }
+
+  // Attribute planes, from the snapped positions so they match the edges:
+  float x[3];
+  float y[3];
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    x[i] = static_cast<float>(fixedX[order[i]]) / c_subpixelScale;
+    y[i] = static_cast<float>(fixedY[order[i]]) / c_subpixelScale;
+  }
+  const float dx1 = x[1] - x[0];
+  const float dy1 = y[1] - y[0];
+  const float dx2 = x[2] - x[0];
+  const float dy2 = y[2] - y[0];
+  const float invDeterminant = 1.0f / (dx1 * dy2 - dx2 * dy1);
+
+  triangle.originX = x[0];
+  triangle.originY = y[0];
+  for (uint32_t attribute = 0; attribute < numVaryings + 2; ++attribute)
+  {
+    float values[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+      const uint32_t vertex = order[i];
+      if (attribute == 0)
+        values[i] = depth[vertex];
+      else if (attribute == 1)
+        values[i] = invW[vertex];
+      else
+        values[i] = vertices[vertex]->varyings[attribute - 2] * invW[vertex];
+    }
+
+    float* plane = triangle.planes[attribute];
+    plane[0] = values[0];
+    plane[1] = ((values[1] - values[0]) * dy2 - (values[2] - values[0]) * dy1) * invDeterminant;
+    plane[2] = ((values[2] - values[0]) * dx1 - (values[1] - values[0]) * dx2) * invDeterminant;
+  }
+
+  triangle.drawState = static_cast<uint32_t>(m_drawStates.size() - 1);
+  triangle.primitiveId = primitiveId;
+
+  // Binned into every tile its bounds touch, except those one of its edges is entirely outside of (tested
+  // at the tile's pixel furthest inside the edge), which skips most of a long thin triangle's:
+  const uint32_t triangleIndex = static_cast<uint32_t>(m_triangles.size());
+  const int32_t tileSize = static_cast<int32_t>(c_tileSize);
+  const int32_t firstTileX = triangle.minX / tileSize;
+  const int32_t firstTileY = triangle.minY / tileSize;
+  const int32_t lastTileX = (triangle.maxX - 1) / tileSize;
+  const int32_t lastTileY = (triangle.maxY - 1) / tileSize;
+  const bool isSingleTile = firstTileX == lastTileX && firstTileY == lastTileY;
+  bool isBinned = false;
+  for (int32_t tileY = firstTileY; tileY <= lastTileY; ++tileY)
+  {
+    for (int32_t tileX = firstTileX; tileX <= lastTileX; ++tileX)
+    {
+      bool isOutside = false;
+      if (!isSingleTile)
+      {
+        const int32_t left = std::max(triangle.minX, tileX * tileSize);
+        const int32_t top = std::max(triangle.minY, tileY * tileSize);
+        const int32_t right = std::min(triangle.maxX, (tileX + 1) * tileSize) - 1;
+        const int32_t bottom = std::min(triangle.maxY, (tileY + 1) * tileSize) - 1;
+        for (uint32_t edge = 0; edge < 3 && !isOutside; ++edge)
+        {
+          const int32_t x = triangle.edgeA[edge] >= 0 ? right : left;
+          const int32_t y = triangle.edgeB[edge] >= 0 ? bottom : top;
+          const int64_t value = static_cast<int64_t>(triangle.edgeA[edge]) * x +
+            static_cast<int64_t>(triangle.edgeB[edge]) * y + triangle.edgeC[edge];
+          isOutside = value < 0;
+        }
+      }
+
+      if (!isOutside)
+      {
+        m_tileBins[tileY * m_numTilesX + tileX].push_back(triangleIndex);
+        isBinned = true;
+      }
+    }
+  }
+
+  if (!isBinned)
+    return false;
+
+  m_triangles.push_back(triangle);
+  ++m_stats.numTrianglesBinned;
+  return true;
+}
+
+void SoftwareRasterizer::Flush()
+{
+  if (!m_triangles.empty())
+  {
+    ParallelFor(m_numTilesX * m_numTilesY, 1, [this](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; ++i)
+        RasterizeTile(i);
+    });
+
+    for (uint32_t i = 0; i < m_tileBins.size(); ++i)
+    {
+      m_stats.numPixelsShaded += m_tileStats[i].numPixelsShaded;
+      m_stats.numPixelsWritten += m_tileStats[i].numPixelsWritten;
+      m_tileStats[i] = {};
+      m_tileBins[i].clear();
+    }
+  }
+
+  m_triangles.clear();
+  m_drawStates.clear();
+}
+
+void SoftwareRasterizer::RasterizeTile(uint32_t tileIndex)
+{
+  const int32_t tileX = static_cast<int32_t>((tileIndex % m_numTilesX) * c_tileSize);
+  const int32_t tileY = static_cast<int32_t>((tileIndex / m_numTilesX) * c_tileSize);
+
+  TileStats& stats = m_tileStats[tileIndex];
+  for (uint32_t triangleIndex : m_tileBins[tileIndex])
+    RasterizeTriangle(m_triangles[triangleIndex], tileX, tileY, stats);
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const Triangle& triangle, int32_t tileX, int32_t tileY, TileStats& stats)
+{
+  const DrawState& drawState = m_drawStates[triangle.drawState];
+  const SwPipelineState& pipelineState = *drawState.pipelineState;
+  const uint32_t numVaryings = pipelineState.numVaryings;
+  const bool writeColour = m_colourTarget && pipelineState.pixelShader;
+  const bool depthTest = m_depthTarget && pipelineState.depthTest;
+  const bool depthWrite = m_depthTarget && pipelineState.depthWrite;
+  const uint32_t width = m_colourTarget ? m_colourTarget->GetWidth() : m_depthTarget->GetWidth();
+
+  const int32_t minX = std::max(triangle.minX, tileX);
+  const int32_t minY = std::max(triangle.minY, tileY);
+  const int32_t maxX = std::min(triangle.maxX, tileX + static_cast<int32_t>(c_tileSize));
+  const int32_t maxY = std::min(triangle.maxY, tileY + static_cast<int32_t>(c_tileSize));
+  const int32_t firstBlockX = minX & ~static_cast<int32_t>(g_swNumLanes - 1);
+
+  int32_t rowEdges[3];
+  int32_t laneOffsets[3][g_swNumLanes];
+  for (uint32_t edge = 0; edge < 3; ++edge)
+  {
+    const int64_t value = static_cast<int64_t>(triangle.edgeA[edge]) * firstBlockX +
+      static_cast<int64_t>(triangle.edgeB[edge]) * minY + triangle.edgeC[edge];
+    rowEdges[edge] = static_cast<int32_t>(std::min(std::max(value, -c_maxEdgeValue), c_maxEdgeValue));
+    for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+      laneOffsets[edge][lane] = triangle.edgeA[edge] * static_cast<int32_t>(lane);
+  }
+
+  SwPixelBlock block;
+  block.primitiveId = triangle.primitiveId;
+  for (int32_t y = minY; y < maxY; ++y)
+  {
+    const float dy = static_cast<float>(y) + 0.5f - triangle.originY;
+    uint32_t* colourRow = writeColour ? m_colourTarget->GetColour() + static_cast<size_t>(y) * width : nullptr;
+    float* depthRow = m_depthTarget ? m_depthTarget->GetDepth() + static_cast<size_t>(y) * width : nullptr;
+
+    int32_t blockEdges[3] = { rowEdges[0], rowEdges[1], rowEdges[2] };
+    for (int32_t blockX = firstBlockX; blockX < maxX; blockX += g_swNumLanes)
+    {
+      // Lanes outside the triangle's bounds in this tile are masked off too:
+      uint32_t mask = CoverageMask(blockEdges, laneOffsets);
+      if (blockX < minX)
+        mask &= c_laneMask << (minX - blockX);
+      if (blockX + static_cast<int32_t>(g_swNumLanes) > maxX)
+        mask &= c_laneMask >> (blockX + g_swNumLanes - maxX);
+
+      for (uint32_t edge = 0; edge < 3; ++edge)
+        blockEdges[edge] += triangle.edgeA[edge] * static_cast<int32_t>(g_swNumLanes);
+
+      if (mask == 0)
+        continue;
+
+      float dx[g_swNumLanes];
+      for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+      {
+        block.x[lane] = static_cast<float>(blockX + static_cast<int32_t>(lane)) + 0.5f;
+        dx[lane] = block.x[lane] - triangle.originX;
+      }
+
+      float depth[g_swNumLanes] = {};
+      if (depthTest || depthWrite)
+        EvaluatePlane(triangle.planes[0], dx, dy, depth);
+
+      if (depthTest)
+      {
+        // Past the end of the row is read from a copy:
+        const float* dest = depthRow + blockX;
+        float lastBlock[g_swNumLanes] = {};
+        if (blockX + g_swNumLanes > width)
+        {
+          std::copy(depthRow + blockX, depthRow + width, lastBlock);
+          dest = lastBlock;
+        }
+        mask &= DepthLessMask(depth, dest);
+        if (mask == 0)
+          continue;
+      }
+
+      if (writeColour)
+      {
+        // Perspective-correct varyings, interpolated over 1/w:
+        float invW[g_swNumLanes];
+        float w[g_swNumLanes];
+        EvaluatePlane(triangle.planes[1], dx, dy, invW);
+        Reciprocal(invW, w);
+        for (uint32_t i = 0; i < numVaryings; ++i)
+        {
+          EvaluatePlane(triangle.planes[i + 2], dx, dy, block.varyings[i]);
+          Multiply(block.varyings[i], w, block.varyings[i]);
+        }
+        block.y = static_cast<float>(y) + 0.5f;
+
+        float colour[4][g_swNumLanes];
+        pipelineState.pixelShader(drawState.constants, block, colour);
+        stats.numPixelsShaded += g_swNumLanes;
+
+        for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+        {
+          if ((mask & (1u << lane)) == 0)
+            continue;
+
+          uint32_t& dest = colourRow[blockX + lane];
+          if (pipelineState.blendMode == SwBlendMode::Alpha)
+          {
+            const float alpha = std::min(std::max(0.0f, colour[3][lane]), 1.0f);
+            float blended[4];
+            for (uint32_t channel = 0; channel < 4; ++channel)
+              blended[channel] = colour[channel][lane] * alpha + UnpackChannel(dest, channel) * (1.0f - alpha);
+            dest = PackColour(blended[0], blended[1], blended[2], blended[3]);
+          }
+          else
+          {
+            dest = PackColour(colour[0][lane], colour[1][lane], colour[2][lane], colour[3][lane]);
+          }
+        }
+      }
+
+      if (depthWrite)
+      {
+        for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+        {
+          if (mask & (1u << lane))
+            depthRow[blockX + lane] = depth[lane];
+        }
+      }
+
+      stats.numPixelsWritten += CountBits(mask);
+    }
+
+    for (uint32_t edge = 0; edge < 3; ++edge)
+      rowEdges[edge] += triangle.edgeB[edge];
+  }
+}
+
+void SoftwareRasterizer::Clear(SwTexture* texture, uint32_t colour, float depth)
+{
+  const uint32_t width = texture->GetWidth();
+  ParallelFor(texture->GetHeight(), c_clearGrainSize, [=](uint32_t begin, uint32_t end) {
+    const size_t first = static_cast<size_t>(begin) * width;
+    const size_t count = static_cast<size_t>(end - begin) * width;
+    if (texture->GetFormat() == SwFormat::RGBA8)
+      std::fill_n(texture->GetColour() + first, count, colour);
+    else
+      std::fill_n(texture->GetDepth() + first, count, depth);
+  });
+}
+
+void SoftwareRasterizer::SetRenderTargets(SwTexture* colour, SwTexture* depth)
+{
+  m_colourTarget = colour;
+  m_depthTarget = depth;
+
+  const SwTexture* target = colour ? colour : depth;
+  m_numTilesX = target ? (target->GetWidth() + c_tileSize - 1) / c_tileSize : 0;
+  m_numTilesY = target ? (target->GetHeight() + c_tileSize - 1) / c_tileSize : 0;
+  m_tileBins.resize(m_numTilesX * m_numTilesY);
+  m_tileStats.assign(m_tileBins.size(), TileStats{});
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// CPU reference backend: command lists recorded with calls named after FilteredCommandList's (clears,
+// barriers, draws and dispatches), executed by a tile-based rasterizer spread across the job system.
+// Needs neither D3D12 nor a GPU, so rendering can be checked and benchmarked anywhere, and the output is
+// deterministic (independent of the number of threads) so images can be compared against golden ones.
+//
+// Rasterization follows D3D12's rules where they matter for comparing images: pixel centers at .5,
+// the top-left fill rule, clockwise front faces, [0, 1] clip space depth and perspective-correct
+// interpolation. Positions are snapped to 1/16 pixel (D3D12 uses 1/256), and triangles are clipped to
+// the near plane and a guard band, so huge ones are fine.
+
+enum class SwFormat : uint8_t
+{
+	RGBA8,						// Colour targets, R in the lowest byte.
+	R32Float,					// Depth buffers.
+};
+
+class SwTexture
+{
+public:
+	SwTexture(SwFormat format, uint32_t width, uint32_t height);
+
+	SwFormat GetFormat() const { return m_format; }
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+
+	uint32_t* GetColour() { return m_colour.data(); }
+	const uint32_t* GetColour() const { return m_colour.data(); }
+	float* GetDepth() { return m_depth.data(); }
+	const float* GetDepth() const { return m_depth.data(); }
+
+	// FNV-1a of every texel, to compare against a golden image's:
+	uint64_t Hash() const;
+
+	// Colour targets only, as a binary PPM (alpha dropped):
+	bool WritePpm(const std::string& path) const;
+
+private:
+	SwFormat				m_format;
+	uint32_t				m_width;
+	uint32_t				m_height;
+	std::vector<uint32_t>	m_colour;
+	std::vector<float>		m_depth;
+};
+
+// Texels of two same-sized colour textures with any channel differing by more than tolerance:
+uint32_t CountDifferingTexels(const SwTexture& a, const SwTexture& b, uint32_t tolerance = 0);
+
+const uint32_t g_swMaxVaryings = 8;
+const uint32_t g_swNumLanes = 4;				// Pixels shaded at once.
+
+struct SwVertexOutput
+{
+	float	position[4];						// Clip space.
+	float	varyings[g_swMaxVaryings];
+};
+
+// A run of g_swNumLanes horizontally adjacent pixels, structure-of-arrays. Lanes outside the triangle
+// are shaded too (like helper pixels) but never written:
+struct SwPixelBlock
+{
+	float		x[g_swNumLanes];				// Pixel centers.
+	float		y;
+	float		varyings[g_swMaxVaryings][g_swNumLanes];
+	uint32_t	primitiveId;
+};
+
+// Shaders are plain functions, constants being the pipeline's last SetGraphicsRoot32BitConstants() or
+// SetComputeRoot32BitConstants(). Pixel shaders write RGBA per lane, colour[channel][lane]:
+using SwVertexShader = void(*)(const void* constants, const void* vertex, uint32_t instanceId, SwVertexOutput& output);
+using SwPixelShader = void(*)(const void* constants, const SwPixelBlock& input, float colour[4][g_swNumLanes]);
+using SwComputeKernel = void(*)(const void* constants, uint32_t groupX, uint32_t groupY, uint32_t groupZ);
+
+enum class SwCullMode : uint8_t
+{
+	None,
+	Back,						// Counter-clockwise triangles.
+};
+
+enum class SwBlendMode : uint8_t
+{
+	Opaque,
+	Alpha,						// src * srcAlpha + dest * (1 - srcAlpha).
+};
+
+// Graphics pipelines set the shaders and fixed function state, compute ones just the kernel:
+struct SwPipelineState
+{
+	SwVertexShader	vertexShader = nullptr;
+	SwPixelShader	pixelShader = nullptr;
+	SwComputeKernel	computeKernel = nullptr;
+	uint32_t		numVaryings = 0;
+	SwCullMode		cullMode = SwCullMode::Back;
+	SwBlendMode		blendMode = SwBlendMode::Opaque;
+	bool			depthTest = true;		// Less.
+	bool			depthWrite = true;
+};
+
+struct SwViewport
+{
+	float	x;
+	float	y;
+	float	width;
+	float	height;
+	float	minDepth;
+	float	maxDepth;
+};
+
+struct SwRect
+{
+	int32_t	left;
+	int32_t	top;
+	int32_t	right;
+	int32_t	bottom;
+};
+
+// Recorded commands, replayed by SoftwareRasterizer::Execute(). Calls are named after FilteredCommandList's
+// but only mirror them: they take Sw objects rather than D3D12 views and descriptors, and there's no
+// recording interface shared with FilteredCommandList, so recording code is written for one backend or the
+// other. Buffers, textures, pipelines and shaders are referenced rather than copied and have to stay alive
+// until executed, constants are copied.
+class SwCommandList
+{
+public:
+	void Reset();
+
+	void ClearRenderTargetView(SwTexture* target, const float colour[4]);
+	void ClearDepthStencilView(SwTexture* depth, float value);
+	void OMSetRenderTargets(SwTexture* colour, SwTexture* depth);
+	void RSSetViewports(const SwViewport& viewport);
+	void RSSetScissorRects(const SwRect& rect);
+	void SetPipelineState(const SwPipelineState* pipelineState);
+	void IASetVertexBuffers(const void* vertices, uint32_t stride, uint32_t count);
+	void IASetIndexBuffer(const uint32_t* indices, uint32_t count);
+	void SetGraphicsRoot32BitConstants(uint32_t num32BitValues, const void* data);
+	void SetComputeRoot32BitConstants(uint32_t num32BitValues, const void* data);
+
+	// Everything recorded before finishes before anything after starts, e.g. between rendering to a
+	// texture and shaders reading it:
+	void ResourceBarrier();
+
+	void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+		uint32_t startInstance);
+	void Dispatch(uint32_t x, uint32_t y, uint32_t z);
+
+	uint32_t NumCommands() const { return static_cast<uint32_t>(m_commands.size()); }
+
+private:
+	friend class SoftwareRasterizer;
+
+	enum class CommandType : uint8_t
+	{
+		ClearColour,
+		ClearDepth,
+		SetRenderTargets,
+		SetViewport,
+		SetScissorRect,
+		SetPipelineState,
+		SetVertexBuffer,
+		SetIndexBuffer,
+		SetGraphicsConstants,
+		SetComputeConstants,
+		Barrier,
+		Draw,
+		DrawIndexed,
+		Dispatch,
+	};
+
+	// Every command the same size, which keeps replay a plain loop:
+	struct Command
+	{
+		CommandType	type;
+		uint32_t	args[5];
+		float		values[6];					// Clear values, viewport.
+		const void*	objects[2];					// Targets, pipeline, buffers.
+	};
+
+	Command& Add(CommandType type);
+
+	std::vector<Command>	m_commands;
+	std::vector<uint32_t>	m_constants;	// Referenced by offset from the constant commands.
+};
+
+struct SwRasterizerStats
+{
+	uint64_t	numDraws;
+	uint64_t	numDispatches;
+	uint64_t	numTriangles;		// Assembled, before culling and clipping.
+	uint64_t	numTrianglesCulled;	// Back facing, degenerate or off screen.
+	uint64_t	numTrianglesBinned;	// After clipping, each counted once however many tiles it touches.
+	uint64_t	numPixelsShaded;	// Blocks run through the pixel shader, times g_swNumLanes.
+	uint64_t	numPixelsWritten;
+};
+
+// Executes command lists. Draws between flush points (clears, barriers, dispatches, render target
+// changes and the end of the list) have their vertices shaded and triangles set up and binned into
+// c_tileSize tiles in submission order, then the tiles are rasterized in parallel, each running through
+// its triangles in order, which is what keeps results deterministic. Coverage, depth testing and
+// interpolation work on g_swNumLanes pixels at once, with SSE2 on x86.
+class SoftwareRasterizer
+{
+public:
+	static const uint32_t c_tileSize = 64;
+
+	// Runs single-threaded without a job system:
+	explicit SoftwareRasterizer(JobSystem* jobSystem = nullptr);
+
+	void Execute(const SwCommandList& commandList);
+
+	const SwRasterizerStats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = {}; }
+
+private:
+	struct DrawState
+	{
+		const SwPipelineState*	pipelineState;
+		const void*				constants;
+	};
+
+	// Screen-space triangle ready to rasterize. Edge functions are in 1/16 pixel fixed point, biased for
+	// the fill rule so pixel (x, y) is covered when edgeA * x + edgeB * y + edgeC >= 0 for all three.
+	// Attributes are planes over pixel centers:
+	struct Triangle
+	{
+		int32_t		minX;							// Pixel bounds, clipped to the scissor and targets, max exclusive.
+		int32_t		minY;
+		int32_t		maxX;
+		int32_t		maxY;
+		int32_t		edgeA[3];						// Per pixel step in x...
+		int32_t		edgeB[3];						// ...and y, in fixed point units.
+		int64_t		edgeC[3];
+		float		originX;						// Where attribute planes are relative to.
+		float		originY;
+		float		planes[g_swMaxVaryings + 2][3];	// Depth, 1/w, then varyings / w: value at origin, d/dx, d/dy.
+		uint32_t	drawState;
+		uint32_t	primitiveId;
+	};
+
+	struct TileStats
+	{
+		uint64_t	numPixelsShaded;
+		uint64_t	numPixelsWritten;
+	};
+
+	void Draw(const void* vertices, uint32_t stride, const uint32_t* indices, uint32_t count, uint32_t instanceCount,
+		uint32_t start, int32_t baseVertex, uint32_t startInstance);
+
+	// Clips a triangle of the last draw and sets up and bins what's left, SetupTriangle() returning false
+	// for a culled one:
+	void AssembleTriangle(const SwVertexOutput* vertices[3], uint32_t primitiveId);
+	bool SetupTriangle(const SwVertexOutput* vertices[3], uint32_t primitiveId);
+
+	void Flush();
+	void RasterizeTile(uint32_t tileIndex);
+	void RasterizeTriangle(const Triangle& triangle, int32_t tileX, int32_t tileY, TileStats& stats);
+	void Clear(SwTexture* texture, uint32_t colour, float depth);
+	void SetRenderTargets(SwTexture* colour, SwTexture* depth);
+
+	template<typename Func>
+	void ParallelFor(uint32_t count, uint32_t grainSize, const Func& func);
+
+	JobSystem*							m_jobSystem;
+	SwRasterizerStats					m_stats = {};
+
+	// Replay state:
+	SwTexture*							m_colourTarget;
+	SwTexture*							m_depthTarget;
+	SwViewport							m_viewport;
+	SwRect								m_scissorRect;
+	const SwPipelineState*				m_pipelineState;
+	const void*							m_graphicsConstants;
+	const void*							m_computeConstants;
+
+	// Draws waiting to be rasterized:
+	std::vector<DrawState>				m_drawStates;
+	std::vector<Triangle>				m_triangles;
+	std::vector<std::vector<uint32_t>>	m_tileBins;			// Triangle indices per tile, in submission order.
+	std::vector<TileStats>				m_tileStats;
+	uint32_t							m_numTilesX;
+	uint32_t							m_numTilesY;
+	std::vector<SwVertexOutput>			m_shadedVertices;	// The draw being set up's, by vertex index - first index.
+};
@@ -0,0 +1,188 @@
+#include "StartupGraph.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+StartupGraph::StartupGraph(JobSystem& jobSystem)
+  : m_jobSystem(jobSystem)
+  , m_mainThreadId(std::this_thread::get_id())
+  , m_totalMs(0.0)
+{
+}
+
+StartupTaskId StartupGraph::Add(const char* name, std::function<void()> func,
+  std::initializer_list<StartupTaskId> dependencies, JobAffinity affinity)
+{
+  const StartupTaskId id = static_cast<StartupTaskId>(m_tasks.size());
+  for (StartupTaskId dependency : dependencies)
+    assert(dependency < id && "Tasks can only depend on tasks added before them!");
+
+  std::unique_ptr<Task> task = std::make_unique<Task>();
+  task->graph = this;
+  task->name = name;
+  task->func = std::move(func);
+  task->dependencies.assign(dependencies.begin(), dependencies.end());
+  task->affinity = affinity;
+  task->hasFailed.store(false, std::memory_order_relaxed);
+  task->timing = { name, 0.0, 0.0, false, false };
+
+  m_tasks.push_back(std::move(task));
+  return id;
+}
+
+void StartupGraph::Run()
+{
+  m_startTime = std::chrono::steady_clock::now();
+
+  // Tasks are scheduled in the order they were added, so every dependency's counter is already pending
+  // (or done) by the time a task is queued up behind it. Several dependencies are joined on one counter
+  // through a no-op continuation on each:
+  for (std::unique_ptr<Task>& task : m_tasks)
+  {
+    switch (task->dependencies.size())
+    {
+    case 0:
+      m_jobSystem.Run(&RunTask, task.get(), &task->done, task->affinity);
+      break;
+
+    case 1:
+      m_jobSystem.RunAfter(m_tasks[task->dependencies[0]]->done, &RunTask, task.get(), &task->done, task->affinity);
+      break;
+
+    default:
+      for (StartupTaskId dependency : task->dependencies)
+        m_jobSystem.RunAfter(m_tasks[dependency]->done, &JoinDependency, nullptr, &task->dependenciesDone);
+      m_jobSystem.RunAfter(task->dependenciesDone, &RunTask, task.get(), &task->done, task->affinity);
+      break;
+    }
+  }
+
+  for (std::unique_ptr<Task>& task : m_tasks)
+    m_jobSystem.Wait(task->done);
+
+  m_totalMs = GetElapsedMs();
+
+  if (m_error)
+    std::rethrow_exception(m_error);
+}
+
+std::vector<StartupPhaseTiming> StartupGraph::GetTimings() const
+{
+  std::vector<StartupPhaseTiming> timings;
+  timings.reserve(m_tasks.size());
+  for (const std::unique_ptr<Task>& task : m_tasks)
+    timings.push_back(task->timing);
+  return timings;
+}
+
+std::vector<StartupTaskId> StartupGraph::GetCriticalPath() const
+{
+  std::vector<StartupTaskId> path;
+  if (m_tasks.empty())
+    return path;
+
+  auto endTime = [this](StartupTaskId id) {
+    const StartupPhaseTiming& timing = m_tasks[id]->timing;
+    return timing.startMs + timing.durationMs;
+  };
+
+  StartupTaskId id = 0;
+  for (StartupTaskId i = 1; i < m_tasks.size(); ++i)
+  {
+    if (endTime(i) > endTime(id))
+      id = i;
+  }
+
+  for (;;)
+  {
+    path.push_back(id);
+
+    const std::vector<StartupTaskId>& dependencies = m_tasks[id]->dependencies;
+    if (dependencies.empty())
+      break;
+
+    id = *std::max_element(dependencies.begin(), dependencies.end(),
+      [&](StartupTaskId a, StartupTaskId b) { return endTime(a) < endTime(b); });
+  }
+
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+std::string StartupGraph::FormatReport() const
+{
+  double sumMs = 0.0;
+  for (const std::unique_ptr<Task>& task : m_tasks)
+    sumMs += task->timing.durationMs;
+
+  char line[256];
+  snprintf(line, sizeof(line), "Startup: %.2fms (%.2fms of work across %u tasks)\n", m_totalMs, sumMs,
+    static_cast<uint32_t>(m_tasks.size()));
+  std::string report = line;
+
+  for (const std::unique_ptr<Task>& task : m_tasks)
+  {
+    const StartupPhaseTiming& timing = task->timing;
+    if (timing.wasRun)
+    {
+      snprintf(line, sizeof(line), "  %-24s %8.2fms +%8.2fms  (%s thread)\n", timing.name, timing.startMs, timing.durationMs,
+        timing.isMainThread ? "main" : "worker");
+    }
+    else
+      snprintf(line, sizeof(line), "  %-24s skipped\n", timing.name);
+    report += line;
+  }
+
+  report += "  Critical path:";
+  const std::vector<StartupTaskId> criticalPath = GetCriticalPath();
+  for (size_t i = 0; i < criticalPath.size(); ++i)
+  {
+    report += (i == 0) ? " " : " -> ";
+    report += m_tasks[criticalPath[i]]->name;
+  }
+  report += "\n";
+  return report;
+}
+
+void StartupGraph::RunTask(void* data)
+{
+  Task& task = *static_cast<Task*>(data);
+  StartupGraph& graph = *task.graph;
+
+  for (StartupTaskId dependency : task.dependencies)
+  {
+    if (graph.m_tasks[dependency]->hasFailed.load(std::memory_order_acquire))
+    {
+      task.hasFailed.store(true, std::memory_order_release);
+      return;
+    }
+  }
+
+  task.timing.isMainThread = std::this_thread::get_id() == graph.m_mainThreadId;
+  task.timing.wasRun = true;
+  task.timing.startMs = graph.GetElapsedMs();
+  DX12_TRACE_SCOPE(task.name);
+
+  // Exceptions can't cross into the job system, they're handed back to Run() instead:
+  try
+  {
+    task.func();
+  }
+  catch (...)
+  {
+    task.hasFailed.store(true, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(graph.m_errorLock);
+    if (!graph.m_error)
+      graph.m_error = std::current_exception();
+  }
+
+  task.timing.durationMs = graph.GetElapsedMs() - task.timing.startMs;
+}
+
+double StartupGraph::GetElapsedMs() const
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+}
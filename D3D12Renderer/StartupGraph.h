@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+using StartupTaskId = uint32_t;
+
+struct StartupPhaseTiming
+{
+	const char*	name;
+	double			startMs;			// Since StartupGraph::Run() was called.
+	double			durationMs;
+	bool				isMainThread;
+	bool				wasRun;				// False if skipped because a task it depends on failed.
+};
+
+// Startup as a graph of init tasks on the job system rather than one long sequence, e.g. creating the
+// window while adapters are probed. Tasks run as soon as everything they depend on has finished, each
+// is timed, and the report shows where startup went and which chain of tasks bounded it.
+//
+// Tasks can only depend on tasks added before them, so the graph can't have cycles. Window work should
+// have JobAffinity::MainThread, which Run() takes part in while it waits.
+class StartupGraph
+{
+public:
+	explicit StartupGraph(JobSystem& jobSystem);
+
+	StartupGraph(const StartupGraph&) = delete;
+	StartupGraph& operator=(const StartupGraph&) = delete;
+
+	StartupTaskId Add(const char* name, std::function<void()> func, std::initializer_list<StartupTaskId> dependencies = {},
+		JobAffinity affinity = JobAffinity::Any);
+
+	// Runs every task and returns once all are done. If any throws, the tasks depending on it are
+	// skipped and the first exception is rethrown here once the rest have finished:
+	void Run();
+
+	std::vector<StartupPhaseTiming> GetTimings() const;
+	double GetTotalTime() const { return m_totalMs; }
+
+	// The chain of tasks that startup had to wait for, each being the dependency of the next that
+	// finished last, ending with the task that finished last overall:
+	std::vector<StartupTaskId> GetCriticalPath() const;
+
+	std::string FormatReport() const;
+
+private:
+	struct Task
+	{
+		StartupGraph*								graph;
+		const char*									name;
+		std::function<void()>				func;
+		std::vector<StartupTaskId>	dependencies;
+		JobAffinity									affinity;
+		JobCounter									dependenciesDone;		// Only used with more than one dependency.
+		JobCounter									done;
+		std::atomic<bool>						hasFailed;					// Threw, or was skipped because a dependency did.
+		StartupPhaseTiming					timing;
+	};
+
+	static void RunTask(void* data);
+	static void JoinDependency(void*) {}
+
+	double GetElapsedMs() const;
+
+	JobSystem&														m_jobSystem;
+	std::vector<std::unique_ptr<Task>>		m_tasks;
+	std::thread::id												m_mainThreadId;
+	std::chrono::steady_clock::time_point	m_startTime;
+	double																m_totalMs;
+
+	std::mutex														m_errorLock;
+	std::exception_ptr										m_error;				// First exception thrown by a task.
+};
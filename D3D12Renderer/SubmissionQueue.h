@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+
+// Lock-free multi-producer, single-consumer channel that hands items to the consumer in the order of
+// their keys rather than the order they were pushed. Keys are a dense sequence, each reserved once (with
+// ReserveKey(), or handed out by whoever splits up the work) and pushed exactly once, so a recording that
+// ends up empty still has to push something for the consumer to get past it.
+//
+// Each key has its own slot in a ring (the bounded queue of Vyukov, indexed by key instead of by a shared
+// tail), so producers never contend with each other and only wait when they're a full ring ahead of the
+// consumer. T must be trivially copyable, in practice a pointer.
+template<typename T, uint32_t Capacity>
+class SubmissionQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two!");
+
+public:
+	SubmissionQueue()
+		: m_nextKey(0)
+		, m_nextPopKey(0)
+	{
+		// A slot's sequence is the key it's free for, or that key + 1 once it holds that key's item:
+		for (uint32_t i = 0; i < Capacity; ++i)
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// Any thread:
+	uint64_t ReserveKey()
+	{
+		return m_nextKey.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Any thread, false if the consumer hasn't got to the item Capacity keys before yet:
+	bool TryPush(uint64_t key, T item)
+	{
+		Slot& slot = m_slots[key & c_mask];
+		if (slot.sequence.load(std::memory_order_acquire) != key)
+			return false;
+
+		// The release store publishes the item to the consumer, which acquires the sequence before reading it:
+		slot.item = item;
+		slot.sequence.store(key + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Any thread, waits for the consumer if it's a full ring behind:
+	void Push(uint64_t key, T item)
+	{
+		while (!TryPush(key, item))
+			std::this_thread::yield();
+	}
+
+	// Consumer thread only, the items of the keys that follow on from the last ones popped and have been
+	// pushed, up to maxItems. Stops at the first key still being recorded, even if later ones are ready:
+	uint32_t TryPop(T* items, uint32_t maxItems)
+	{
+		uint32_t numItems = 0;
+		while (numItems < maxItems)
+		{
+			Slot& slot = m_slots[m_nextPopKey & c_mask];
+			if (slot.sequence.load(std::memory_order_acquire) != m_nextPopKey + 1)
+				break;
+
+			items[numItems++] = slot.item;
+			slot.sequence.store(m_nextPopKey + Capacity, std::memory_order_release);
+			++m_nextPopKey;
+		}
+
+		return numItems;
+	}
+
+	// Consumer thread only, the key the next item popped will have:
+	uint64_t GetNextPopKey() const { return m_nextPopKey; }
+
+	// Consumer thread only, a hint while other threads are reserving keys:
+	bool IsDrained() const { return m_nextPopKey == m_nextKey.load(std::memory_order_relaxed); }
+
+private:
+	static const uint64_t c_mask = Capacity - 1;
+
+	// Neighbouring keys are pushed by different threads at about the same time, keep them on separate cache
+	// lines:
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t>	sequence;
+		T						item;
+	};
+
+	alignas(64) std::atomic<uint64_t>	m_nextKey;
+	alignas(64) uint64_t				m_nextPopKey;
+	Slot								m_slots[Capacity];
+};
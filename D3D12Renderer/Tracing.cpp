@@ -0,0 +1,288 @@
+#include "Tracing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define DX12_TRACING_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DX12_TRACING_X86 1
+#else
+#define DX12_TRACING_X86 0
+#endif
+
+namespace
+{
+  // Chrome trace "processes" the timelines are grouped under:
+  const uint32_t c_cpuProcessId = 1;
+  const uint32_t c_gpuProcessId = 2;
+
+  // Each thread's buffer, looked up once per thread, owned by the tracer:
+  thread_local const Tracer* t_tracer = nullptr;
+  thread_local void* t_buffer = nullptr;
+
+  uint64_t GetSteadyClockNs()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Names are usually literals, but thread names can come from anywhere:
+  void AppendJsonString(std::string& json, const char* text)
+  {
+    json += '"';
+    for (const char* c = text; *c; ++c)
+    {
+      if (*c == '"' || *c == '\\')
+      {
+        json += '\\';
+        json += *c;
+      }
+      else if (static_cast<unsigned char>(*c) < 0x20)
+        json += ' ';
+      else
+        json += *c;
+    }
+    json += '"';
+  }
+
+  void AppendCompleteEvent(std::string& json, const char* name, uint32_t processId, uint32_t threadId,
+    double beginUs, double durationUs)
+  {
+    char text[128];
+    json += ",\n{\"name\":";
+    AppendJsonString(json, name);
+    snprintf(text, sizeof(text), ",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", processId, threadId,
+      beginUs, durationUs);
+    json += text;
+  }
+
+  void AppendNameEvent(std::string& json, const char* type, uint32_t processId, uint32_t threadId, const char* name)
+  {
+    char text[128];
+    snprintf(text, sizeof(text), ",\n{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", type,
+      processId, threadId);
+    json += text;
+    AppendJsonString(json, name);
+    json += "}}";
+  }
+}
+
+Tracer::Tracer()
+  : m_isCapturing(false)
+  , m_captureIndex(0)
+  , m_captureStartTicks(0)
+  , m_captureEndTicks(0)
+  , m_captureStartNs(0)
+  , m_captureEndNs(0)
+{
+}
+
+void Tracer::BeginCapture()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+
+  // Threads drop their old events themselves on their first record of the new capture:
+  m_gpuRanges.clear();
+  m_captureStartNs = GetSteadyClockNs();
+  m_captureStartTicks = Now();
+  m_captureIndex.fetch_add(1, std::memory_order_release);
+  m_isCapturing.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::EndCapture()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (!m_isCapturing.load(std::memory_order_relaxed))
+    return;
+
+  m_isCapturing.store(false, std::memory_order_relaxed);
+  m_captureEndTicks = Now();
+  m_captureEndNs = GetSteadyClockNs();
+}
+
+uint64_t Tracer::Now()
+{
+#if DX12_TRACING_X86
+  // Invariant on anything this renderer runs on, and a fraction of the cost of the OS clock:
+  return __rdtsc();
+#else
+  return GetSteadyClockNs();
+#endif
+}
+
+void Tracer::Record(const char* name, uint64_t beginTicks, uint64_t endTicks)
+{
+  ThreadBuffer& buffer = GetThreadBuffer();
+
+  const uint32_t captureIndex = m_captureIndex.load(std::memory_order_acquire);
+  if (buffer.captureIndex.load(std::memory_order_relaxed) != captureIndex)
+  {
+    // Threads that never record in a capture never pay for a buffer:
+    if (!buffer.events)
+      buffer.events.reset(new Event[c_maxEventsPerThread]);
+
+    buffer.numEvents.store(0, std::memory_order_relaxed);
+    buffer.numDropped.store(0, std::memory_order_relaxed);
+    buffer.captureIndex.store(captureIndex, std::memory_order_release);
+  }
+
+  const uint32_t numEvents = buffer.numEvents.load(std::memory_order_relaxed);
+  if (numEvents == c_maxEventsPerThread)
+  {
+    buffer.numDropped.store(buffer.numDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Only this thread writes the buffer, publishing the event is all it takes:
+  buffer.events[numEvents] = { name, beginTicks, endTicks };
+  buffer.numEvents.store(numEvents + 1, std::memory_order_release);
+}
+
+void Tracer::SetThreadName(const char* name)
+{
+  ThreadBuffer& buffer = GetThreadBuffer();
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  buffer.name = name;
+}
+
+void Tracer::AddGpuRange(const char* name, uint32_t gpuIndex, uint64_t beginUs, uint64_t endUs)
+{
+  if (!IsCapturing())
+    return;
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_gpuRanges.push_back({ name, gpuIndex, beginUs, endUs });
+}
+
+TraceStats Tracer::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+
+  TraceStats stats = {};
+  const uint32_t captureIndex = m_captureIndex.load(std::memory_order_relaxed);
+  for (const std::unique_ptr<ThreadBuffer>& buffer : m_threads)
+  {
+    if (buffer->captureIndex.load(std::memory_order_acquire) != captureIndex)
+      continue;
+
+    stats.numEvents += buffer->numEvents.load(std::memory_order_acquire);
+    stats.numDropped += buffer->numDropped.load(std::memory_order_relaxed);
+    ++stats.numThreads;
+  }
+  stats.numGpuRanges = static_cast<uint32_t>(m_gpuRanges.size());
+  return stats;
+}
+
+std::string Tracer::FormatChromeJson() const
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+
+  // Ticks are converted by how many went by over the capture, timed against the steady clock, taking
+  // the capture as running up to now if it still is:
+  const bool isCapturing = m_isCapturing.load(std::memory_order_relaxed);
+  const uint64_t endTicks = isCapturing ? Now() : m_captureEndTicks;
+  const uint64_t endNs = isCapturing ? GetSteadyClockNs() : m_captureEndNs;
+  const double nanosecondsPerTick = endTicks > m_captureStartTicks ?
+    static_cast<double>(endNs - m_captureStartNs) / (endTicks - m_captureStartTicks) : 1.0;
+
+  // Every event after the first is appended with a leading separator:
+  char text[128];
+  snprintf(text, sizeof(text),
+    "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+    "\"args\":{\"name\":\"CPU\"}}", c_cpuProcessId);
+  std::string json = text;
+  AppendNameEvent(json, "process_name", c_gpuProcessId, 0, "GPU");
+
+  const uint32_t captureIndex = m_captureIndex.load(std::memory_order_relaxed);
+  for (const std::unique_ptr<ThreadBuffer>& buffer : m_threads)
+  {
+    char threadName[32];
+    snprintf(threadName, sizeof(threadName), "Thread %u", buffer->threadId);
+    AppendNameEvent(json, "thread_name", c_cpuProcessId, buffer->threadId,
+      buffer->name.empty() ? threadName : buffer->name.c_str());
+
+    if (buffer->captureIndex.load(std::memory_order_acquire) != captureIndex)
+      continue;
+
+    const uint32_t numEvents = buffer->numEvents.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < numEvents; ++i)
+    {
+      const Event& event = buffer->events[i];
+      AppendCompleteEvent(json, event.name, c_cpuProcessId, buffer->threadId,
+        TicksToMicroseconds(event.beginTicks, nanosecondsPerTick),
+        (event.endTicks - event.beginTicks) * nanosecondsPerTick / 1000.0);
+    }
+  }
+
+  // GPU ranges are already on the steady clock, each GPU gets a timeline of its own:
+  const double captureStartUs = m_captureStartNs / 1000.0;
+  for (const GpuRange& range : m_gpuRanges)
+  {
+    AppendCompleteEvent(json, range.name, c_gpuProcessId, range.gpuIndex, range.beginUs - captureStartUs,
+      static_cast<double>(range.endUs - range.beginUs));
+  }
+  std::vector<bool> isGpuUsed;
+  for (const GpuRange& range : m_gpuRanges)
+  {
+    if (range.gpuIndex >= isGpuUsed.size())
+      isGpuUsed.resize(range.gpuIndex + 1, false);
+    isGpuUsed[range.gpuIndex] = true;
+  }
+  for (uint32_t gpuIndex = 0; gpuIndex < isGpuUsed.size(); ++gpuIndex)
+  {
+    char gpuName[16];
+    snprintf(gpuName, sizeof(gpuName), "GPU %u", gpuIndex);
+    if (isGpuUsed[gpuIndex])
+      AppendNameEvent(json, "thread_name", c_gpuProcessId, gpuIndex, gpuName);
+  }
+
+  json += "\n]}\n";
+  return json;
+}
+
+bool Tracer::SaveChromeJson(const std::string& path) const
+{
+  std::ofstream file(path, std::ios::trunc);
+  if (!file)
+    return false;
+
+  file << FormatChromeJson();
+  return static_cast<bool>(file);
+}
+
+Tracer::ThreadBuffer& Tracer::GetThreadBuffer()
+{
+  if (t_tracer == this)
+    return *static_cast<ThreadBuffer*>(t_buffer);
+
+  // First event on this thread, buffers live as long as the tracer so a trace can still show threads that
+  // have since exited:
+  std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  buffer->threadId = static_cast<uint32_t>(m_threads.size()) + 1;
+  t_tracer = this;
+  t_buffer = buffer.get();
+  m_threads.push_back(std::move(buffer));
+  return *m_threads.back();
+}
+
+double Tracer::TicksToMicroseconds(uint64_t ticks, double nanosecondsPerTick) const
+{
+  // Relative to the start of the capture, scopes that were open when it started begin before it:
+  const double ticksSinceStart = ticks >= m_captureStartTicks ?
+    static_cast<double>(ticks - m_captureStartTicks) : -static_cast<double>(m_captureStartTicks - ticks);
+  return ticksSinceStart * nanosecondsPerTick / 1000.0;
+}
+
+Tracer& GetTracer()
+{
+  // Never destroyed, threads may still be recording as the process exits:
+  static Tracer* s_tracer = new Tracer();
+  return *s_tracer;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scopes compile to nothing with this set to 0, otherwise they cost a flag check until a capture starts:
+#if !defined(DX12_ENABLE_TRACING)
+#define DX12_ENABLE_TRACING 1
+#endif
+
+#define DX12_TRACE_CONCAT_INNER(a, b) a##b
+#define DX12_TRACE_CONCAT(a, b) DX12_TRACE_CONCAT_INNER(a, b)
+
+// Records the enclosing scope as a zone on the calling thread's timeline, name must be a string literal
+// (or otherwise outlive the capture):
+#if DX12_ENABLE_TRACING
+#define DX12_TRACE_SCOPE(name) const TraceScope DX12_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define DX12_TRACE_SCOPE(name) ((void)0)
+#endif
+
+struct TraceStats
+{
+	uint64_t	numEvents;			// Recorded this capture...
+	uint64_t	numDropped;			// ...and lost to a thread's buffer being full.
+	uint32_t	numThreads;
+	uint32_t	numGpuRanges;
+};
+
+// Records CPU zones from any thread, and GPU ranges, onto one timeline, exported as Chrome trace event
+// JSON (which chrome://tracing and ui.perfetto.dev both load).
+//
+// Each thread records into a buffer of its own, so recording takes no locks: the owning thread appends
+// events and publishes the count, exporting reads up to it. Buffers are fixed size and stop recording
+// once full rather than overwrite anything. Timestamps are raw TSC ticks on x86, converted to
+// microseconds of std::chrono::steady_clock on export by timing the capture against it.
+//
+// Exporting while recording is fine, but a new capture mustn't be started while exporting.
+class Tracer
+{
+public:
+	static const uint32_t c_maxEventsPerThread = 64 * 1024;
+
+	Tracer();
+
+	Tracer(const Tracer&) = delete;
+	Tracer& operator=(const Tracer&) = delete;
+
+	// Starting a capture throws away the last one:
+	void BeginCapture();
+	void EndCapture();
+	bool IsCapturing() const { return m_isCapturing.load(std::memory_order_relaxed); }
+
+	// Timestamp for Record(), cheap enough to take twice per scope:
+	static uint64_t Now();
+
+	void Record(const char* name, uint64_t beginTicks, uint64_t endTicks);
+
+	// Shown as the calling thread's name in the trace:
+	void SetThreadName(const char* name);
+
+	// A range on a GPU's timeline, in microseconds of std::chrono::steady_clock (which on Windows is
+	// QueryPerformanceCounter, as GetTimeMicroseconds() and GpuTimer use). Not for hot paths, it locks:
+	void AddGpuRange(const char* name, uint32_t gpuIndex, uint64_t beginUs, uint64_t endUs);
+
+	TraceStats GetStats() const;
+
+	std::string FormatChromeJson() const;
+	bool SaveChromeJson(const std::string& path) const;
+
+private:
+	struct Event
+	{
+		const char*	name;
+		uint64_t	beginTicks;
+		uint64_t	endTicks;
+	};
+
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]>	events;					// Allocated on the first record.
+		std::atomic<uint32_t>		numEvents{ 0 };			// Written by the owning thread only.
+		std::atomic<uint32_t>		numDropped{ 0 };
+		std::atomic<uint32_t>		captureIndex{ 0 };		// Capture the events belong to.
+		uint32_t					threadId = 0;
+		std::string					name;					// Guarded by m_lock.
+	};
+
+	struct GpuRange
+	{
+		const char*	name;
+		uint32_t	gpuIndex;
+		uint64_t	beginUs;
+		uint64_t	endUs;
+	};
+
+	ThreadBuffer& GetThreadBuffer();
+	double TicksToMicroseconds(uint64_t ticks, double nanosecondsPerTick) const;
+
+	std::atomic<bool>							m_isCapturing;
+	std::atomic<uint32_t>						m_captureIndex;
+	uint64_t									m_captureStartTicks;	// When the capture started and ended, by
+	uint64_t									m_captureEndTicks;		// both clocks, to convert ticks with.
+	uint64_t									m_captureStartNs;
+	uint64_t									m_captureEndNs;
+
+	mutable std::mutex							m_lock;
+	std::vector<std::unique_ptr<ThreadBuffer>>	m_threads;				// Every thread that ever recorded.
+	std::vector<GpuRange>						m_gpuRanges;
+};
+
+Tracer& GetTracer();
+
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name)
+		: m_name(GetTracer().IsCapturing() ? name : nullptr)
+		, m_beginTicks(m_name ? Tracer::Now() : 0)
+	{
+	}
+
+	~TraceScope()
+	{
+		if (m_name)
+			GetTracer().Record(m_name, m_beginTicks, Tracer::Now());
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char*	m_name;
+	uint64_t	m_beginTicks;
+};
@@ -0,0 +1,360 @@
+#include "TransformHierarchy.h"
+
+#include <cassert>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX12_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#else
+#define DX12_TRANSFORM_SSE 0
+#endif
+
+namespace
+{
+  template<typename T>
+  void Permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+  {
+    std::vector<T> permuted(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+      permuted[i] = values[order[i]];
+    values.swap(permuted);
+  }
+
+#if DX12_TRANSFORM_SSE
+  __m128 Gather(const std::vector<float>& values, const uint32_t indices[4], bool isContiguous)
+  {
+    if (isContiguous)
+      return _mm_loadu_ps(values.data() + indices[0]);
+
+    return _mm_setr_ps(values[indices[0]], values[indices[1]], values[indices[2]], values[indices[3]]);
+  }
+
+  // out = a * b, XMMatrixMultiply style: each row of the result is a's row broadcast across b's rows:
+  void MultiplyMatrices(const __m128 aRows[4], const Matrix4x4& b, Matrix4x4& out)
+  {
+    const __m128 b0 = _mm_load_ps(b.m + 0);
+    const __m128 b1 = _mm_load_ps(b.m + 4);
+    const __m128 b2 = _mm_load_ps(b.m + 8);
+    const __m128 b3 = _mm_load_ps(b.m + 12);
+
+    for (int row = 0; row < 4; ++row)
+    {
+      const __m128 aRow = aRows[row];
+      __m128 result = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+      result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+      result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+      result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+      _mm_store_ps(out.m + row * 4, result);
+    }
+  }
+#else
+  void MultiplyMatrices(const Matrix4x4& a, const Matrix4x4& b, Matrix4x4& out)
+  {
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        out.m[row * 4 + column] = a.m[row * 4 + 0] * b.m[0 + column] + a.m[row * 4 + 1] * b.m[4 + column] +
+          a.m[row * 4 + 2] * b.m[8 + column] + a.m[row * 4 + 3] * b.m[12 + column];
+      }
+    }
+  }
+#endif
+}
+
+TransformId TransformHierarchy::Add(TransformId parent, const TransformLocal& local)
+{
+  TransformId id;
+  if (!m_freeIds.empty())
+  {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+  }
+  else
+  {
+    id = static_cast<TransformId>(m_idToIndex.size());
+    m_idToIndex.push_back(0);
+  }
+
+  const uint32_t index = Size();
+  uint32_t parentIndex = c_noParent;
+  uint32_t depth = 0;
+  if (parent != g_invalidTransformId)
+  {
+    parentIndex = IndexOf(parent);
+    assert(!m_isRemoved[parentIndex] && "Can't add children to a removed transform!");
+    depth = m_depths[parentIndex] + 1;
+    ++m_numChildren[parentIndex];
+  }
+
+  // Appending keeps the order sorted as long as nodes are added breadth first:
+  if (index > 0 && depth < m_depths.back())
+    m_needsSort = true;
+
+  m_idToIndex[id] = index;
+  m_ids.push_back(id);
+  m_parents.push_back(parentIndex);
+  m_depths.push_back(depth);
+  m_numChildren.push_back(0);
+  m_isDirty.push_back(1);
+  m_isRemoved.push_back(0);
+  m_worldMatrices.emplace_back();
+
+  m_positionX.push_back(0.0f);
+  m_positionY.push_back(0.0f);
+  m_positionZ.push_back(0.0f);
+  m_rotationX.push_back(0.0f);
+  m_rotationY.push_back(0.0f);
+  m_rotationZ.push_back(0.0f);
+  m_rotationW.push_back(1.0f);
+  m_scaleX.push_back(1.0f);
+  m_scaleY.push_back(1.0f);
+  m_scaleZ.push_back(1.0f);
+
+  SetLocal(id, local);
+  return id;
+}
+
+void TransformHierarchy::Remove(TransformId id)
+{
+  const uint32_t index = IndexOf(id);
+  assert(m_numChildren[index] == 0 && "Remove a transform's children before removing it!");
+
+  if (m_parents[index] != c_noParent)
+    --m_numChildren[m_parents[index]];
+
+  // The slot stays (unused) until the next Update() compacts the arrays:
+  m_isRemoved[index] = 1;
+  m_isDirty[index] = 0;
+  m_idToIndex[id] = c_noParent;
+  m_freeIds.push_back(id);
+  m_needsSort = true;
+}
+
+void TransformHierarchy::SetLocal(TransformId id, const TransformLocal& local)
+{
+  const uint32_t index = IndexOf(id);
+
+  m_positionX[index] = local.position[0];
+  m_positionY[index] = local.position[1];
+  m_positionZ[index] = local.position[2];
+  m_rotationX[index] = local.rotation[0];
+  m_rotationY[index] = local.rotation[1];
+  m_rotationZ[index] = local.rotation[2];
+  m_rotationW[index] = local.rotation[3];
+  m_scaleX[index] = local.scale[0];
+  m_scaleY[index] = local.scale[1];
+  m_scaleZ[index] = local.scale[2];
+  m_isDirty[index] = 1;
+}
+
+TransformLocal TransformHierarchy::GetLocal(TransformId id) const
+{
+  const uint32_t index = IndexOf(id);
+
+  TransformLocal local;
+  local.position[0] = m_positionX[index];
+  local.position[1] = m_positionY[index];
+  local.position[2] = m_positionZ[index];
+  local.rotation[0] = m_rotationX[index];
+  local.rotation[1] = m_rotationY[index];
+  local.rotation[2] = m_rotationZ[index];
+  local.rotation[3] = m_rotationW[index];
+  local.scale[0] = m_scaleX[index];
+  local.scale[1] = m_scaleY[index];
+  local.scale[2] = m_scaleZ[index];
+  return local;
+}
+
+TransformUpdateResult TransformHierarchy::Update()
+{
+  if (m_needsSort)
+    SortByDepth();
+
+  // Parents come first, so a single pass propagates dirtiness all the way down:
+  m_changedIndices.clear();
+  const uint32_t numNodes = Size();
+  for (uint32_t i = 0; i < numNodes; ++i)
+  {
+    const uint32_t parent = m_parents[i];
+    if (parent != c_noParent && m_isDirty[parent])
+      m_isDirty[i] = 1;
+
+    if (m_isDirty[i])
+      m_changedIndices.push_back(i);
+  }
+
+  UpdateWorldMatrices();
+
+  for (uint32_t index : m_changedIndices)
+    m_isDirty[index] = 0;
+
+  TransformUpdateResult result = {};
+  result.numChanged = static_cast<uint32_t>(m_changedIndices.size());
+  if (result.numChanged > 0)
+  {
+    result.firstChanged = m_changedIndices.front();
+    result.endChanged = m_changedIndices.back() + 1;
+  }
+  return result;
+}
+
+void TransformHierarchy::SortByDepth()
+{
+  // Counting sort on depth, stable so siblings keep their relative order. Removed nodes are dropped:
+  uint32_t maxDepth = 0;
+  for (uint32_t i = 0; i < Size(); ++i)
+  {
+    if (!m_isRemoved[i] && m_depths[i] > maxDepth)
+      maxDepth = m_depths[i];
+  }
+
+  std::vector<uint32_t> depthOffsets(maxDepth + 2, 0);
+  for (uint32_t i = 0; i < Size(); ++i)
+  {
+    if (!m_isRemoved[i])
+      ++depthOffsets[m_depths[i] + 1];
+  }
+
+  for (uint32_t depth = 1; depth < depthOffsets.size(); ++depth)
+    depthOffsets[depth] += depthOffsets[depth - 1];
+
+  const uint32_t numLive = depthOffsets.back();
+  std::vector<uint32_t> order(numLive);
+  std::vector<uint32_t> oldToNew(Size(), c_noParent);
+  for (uint32_t i = 0; i < Size(); ++i)
+  {
+    if (m_isRemoved[i])
+      continue;
+
+    const uint32_t newIndex = depthOffsets[m_depths[i]]++;
+    order[newIndex] = i;
+    oldToNew[i] = newIndex;
+  }
+
+  Permute(m_positionX, order);
+  Permute(m_positionY, order);
+  Permute(m_positionZ, order);
+  Permute(m_rotationX, order);
+  Permute(m_rotationY, order);
+  Permute(m_rotationZ, order);
+  Permute(m_rotationW, order);
+  Permute(m_scaleX, order);
+  Permute(m_scaleY, order);
+  Permute(m_scaleZ, order);
+  Permute(m_parents, order);
+  Permute(m_depths, order);
+  Permute(m_numChildren, order);
+  Permute(m_ids, order);
+
+  for (uint32_t i = 0; i < numLive; ++i)
+  {
+    if (m_parents[i] != c_noParent)
+      m_parents[i] = oldToNew[m_parents[i]];
+    m_idToIndex[m_ids[i]] = i;
+  }
+
+  // Every node may have moved, so every world matrix has to be rewritten (and re-uploaded):
+  m_isDirty.assign(numLive, 1);
+  m_isRemoved.assign(numLive, 0);
+  m_worldMatrices.resize(numLive);
+  m_needsSort = false;
+}
+
+void TransformHierarchy::UpdateWorldMatrices()
+{
+  const uint32_t count = static_cast<uint32_t>(m_changedIndices.size());
+  const uint32_t* indices = m_changedIndices.data();
+
+  // Changed indices are ascending, so a changed parent's world matrix is always updated before its
+  // children's (even within a batch, lanes are finished in order):
+#if DX12_TRANSFORM_SSE
+  // Local matrices (scale * rotation * translation) are built 4 nodes per instruction and kept in
+  // registers, the last batch repeats its final node to fill the lanes:
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 zero = _mm_setzero_ps();
+
+  for (uint32_t batch = 0; batch < count; batch += 4)
+  {
+    uint32_t lanes[4];
+    for (uint32_t lane = 0; lane < 4; ++lane)
+      lanes[lane] = indices[(batch + lane < count) ? batch + lane : count - 1];
+
+    // Runs of changed nodes (e.g. whole subtrees moving) can be loaded directly:
+    const bool isContiguous = lanes[3] - lanes[0] == 3;
+
+    const __m128 x = Gather(m_rotationX, lanes, isContiguous);
+    const __m128 y = Gather(m_rotationY, lanes, isContiguous);
+    const __m128 z = Gather(m_rotationZ, lanes, isContiguous);
+    const __m128 w = Gather(m_rotationW, lanes, isContiguous);
+    const __m128 scaleX = Gather(m_scaleX, lanes, isContiguous);
+    const __m128 scaleY = Gather(m_scaleY, lanes, isContiguous);
+    const __m128 scaleZ = Gather(m_scaleZ, lanes, isContiguous);
+
+    const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+    // Same rotation matrix as XMMatrixRotationQuaternion, with each row scaled:
+    __m128 rows[4][4];
+    rows[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+    rows[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+    rows[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+    rows[0][3] = zero;
+    rows[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+    rows[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+    rows[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+    rows[1][3] = zero;
+    rows[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+    rows[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+    rows[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+    rows[2][3] = zero;
+    rows[3][0] = Gather(m_positionX, lanes, isContiguous);
+    rows[3][1] = Gather(m_positionY, lanes, isContiguous);
+    rows[3][2] = Gather(m_positionZ, lanes, isContiguous);
+    rows[3][3] = one;
+
+    // Each row is held across the 4 nodes, transposing gives that row for each node in turn:
+    for (int row = 0; row < 4; ++row)
+      _MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+
+    const uint32_t numLanes = (count - batch < 4) ? count - batch : 4;
+    for (uint32_t lane = 0; lane < numLanes; ++lane)
+    {
+      const __m128 localRows[4] = { rows[0][lane], rows[1][lane], rows[2][lane], rows[3][lane] };
+      const uint32_t parent = m_parents[lanes[lane]];
+      Matrix4x4& world = m_worldMatrices[lanes[lane]];
+
+      if (parent == c_noParent)
+      {
+        for (int row = 0; row < 4; ++row)
+          _mm_store_ps(world.m + row * 4, localRows[row]);
+      }
+      else
+        MultiplyMatrices(localRows, m_worldMatrices[parent], world);
+    }
+  }
+#else
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const uint32_t index = indices[i];
+    const float x = m_rotationX[index], y = m_rotationY[index], z = m_rotationZ[index], w = m_rotationW[index];
+    const float sx = m_scaleX[index], sy = m_scaleY[index], sz = m_scaleZ[index];
+
+    const Matrix4x4 local =
+    {{
+      (1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + w * z) * sx, 2.0f * (x * z - w * y) * sx, 0.0f,
+      2.0f * (x * y - w * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + w * x) * sy, 0.0f,
+      2.0f * (x * z + w * y) * sz, 2.0f * (y * z - w * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f,
+      m_positionX[index], m_positionY[index], m_positionZ[index], 1.0f,
+    }};
+
+    const uint32_t parent = m_parents[index];
+    if (parent == c_noParent)
+      m_worldMatrices[index] = local;
+    else
+      MultiplyMatrices(local, m_worldMatrices[parent], m_worldMatrices[index]);
+  }
+#endif
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 4x4 row-major matrix using the row-vector convention, laid out like an XMMATRIX/XMFLOAT4X4 so it can be
+// uploaded to the GPU or loaded into DirectXMath as-is.
+struct alignas(16) Matrix4x4
+{
+	float m[16];
+};
+
+struct TransformLocal
+{
+	float	position[3];
+	float	rotation[4];		// Unit quaternion (x, y, z, w).
+	float	scale[3];
+};
+
+using TransformId = uint32_t;
+static const TransformId g_invalidTransformId = 0xffffffff;
+
+// Range of world matrices changed by TransformHierarchy::Update(), [firstChanged, endChanged) covers every
+// changed node so it can be uploaded in one copy:
+struct TransformUpdateResult
+{
+	uint32_t	firstChanged;
+	uint32_t	endChanged;
+	uint32_t	numChanged;
+};
+
+// Data-oriented transform hierarchy. Local transforms live in structure-of-arrays storage sorted by depth,
+// so a node's parent always comes before it and Update() is a single forward pass, no tree walking:
+//  - Dirty flags are propagated parent to child in that pass, and only dirty nodes get new world matrices.
+//  - Local matrices are built 4 nodes at a time from the SoA arrays with SSE and, still in registers, each
+//    is multiplied by its (already updated) parent's world matrix.
+//  - World matrices are indexed by position in the sorted order, which only changes when nodes are added
+//    out of depth order or removed. IndexOf() maps a stable TransformId to that position.
+class TransformHierarchy
+{
+public:
+	TransformId	Add(TransformId parent, const TransformLocal& local);		// parent = g_invalidTransformId for a root.
+	void				Remove(TransformId id);																	// Children must be removed first.
+
+	void						SetLocal(TransformId id, const TransformLocal& local);
+	TransformLocal	GetLocal(TransformId id) const;
+
+	// Recomputes the world matrices of every node whose local transform, or any ancestor's, changed:
+	TransformUpdateResult Update();
+
+	uint32_t					Size() const { return static_cast<uint32_t>(m_ids.size()); }
+	uint32_t					IndexOf(TransformId id) const { return m_idToIndex[id]; }
+	const Matrix4x4&	GetWorld(TransformId id) const { return m_worldMatrices[IndexOf(id)]; }
+	const Matrix4x4*	WorldMatrices() const { return m_worldMatrices.data(); }
+
+	// Indices of the nodes updated by the last Update(), in ascending order:
+	const std::vector<uint32_t>& ChangedIndices() const { return m_changedIndices; }
+
+private:
+	static constexpr uint32_t c_noParent = 0xffffffff;
+
+	void SortByDepth();
+	void UpdateWorldMatrices();
+
+	// SoA local transforms, by index:
+	std::vector<float>			m_positionX, m_positionY, m_positionZ;
+	std::vector<float>			m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+	std::vector<float>			m_scaleX, m_scaleY, m_scaleZ;
+
+	std::vector<uint32_t>		m_parents;				// Index of the parent, c_noParent for roots.
+	std::vector<uint32_t>		m_depths;
+	std::vector<uint32_t>		m_numChildren;
+	std::vector<uint8_t>		m_isDirty;				// Local transform changed since the last Update().
+	std::vector<uint8_t>		m_isRemoved;
+	std::vector<Matrix4x4>	m_worldMatrices;
+
+	std::vector<TransformId>	m_ids;					// Index to id.
+	std::vector<uint32_t>			m_idToIndex;
+	std::vector<TransformId>	m_freeIds;
+
+	bool										m_needsSort = false;
+	std::vector<uint32_t>		m_changedIndices;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+// Offset bookkeeping of UploadBuffer: linear allocation out of a buffer of a given size, reset wholesale.
+// Knows nothing of the buffer itself, so it can be exercised without a device.
+class UploadAllocator
+{
+public:
+	static const uint64_t c_invalidOffset = ~0ull;
+
+	explicit UploadAllocator(uint64_t size = 0)
+		: m_size(size)
+		, m_offset(0)
+	{
+	}
+
+	// Frees everything, the buffer now being size bytes:
+	void Reset(uint64_t size)
+	{
+		m_size = size;
+		m_offset = 0;
+	}
+
+	// alignment must be a power of two, c_invalidOffset if there isn't room:
+	uint64_t Allocate(uint64_t size, uint64_t alignment)
+	{
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+		const uint64_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+		if (offset + size > m_size)
+			return c_invalidOffset;
+
+		m_offset = offset + size;
+		return offset;
+	}
+
+	uint64_t Size() const { return m_size; }
+	uint64_t UsedSize() const { return m_offset; }
+
+private:
+	uint64_t	m_size;
+	uint64_t	m_offset;
+};
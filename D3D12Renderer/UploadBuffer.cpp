@@ -0,0 +1,69 @@
+#include "UploadBuffer.h"
+#include "GpuMemoryTracking.h"
+#include "Helpers.h"
+
+#include "Dx12Headers/d3dx12.h"
+
+#include <cassert>
+
+UploadBuffer::UploadBuffer(ID3D12Device2* device, uint64_t size)
+  : m_device(device)
+  , m_cpuBase(nullptr)
+  , m_gpuBase(0)
+{
+  CreateBuffer(size);
+}
+
+UploadBuffer::~UploadBuffer()
+{
+  if (m_resource)
+    m_resource->Unmap(0, nullptr);
+}
+
+void UploadBuffer::Reset(uint64_t minSize)
+{
+  m_allocator.Reset(m_allocator.Size());
+
+  if (minSize > m_allocator.Size())
+  {
+    // Doubling, so a growing scene doesn't reallocate every frame:
+    uint64_t newSize = m_allocator.Size();
+    while (newSize < minSize)
+      newSize *= 2;
+
+    m_resource->Unmap(0, nullptr);
+    CreateBuffer(newSize);
+  }
+}
+
+UploadBuffer::Allocation UploadBuffer::Allocate(uint64_t size, uint64_t alignment)
+{
+  const uint64_t offset = m_allocator.Allocate(size, alignment);
+  if (offset == UploadAllocator::c_invalidOffset)
+    throw std::exception("Upload buffer out of space!");
+
+  return Allocation{ m_cpuBase + offset, m_gpuBase + offset, offset };
+}
+
+void UploadBuffer::CreateBuffer(uint64_t size)
+{
+  assert(size > 0);
+
+  const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+  const CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+  m_resource.Reset();
+  m_memory.Reset();
+  DX12_CHECK(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+    D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_resource)), "Failed to create upload buffer!");
+  m_memory = TrackResource(m_device, m_resource.Get(), MemoryCategory::Buffers);
+
+  // Upload heap memory stays mapped for its whole lifetime, the CPU never reads it back:
+  const CD3DX12_RANGE readRange(0, 0);
+  void* cpuBase = nullptr;
+  DX12_CHECK(m_resource->Map(0, &readRange, &cpuBase));
+
+  m_cpuBase = static_cast<uint8_t*>(cpuBase);
+  m_gpuBase = m_resource->GetGPUVirtualAddress();
+  m_allocator.Reset(size);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+
+#include "MemoryTracker.h"
+#include "UploadAllocator.h"
+
+// Persistently mapped upload heap buffer, linearly allocated from and reset wholesale. Meant for data
+// written every frame (e.g. per-instance data), with one buffer per frame in flight so a frame's
+// buffer is only reset once the GPU has finished reading it.
+class UploadBuffer
+{
+public:
+	struct Allocation
+	{
+		void*											cpuAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS	gpuAddress;
+		uint64_t									offset;				// Within Resource(), for copies.
+	};
+
+	UploadBuffer(ID3D12Device2* device, uint64_t size);
+	~UploadBuffer();
+
+	UploadBuffer(const UploadBuffer&) = delete;
+	UploadBuffer& operator=(const UploadBuffer&) = delete;
+
+	// Frees everything allocated, growing the buffer if it's smaller than minSize. The GPU must be done
+	// with the buffer:
+	void Reset(uint64_t minSize = 0);
+
+	Allocation				Allocate(uint64_t size, uint64_t alignment = 16);
+	ID3D12Resource*		Resource() const { return m_resource.Get(); }
+	uint64_t					Size() const { return m_allocator.Size(); }
+	uint64_t					UsedSize() const { return m_allocator.UsedSize(); }
+
+private:
+	void CreateBuffer(uint64_t size);
+
+	ID3D12Device2*													m_device;
+	Microsoft::WRL::ComPtr<ID3D12Resource>	m_resource;
+	TrackedAllocation												m_memory;
+	uint8_t*																m_cpuBase;
+	D3D12_GPU_VIRTUAL_ADDRESS								m_gpuBase;
+	UploadAllocator													m_allocator;
+};
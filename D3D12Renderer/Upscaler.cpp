@@ -0,0 +1,154 @@
+#include "Upscaler.h"
+#include "FilteredCommandList.h"
+#include "GpuMemoryTracking.h"
+#include "Helpers.h"
+#include "ShaderCompiler.h"
+
+#include "Dx12Headers/d3dx12.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+  const ShaderSourceDesc c_upscaleVertexShader = { L"Upscale.hlsl", "VSMain", "vs_5_1" };
+  const ShaderSourceDesc c_upscalePixelShader = { L"Upscale.hlsl", "PSMain", "ps_5_1" };
+
+  // UpscaleConstants in Upscale.hlsl:
+  struct UpscaleConstants
+  {
+    float sourceSize[2];
+  };
+}
+
+Upscaler::Upscaler(ID3D12Device2* device, ShaderCompiler& shaderCompiler, RootSignatureCache& rootSignatures,
+  DXGI_FORMAT format)
+  : m_device(device)
+  , m_rootSignatures(rootSignatures)
+  , m_format(format)
+  , m_renderTargetState(D3D12_RESOURCE_STATE_RENDER_TARGET)
+  , m_outputWidth(0)
+  , m_outputHeight(0)
+  , m_renderWidth(0)
+  , m_renderHeight(0)
+{
+  Microsoft::WRL::ComPtr<ID3DBlob> vertexShader = shaderCompiler.CompileOrLoad(c_upscaleVertexShader, 0, {});
+  Microsoft::WRL::ComPtr<ID3DBlob> pixelShader = shaderCompiler.CompileOrLoad(c_upscalePixelShader, 0, {});
+
+  m_rootSignatureId = m_rootSignatures.GetOrCreate({
+    ReflectShaderBindings(vertexShader.Get(), ShaderStage::Vertex),
+    ReflectShaderBindings(pixelShader.Get(), ShaderStage::Pixel),
+    });
+
+  const RootSignatureLayout& layout = m_rootSignatures.GetLayout(m_rootSignatureId);
+  m_constantsRootIndex = layout.FindRootIndex("UpscaleConstants");
+  m_sourceRootIndex = layout.FindRootIndex("g_source");
+
+  // Fullscreen triangle, no vertex buffers, depth or blending:
+  D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc = {};
+  pipelineDesc.pRootSignature = m_rootSignatures.GetRootSignature(m_rootSignatureId);
+  pipelineDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
+  pipelineDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
+  pipelineDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+  pipelineDesc.SampleMask = UINT_MAX;
+  pipelineDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+  pipelineDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+  pipelineDesc.DepthStencilState.DepthEnable = FALSE;
+  pipelineDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+  pipelineDesc.NumRenderTargets = 1;
+  pipelineDesc.RTVFormats[0] = format;
+  pipelineDesc.SampleDesc.Count = 1;
+  DX12_CHECK(m_device->CreateGraphicsPipelineState(&pipelineDesc, IID_PPV_ARGS(&m_pipelineState)),
+    "Failed to create upscale pipeline!");
+
+  D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
+  rtvHeapDesc.NumDescriptors = 1;
+  rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+  DX12_CHECK(m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)), "Failed to create upscaler RTV heap!");
+  m_rtvHeapMemory = TrackDescriptorHeap(m_device, m_rtvHeap.Get());
+
+  D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
+  srvHeapDesc.NumDescriptors = 1;
+  srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+  srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+  DX12_CHECK(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvHeap)), "Failed to create upscaler SRV heap!");
+  m_srvHeapMemory = TrackDescriptorHeap(m_device, m_srvHeap.Get());
+}
+
+void Upscaler::Resize(uint32_t outputWidth, uint32_t outputHeight)
+{
+  outputWidth = std::max(outputWidth, 1u);
+  outputHeight = std::max(outputHeight, 1u);
+  if (m_renderTarget && outputWidth == m_outputWidth && outputHeight == m_outputHeight)
+    return;
+
+  m_outputWidth = outputWidth;
+  m_outputHeight = outputHeight;
+
+  const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+  const CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(m_format, outputWidth, outputHeight, 1, 1, 1, 0,
+    D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+  D3D12_CLEAR_VALUE clearValue = {};
+  clearValue.Format = m_format;
+
+  m_renderTarget.Reset();
+  m_renderTargetMemory.Reset();
+  m_renderTargetState = D3D12_RESOURCE_STATE_RENDER_TARGET;
+  DX12_CHECK(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &textureDesc, m_renderTargetState,
+    &clearValue, IID_PPV_ARGS(&m_renderTarget)), "Failed to create scene render target!");
+  m_renderTargetMemory = TrackResource(m_device, m_renderTarget.Get(), MemoryCategory::RenderTargets);
+
+  m_device->CreateRenderTargetView(m_renderTarget.Get(), nullptr, m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+  m_device->CreateShaderResourceView(m_renderTarget.Get(), nullptr, m_srvHeap->GetCPUDescriptorHandleForHeapStart());
+}
+
+void Upscaler::BeginScene(FilteredCommandList& commandList, uint32_t renderWidth, uint32_t renderHeight)
+{
+  assert(m_renderTarget && "Resize() has to be called before rendering!");
+
+  m_renderWidth = std::min(std::max(renderWidth, 1u), m_outputWidth);
+  m_renderHeight = std::min(std::max(renderHeight, 1u), m_outputHeight);
+
+  Transition(commandList, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+  const D3D12_CPU_DESCRIPTOR_HANDLE rtv = GetRenderTargetView();
+  const CD3DX12_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(m_renderWidth), static_cast<float>(m_renderHeight));
+  const CD3DX12_RECT scissorRect(0, 0, static_cast<LONG>(m_renderWidth), static_cast<LONG>(m_renderHeight));
+  commandList.OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+  commandList.RSSetViewports(1, &viewport);
+  commandList.RSSetScissorRects(1, &scissorRect);
+}
+
+void Upscaler::Upscale(FilteredCommandList& commandList, D3D12_CPU_DESCRIPTOR_HANDLE outputRtv)
+{
+  Transition(commandList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+  const CD3DX12_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(m_outputWidth), static_cast<float>(m_outputHeight));
+  const CD3DX12_RECT scissorRect(0, 0, static_cast<LONG>(m_outputWidth), static_cast<LONG>(m_outputHeight));
+  commandList.OMSetRenderTargets(1, &outputRtv, FALSE, nullptr);
+  commandList.RSSetViewports(1, &viewport);
+  commandList.RSSetScissorRects(1, &scissorRect);
+
+  const UpscaleConstants constants = { { static_cast<float>(m_renderWidth), static_cast<float>(m_renderHeight) } };
+  ID3D12DescriptorHeap* const heaps[] = { m_srvHeap.Get() };
+
+  commandList.SetGraphicsRootSignature(m_rootSignatures.GetRootSignature(m_rootSignatureId));
+  commandList.SetPipelineState(m_pipelineState.Get());
+  commandList.SetDescriptorHeaps(_countof(heaps), heaps);
+  commandList.SetGraphicsRoot32BitConstants(m_constantsRootIndex, 2, &constants, 0);
+  commandList.SetGraphicsRootDescriptorTable(m_sourceRootIndex, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
+  commandList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  commandList.DrawInstanced(3, 1, 0, 0);
+}
+
+void Upscaler::Transition(FilteredCommandList& commandList, D3D12_RESOURCE_STATES newState)
+{
+  if (m_renderTargetState == newState)
+    return;
+
+  const CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTarget.Get(),
+    m_renderTargetState, newState);
+  commandList.ResourceBarrier(1, &barrier);
+  m_renderTargetState = newState;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+
+#include "MemoryTracker.h"
+#include "RootSignatureCache.h"
+
+class FilteredCommandList;
+class ShaderCompiler;
+
+// Render target the scene is drawn into at the dynamic resolution, and the pass upscaling it to the
+// back buffer. The target is allocated at the output size, the most it's ever rendered at, and smaller
+// resolutions use its top-left region, so changing resolution never reallocates anything.
+class Upscaler
+{
+public:
+	Upscaler(ID3D12Device2* device, ShaderCompiler& shaderCompiler, RootSignatureCache& rootSignatures,
+		DXGI_FORMAT format);
+
+	// Recreates the scene target for a new output size, the GPU mustn't be using the old one:
+	void Resize(uint32_t outputWidth, uint32_t outputHeight);
+
+	// Binds the scene target, with the viewport and scissor covering renderWidth x renderHeight:
+	void BeginScene(FilteredCommandList& commandList, uint32_t renderWidth, uint32_t renderHeight);
+
+	// Draws the rendered region to outputRtv (in the render target state), stretched over the whole output:
+	void Upscale(FilteredCommandList& commandList, D3D12_CPU_DESCRIPTOR_HANDLE outputRtv);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView() const { return m_rtvHeap->GetCPUDescriptorHandleForHeapStart(); }
+
+	uint32_t GetRenderWidth() const { return m_renderWidth; }
+	uint32_t GetRenderHeight() const { return m_renderHeight; }
+
+	// For writing the scene target other than by rendering to it, e.g. copying in bands rendered on other
+	// GPUs. The upscaler tracks the target's state, so transitions have to go through it:
+	ID3D12Resource* GetRenderTarget() const { return m_renderTarget.Get(); }
+	void Transition(FilteredCommandList& commandList, D3D12_RESOURCE_STATES newState);
+
+private:
+	ID3D12Device2*									m_device;
+	RootSignatureCache&								m_rootSignatures;
+	DXGI_FORMAT										m_format;
+
+	Microsoft::WRL::ComPtr<ID3D12PipelineState>		m_pipelineState;
+	RootSignatureId									m_rootSignatureId;
+	int32_t											m_constantsRootIndex;
+	int32_t											m_sourceRootIndex;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource>			m_renderTarget;
+	TrackedAllocation								m_renderTargetMemory;
+	D3D12_RESOURCE_STATES							m_renderTargetState;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>	m_rtvHeap;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>	m_srvHeap;		// Shader visible, just the scene target's SRV.
+	TrackedAllocation								m_rtvHeapMemory;
+	TrackedAllocation								m_srvHeapMemory;
+
+	uint32_t										m_outputWidth;
+	uint32_t										m_outputHeight;
+	uint32_t										m_renderWidth;
+	uint32_t										m_renderHeight;
+};
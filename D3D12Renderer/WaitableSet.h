@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+using WaitableHandle = void*;		// A Win32 HANDLE on Windows, whatever the implementation waits on elsewhere.
+
+static const uint32_t g_waitInfinite = 0xffffffff;
+
+enum class WaitResult
+{
+	Signalled,		// One of the waitables was signalled, its index is returned.
+	Messages,			// Window messages are waiting to be processed.
+	Timeout,
+};
+
+// Blocks the calling thread until one of a set of waitable objects is signalled or window messages
+// arrive (i.e. MsgWaitForMultipleObjects). Kept abstract so FrameScheduler can run, and be tested,
+// without a window or a GPU.
+class IWaitableSet
+{
+public:
+	virtual ~IWaitableSet() = default;
+
+	virtual WaitResult Wait(const WaitableHandle* handles, uint32_t numHandles, uint32_t timeoutMs,
+		uint32_t& signalledIndex) = 0;
+};
@@ -0,0 +1,29 @@
+#include "Win32WaitableSet.h"
+#include "Helpers.h"
+
+#include <cassert>
+
+WaitResult Win32WaitableSet::Wait(const WaitableHandle* handles, uint32_t numHandles, uint32_t timeoutMs,
+  uint32_t& signalledIndex)
+{
+  assert(numHandles < MAXIMUM_WAIT_OBJECTS && "Too many handles to wait on!");
+
+  // MWMO_INPUTAVAILABLE also wakes for messages that arrived before the wait but haven't been removed
+  // from the queue yet, otherwise those would sit there until the next new message:
+  DWORD result = ::MsgWaitForMultipleObjectsEx(numHandles, handles, timeoutMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+
+  if (result < WAIT_OBJECT_0 + numHandles)
+  {
+    signalledIndex = result - WAIT_OBJECT_0;
+    return WaitResult::Signalled;
+  }
+
+  if (result == WAIT_OBJECT_0 + numHandles)
+    return WaitResult::Messages;
+
+  if (result == WAIT_TIMEOUT)
+    return WaitResult::Timeout;
+
+  DX12_CHECK(HRESULT_FROM_WIN32(::GetLastError()), "MsgWaitForMultipleObjectsEx failed!");
+  return WaitResult::Timeout;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "WaitableSet.h"
+
+// IWaitableSet over MsgWaitForMultipleObjectsEx, waking for any input or posted messages on the
+// calling thread's queue as well as the given handles.
+class Win32WaitableSet : public IWaitableSet
+{
+public:
+	WaitResult Wait(const WaitableHandle* handles, uint32_t numHandles, uint32_t timeoutMs,
+		uint32_t& signalledIndex) override;
+};
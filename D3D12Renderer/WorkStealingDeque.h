@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+// Fixed-capacity Chase-Lev work-stealing deque (with the C11 memory orderings from Lê et al., "Correct
+// and Efficient Work-Stealing for Weak Memory Models"). The owning thread pushes and pops at the bottom
+// without locking, any other thread can steal from the top with a single CAS. T must be trivially
+// copyable, in practice a pointer.
+template<typename T, uint32_t Capacity>
+class WorkStealingDeque
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two!");
+
+public:
+	WorkStealingDeque()
+		: m_top(0)
+		, m_bottom(0)
+	{
+	}
+
+	// Owner thread only:
+	void Push(T item)
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_top.load(std::memory_order_acquire);
+		assert(bottom - top < static_cast<int64_t>(Capacity) && "Work-stealing deque is full!");
+		(void)top;
+
+		// The release store publishes the item to thieves, which acquire m_bottom before reading it:
+		m_items[bottom & c_mask].store(item, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_release);
+	}
+
+	// Owner thread only, LIFO so recently pushed (cache-warm) work runs first:
+	bool Pop(T& item)
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// Already empty:
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = m_items[bottom & c_mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// Last item, race any thieves for it:
+			const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+				std::memory_order_relaxed);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return won;
+		}
+
+		return true;
+	}
+
+	// Any thread, FIFO so thieves take the oldest (typically largest) work:
+	bool Steal(T& item)
+	{
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+			return false;
+
+		item = m_items[top & c_mask].load(std::memory_order_relaxed);
+		return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+	// Only a hint while other threads are pushing or stealing:
+	bool IsEmpty() const
+	{
+		return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+	}
+
+private:
+	static const int64_t c_mask = Capacity - 1;
+
+	// Thieves hammer m_top while the owner works on m_bottom, keep them on separate cache lines:
+	alignas(64) std::atomic<int64_t>	m_top;
+	alignas(64) std::atomic<int64_t>	m_bottom;
+	alignas(64) std::atomic<T>				m_items[Capacity];
+};
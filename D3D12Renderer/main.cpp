@@ -12,12 +12,47 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
 
 #include "Helpers.h"
+#include "FilteredCommandList.h"
+#include "HandleRegistry.h"
+#include "FrameScheduler.h"
+#include "Win32WaitableSet.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "GpuMemoryTracking.h"
+#include "DrawPacket.h"
+#include "DrawBatcher.h"
+#include "DrawPacketRecorder.h"
+#include "UploadBuffer.h"
+#include "ShaderCompiler.h"
+#include "RootSignatureCache.h"
+#include "DynamicResolution.h"
+#include "GpuTimer.h"
+#include "Upscaler.h"
+#include "InputLatency.h"
+#include "FramePacer.h"
+#include "StartupGraph.h"
+#include "AdapterSelection.h"
+#include "DxgiAdapterProbe.h"
+#include "MultiGpuContext.h"
+#include "ResizeCoalescer.h"
+#include "Tracing.h"
+
+using ResourceRegistry = HandleRegistry<ComPtr<ID3D12Resource>, ID3D12Resource>;
+using ResourceHandle = ResourceRegistry::HandleType;
 
 const uint8_t                     g_numFrames = 3;        // Number of frames in flight
+const DXGI_FORMAT                 g_backBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
 bool                              g_useWarp = false;      // Whether or not to use Windows Advanced Rasterization Platform (WARP) or not, i.e. software rasterisation. Using
                                                           // WARP gives the programmer access to the full set of advanced rendering features not always available in hardware.
+AdapterPolicy                     g_adapterPolicy;        // Which adapter to render on otherwise (--low-power, --adapter <index>).
+const char* const                 g_adapterCachePath = "AdapterCache.txt";  // Capabilities of adapters probed on previous runs.
+const char* const                 g_memoryReportPath = "MemoryReport.json"; // Written on 'J' press, memory in use by category.
+const char* const                 g_tracePath = "Trace.json";               // Written when a capture ends, for chrome://tracing or ui.perfetto.dev.
 
 bool                              g_isInitialised = false;
 
@@ -30,10 +65,15 @@ RECT                              g_windowRect;   // Used to store previous wind
 ComPtr<ID3D12Device2>             g_device;
 ComPtr<ID3D12CommandQueue>        g_commandQueue;
 ComPtr<IDXGISwapChain4>           g_swapChain;
-ComPtr<ID3D12Resource>            g_backBuffers[g_numFrames];         // Pointers to swapchain's back buffer resources
-ComPtr<ID3D12GraphicsCommandList> g_commandList;                      // Used to record GPU commands (like Vulkan's command pool?)
+ResourceRegistry                  g_resources;                        // Owns every GPU resource, released resources are only destroyed once the GPU is done with them.
+ResourceHandle                    g_backBuffers[g_numFrames];         // Handles to swapchain's back buffer resources
+TrackedAllocation                 g_backBufferMemory[g_numFrames];    // What each back buffer takes up, for GetMemoryTracker().
+ComPtr<ID3D12GraphicsCommandList2> g_commandList;                     // Used to record GPU commands (like Vulkan's command pool?)
+FilteredCommandList               g_filteredCommandList;              // Wraps g_commandList while recording, dropping redundant state changes.
 ComPtr<ID3D12CommandAllocator>    g_commandAllocators[g_numFrames];   // Backing memory for recording GPU commands into command list, one per frame in flight is required.
+TrackedAllocation                 g_commandAllocatorMemory[g_numFrames];
 ComPtr<ID3D12DescriptorHeap>      g_RTVDescriptorHeap;                // Render target view (RTV) object to describe properties of back buffers. (Descriptor heaps are essentially descriptor sets.)
+TrackedAllocation                 g_RTVDescriptorHeapMemory;
 UINT                              g_RTVDescriptorSize;                // Size of a single RTV descriptor, used to correctly index into the descriptor heap.
 UINT                              g_currentBackBufferIndex;
 
@@ -41,6 +81,31 @@ ComPtr<ID3D12Fence>               g_fence;
 uint64_t                          g_fenceValue = 0;
 uint64_t                          g_frameFenceValues[g_numFrames] = {};
 HANDLE                            g_fenceEvent;
+HANDLE                            g_frameFenceEvent;                  // Gates the next frame on the GPU finishing with its back buffer, separate from g_fenceEvent so Flush() can't consume it.
+HANDLE                            g_frameLatencyWaitable;             // Signalled by the swapchain whenever it can queue another frame.
+
+FrameScheduler*                   g_frameScheduler = nullptr;
+JobSystem*                        g_jobSystem = nullptr;              // Runs engine/render tasks across cores, jobs touching the window go through JobAffinity::MainThread.
+FrameArenas*                      g_frameArenas = nullptr;            // Transient CPU data of each frame in flight, per thread, instead of the global heap.
+DrawPacketQueue                   g_drawPackets;                      // This frame's visible draws, recorded in sort key order.
+DrawBatcher                       g_drawBatcher;                      // Merges sorted draws of the same mesh and state into instanced draws.
+DrawPacketResources               g_drawResources;                    // What draw packet ids resolve to.
+std::unique_ptr<UploadBuffer>     g_instanceUploadBuffers[g_numFrames]; // Per-instance data of each frame in flight's draw batches.
+bool                              g_renderOnDemand = false;           // Only render in response to input/WM_PAINT rather than continuously, for mostly static content.
+bool                              g_useDynamicResolution = true;      // Render the scene at whatever resolution holds the display's refresh rate, upscaled to the window.
+DynamicResolutionController       g_dynamicResolution;                // Picks the scene resolution from measured GPU frame times.
+std::unique_ptr<GpuTimer>         g_gpuTimer;                         // GPU time of each frame in flight, fed to g_dynamicResolution.
+std::unique_ptr<Upscaler>         g_upscaler;                         // Scene render target and its upscale to the back buffer.
+InputLatencyTracker               g_inputLatency;                     // Latency from each key press to the frame that sampled it being presented and displayed.
+bool                              g_useLowLatencyPacing = false;      // Hold frames back until just before the GPU can take them, so they sample fresher input.
+FramePacer                        g_framePacer;                       // Predicts when the GPU goes idle, for g_useLowLatencyPacing.
+HANDLE                            g_pacingTimer;                      // Paced frames wait on this, high resolution where the OS supports it.
+uint64_t                          g_slotFrameIds[g_numFrames] = {};   // Frame last rendered in each back buffer slot...
+bool                              g_isGpuTimingPending[g_numFrames] = {}; // ...and whether its GPU timings are still to be passed to g_framePacer.
+MultiGpuMode                      g_multiGpuMode = MultiGpuMode::Single; // Whether to render on other GPUs too (--multi-gpu afr|sfr)...
+std::unique_ptr<MultiGpuContext>  g_multiGpu;                         // ...and what they render with, only created if there are any.
+ComPtr<ID3D12GraphicsCommandList2> g_compositeCommandList;            // With other GPUs, the rest of the frame once their bands are in.
+ResizeCoalescer                   g_resizeCoalescer(1280, 720);       // Batches up WM_SIZEs so the swap chain is resized between frames, and only once a drag settles.
 
 bool                              g_useVsync = true;
 bool                              g_tearingSupported = false;
@@ -54,20 +119,65 @@ void ParseCommandLineArguments()
   int argc;
   wchar_t** argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
 
-  for (size_t i = 0; i < argc; ++i)
-  {
-    if (::wcscmp(argv[i], L"-w") == 0 || ::wcscmp(argv[i], L"--width") == 0)
-      g_windowWidth = ::wcstol(argv[++i], nullptr, 10);
+  // The value following a flag, consumed, or null (and reported) if the flag is the last argument:
+  auto takeOperand = [&](int& i) -> const wchar_t* {
+    if (i + 1 < argc)
+      return argv[++i];
 
-    if (::wcscmp(argv[i], L"-h") == 0 || ::wcscmp(argv[i], L"--height") == 0)
-      g_windowHeight = ::wcstol(argv[++i], nullptr, 10);
+    ::OutputDebugStringW((std::wstring(L"Missing value after ") + argv[i] + L", ignored.\n").c_str());
+    return nullptr;
+  };
 
-    if (::wcscmp(argv[i], L"-warp") == 0 || ::wcscmp(argv[i], L"--warp") == 0)
+  for (int i = 1; i < argc; ++i)
+  {
+    if (::wcscmp(argv[i], L"-w") == 0 || ::wcscmp(argv[i], L"--width") == 0)
+    {
+      if (const wchar_t* width = takeOperand(i))
+        g_windowWidth = ::wcstol(width, nullptr, 10);
+    }
+    else if (::wcscmp(argv[i], L"-h") == 0 || ::wcscmp(argv[i], L"--height") == 0)
+    {
+      if (const wchar_t* height = takeOperand(i))
+        g_windowHeight = ::wcstol(height, nullptr, 10);
+    }
+    else if (::wcscmp(argv[i], L"-warp") == 0 || ::wcscmp(argv[i], L"--warp") == 0)
       g_useWarp = true;
-
-    // Free memory allocated by CommandLineToArgvW:
-    ::LocalFree(argv);
+    else if (::wcscmp(argv[i], L"--low-power") == 0)
+      g_adapterPolicy.preference = AdapterPreference::MinimumPower;
+    else if (::wcscmp(argv[i], L"--adapter") == 0)
+    {
+      if (const wchar_t* index = takeOperand(i))
+      {
+        g_adapterPolicy.preference = AdapterPreference::Index;
+        g_adapterPolicy.index = ::wcstol(index, nullptr, 10);
+      }
+    }
+    else if (::wcscmp(argv[i], L"--on-demand") == 0)
+      g_renderOnDemand = true;
+    else if (::wcscmp(argv[i], L"--no-dynamic-resolution") == 0)
+      g_useDynamicResolution = false;
+    else if (::wcscmp(argv[i], L"--low-latency") == 0)
+      g_useLowLatencyPacing = true;
+    else if (::wcscmp(argv[i], L"--multi-gpu") == 0)
+    {
+      // Anything but a known mode is reported and leaves rendering on the one GPU:
+      if (const wchar_t* mode = takeOperand(i))
+      {
+        if (::wcscmp(mode, L"afr") == 0)
+          g_multiGpuMode = MultiGpuMode::AlternateFrame;
+        else if (::wcscmp(mode, L"sfr") == 0)
+          g_multiGpuMode = MultiGpuMode::SplitFrame;
+        else
+          ::OutputDebugStringW((std::wstring(L"Unknown --multi-gpu mode ") + mode + L", ignored.\n").c_str());
+      }
+    }
+    // Captures from here, so startup is in the trace too, until the 'T' press that saves it:
+    else if (::wcscmp(argv[i], L"--trace") == 0)
+      GetTracer().BeginCapture();
   }
+
+  // Free memory allocated by CommandLineToArgvW, only once every argument has been read:
+  ::LocalFree(argv);
 }
 
 void EnableDebugLayer()
@@ -141,6 +251,8 @@ HWND CreateWindow(const wchar_t* windowClassName, HINSTANCE hInst,
   return hWnd;
 }
 
+// Adapter capabilities are cached by LUID and driver version, so only adapters (or drivers) not seen
+// before get a device created on them just to find out whether they'd do:
 ComPtr<IDXGIAdapter4> GetAdapter(bool useWarp)
 {
   ComPtr<IDXGIFactory4> dxgiFactory;
@@ -151,41 +263,28 @@ ComPtr<IDXGIAdapter4> GetAdapter(bool useWarp)
 
   DX12_CHECK(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory)));
 
-  ComPtr<IDXGIAdapter1> dxgiAdapter1;
-  ComPtr<IDXGIAdapter4> dxgiAdapter4;
-
+  AdapterPolicy policy = g_adapterPolicy;
   if (useWarp)
-  {
-    DX12_CHECK(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&dxgiAdapter1)));
-    DX12_CHECK(dxgiAdapter1.As(&dxgiAdapter4));
-  }
-  else
-  {
-    SIZE_T maxDedicatedVideoMemory = 0;
+    policy.preference = AdapterPreference::Warp;
 
-    for (UINT i = 0; dxgiFactory->EnumAdapters1(i, &dxgiAdapter1) != DXGI_ERROR_NOT_FOUND; ++i)
-    {
-      // Enumerate available adapters to find ones capable of creating a D3D12 device,
-      // keep track of the adapter with the largest dedicated video memory:
-      DXGI_ADAPTER_DESC1 dxgiAdapterDesc1;
-      dxgiAdapter1->GetDesc1(&dxgiAdapterDesc1);
-
-      if ((dxgiAdapterDesc1.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) == 0
-        && SUCCEEDED(D3D12CreateDevice(dxgiAdapter1.Get(), D3D_FEATURE_LEVEL_11_0, __uuidof(ID3D12Device), nullptr)) 
-        && dxgiAdapterDesc1.DedicatedVideoMemory > maxDedicatedVideoMemory)
-      {
-        maxDedicatedVideoMemory = dxgiAdapterDesc1.DedicatedVideoMemory;
-        DX12_CHECK(dxgiAdapter1.As(&dxgiAdapter4));
-      }
-    }
-  }
-  return dxgiAdapter4;
+  DxgiAdapterProbe probe(dxgiFactory.Get());
+  AdapterCapabilityCache cache;
+  cache.Load(g_adapterCachePath);
+
+  uint32_t adapterIndex = 0;
+  if (!SelectAdapter(probe, cache, policy, adapterIndex))
+    throw std::exception("No adapter matching the adapter policy supports D3D12!");
+
+  if (cache.IsDirty())
+    cache.Save(g_adapterCachePath);
+
+  return probe.GetAdapter(adapterIndex);
 }
 
-ComPtr<ID3D12Device2> CreateDevice(ComPtr <IDXGIAdapter4> adapter)
+ComPtr<ID3D12Device2> CreateDevice(IDXGIAdapter4* adapter)
 {
   ComPtr<ID3D12Device2> d3d12Device2;
-  DX12_CHECK(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&d3d12Device2)));
+  DX12_CHECK(D3D12CreateDevice(adapter, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&d3d12Device2)));
 
 #if defined(_DEBUG)
   // Enable debug messages if in debug mode:
@@ -219,7 +318,57 @@ ComPtr<ID3D12Device2> CreateDevice(ComPtr <IDXGIAdapter4> adapter)
   return d3d12Device2;
 }
 
-ComPtr<ID3D12CommandQueue> CreateCommandQueue(ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
+// Devices on every other hardware adapter that would do, for rendering on more than one GPU without a
+// linked adapter:
+std::vector<ComPtr<ID3D12Device2>> CreateSecondaryDevices(IDXGIAdapter4* displayAdapter)
+{
+  DXGI_ADAPTER_DESC1 displayDesc;
+  DX12_CHECK(displayAdapter->GetDesc1(&displayDesc));
+
+  ComPtr<IDXGIFactory4> dxgiFactory;
+  UINT createFactoryFlags = 0;
+#if defined (_DEBUG)
+  createFactoryFlags = DXGI_CREATE_FACTORY_DEBUG;
+#endif
+
+  DX12_CHECK(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory)));
+
+  DxgiAdapterProbe probe(dxgiFactory.Get());
+  AdapterCapabilityCache cache;
+  cache.Load(g_adapterCachePath);
+
+  std::vector<ComPtr<ID3D12Device2>> devices;
+  const std::vector<AdapterInfo>& adapters = probe.GetAdapters();
+  for (uint32_t i = 0; i < adapters.size(); ++i)
+  {
+    ComPtr<IDXGIAdapter4> adapter = probe.GetAdapter(i);
+    DXGI_ADAPTER_DESC1 desc;
+    DX12_CHECK(adapter->GetDesc1(&desc));
+
+    const bool isDisplayAdapter = desc.AdapterLuid.LowPart == displayDesc.AdapterLuid.LowPart &&
+      desc.AdapterLuid.HighPart == displayDesc.AdapterLuid.HighPart;
+    if (adapters[i].isSoftware || isDisplayAdapter)
+      continue;
+
+    AdapterCapabilities capabilities;
+    if (!cache.Find(adapters[i], capabilities))
+    {
+      capabilities = probe.ProbeCapabilities(i);
+      cache.Insert(adapters[i], capabilities);
+    }
+
+    if (capabilities.supportsD3D12 && capabilities.maxFeatureLevel >= g_adapterPolicy.minFeatureLevel)
+      devices.push_back(CreateDevice(adapter.Get()));
+  }
+
+  cache.Prune(adapters);
+  if (cache.IsDirty())
+    cache.Save(g_adapterCachePath);
+
+  return devices;
+}
+
+ComPtr<ID3D12CommandQueue> CreateCommandQueue(ID3D12Device2* device, D3D12_COMMAND_LIST_TYPE type, uint32_t nodeMask = 0)
 {
   ComPtr<ID3D12CommandQueue> d3d12CommandQueue;
 
@@ -227,7 +376,7 @@ ComPtr<ID3D12CommandQueue> CreateCommandQueue(ComPtr<ID3D12Device2> device, D3D1
   desc.Type = type;
   desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
   desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-  desc.NodeMask = 0;
+  desc.NodeMask = nodeMask;
 
   DX12_CHECK(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&d3d12CommandQueue)));
 
@@ -257,7 +406,7 @@ bool CheckTearingSupport()
   return allowTearing == TRUE;
 }
 
-ComPtr<IDXGISwapChain4> CreateSwapChain(HWND hWnd, ComPtr<ID3D12CommandQueue> commandQueue,
+ComPtr<IDXGISwapChain4> CreateSwapChain(HWND hWnd, ID3D12CommandQueue* commandQueue,
   uint32_t width, uint32_t height, uint32_t bufferCount)
 {
   ComPtr<IDXGISwapChain4> dxgiSwapChain4;
@@ -273,7 +422,7 @@ ComPtr<IDXGISwapChain4> CreateSwapChain(HWND hWnd, ComPtr<ID3D12CommandQueue> co
   DXGI_SWAP_CHAIN_DESC1 desc = {};
   desc.Width = width;                                   // Resolution width. If 0 is specified, then output window's width is automatically used.
   desc.Height = height;                                 // As above, but for height.
-  desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;             // Display format.
+  desc.Format = g_backBufferFormat;                     // Display format.
   desc.Stereo = FALSE;                                  // Whether or not the fullscreen-display mode or swapchain back buffer is stereo (what does this mean).
   desc.SampleDesc = { 1, 0 };                           // Multisampling parameters. When using a "flip" model swapchain, { 1, 0 } is required.
   desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;   // Surface usage and CPU access options for the back buffer. Could specify as DXGI_USAGE_SHADER_INPUT as well.
@@ -281,18 +430,23 @@ ComPtr<IDXGISwapChain4> CreateSwapChain(HWND hWnd, ComPtr<ID3D12CommandQueue> co
   desc.Scaling = DXGI_SCALING_STRETCH;                  // Specifies behaviour upon window resize, could also be SCALING_NONE or SCALING_ASPECT_RATIO_STRETCH.
   desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;      // Defines flip model, could also be EFFECT_FLIP_SEQUENTIAL.
   desc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;         // Transparency behaviour of the back buffer, could also be PREMULTIPLIED (additive), STRAIGHT or IGNORE.
-  desc.Flags = CheckTearingSupport() ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;  // ALLOW_TEARING should be specified if tearing support is available!
+  desc.Flags = g_tearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;     // ALLOW_TEARING should be specified if tearing support is available!
+  desc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;               // Lets the frame scheduler sleep until a new frame can be queued.
 
   ComPtr<IDXGISwapChain1> swapChain1;
 
-  DX12_CHECK(dxgiFactory4->CreateSwapChainForHwnd(commandQueue.Get(), hWnd, &desc, NULL, NULL, &swapChain1));
+  DX12_CHECK(dxgiFactory4->CreateSwapChainForHwnd(commandQueue, hWnd, &desc, NULL, NULL, &swapChain1));
   DX12_CHECK(dxgiFactory4->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER)); // Disable Alt+Enter fullscreen toggle.
   DX12_CHECK(swapChain1.As(&dxgiSwapChain4));
 
+  // Queue at most one frame fewer than there are back buffers, so the waitable is only signalled
+  // when a back buffer is actually available:
+  DX12_CHECK(dxgiSwapChain4->SetMaximumFrameLatency(bufferCount - 1));
+
   return dxgiSwapChain4;
 }
 
-ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(ComPtr<ID3D12Device2> device, 
+ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(ID3D12Device2* device, 
   D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors)
 {
   ComPtr<ID3D12DescriptorHeap> descriptorHeap;
@@ -306,8 +460,8 @@ ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(ComPtr<ID3D12Device2> device,
   return descriptorHeap;
 }
 
-void UpdateRenderTargetViews(ComPtr<ID3D12Device2> device, ComPtr<IDXGISwapChain4> swapChain,
-  ComPtr<ID3D12DescriptorHeap> descriptorHeap)
+void UpdateRenderTargetViews(ID3D12Device2* device, IDXGISwapChain4* swapChain,
+  ID3D12DescriptorHeap* descriptorHeap)
 {
   UINT rtvDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
@@ -318,12 +472,13 @@ void UpdateRenderTargetViews(ComPtr<ID3D12Device2> device, ComPtr<IDXGISwapChain
     ComPtr<ID3D12Resource> backBuffer;
     DX12_CHECK(swapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffer)));
     device->CreateRenderTargetView(backBuffer.Get(), nullptr, rtvHandle);
-    g_backBuffers[i] = backBuffer;
+    g_backBufferMemory[i] = TrackResource(device, backBuffer.Get(), MemoryCategory::SwapChain);
+    g_backBuffers[i] = g_resources.Add(std::move(backBuffer));
     rtvHandle.Offset(rtvDescriptorSize);
   }
 }
 
-ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
+ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(ID3D12Device2* device, D3D12_COMMAND_LIST_TYPE type)
 {
   ComPtr<ID3D12CommandAllocator> commandAllocator;
   DX12_CHECK(device->CreateCommandAllocator(type, IID_PPV_ARGS(&commandAllocator)));
@@ -331,17 +486,17 @@ ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(ComPtr<ID3D12Device2> devi
   return commandAllocator;
 }
 
-ComPtr<ID3D12GraphicsCommandList> CreateCommandList(ComPtr<ID3D12Device2> device,
-  ComPtr<ID3D12CommandAllocator> commandAllocator, D3D12_COMMAND_LIST_TYPE type)
+ComPtr<ID3D12GraphicsCommandList2> CreateCommandList(ID3D12Device2* device,
+  ID3D12CommandAllocator* commandAllocator, D3D12_COMMAND_LIST_TYPE type, uint32_t nodeMask = 0)
 {
-  ComPtr<ID3D12GraphicsCommandList> commandList;
-  DX12_CHECK(device->CreateCommandList(0, type, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+  ComPtr<ID3D12GraphicsCommandList2> commandList;
+  DX12_CHECK(device->CreateCommandList(nodeMask, type, commandAllocator, nullptr, IID_PPV_ARGS(&commandList)));
   DX12_CHECK(commandList->Close());
 
   return commandList;
 }
 
-ComPtr<ID3D12Fence> CreateFence(ComPtr<ID3D12Device2> device)
+ComPtr<ID3D12Fence> CreateFence(ID3D12Device2* device)
 {
   ComPtr<ID3D12Fence> fence;
   DX12_CHECK(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
@@ -356,14 +511,14 @@ HANDLE CreateEventHandle()
   return fenceEvent;
 }
 
-uint64_t Signal(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence, uint64_t& fenceVal)
+uint64_t Signal(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, uint64_t& fenceVal)
 {
   uint64_t fenceValForSignal = ++fenceVal;
-  DX12_CHECK(commandQueue->Signal(fence.Get(), fenceValForSignal));
+  DX12_CHECK(commandQueue->Signal(fence, fenceValForSignal));
   return fenceValForSignal;
 }
 
-void WaitForFenceValue(ComPtr<ID3D12Fence> fence, uint64_t fenceVal, HANDLE fenceEvent,
+void WaitForFenceValue(ID3D12Fence* fence, uint64_t fenceVal, HANDLE fenceEvent,
   std::chrono::milliseconds duration = std::chrono::milliseconds::max())
 {
   if (fence->GetCompletedValue() < fenceVal)
@@ -373,13 +528,43 @@ void WaitForFenceValue(ComPtr<ID3D12Fence> fence, uint64_t fenceVal, HANDLE fenc
   }
 }
 
-void Flush(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence,
+void Flush(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence,
   uint64_t& fenceVal, HANDLE fenceEvent)
 {
   uint64_t fenceValForSignal = Signal(commandQueue, fence, fenceVal);
   WaitForFenceValue(fence, fenceValForSignal, fenceEvent);
 }
 
+// Waits for the GPU to finish the frames in flight, i.e. to be done with every back buffer, without
+// signalling (and waiting for) anything else on the queue:
+void WaitForFramesInFlight()
+{
+  const uint64_t lastFrameFenceValue = *std::max_element(std::begin(g_frameFenceValues), std::end(g_frameFenceValues));
+  WaitForFenceValue(g_fence.Get(), lastFrameFenceValue, g_fenceEvent);
+}
+
+// Budget for dynamic resolution, a frame per refresh of the monitor the window is (mostly) on:
+DynamicResolutionSettings GetDynamicResolutionSettings()
+{
+  HMONITOR hMonitor = ::MonitorFromWindow(g_hWnd, MONITOR_DEFAULTTONEAREST);
+  MONITORINFOEXW monitorInfo = {};
+  monitorInfo.cbSize = sizeof(MONITORINFOEXW);
+  ::GetMonitorInfoW(hMonitor, &monitorInfo);
+
+  DEVMODEW displayMode = {};
+  displayMode.dmSize = sizeof(DEVMODEW);
+
+  // 0 and 1 both mean the hardware's default rate:
+  DWORD refreshRate = 60;
+  if (::EnumDisplaySettingsW(monitorInfo.szDevice, ENUM_CURRENT_SETTINGS, &displayMode) && displayMode.dmDisplayFrequency > 1)
+    refreshRate = displayMode.dmDisplayFrequency;
+
+  DynamicResolutionSettings settings;
+  settings.targetFrameTime = 1000.0f / refreshRate;
+  settings.latencyFrames = g_numFrames;
+  return settings;
+}
+
 void Update()
 {
   static uint64_t frameCount = 0;
@@ -398,82 +583,304 @@ void Update()
   {
     char buffer[500];
     auto fps = frameCount / elapsedSecs;
-    sprintf_s(buffer, 500, "FPS: %f\n", fps);
+    const DrawBatchStats& drawStats = g_drawBatcher.GetStats();
+    sprintf_s(buffer, 500, "FPS: %f, draws: %u (%u merged into instanced draws), render resolution: %ux%u (GPU %.2fms)\n",
+      fps, drawStats.numBatches, drawStats.numMergedDraws, g_upscaler->GetRenderWidth(), g_upscaler->GetRenderHeight(),
+      g_dynamicResolution.GetSmoothedFrameTime());
+    OutputDebugString((LPCSTR)buffer);
+
+    const BarrierBatchStats& barrierStats = g_filteredCommandList.GetBarrierStats();
+    sprintf_s(buffer, 500, "Barriers per frame: %.1f issued in %.1f batches, %.1f merged\n",
+      barrierStats.barriersIssued / double(frameCount), barrierStats.batchesIssued / double(frameCount),
+      barrierStats.barriersMerged / double(frameCount));
+    OutputDebugString((LPCSTR)buffer);
+    g_filteredCommandList.ResetBarrierStats();
+
+    const LatencyPercentiles presentLatency = g_inputLatency.GetInputToPresent().GetPercentiles();
+    const LatencyPercentiles displayLatency = g_inputLatency.GetInputToDisplay().GetPercentiles();
+    sprintf_s(buffer, 500, "Input latency (%s): to present p50 %.2fms p90 %.2fms p99 %.2fms, to display p50 %.2fms p90 %.2fms p99 %.2fms (%u inputs)\n",
+      g_useLowLatencyPacing ? "paced" : "unpaced", presentLatency.p50, presentLatency.p90, presentLatency.p99,
+      displayLatency.p50, displayLatency.p90, displayLatency.p99, presentLatency.numSamples);
+    OutputDebugString((LPCSTR)buffer);
+
+    const ResizeCoalescerStats& resizeStats = g_resizeCoalescer.GetStats();
+    sprintf_s(buffer, 500, "Window: %ux%u, %llu swap chain resizes for %llu size changes\n", g_windowWidth, g_windowHeight,
+      resizeStats.numResizes, resizeStats.numEvents);
+    OutputDebugString((LPCSTR)buffer);
+
+    GetMemoryTracker().GetSnapshot().FormatSummary(buffer, 500);
+    OutputDebugStringA(buffer);
+    OutputDebugStringA("\n");
+
+    const FrameArenaStats arenaStats = g_frameArenas->GetStats();
+    sprintf_s(buffer, 500, "Frame arenas: %llu KB peak per frame, %llu KB reserved in %u chunks\n",
+      arenaStats.highWaterMark / 1024, arenaStats.bytesReserved / 1024, arenaStats.numChunks);
     OutputDebugString((LPCSTR)buffer);
+
+    if (GetTracer().IsCapturing())
+    {
+      const TraceStats traceStats = GetTracer().GetStats();
+      sprintf_s(buffer, 500, "Tracing: %llu events on %u threads, %u GPU ranges, %llu dropped\n",
+        traceStats.numEvents, traceStats.numThreads, traceStats.numGpuRanges, traceStats.numDropped);
+      OutputDebugString((LPCSTR)buffer);
+    }
+
+    if (g_multiGpu)
+    {
+      static const char* const modeNames[] = { "single GPU", "alternate-frame", "split-frame" };
+      sprintf_s(buffer, 500, "Multi-GPU: %u GPUs (%s adapter), %s, display GPU renders %.0f%% of split frames\n",
+        g_multiGpu->NumGpus(), g_multiGpu->IsLinkedAdapter() ? "linked" : "unlinked",
+        modeNames[static_cast<int>(g_multiGpu->GetMode())], g_multiGpu->GetSplit()[0] * 100.0f);
+      OutputDebugString((LPCSTR)buffer);
+    }
+
+    // Once a second is plenty to keep GPU timestamps in step with the CPU clock:
+    g_gpuTimer->Calibrate();
+
+    frameCount = 0;
+    elapsedSecs = 0.0;
+  }
+}
+
+// Passes the GPU timings of every frame the GPU has finished since the last call to the frame pacer (and
+// the tracer, which puts them on the CPU's timeline):
+void CollectGpuTimings()
+{
+  const uint64_t completedFenceValue = g_fence->GetCompletedValue();
+  for (uint32_t i = 0; i < g_numFrames; ++i)
+  {
+    uint64_t beginUs = 0;
+    uint64_t endUs = 0;
+    if (g_isGpuTimingPending[i] && completedFenceValue >= g_frameFenceValues[i] &&
+        g_gpuTimer->GetFrameInterval(i, beginUs, endUs))
+    {
+      g_framePacer.OnGpuFrameCompleted(g_slotFrameIds[i], beginUs, endUs);
+      GetTracer().AddGpuRange("Frame", 0, beginUs, endUs);
+      g_isGpuTimingPending[i] = false;
+    }
   }
 }
 
 void Render()
 {
+  DX12_TRACE_SCOPE("Render");
+
   auto& commandAllocator = g_commandAllocators[g_currentBackBufferIndex];
-  auto& backBuffer = g_backBuffers[g_currentBackBufferIndex];
+  ID3D12Resource* backBuffer = g_resources.Get(g_backBuffers[g_currentBackBufferIndex])->Get();
+
+  // This frame consumes every input handled up to now. Frame ids follow the swap chain's present count,
+  // so its frame statistics can tell when the frame reached the screen:
+  UINT lastPresentCount = 0;
+  g_swapChain->GetLastPresentCount(&lastPresentCount);
+  const uint64_t frameId = lastPresentCount + 1;
+  const uint64_t frameStartUs = GetTimeMicroseconds();
+
+  // The frame last rendered in this slot has finished (it gated this one), so its transient data can go:
+  g_frameArenas->BeginFrame(g_currentBackBufferIndex);
+
+  CollectGpuTimings();
+  g_inputLatency.OnFrameStart(frameId, frameStartUs);
+  g_framePacer.OnFrameStart(frameId, frameStartUs);
+  g_slotFrameIds[g_currentBackBufferIndex] = frameId;
 
   commandAllocator->Reset();
   g_commandList->Reset(commandAllocator.Get(), nullptr);
+  g_filteredCommandList.Begin(g_commandList.Get());
+  ID3D12GraphicsCommandList2* commandList = g_commandList.Get();
 
-  // Clear render target:
+  // The last frame in this slot has finished on the GPU (it gated this one), so its timing is ready:
+  uint32_t renderWidth = g_windowWidth;
+  uint32_t renderHeight = g_windowHeight;
+  if (g_useDynamicResolution)
   {
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-      backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    const float gpuFrameTime = g_gpuTimer->GetFrameTime(g_currentBackBufferIndex);
+    if (gpuFrameTime >= 0.0f)
+      g_dynamicResolution.Update(gpuFrameTime);
+
+    g_dynamicResolution.GetRenderSize(g_windowWidth, g_windowHeight, renderWidth, renderHeight);
+  }
+
+  g_gpuTimer->BeginFrame(g_filteredCommandList, g_currentBackBufferIndex);
 
-    g_commandList->ResourceBarrier(1, &barrier);
+  // Clear the scene target and draw, at the render resolution:
+  {
+    g_upscaler->BeginScene(g_filteredCommandList, renderWidth, renderHeight);
 
     FLOAT clearColour[] = { 0.2f, 0.3f, 0.3f, 1.0f };
+    if (!g_multiGpu)
+      g_filteredCommandList.ClearRenderTargetView(g_upscaler->GetRenderTargetView(), clearColour, 0, nullptr);
+    else
+    {
+      // The other GPUs are set going on their parts of the frame first. Draw packets refer to this
+      // device's resources, so they only clear theirs, while this GPU renders its band (if any) with
+      // draws clipped to it:
+      g_multiGpu->BeginFrame(frameId, renderHeight);
+      g_multiGpu->RenderSecondaries(renderWidth, renderHeight,
+        [&](FilteredCommandList& secondaryCommandList, D3D12_CPU_DESCRIPTOR_HANDLE rtv, const D3D12_RECT& band) {
+          secondaryCommandList.ClearRenderTargetView(rtv, clearColour, 1, &band);
+        });
+
+      const D3D12_RECT band = g_multiGpu->GetDisplayBand(renderWidth);
+      g_filteredCommandList.RSSetScissorRects(1, &band);
+      g_multiGpu->BeginDisplayBand(g_filteredCommandList);
+      if (band.bottom > band.top)
+        g_filteredCommandList.ClearRenderTargetView(g_upscaler->GetRenderTargetView(), clearColour, 1, &band);
+    }
+
+    // Draws, sorted so state changes are minimised (and opaque geometry goes front to back):
+    if (g_drawPackets.Size() > 0)
+    {
+      DX12_TRACE_SCOPE("Draws");
+      g_drawPackets.Sort(g_jobSystem);
+      g_drawBatcher.Build(g_drawPackets);
+
+      // This frame's upload buffer was last read by the GPU g_numFrames ago, which has finished by now:
+      const std::vector<uint32_t>& instanceData = g_drawBatcher.GetInstanceData();
+      const uint64_t instanceDataSize = instanceData.size() * sizeof(uint32_t);
+      UploadBuffer& uploadBuffer = *g_instanceUploadBuffers[g_currentBackBufferIndex];
+      uploadBuffer.Reset(instanceDataSize);
+
+      const UploadBuffer::Allocation allocation = uploadBuffer.Allocate(instanceDataSize);
+      if (instanceDataSize > 0)
+        memcpy(allocation.cpuAddress, instanceData.data(), instanceDataSize);
+
+      RecordDrawBatches(g_filteredCommandList, g_drawPackets, g_drawBatcher, g_drawResources, allocation.gpuAddress);
+    }
+    else
+    {
+      g_drawBatcher.Clear();
+    }
+    g_drawPackets.Clear();
+  }
+
+  // Everything from here on has to wait for the other GPUs' bands, so this GPU's band is executed on its
+  // own to overlap with them, then theirs are copied into the scene target:
+  if (g_multiGpu)
+  {
+    g_multiGpu->EndDisplayBand(g_filteredCommandList);
+    g_filteredCommandList.FlushBarriers();
+    DX12_CHECK(g_commandList->Close());
+    ID3D12CommandList* const commandLists[] = {
+      g_commandList.Get(),
+    };
+
+    g_commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+    g_multiGpu->WaitForSecondaries();
+
+    commandList = g_compositeCommandList.Get();
+    commandList->Reset(commandAllocator.Get(), nullptr);
+    g_filteredCommandList.Begin(commandList);
+
+    g_upscaler->Transition(g_filteredCommandList, D3D12_RESOURCE_STATE_COPY_DEST);
+    g_multiGpu->Composite(g_filteredCommandList, g_upscaler->GetRenderTarget());
+  }
+
+  // Upscale to the back buffer:
+  {
+    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+      backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    g_filteredCommandList.ResourceBarrier(1, &barrier);
+
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(g_RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
       g_currentBackBufferIndex, g_RTVDescriptorSize);
 
-    g_commandList->ClearRenderTargetView(rtv, clearColour, 0, nullptr);
+    g_upscaler->Upscale(g_filteredCommandList, rtv);
   }
 
   // Present:
   {
     CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-      backBuffer.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+      backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 
-    g_commandList->ResourceBarrier(1, &barrier);
+    g_filteredCommandList.ResourceBarrier(1, &barrier);
+    g_gpuTimer->EndFrame(g_filteredCommandList, g_currentBackBufferIndex);
+    g_isGpuTimingPending[g_currentBackBufferIndex] = true;
 
-    DX12_CHECK(g_commandList->Close());
+    g_filteredCommandList.FlushBarriers();
+    DX12_CHECK(commandList->Close());
     ID3D12CommandList* const commandLists[] = {
-      g_commandList.Get(),
+      commandList,
     };
 
     g_commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+    if (g_multiGpu)
+      g_multiGpu->EndFrame();
+    g_framePacer.OnFrameSubmitted(frameId, GetTimeMicroseconds());
 
     UINT syncInterval = g_useVsync ? 1 : 0;
     UINT presentFlags = g_tearingSupported && !g_useVsync ? DXGI_PRESENT_ALLOW_TEARING : 0;
 
-    DX12_CHECK(g_swapChain->Present(syncInterval, presentFlags));
+    HRESULT presentResult = S_OK;
+    {
+      DX12_TRACE_SCOPE("Present");
+      presentResult = g_swapChain->Present(syncInterval, presentFlags);
+    }
+    DX12_CHECK(presentResult);
+
+    // Not every swap chain mode reports frame statistics, without them there are just no display latencies:
+    g_inputLatency.OnPresent(frameId, GetTimeMicroseconds());
+    DXGI_FRAME_STATISTICS frameStatistics = {};
+    if (SUCCEEDED(g_swapChain->GetFrameStatistics(&frameStatistics)))
+      g_inputLatency.OnDisplayed(frameStatistics.PresentCount, QpcToMicroseconds(frameStatistics.SyncQPCTime.QuadPart));
 
-    g_frameFenceValues[g_currentBackBufferIndex] = Signal(g_commandQueue, g_fence, g_fenceValue);
+    // Nothing on screen to update, stop rendering until the window becomes visible again:
+    if (presentResult == DXGI_STATUS_OCCLUDED)
+      g_frameScheduler->SetPaused(true, 100);
+
+    g_frameFenceValues[g_currentBackBufferIndex] = Signal(g_commandQueue.Get(), g_fence.Get(), g_fenceValue);
 
     g_currentBackBufferIndex = g_swapChain->GetCurrentBackBufferIndex();
-    WaitForFenceValue(g_fence, g_frameFenceValues[g_currentBackBufferIndex], g_fenceEvent);
+
+    // Rather than blocking here until the GPU is done with the next back buffer, hold back the next
+    // frame until it is, so messages keep being processed in the meantime:
+    if (g_fence->GetCompletedValue() < g_frameFenceValues[g_currentBackBufferIndex])
+    {
+      DX12_CHECK(g_fence->SetEventOnCompletion(g_frameFenceValues[g_currentBackBufferIndex], g_frameFenceEvent));
+      g_frameScheduler->AddFrameGate(g_frameFenceEvent);
+    }
+
+    // Deferred-destruction point, anything released at or before the completed fence value can go:
+    g_resources.CollectGarbage(g_fence->GetCompletedValue());
   }
 }
 
 void Resize(uint32_t width, uint32_t height)
 {
+  DX12_TRACE_SCOPE("Resize");
+
   if (g_windowWidth != width || g_windowHeight != height)
   {
     g_windowWidth = std::max(width, 1u);
     g_windowHeight= std::max(height, 1u);
 
-    Flush(g_commandQueue, g_fence, g_fenceValue, g_fenceEvent);
+    WaitForFramesInFlight();
 
     for (int i = 0; i < g_numFrames; ++i)
     {
       // Release all back buffer references before resizing swapchain:
-      g_backBuffers[i].Reset();
+      g_resources.Release(g_backBuffers[i], g_fenceValue);
+      g_backBufferMemory[i].Reset();
       g_frameFenceValues[i] = g_frameFenceValues[g_currentBackBufferIndex];
     }
 
+    // The frames using them are done, so the back buffers are destroyed here rather than deferred:
+    g_resources.CollectGarbage(g_fence->GetCompletedValue());
+
     DXGI_SWAP_CHAIN_DESC desc = {};
     DX12_CHECK(g_swapChain->GetDesc(&desc));
     DX12_CHECK(g_swapChain->ResizeBuffers(g_numFrames, g_windowWidth, g_windowHeight, 
       desc.BufferDesc.Format, desc.Flags));
 
     g_currentBackBufferIndex = g_swapChain->GetCurrentBackBufferIndex();
-    UpdateRenderTargetViews(g_device, g_swapChain, g_RTVDescriptorHeap);
+    UpdateRenderTargetViews(g_device.Get(), g_swapChain.Get(), g_RTVDescriptorHeap.Get());
+
+    // The scene target is idle once the frames are done too. Timings at the old size say nothing about the new
+    // one, and the window may have moved to a monitor with a different refresh rate:
+    g_upscaler->Resize(g_windowWidth, g_windowHeight);
+    if (g_multiGpu)
+      g_multiGpu->Resize(g_windowWidth, g_windowHeight);
+    g_dynamicResolution.SetSettings(GetDynamicResolutionSettings());
   }
 }
 
@@ -530,20 +937,48 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
     switch (message)
     {
     case WM_PAINT:
-      Update();
-      Render();
+      // Frames are driven by the frame scheduler, so just validate the window (otherwise WM_PAINT keeps
+      // being sent) and make sure a frame gets rendered:
+      ::ValidateRect(hwnd, nullptr);
+      g_frameScheduler->RequestFrame();
       break;
 
     case WM_SYSKEYDOWN:
     case WM_KEYDOWN:
     {
       bool alt = (::GetAsyncKeyState(VK_MENU) & 0x8000) != 0;
+      g_inputLatency.RecordInput(GetTimeMicroseconds());
+      g_frameScheduler->RequestFrame();
 
       switch (wParam)
       {
       case 'V':         // Toggle vsync usage on 'V' press.
         g_useVsync = !g_useVsync;
         break;
+      case 'R':         // Toggle dynamic resolution on 'R' press.
+        g_useDynamicResolution = !g_useDynamicResolution;
+        g_dynamicResolution.Reset();
+        break;
+      case 'L':         // Toggle low-latency frame pacing on 'L' press.
+        g_useLowLatencyPacing = !g_useLowLatencyPacing;
+        g_inputLatency.Clear();
+        break;
+      case 'M':         // Cycle single, alternate-frame and split-frame rendering on 'M' press, if there are other GPUs.
+        if (g_multiGpu)
+          g_multiGpu->SetMode(static_cast<MultiGpuMode>((static_cast<int>(g_multiGpu->GetMode()) + 1) % 3));
+        break;
+      case 'J':         // Write a report of memory in use by category on 'J' press.
+        GetMemoryTracker().GetSnapshot().SaveJson(g_memoryReportPath);
+        break;
+      case 'T':         // Start a trace capture on 'T' press, and end it and write it out on the next.
+        if (!GetTracer().IsCapturing())
+          GetTracer().BeginCapture();
+        else
+        {
+          GetTracer().EndCapture();
+          GetTracer().SaveChromeJson(g_tracePath);
+        }
+        break;
       case VK_ESCAPE:   // Quit on 'escape' press.
         ::PostQuitMessage(0);
         break;
@@ -563,16 +998,35 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 
     case WM_SIZE:
       {
+        // Don't render at all while minimised:
+        g_frameScheduler->SetPaused(wParam == SIZE_MINIMIZED);
+        if (wParam == SIZE_MINIMIZED)
+          break;
+
+        g_frameScheduler->RequestFrame();
+
         RECT clientRect = {};
         ::GetClientRect(g_hWnd, &clientRect);
 
         int width = clientRect.right - clientRect.left;
-        int height = clientRect.bottom - clientRect.bottom;
+        int height = clientRect.bottom - clientRect.top;
 
-        Resize(width, height);
+        // Applied by the next frame, see RenderFrame():
+        g_resizeCoalescer.OnResize(static_cast<uint32_t>(std::max(width, 1)), static_cast<uint32_t>(std::max(height, 1)),
+          GetTimeMicroseconds());
       }
       break;
 
+    // Dragging the window's edges, WM_SIZEs come in on every mouse move until the drag ends:
+    case WM_ENTERSIZEMOVE:
+      g_resizeCoalescer.SetInteractive(true);
+      break;
+
+    case WM_EXITSIZEMOVE:
+      g_resizeCoalescer.SetInteractive(false);
+      g_frameScheduler->RequestFrame();
+      break;
+
     case WM_DESTROY:
       ::PostQuitMessage(0);
       break;
@@ -587,6 +1041,66 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
   return 0;
 }
 
+bool PumpMessages()
+{
+  MSG msg = {};
+  while (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+  {
+    if (msg.message == WM_QUIT)
+      return false;
+
+    ::TranslateMessage(&msg);
+    ::DispatchMessage(&msg);
+  }
+
+  // Window work queued by other threads, they post us a WM_NULL to get here:
+  g_jobSystem->RunMainThreadJobs();
+  return true;
+}
+
+void RenderFrame()
+{
+  // Window size changes are applied here, between frames, so a burst of WM_SIZEs costs one resize. One
+  // held back for a drag to settle needs another frame to apply it, even when rendering on demand:
+  uint32_t width = 0;
+  uint32_t height = 0;
+  if (g_resizeCoalescer.TakeResize(GetTimeMicroseconds(), width, height))
+    Resize(width, height);
+  else if (g_resizeCoalescer.IsPending())
+    g_frameScheduler->RequestFrame();
+
+  Update();
+  Render();
+}
+
+// With low-latency pacing, holds the frame back until just before the GPU is predicted to be done with
+// the frames ahead of it, handling input meanwhile. Returns false to start the frame right away:
+bool PaceFrame()
+{
+  if (!g_useLowLatencyPacing)
+    return false;
+
+  CollectGpuTimings();
+
+  // Not worth a trip through the timer for less than this:
+  const uint64_t minDelayUs = 200;
+  const uint64_t nowUs = GetTimeMicroseconds();
+  const uint64_t startUs = g_framePacer.GetFrameStartTime(nowUs);
+  if (startUs < nowUs + minDelayUs)
+    return false;
+
+  // Negative due times are relative, in 100ns units:
+  LARGE_INTEGER dueTime;
+  dueTime.QuadPart = -static_cast<LONGLONG>((startUs - nowUs) * 10);
+  return ::SetWaitableTimer(g_pacingTimer, &dueTime, 0, nullptr, nullptr, FALSE) != FALSE;
+}
+
+// Called periodically while paused after an occluded Present(), to check whether the window is visible again:
+bool IsSwapChainVisible()
+{
+  return g_swapChain->Present(0, DXGI_PRESENT_TEST) != DXGI_STATUS_OCCLUDED;
+}
+
 int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
 {
   // Windows 10 Creators update added "Par Monitor V2 DPI awareness context, allowing the client area
@@ -595,47 +1109,139 @@ int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdL
   SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
 
   const wchar_t* windowClassName = L"DX12WindowClass";
+  GetTracer().SetThreadName("Main");
   ParseCommandLineArguments();
   EnableDebugLayer();
 
-  // Register window class and create window + window rect:
-  g_tearingSupported = CheckTearingSupport();
-  RegisterWindowClass(hInstance, windowClassName);
-  g_hWnd = CreateWindow(windowClassName, hInstance, L"3DGEP Dx12 Tutorial", g_windowWidth, g_windowHeight);
-  ::GetWindowRect(g_hWnd, &g_windowRect);
+  // Workers for every other hardware thread, this thread keeps window/message loop duty:
+  JobSystem jobSystem;
+  const DWORD mainThreadId = ::GetCurrentThreadId();
+  jobSystem.SetMainThreadWakeup([mainThreadId]() { ::PostThreadMessageW(mainThreadId, WM_NULL, 0, 0); });
+  g_jobSystem = &jobSystem;
 
-  // Create Dx12 objects:
-  ComPtr<IDXGIAdapter4> dxgiAdapter4 = GetAdapter(g_useWarp);
-  g_device = CreateDevice(dxgiAdapter4);
-  g_commandQueue = CreateCommandQueue(g_device, D3D12_COMMAND_LIST_TYPE_DIRECT);
-  g_swapChain = CreateSwapChain(g_hWnd, g_commandQueue, g_windowWidth, g_windowHeight, g_numFrames);
-  g_currentBackBufferIndex = g_swapChain->GetCurrentBackBufferIndex();
-  g_RTVDescriptorHeap = CreateDescriptorHeap(g_device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, g_numFrames);
-  g_RTVDescriptorSize = g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+  // Sized for every thread that can run frame work, arenas grow to fit the first few frames then stay put:
+  FrameArenas frameArenas(g_numFrames, jobSystem.NumThreads());
+  g_frameArenas = &frameArenas;
 
-  UpdateRenderTargetViews(g_device, g_swapChain, g_RTVDescriptorHeap);
+  // Startup runs as a graph of init tasks so independent ones overlap, e.g. the window is created on
+  // this thread while adapters are probed on a worker, and shaders/pipelines are built alongside the
+  // swap chain. Window and swap chain work stays on this thread:
+  ComPtr<IDXGIAdapter4> dxgiAdapter4;
+  std::unique_ptr<ShaderCompiler> shaderCompiler;
+  std::unique_ptr<RootSignatureCache> rootSignatures;
 
-  for (int i = 0; i < g_numFrames; ++i)
-    g_commandAllocators[i] = CreateCommandAllocator(g_device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+  StartupGraph startup(jobSystem);
 
-  g_commandList = CreateCommandList(g_device, g_commandAllocators[g_currentBackBufferIndex], D3D12_COMMAND_LIST_TYPE_DIRECT);
-  g_fence = CreateFence(g_device);
-  g_fenceEvent = CreateEventHandle();
+  const StartupTaskId tearingTask = startup.Add("Tearing support", []() {
+    g_tearingSupported = CheckTearingSupport();
+  });
 
-  g_isInitialised = true;
-  ::ShowWindow(g_hWnd, SW_SHOW);
+  const StartupTaskId windowTask = startup.Add("Window", [&]() {
+    RegisterWindowClass(hInstance, windowClassName);
+    g_hWnd = CreateWindow(windowClassName, hInstance, L"3DGEP Dx12 Tutorial", g_windowWidth, g_windowHeight);
+    ::GetWindowRect(g_hWnd, &g_windowRect);
+  }, {}, JobAffinity::MainThread);
 
-  MSG msg = {};
-  while (msg.message != WM_QUIT)
-  {
-    if (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+  const StartupTaskId adapterTask = startup.Add("Adapter", [&]() {
+    dxgiAdapter4 = GetAdapter(g_useWarp);
+  });
+
+  const StartupTaskId deviceTask = startup.Add("Device", [&]() {
+    g_device = CreateDevice(dxgiAdapter4.Get());
+    g_commandQueue = CreateCommandQueue(g_device.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+  }, { adapterTask });
+
+  startup.Add("Swap chain", []() {
+    g_swapChain = CreateSwapChain(g_hWnd, g_commandQueue.Get(), g_windowWidth, g_windowHeight, g_numFrames);
+    g_currentBackBufferIndex = g_swapChain->GetCurrentBackBufferIndex();
+    g_RTVDescriptorHeap = CreateDescriptorHeap(g_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, g_numFrames);
+    g_RTVDescriptorHeapMemory = TrackDescriptorHeap(g_device.Get(), g_RTVDescriptorHeap.Get());
+    g_RTVDescriptorSize = g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    UpdateRenderTargetViews(g_device.Get(), g_swapChain.Get(), g_RTVDescriptorHeap.Get());
+    g_frameLatencyWaitable = g_swapChain->GetFrameLatencyWaitableObject();
+    g_dynamicResolution.SetSettings(GetDynamicResolutionSettings());
+    g_resizeCoalescer = ResizeCoalescer(g_windowWidth, g_windowHeight);
+  }, { windowTask, deviceTask, tearingTask }, JobAffinity::MainThread);
+
+  const StartupTaskId frameResourcesTask = startup.Add("Frame resources", []() {
+    for (int i = 0; i < g_numFrames; ++i)
     {
-      ::TranslateMessage(&msg);
-      ::DispatchMessage(&msg);
+      g_commandAllocators[i] = CreateCommandAllocator(g_device.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+      g_commandAllocatorMemory[i] = TrackCommandAllocator();
+      g_instanceUploadBuffers[i] = std::make_unique<UploadBuffer>(g_device.Get(), 64 * 1024);
     }
-  }
 
-  Flush(g_commandQueue, g_fence, g_fenceValue, g_fenceEvent);
+    // The list is created closed and reset with the right frame's allocator in Render(), so which
+    // allocator it starts on doesn't matter (and the swap chain may not exist yet):
+    g_commandList = CreateCommandList(g_device.Get(), g_commandAllocators[0].Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+    g_fence = CreateFence(g_device.Get());
+    g_fenceEvent = CreateEventHandle();
+    g_frameFenceEvent = CreateEventHandle();
+    g_gpuTimer = std::make_unique<GpuTimer>(g_device.Get(), g_commandQueue.Get(), g_numFrames);
+
+    // High resolution timers (Windows 10 1803+) wake within a fraction of a millisecond rather than a
+    // scheduler tick, which is most of a frame's worth of pacing:
+    g_pacingTimer = ::CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!g_pacingTimer)
+      g_pacingTimer = ::CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+  }, { deviceTask });
+
+  // Other GPUs are the display device's other nodes on a linked adapter, otherwise other adapters:
+  startup.Add("Multi-GPU", [&]() {
+    if (g_multiGpuMode == MultiGpuMode::Single)
+      return;
+
+    std::vector<ComPtr<ID3D12Device2>> secondaryDevices;
+    if (g_device->GetNodeCount() == 1)
+    {
+      secondaryDevices = CreateSecondaryDevices(dxgiAdapter4.Get());
+      if (secondaryDevices.empty())
+      {
+        OutputDebugStringA("No other GPU to render on, rendering on one.\n");
+        return;
+      }
+    }
+
+    g_multiGpu = std::make_unique<MultiGpuContext>(g_device.Get(), g_commandQueue.Get(), secondaryDevices,
+      g_backBufferFormat, g_numFrames, g_multiGpuMode);
+    g_multiGpu->Resize(g_windowWidth, g_windowHeight);
+    g_compositeCommandList = CreateCommandList(g_device.Get(), g_commandAllocators[0].Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+  }, { frameResourcesTask });
+
+  // Shaders are compiled from the Shaders directory next to the working directory, cached in ShaderCache:
+  startup.Add("Shaders and pipelines", [&]() {
+    shaderCompiler = std::make_unique<ShaderCompiler>(L"Shaders", L"ShaderCache");
+    rootSignatures = std::make_unique<RootSignatureCache>(g_device.Get());
+    g_upscaler = std::make_unique<Upscaler>(g_device.Get(), *shaderCompiler, *rootSignatures, g_backBufferFormat);
+    g_upscaler->Resize(g_windowWidth, g_windowHeight);
+  }, { deviceTask });
+
+  startup.Run();
+  OutputDebugStringA(startup.FormatReport().c_str());
+
+  // Sleeps until there's a message to handle or a frame to render, instead of spinning on PeekMessage:
+  Win32WaitableSet waitableSet;
+  FrameScheduler frameScheduler(waitableSet, { &PumpMessages, &RenderFrame, &IsSwapChainVisible, &PaceFrame });
+  frameScheduler.SetFrameLatencyWaitable(g_frameLatencyWaitable);
+  frameScheduler.SetPacingWaitable(g_pacingTimer);
+  frameScheduler.SetContinuousRendering(!g_renderOnDemand);
+  g_frameScheduler = &frameScheduler;
+
+  g_isInitialised = true;
+  ::ShowWindow(g_hWnd, SW_SHOW);
+
+  frameScheduler.Run();
+
+  Flush(g_commandQueue.Get(), g_fence.Get(), g_fenceValue, g_fenceEvent);
+  for (std::unique_ptr<UploadBuffer>& uploadBuffer : g_instanceUploadBuffers)
+    uploadBuffer.reset();
+  g_gpuTimer.reset();
+  g_multiGpu.reset();
+  g_upscaler.reset();
+
+  ::CloseHandle(g_pacingTimer);
+  ::CloseHandle(g_frameLatencyWaitable);
+  ::CloseHandle(g_frameFenceEvent);
   ::CloseHandle(g_fenceEvent);
 
   return 0;
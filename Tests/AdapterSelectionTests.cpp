@@ -0,0 +1,255 @@
+#include "Test.h"
+#include "FakeAdapterProbe.h"
+
+#include <cstdio>
+#include <fstream>
+
+// SelectAdapter and AdapterCapabilityCache over fake adapters: which adapter each policy picks, how many
+// are probed to find it, when cached capabilities are reused or probed again, and adapters that are
+// gone being dropped from the cache.
+
+namespace
+{
+  const uint32_t c_featureLevel12_0 = 0xc000;
+  const uint32_t c_featureLevel12_1 = 0xc100;
+  const uint32_t c_noRank = ~0u;
+  const char* c_cachePath = "AdapterSelectionTests.cache.txt";
+
+  AdapterInfo MakeAdapter(uint64_t luid, uint64_t dedicatedVideoMemory, bool isSoftware, uint32_t highPerformanceRank,
+    uint32_t minimumPowerRank)
+  {
+    AdapterInfo info = {};
+    info.luid = luid;
+    info.driverVersion = 7;
+    info.vendorId = 0x10de;
+    info.deviceId = 1;
+    info.dedicatedVideoMemory = dedicatedVideoMemory;
+    info.isSoftware = isSoftware;
+    info.highPerformanceRank = highPerformanceRank;
+    info.minimumPowerRank = minimumPowerRank;
+    return info;
+  }
+
+  // An integrated GPU the OS prefers for power, a discrete one it prefers for performance, WARP, and an
+  // old GPU without D3D12 support:
+  struct Laptop
+  {
+    FakeAdapterProbe probe;
+    uint32_t integrated;
+    uint32_t discrete;
+    uint32_t warp;
+    uint32_t legacy;
+
+    Laptop()
+    {
+      integrated = probe.Add(MakeAdapter(1, 128, false, 1, 0), AdapterCapabilities{ true, c_featureLevel12_0 });
+      discrete = probe.Add(MakeAdapter(2, 8192, false, 0, 1), AdapterCapabilities{ true, c_featureLevel12_1 });
+      warp = probe.Add(MakeAdapter(3, 0, true, 2, 2), AdapterCapabilities{ true, c_featureLevel12_1 });
+      legacy = probe.Add(MakeAdapter(4, 4096, false, 3, 3), AdapterCapabilities{ false, 0 });
+    }
+  };
+}
+
+DX12_TEST(AdapterSelection_PoliciesFollowOsOrder)
+{
+  Laptop laptop;
+  AdapterCapabilityCache cache;
+  uint32_t adapterIndex = ~0u;
+  AdapterSelectionStats stats = {};
+
+  // Only the adapter picked is probed:
+  AdapterPolicy policy;
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(adapterIndex, laptop.discrete);
+  DX12_EXPECT_EQ(stats.numProbed, 1u);
+  DX12_EXPECT_EQ(laptop.probe.NumProbes(), 1u);
+
+  policy.preference = AdapterPreference::MinimumPower;
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(adapterIndex, laptop.integrated);
+  DX12_EXPECT_EQ(stats.numProbed, 1u);
+
+  // Adapters below the minimum feature level are passed over:
+  policy.minFeatureLevel = c_featureLevel12_1;
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(adapterIndex, laptop.discrete);
+  DX12_EXPECT_EQ(stats.numCached, 2u);
+  DX12_EXPECT_EQ(stats.numProbed, 0u);
+
+  // The OS hasn't ranked them, the one with the most video memory performs best and the least saves
+  // the most power:
+  FakeAdapterProbe unranked;
+  const uint32_t small = unranked.Add(MakeAdapter(1, 128, false, c_noRank, c_noRank),
+    AdapterCapabilities{ true, g_featureLevel11_0 });
+  const uint32_t large = unranked.Add(MakeAdapter(2, 8192, false, c_noRank, c_noRank),
+    AdapterCapabilities{ true, g_featureLevel11_0 });
+  AdapterCapabilityCache unrankedCache;
+
+  policy = AdapterPolicy();
+  DX12_EXPECT(SelectAdapter(unranked, unrankedCache, policy, adapterIndex));
+  DX12_EXPECT_EQ(adapterIndex, large);
+  policy.preference = AdapterPreference::MinimumPower;
+  DX12_EXPECT(SelectAdapter(unranked, unrankedCache, policy, adapterIndex));
+  DX12_EXPECT_EQ(adapterIndex, small);
+}
+
+DX12_TEST(AdapterSelection_ExplicitIndexAndWarp)
+{
+  Laptop laptop;
+  AdapterCapabilityCache cache;
+  uint32_t adapterIndex = ~0u;
+
+  AdapterPolicy policy;
+  policy.preference = AdapterPreference::Index;
+  policy.index = laptop.integrated;
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex));
+  DX12_EXPECT_EQ(adapterIndex, laptop.integrated);
+
+  // An explicit choice isn't swapped for another adapter when it doesn't qualify, or doesn't exist:
+  policy.index = laptop.legacy;
+  DX12_EXPECT(!SelectAdapter(laptop.probe, cache, policy, adapterIndex));
+  policy.index = 9;
+  DX12_EXPECT(!SelectAdapter(laptop.probe, cache, policy, adapterIndex));
+  policy.index = laptop.integrated;
+  policy.minFeatureLevel = c_featureLevel12_1;
+  DX12_EXPECT(!SelectAdapter(laptop.probe, cache, policy, adapterIndex));
+
+  policy = AdapterPolicy();
+  policy.preference = AdapterPreference::Warp;
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex));
+  DX12_EXPECT_EQ(adapterIndex, laptop.warp);
+
+  // No software adapter, no WARP:
+  FakeAdapterProbe hardwareOnly;
+  hardwareOnly.Add(MakeAdapter(1, 8192, false, 0, 0), AdapterCapabilities{ true, c_featureLevel12_1 });
+  DX12_EXPECT(!SelectAdapter(hardwareOnly, cache, policy, adapterIndex));
+}
+
+DX12_TEST(AdapterSelection_CacheSkipsProbesOnWarmStart)
+{
+  Laptop laptop;
+  uint32_t adapterIndex = ~0u;
+  AdapterSelectionStats stats = {};
+
+  // Probe every hardware adapter, as a policy none of them satisfies does, then WARP:
+  AdapterCapabilityCache cache;
+  AdapterPolicy policy;
+  policy.minFeatureLevel = 0xd000;
+  DX12_EXPECT(!SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(stats.numProbed, 3u);
+  policy.preference = AdapterPreference::Warp;
+  DX12_EXPECT(!SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(stats.numProbed, 1u);
+  DX12_EXPECT(cache.IsDirty());
+  DX12_EXPECT_EQ(cache.Size(), 4u);
+  DX12_EXPECT(cache.Save(c_cachePath));
+
+  AdapterCapabilityCache warmCache;
+  warmCache.Load(c_cachePath);
+  DX12_EXPECT_EQ(warmCache.Size(), 4u);
+  DX12_EXPECT(!warmCache.IsDirty());
+
+  laptop.probe.ResetNumProbes();
+  policy = AdapterPolicy();
+  DX12_EXPECT(SelectAdapter(laptop.probe, warmCache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(adapterIndex, laptop.discrete);
+  DX12_EXPECT_EQ(laptop.probe.NumProbes(), 0u);
+  DX12_EXPECT_EQ(stats.numCached, 1u);
+  DX12_EXPECT(!warmCache.IsDirty());
+
+  std::remove(c_cachePath);
+}
+
+DX12_TEST(AdapterSelection_DriverUpdateInvalidatesCachedEntry)
+{
+  Laptop laptop;
+  AdapterCapabilityCache cache;
+  uint32_t adapterIndex = ~0u;
+  AdapterSelectionStats stats = {};
+
+  AdapterPolicy policy;
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex));
+  DX12_EXPECT_EQ(adapterIndex, laptop.discrete);
+
+  // The new driver drops D3D12 support: the stale entry is replaced, not used, and selection moves on:
+  laptop.probe.Info(laptop.discrete).driverVersion = 8;
+  laptop.probe.Capabilities(laptop.discrete) = AdapterCapabilities{ false, 0 };
+  laptop.probe.ResetNumProbes();
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(adapterIndex, laptop.integrated);
+  DX12_EXPECT_EQ(laptop.probe.NumProbes(), 2u);
+  DX12_EXPECT_EQ(cache.Size(), 2u);
+
+  // Same LUID and driver but a different device (the LUID was reused after a reboot) isn't a match either,
+  // while the updated adapter's new entry is:
+  laptop.probe.Info(laptop.integrated).deviceId = 2;
+  laptop.probe.ResetNumProbes();
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(laptop.probe.NumProbes(), 1u);
+  DX12_EXPECT_EQ(stats.numCached, 1u);
+  DX12_EXPECT_EQ(cache.Size(), 2u);
+
+  // Unchanged, it's cached again:
+  laptop.probe.ResetNumProbes();
+  DX12_EXPECT(SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+  DX12_EXPECT_EQ(laptop.probe.NumProbes(), 0u);
+}
+
+DX12_TEST(AdapterSelection_CacheDropsAdaptersGoneAfterReboot)
+{
+  Laptop laptop;
+  uint32_t adapterIndex = ~0u;
+  AdapterSelectionStats stats = {};
+
+  // Each boot gives every adapter a new LUID. Probing all of them each time, the saved cache only ever
+  // has this boot's:
+  for (uint32_t boot = 0; boot < 5; ++boot)
+  {
+    for (uint32_t i = 0; i < laptop.probe.GetAdapters().size(); ++i)
+      laptop.probe.Info(i).luid = 100 * boot + i + 1;
+
+    AdapterCapabilityCache cache;
+    cache.Load(c_cachePath);
+    AdapterPolicy policy;
+    policy.minFeatureLevel = 0xd000;
+    DX12_EXPECT(!SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+    DX12_EXPECT_EQ(stats.numProbed, 3u);
+    policy.preference = AdapterPreference::Warp;
+    DX12_EXPECT(!SelectAdapter(laptop.probe, cache, policy, adapterIndex, &stats));
+    DX12_EXPECT_EQ(cache.Size(), 4u);
+    DX12_EXPECT(cache.Save(c_cachePath));
+  }
+
+  // Pruning only changes the cache when something's gone:
+  AdapterCapabilityCache cache;
+  cache.Load(c_cachePath);
+  cache.Prune(laptop.probe.GetAdapters());
+  DX12_EXPECT(!cache.IsDirty());
+  DX12_EXPECT_EQ(cache.Size(), 4u);
+
+  // A GPU removed, its entry goes with the next selection, even one finding everything cached:
+  FakeAdapterProbe docked;
+  docked.Add(laptop.probe.Info(laptop.discrete), laptop.probe.Capabilities(laptop.discrete));
+  DX12_EXPECT(SelectAdapter(docked, cache, AdapterPolicy(), adapterIndex, &stats));
+  DX12_EXPECT_EQ(stats.numCached, 1u);
+  DX12_EXPECT(cache.IsDirty());
+  DX12_EXPECT_EQ(cache.Size(), 1u);
+
+  std::remove(c_cachePath);
+}
+
+DX12_TEST(AdapterSelection_CorruptOrMissingCacheIsEmpty)
+{
+  {
+    std::ofstream file(c_cachePath, std::ios::trunc);
+    file << "garbage\n1 2 3\n";
+  }
+
+  AdapterCapabilityCache cache;
+  cache.Load(c_cachePath);
+  DX12_EXPECT_EQ(cache.Size(), 0u);
+  std::remove(c_cachePath);
+
+  cache.Load(c_cachePath);
+  DX12_EXPECT_EQ(cache.Size(), 0u);
+}
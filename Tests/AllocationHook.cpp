@@ -0,0 +1,35 @@
+#include "AllocationHook.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Only linked into Dx12AllocationTests, so nothing else pays for the count:
+
+namespace
+{
+  std::atomic<uint64_t> g_numHeapAllocations(0);
+}
+
+uint64_t GetNumHeapAllocations()
+{
+  return g_numHeapAllocations.load();
+}
+
+void* operator new(std::size_t size)
+{
+  g_numHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size ? size : 1))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t /*size*/) noexcept
+{
+  std::free(pointer);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// Calls to the global operator new so far (array and nothrow forms included), counted by
+// AllocationHook.cpp replacing it for the executable it's linked into. Over-aligned allocations go
+// through their own operator new and aren't counted.
+uint64_t GetNumHeapAllocations();
@@ -0,0 +1,96 @@
+#include "Test.h"
+#include "BarrierBatcher.h"
+
+#include <vector>
+
+// BarrierBatcher's merging: transitions that follow on fold together or cancel out, and nothing merges
+// across another barrier on the resource, between subresources or with split barriers.
+
+namespace
+{
+  std::vector<BatchedBarrier> Flush(BarrierBatcher& batcher)
+  {
+    std::vector<BatchedBarrier> issued;
+    batcher.Flush([&](const BatchedBarrier* barriers, uint32_t numBarriers) {
+      issued.assign(barriers, barriers + numBarriers);
+      });
+    return issued;
+  }
+
+  BatchedBarrier MakeUavBarrier(const void* resource)
+  {
+    BatchedBarrier barrier = {};
+    barrier.type = BarrierType::Uav;
+    barrier.resource = resource;
+    return barrier;
+  }
+}
+
+DX12_TEST(BarrierBatcher_MergesFollowingTransitions)
+{
+  int a, b, c;
+  BarrierBatcher batcher;
+  batcher.Transition(&a, 0, 1, 2);
+  batcher.Transition(&b, 0, 1, 2);
+  batcher.Transition(&a, 0, 2, 4);          // Folded: 1 -> 4.
+  batcher.Transition(&b, 0, 2, 1);          // Cancels out.
+  batcher.Transition(&c, 0, 1, 2);
+  batcher.Transition(&c, 0, 4, 8);          // Doesn't follow on, kept for the debug layer to report.
+
+  const std::vector<BatchedBarrier> issued = Flush(batcher);
+  DX12_EXPECT_EQ(issued.size(), 3u);
+  DX12_EXPECT(issued[0].resource == &a && issued[0].stateBefore == 1 && issued[0].stateAfter == 4);
+  DX12_EXPECT(issued[1].resource == &c && issued[1].stateAfter == 2);
+  DX12_EXPECT(issued[2].resource == &c && issued[2].stateBefore == 4);
+
+  const BarrierBatchStats& stats = batcher.GetStats();
+  DX12_EXPECT_EQ(stats.barriersAdded, 6u);
+  DX12_EXPECT_EQ(stats.barriersMerged, 2u);
+  DX12_EXPECT_EQ(stats.barriersIssued, 3u);
+  DX12_EXPECT_EQ(stats.batchesIssued, 1u);
+  DX12_EXPECT(batcher.IsEmpty());
+
+  // Nothing to issue, no batch:
+  DX12_EXPECT(Flush(batcher).empty());
+  DX12_EXPECT_EQ(batcher.GetStats().batchesIssued, 1u);
+}
+
+DX12_TEST(BarrierBatcher_KeepsOrderAcrossOtherBarriers)
+{
+  int a, b;
+  BarrierBatcher batcher;
+  batcher.Transition(&a, 0, 1, 2);
+  batcher.Add(MakeUavBarrier(&a));
+  batcher.Transition(&a, 0, 2, 4);          // Not past the UAV barrier on it...
+  batcher.Add(MakeUavBarrier(&b));
+  batcher.Transition(&a, 0, 4, 8);          // ...but past one on another resource.
+  batcher.Transition(&a, 5, 8, 1);          // A different subresource.
+  batcher.Add(MakeUavBarrier(nullptr));
+  batcher.Transition(&b, 0, 1, 2);          // Not past a barrier on every resource.
+
+  BatchedBarrier split = {};
+  split.type = BarrierType::Transition;
+  split.flags = 1;
+  split.resource = &b;
+  split.stateBefore = 2;
+  split.stateAfter = 4;
+  batcher.Add(split);
+  batcher.Transition(&b, 0, 4, 8);          // Nor with a split barrier.
+
+  const std::vector<BatchedBarrier> issued = Flush(batcher);
+  DX12_EXPECT_EQ(issued.size(), 9u);
+  DX12_EXPECT_EQ(batcher.GetStats().barriersMerged, 1u);
+  DX12_EXPECT(issued[0].type == BarrierType::Transition && issued[0].stateAfter == 2);
+  DX12_EXPECT(issued[1].type == BarrierType::Uav && issued[1].resource == &a);
+  DX12_EXPECT(issued[2].stateBefore == 2 && issued[2].stateAfter == 8);
+  DX12_EXPECT(issued[3].type == BarrierType::Uav && issued[3].resource == &b);
+  DX12_EXPECT(issued[4].subresource == 5);
+  DX12_EXPECT(issued[5].type == BarrierType::Uav && !issued[5].resource);
+  DX12_EXPECT(issued[7].flags == 1 && issued[8].stateBefore == 4);
+
+  // Cleared, nothing's issued:
+  batcher.Transition(&a, 0, 1, 2);
+  batcher.Clear();
+  DX12_EXPECT(batcher.IsEmpty());
+  DX12_EXPECT(Flush(batcher).empty());
+}
@@ -0,0 +1,225 @@
+#include "Test.h"
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// LightClusterBuilder's lists, every culling path the CPU has serial and across the job system, against
+// testing every light against every cluster with IntersectsCluster(), including the clamping to the index
+// list's capacity; and LightClusterGrid::FindCluster() finding the clusters around known points.
+
+namespace
+{
+  LightClusterGrid MakeGrid()
+  {
+    LightClusterGridDesc desc;
+    desc.sizeX = 8;
+    desc.sizeY = 5;
+    desc.sizeZ = 12;
+    desc.tanHalfFovX = 1.2f;
+    desc.tanHalfFovY = 0.7f;
+    desc.nearZ = 0.1f;
+    desc.farZ = 100.0f;
+
+    LightClusterGrid grid;
+    grid.Build(desc);
+    return grid;
+  }
+
+  // Lights through and around the frustum at a mix of sizes, not a multiple of a SIMD block, and some
+  // with no radius on cluster corners, which only just touch:
+  std::vector<ClusterLight> MakeLights(const LightClusterGrid& grid, uint32_t count)
+  {
+    const LightClusterGridDesc& desc = grid.GetDesc();
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> ndc(-1.3f, 1.3f);
+    std::uniform_real_distribution<float> depth(-5.0f, 120.0f);
+    std::uniform_real_distribution<float> radius(0.1f, 10.0f);
+
+    std::vector<ClusterLight> lights(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      ClusterLight& light = lights[i];
+      if (i % 16 == 0)
+      {
+        const ClusterBounds& bounds = grid.GetClusterBounds()[random() % grid.NumClusters()];
+        for (uint32_t axis = 0; axis < 3; ++axis)
+          light.position[axis] = (random() % 2) ? bounds.max[axis] : bounds.min[axis];
+        light.radius = 0.0f;
+        continue;
+      }
+
+      light.position[2] = depth(random);
+      light.position[0] = ndc(random) * std::abs(light.position[2]) * desc.tanHalfFovX;
+      light.position[1] = ndc(random) * std::abs(light.position[2]) * desc.tanHalfFovY;
+      light.radius = radius(random);
+    }
+    return lights;
+  }
+
+  // Every cluster's lights one after another, with the ranges clamped as the builder's are:
+  void BuildReference(const LightClusterGrid& grid, const std::vector<ClusterLight>& lights,
+    uint32_t maxLightIndices, std::vector<ClusterRange>& ranges, std::vector<uint32_t>& lightIndices)
+  {
+    ranges.resize(grid.NumClusters());
+    lightIndices.clear();
+
+    uint32_t prefix = 0;
+    for (uint32_t cluster = 0; cluster < grid.NumClusters(); ++cluster)
+    {
+      uint32_t count = 0;
+      for (uint32_t light = 0; light < lights.size(); ++light)
+      {
+        if (!LightClusterBuilder::IntersectsCluster(lights[light], grid.GetClusterBounds()[cluster]))
+          continue;
+
+        if (prefix + count < maxLightIndices)
+          lightIndices.push_back(light);
+        ++count;
+      }
+
+      ranges[cluster].offset = std::min(prefix, maxLightIndices);
+      ranges[cluster].count = std::min(count, maxLightIndices - ranges[cluster].offset);
+      prefix += count;
+    }
+  }
+
+  bool IsSameRanges(const std::vector<ClusterRange>& a, const std::vector<ClusterRange>& b)
+  {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const ClusterRange& x, const ClusterRange& y) {
+      return x.offset == y.offset && x.count == y.count;
+      });
+  }
+
+  // The paths this CPU can run:
+  std::vector<CullingPath> GetPaths()
+  {
+    std::vector<CullingPath> paths = { CullingPath::Scalar };
+    if (GetBestCullingPath() != CullingPath::Scalar)
+      paths.push_back(CullingPath::SSE);
+    if (GetBestCullingPath() == CullingPath::AVX2)
+      paths.push_back(CullingPath::AVX2);
+    return paths;
+  }
+}
+
+DX12_TEST(LightClusterBuilder_MatchesBruteForceOnEveryPath)
+{
+  const LightClusterGrid grid = MakeGrid();
+  JobSystem jobSystem(3);
+  LightClusterBuilder builder(1024 * 1024);
+
+  const uint32_t lightCounts[] = { 0, 1, 203 };
+  for (uint32_t numLights : lightCounts)
+  {
+    const std::vector<ClusterLight> lights = MakeLights(grid, numLights);
+    std::vector<ClusterRange> expectedRanges;
+    std::vector<uint32_t> expectedIndices;
+    BuildReference(grid, lights, 1024 * 1024, expectedRanges, expectedIndices);
+
+    for (CullingPath path : GetPaths())
+    {
+      // Builder reused, as from frame to frame:
+      builder.Build(grid, lights.data(), numLights, path);
+      DX12_EXPECT(IsSameRanges(builder.GetRanges(), expectedRanges));
+      DX12_EXPECT(builder.GetLightIndices() == expectedIndices);
+
+      builder.BuildParallel(jobSystem, grid, lights.data(), numLights, path);
+      DX12_EXPECT(IsSameRanges(builder.GetRanges(), expectedRanges));
+      DX12_EXPECT(builder.GetLightIndices() == expectedIndices);
+
+      const LightClusterStats& stats = builder.GetStats();
+      DX12_EXPECT_EQ(stats.numLights, numLights);
+      DX12_EXPECT_EQ(stats.numLightIndices, static_cast<uint32_t>(expectedIndices.size()));
+    }
+
+    // Enough for the comparison to mean something, lights spread over most clusters:
+    if (numLights > 1)
+      DX12_EXPECT(builder.GetStats().numNonEmptyClusters > grid.NumClusters() / 2);
+  }
+}
+
+DX12_TEST(LightClusterBuilder_ClampsToMaxLightIndices)
+{
+  const LightClusterGrid grid = MakeGrid();
+  const std::vector<ClusterLight> lights = MakeLights(grid, 203);
+  JobSystem jobSystem(3);
+
+  std::vector<ClusterRange> unclampedRanges;
+  std::vector<uint32_t> unclampedIndices;
+  BuildReference(grid, lights, ~0u, unclampedRanges, unclampedIndices);
+  const uint32_t numLightIndices = static_cast<uint32_t>(unclampedIndices.size());
+
+  // None at all, about half and exactly enough:
+  const uint32_t maxLightIndices[] = { 0, numLightIndices / 2 + 1, numLightIndices };
+  for (uint32_t maxIndices : maxLightIndices)
+  {
+    std::vector<ClusterRange> expectedRanges;
+    std::vector<uint32_t> expectedIndices;
+    BuildReference(grid, lights, maxIndices, expectedRanges, expectedIndices);
+    DX12_EXPECT_EQ(static_cast<uint32_t>(expectedIndices.size()), maxIndices);
+
+    LightClusterBuilder builder(maxIndices);
+    for (CullingPath path : GetPaths())
+    {
+      builder.Build(grid, lights.data(), static_cast<uint32_t>(lights.size()), path);
+      DX12_EXPECT(IsSameRanges(builder.GetRanges(), expectedRanges));
+      DX12_EXPECT(builder.GetLightIndices() == expectedIndices);
+
+      builder.BuildParallel(jobSystem, grid, lights.data(), static_cast<uint32_t>(lights.size()), path);
+      DX12_EXPECT(IsSameRanges(builder.GetRanges(), expectedRanges));
+      DX12_EXPECT(builder.GetLightIndices() == expectedIndices);
+
+      // The stats count what the clusters wanted, before clamping:
+      DX12_EXPECT_EQ(builder.GetStats().numLightIndices, numLightIndices);
+    }
+
+    // Every range stays inside the list, the clusters past the cap being empty:
+    bool isInside = true;
+    for (const ClusterRange& range : builder.GetRanges())
+      isInside &= range.offset + range.count <= maxIndices;
+    DX12_EXPECT(isInside);
+  }
+}
+
+DX12_TEST(LightClusterGrid_FindsClusterOfPoint)
+{
+  const LightClusterGrid grid = MakeGrid();
+  const LightClusterGridDesc& desc = grid.GetDesc();
+
+  // The middle of every cluster, on screen and in depth (slices are spaced exponentially):
+  uint32_t numWrong = 0;
+  uint32_t numOutside = 0;
+  for (uint32_t z = 0; z < desc.sizeZ; ++z)
+  {
+    const float viewZ = desc.nearZ * std::pow(desc.farZ / desc.nearZ, (z + 0.5f) / desc.sizeZ);
+    for (uint32_t y = 0; y < desc.sizeY; ++y)
+    {
+      for (uint32_t x = 0; x < desc.sizeX; ++x)
+      {
+        const float viewportX = (x + 0.5f) / desc.sizeX;
+        const float viewportY = (y + 0.5f) / desc.sizeY;
+        const uint32_t cluster = grid.FindCluster(viewportX, viewportY, viewZ);
+        numWrong += cluster != grid.GetClusterIndex(x, y, z);
+
+        // And the point in view space is inside that cluster's bounds:
+        const float point[3] = { (viewportX * 2.0f - 1.0f) * viewZ * desc.tanHalfFovX,
+          (1.0f - viewportY * 2.0f) * viewZ * desc.tanHalfFovY, viewZ };
+        const ClusterBounds& bounds = grid.GetClusterBounds()[cluster];
+        for (uint32_t axis = 0; axis < 3; ++axis)
+          numOutside += point[axis] < bounds.min[axis] || point[axis] > bounds.max[axis];
+      }
+    }
+  }
+  DX12_EXPECT_EQ(numWrong, 0u);
+  DX12_EXPECT_EQ(numOutside, 0u);
+
+  // Off the edges of the screen and outside the depth range, the nearest cluster:
+  DX12_EXPECT_EQ(grid.FindCluster(-0.5f, -0.5f, 0.01f), grid.GetClusterIndex(0, 0, 0));
+  DX12_EXPECT_EQ(grid.FindCluster(1.0f, 1.0f, 500.0f), grid.GetClusterIndex(desc.sizeX - 1, desc.sizeY - 1,
+    desc.sizeZ - 1));
+  DX12_EXPECT_EQ(grid.FindCluster(0.0f, 1.5f, desc.nearZ), grid.GetClusterIndex(0, desc.sizeY - 1, 0));
+}
@@ -0,0 +1,111 @@
+#include "Test.h"
+#include "DescriptorAllocator.h"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+// DescriptorAllocator's best fit and merging of freed ranges, then random allocations and frees checked
+// against a bitmap of which descriptors are in use.
+
+namespace
+{
+  // A copy, as the expectations take their arguments by reference and the class constant isn't defined:
+  const uint32_t c_invalidIndex = DescriptorAllocator::c_invalidIndex;
+}
+
+DX12_TEST(DescriptorAllocator_BestFitAndMerge)
+{
+  DescriptorAllocator allocator(100);
+  DX12_EXPECT_EQ(allocator.Allocate(10), 0u);
+  DX12_EXPECT_EQ(allocator.Allocate(20), 10u);
+  DX12_EXPECT_EQ(allocator.Allocate(5), 30u);
+  DX12_EXPECT_EQ(allocator.Allocate(30), 35u);
+
+  // Free: [0, 10), [30, 35) and [65, 100). Four goes in the smallest range it fits, ten in the one it fits
+  // exactly:
+  allocator.Free(0, 10);
+  allocator.Free(30, 5);
+  DX12_EXPECT_EQ(allocator.NumFreeRanges(), 3u);
+  DX12_EXPECT_EQ(allocator.Allocate(4), 30u);
+  DX12_EXPECT_EQ(allocator.Allocate(10), 0u);
+  DX12_EXPECT_EQ(allocator.Allocate(36), c_invalidIndex);
+
+  // Freed next to free ranges on both sides, they become one:
+  allocator.Free(30, 4);
+  allocator.Free(35, 30);
+  DX12_EXPECT_EQ(allocator.NumFreeRanges(), 1u);
+  DX12_EXPECT_EQ(allocator.Allocate(70), 30u);
+
+  allocator.Free(0, 10);
+  allocator.Free(10, 20);
+  allocator.Free(30, 70);
+  DX12_EXPECT_EQ(allocator.NumFree(), 100u);
+  DX12_EXPECT_EQ(allocator.NumFreeRanges(), 1u);
+}
+
+DX12_TEST(DescriptorAllocator_MatchesBitmapUnderRandomUse)
+{
+  const uint32_t numDescriptors = 4096;
+  DescriptorAllocator allocator(numDescriptors);
+  std::vector<bool> isUsed(numDescriptors, false);
+  std::vector<std::pair<uint32_t, uint32_t>> live;
+  std::mt19937 random(1);
+
+  uint32_t numOverlaps = 0;
+  uint32_t numFailedWithRoom = 0;
+  uint32_t numMiscounted = 0;
+  for (uint32_t step = 0; step < 200000; ++step)
+  {
+    if (live.empty() || random() % 2)
+    {
+      const uint32_t count = 1 + random() % 32;
+      const uint32_t index = allocator.Allocate(count);
+      if (index == c_invalidIndex)
+      {
+        // Only when no free run in the bitmap is long enough:
+        uint32_t run = 0;
+        for (uint32_t i = 0; i < numDescriptors && run < count; ++i)
+          run = isUsed[i] ? 0 : run + 1;
+        numFailedWithRoom += run >= count;
+        continue;
+      }
+
+      for (uint32_t i = index; i < index + count; ++i)
+      {
+        numOverlaps += isUsed[i];
+        isUsed[i] = true;
+      }
+      live.emplace_back(index, count);
+    }
+    else
+    {
+      const size_t freed = random() % live.size();
+      for (uint32_t i = live[freed].first; i < live[freed].first + live[freed].second; ++i)
+        isUsed[i] = false;
+      allocator.Free(live[freed].first, live[freed].second);
+      live[freed] = live.back();
+      live.pop_back();
+    }
+
+    if (step % 1000 == 0)
+    {
+      uint32_t numFree = 0;
+      for (bool used : isUsed)
+        numFree += !used;
+      numMiscounted += numFree != allocator.NumFree();
+    }
+  }
+
+  DX12_EXPECT_EQ(numOverlaps, 0u);
+  DX12_EXPECT_EQ(numFailedWithRoom, 0u);
+  DX12_EXPECT_EQ(numMiscounted, 0u);
+
+  // Everything freed merges back into the one range:
+  for (const std::pair<uint32_t, uint32_t>& range : live)
+    allocator.Free(range.first, range.second);
+  DX12_EXPECT_EQ(allocator.NumFree(), numDescriptors);
+  DX12_EXPECT_EQ(allocator.NumFreeRanges(), 1u);
+  DX12_EXPECT_EQ(allocator.Allocate(numDescriptors), 0u);
+  DX12_EXPECT_EQ(allocator.Allocate(1), c_invalidIndex);
+}
@@ -0,0 +1,175 @@
+#include "Test.h"
+#include "DrawBatcher.h"
+#include "DrawPacket.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// DrawBatcher over sorted queues: opaque draws of the same mesh range and state merge across their
+// pipeline/material group keeping their instances front to back, transparent ones only with the draws
+// next to them, and packets with no instances don't become draws.
+
+namespace
+{
+  DrawPacket MakePacket(uint32_t meshId, uint32_t materialId, uint32_t objectIndex, uint32_t instanceCount = 1)
+  {
+    DrawPacket packet = {};
+    packet.pipelineId = 3;
+    packet.rootSignatureId = 1;
+    packet.materialId = materialId;
+    packet.meshId = meshId;
+    packet.objectIndex = objectIndex;
+    packet.indexCount = 36;
+    packet.startIndex = meshId * 36;
+    packet.instanceCount = instanceCount;
+    return packet;
+  }
+
+  uint32_t AddDraw(DrawPacketQueue& queue, DrawLayer layer, uint32_t depth, const DrawPacket& packet)
+  {
+    return queue.Add(DrawSortKey::Make(layer, packet.pipelineId, packet.materialId, depth), packet);
+  }
+
+  // The instance data of a batch:
+  std::vector<uint32_t> GetInstances(const DrawBatcher& batcher, const DrawBatch& batch)
+  {
+    const uint32_t* instanceData = batcher.GetInstanceData().data() + batch.firstInstance;
+    return std::vector<uint32_t>(instanceData, instanceData + batch.instanceCount);
+  }
+
+  bool IsStatsConsistent(const DrawBatcher& batcher, uint32_t numPackets)
+  {
+    const DrawBatchStats& stats = batcher.GetStats();
+    return stats.numPackets == numPackets && stats.numBatches == batcher.GetBatches().size() &&
+      stats.numMergedDraws == stats.numPackets - stats.numBatches;
+  }
+}
+
+DX12_TEST(DrawBatcher_MergesOpaqueDrawsFrontToBack)
+{
+  // Meshes 0 and 1 interleaved with one material, added out of depth order; object indices rise with
+  // depth, so front to back instances come out ascending. Mesh 0 with another material is a group of its
+  // own, and so is mesh 1 drawing fewer indices:
+  DrawPacketQueue queue;
+  AddDraw(queue, DrawLayer_Opaque, 500, MakePacket(0, 7, 50));
+  AddDraw(queue, DrawLayer_Opaque, 100, MakePacket(1, 7, 10));
+  AddDraw(queue, DrawLayer_Opaque, 300, MakePacket(0, 7, 30, 2));
+  AddDraw(queue, DrawLayer_Opaque, 200, MakePacket(0, 7, 20));
+  AddDraw(queue, DrawLayer_Opaque, 400, MakePacket(1, 7, 40));
+  AddDraw(queue, DrawLayer_Opaque, 150, MakePacket(0, 8, 15));
+  DrawPacket shorter = MakePacket(1, 7, 45);
+  shorter.indexCount = 12;
+  AddDraw(queue, DrawLayer_Opaque, 450, shorter);
+  queue.Sort();
+
+  DrawBatcher batcher;
+  batcher.Build(queue);
+  const std::vector<DrawBatch>& batches = batcher.GetBatches();
+  DX12_EXPECT_EQ(batches.size(), 4u);
+  DX12_EXPECT(IsStatsConsistent(batcher, 7));
+  DX12_EXPECT_EQ(batcher.GetStats().numMergedDraws, 3u);
+  if (batches.size() == 4)
+  {
+    DX12_EXPECT(GetInstances(batcher, batches[0]) == std::vector<uint32_t>({ 20, 30, 31, 50 }));
+    DX12_EXPECT(GetInstances(batcher, batches[1]) == std::vector<uint32_t>({ 10, 40 }));
+    DX12_EXPECT(GetInstances(batcher, batches[2]) == std::vector<uint32_t>({ 45 }));
+    DX12_EXPECT(GetInstances(batcher, batches[3]) == std::vector<uint32_t>({ 15 }));
+    DX12_EXPECT_EQ(queue.GetPacket(batches[1].packetIndex).meshId, 1u);
+    DX12_EXPECT_EQ(queue.GetPacket(batches[3].packetIndex).materialId, 8u);
+  }
+}
+
+DX12_TEST(DrawBatcher_MergesLargeGroupsFrontToBack)
+{
+  // Past the insertion sort's limit, so the group goes through the radix sort:
+  const uint32_t numMeshes = 3;
+  const uint32_t numDraws = 300;
+  std::vector<uint32_t> depths(numDraws);
+  for (uint32_t i = 0; i < numDraws; ++i)
+    depths[i] = i * 10;
+  std::shuffle(depths.begin(), depths.end(), std::mt19937(5));
+
+  DrawPacketQueue queue;
+  for (uint32_t i = 0; i < numDraws; ++i)
+    AddDraw(queue, DrawLayer_AlphaTested, depths[i], MakePacket(i % numMeshes, 2, depths[i]));
+  queue.Sort();
+
+  DrawBatcher batcher;
+  batcher.Build(queue);
+  DX12_EXPECT_EQ(batcher.GetBatches().size(), numMeshes);
+  DX12_EXPECT(IsStatsConsistent(batcher, numDraws));
+
+  uint32_t numInstances = 0;
+  for (const DrawBatch& batch : batcher.GetBatches())
+  {
+    const std::vector<uint32_t> instances = GetInstances(batcher, batch);
+    const uint32_t meshId = queue.GetPacket(batch.packetIndex).meshId;
+    bool isFrontToBack = true;
+    for (size_t i = 0; i < instances.size(); ++i)
+      isFrontToBack &= (i == 0 || instances[i - 1] < instances[i]);
+    DX12_EXPECT(isFrontToBack);
+
+    // Every instance is one of the batch's mesh's draws:
+    bool isSameMesh = true;
+    for (uint32_t instance : instances)
+    {
+      const uint32_t draw = static_cast<uint32_t>(std::find(depths.begin(), depths.end(), instance) - depths.begin());
+      isSameMesh &= draw % numMeshes == meshId;
+    }
+    DX12_EXPECT(isSameMesh);
+    numInstances += batch.instanceCount;
+  }
+  DX12_EXPECT_EQ(numInstances, numDraws);
+}
+
+DX12_TEST(DrawBatcher_MergesTransparentDrawsOnlyWithNeighbours)
+{
+  // Back to front: mesh 0, 0, 1, 0, 0. The first two and the last two merge, but not across mesh 1,
+  // which would blend it in the wrong order:
+  DrawPacketQueue queue;
+  AddDraw(queue, DrawLayer_Transparent, 100, MakePacket(0, 7, 5));
+  AddDraw(queue, DrawLayer_Transparent, 500, MakePacket(0, 7, 1));
+  AddDraw(queue, DrawLayer_Transparent, 300, MakePacket(1, 7, 3));
+  AddDraw(queue, DrawLayer_Transparent, 400, MakePacket(0, 7, 2));
+  AddDraw(queue, DrawLayer_Transparent, 200, MakePacket(0, 7, 4));
+  queue.Sort();
+
+  DrawBatcher batcher;
+  batcher.Build(queue);
+  const std::vector<DrawBatch>& batches = batcher.GetBatches();
+  DX12_EXPECT_EQ(batches.size(), 3u);
+  DX12_EXPECT(IsStatsConsistent(batcher, 5));
+  DX12_EXPECT_EQ(batcher.GetStats().numMergedDraws, 2u);
+  if (batches.size() == 3)
+  {
+    DX12_EXPECT(GetInstances(batcher, batches[0]) == std::vector<uint32_t>({ 1, 2 }));
+    DX12_EXPECT(GetInstances(batcher, batches[1]) == std::vector<uint32_t>({ 3 }));
+    DX12_EXPECT(GetInstances(batcher, batches[2]) == std::vector<uint32_t>({ 4, 5 }));
+  }
+}
+
+DX12_TEST(DrawBatcher_DropsPacketsWithoutInstances)
+{
+  // One packet drawing nothing alone, one merged with a draw that does:
+  DrawPacketQueue queue;
+  AddDraw(queue, DrawLayer_Opaque, 100, MakePacket(0, 7, 10, 0));
+  AddDraw(queue, DrawLayer_Opaque, 200, MakePacket(0, 7, 20));
+  AddDraw(queue, DrawLayer_Opaque, 300, MakePacket(1, 7, 30, 0));
+  AddDraw(queue, DrawLayer_Transparent, 300, MakePacket(2, 7, 40, 0));
+  queue.Sort();
+
+  DrawBatcher batcher;
+  batcher.Build(queue);
+  DX12_EXPECT_EQ(batcher.GetBatches().size(), 1u);
+  DX12_EXPECT(batcher.GetInstanceData() == std::vector<uint32_t>({ 20 }));
+  DX12_EXPECT(IsStatsConsistent(batcher, 4));
+  DX12_EXPECT_EQ(batcher.GetStats().numMergedDraws, 3u);
+
+  // Rebuilt, nothing's left over from the last build:
+  DrawPacketQueue empty;
+  empty.Sort();
+  batcher.Build(empty);
+  DX12_EXPECT(batcher.GetBatches().empty() && batcher.GetInstanceData().empty());
+  DX12_EXPECT(IsStatsConsistent(batcher, 0));
+}
@@ -0,0 +1,212 @@
+#include "Test.h"
+#include "DynamicResolution.h"
+
+#include <deque>
+#include <functional>
+#include <random>
+
+// DynamicResolutionController fed synthetic GPU timing traces. The simulated GPU takes a fixed 2ms plus
+// content cost that scales with pixel count, and each time is reported latencyFrames frames after the
+// frame was rendered, as GpuTimer does.
+
+namespace
+{
+  const float c_fixedCostMs = 2.0f;
+
+  struct TraceResult
+  {
+    std::vector<float> frameTimes;          // GPU time of every frame rendered.
+    std::vector<float> scales;              // Scale each frame was rendered at.
+  };
+
+  // contentCost(frame) is the pixel-dependent cost at full resolution, in milliseconds:
+  TraceResult RunTrace(DynamicResolutionController& controller, uint32_t numFrames,
+    const std::function<float(uint32_t)>& contentCost, float noiseMs = 0.0f)
+  {
+    std::mt19937 random(1);
+    std::normal_distribution<float> noise(0.0f, noiseMs);
+    std::deque<float> inFlight;
+
+    TraceResult result;
+    for (uint32_t frame = 0; frame < numFrames; ++frame)
+    {
+      const float scale = controller.GetScale();
+      float frameTime = c_fixedCostMs + contentCost(frame) * scale * scale;
+      if (noiseMs > 0.0f)
+        frameTime += noise(random);
+
+      result.frameTimes.push_back(frameTime);
+      result.scales.push_back(scale);
+
+      inFlight.push_back(frameTime);
+      if (inFlight.size() > controller.GetSettings().latencyFrames)
+      {
+        controller.Update(inFlight.front());
+        inFlight.pop_front();
+      }
+    }
+    return result;
+  }
+
+  uint32_t CountMissedFrames(const TraceResult& trace, float targetFrameTime, uint32_t begin, uint32_t end)
+  {
+    uint32_t numMissed = 0;
+    for (uint32_t frame = begin; frame < end; ++frame)
+    {
+      if (trace.frameTimes[frame] > targetFrameTime)
+        ++numMissed;
+    }
+    return numMissed;
+  }
+
+  uint32_t CountScaleChanges(const TraceResult& trace, uint32_t begin, uint32_t end)
+  {
+    uint32_t numChanges = 0;
+    for (uint32_t frame = begin + 1; frame < end; ++frame)
+    {
+      if (trace.scales[frame] != trace.scales[frame - 1])
+        ++numChanges;
+    }
+    return numChanges;
+  }
+}
+
+DX12_TEST(DynamicResolution_LightContentStaysAtFullResolution)
+{
+  DynamicResolutionController controller;
+  const TraceResult trace = RunTrace(controller, 1000, [](uint32_t) { return 8.0f; });
+
+  DX12_EXPECT_EQ(controller.GetScale(), 1.0f);
+  DX12_EXPECT_EQ(controller.NumAdjustments(), 0u);
+  DX12_EXPECT_EQ(CountMissedFrames(trace, controller.GetSettings().targetFrameTime, 0, 1000), 0u);
+}
+
+DX12_TEST(DynamicResolution_HeavyContentSettlesWithoutOscillating)
+{
+  // 30ms at full resolution has to drop to about sqrt((15 - 2) / 28) = 0.68 to fit the aimed 15ms:
+  DynamicResolutionController controller;
+  const TraceResult trace = RunTrace(controller, 2000, [](uint32_t) { return 28.0f; });
+  const float targetFrameTime = controller.GetSettings().targetFrameTime;
+
+  DX12_EXPECT(controller.GetScale() > 0.64f && controller.GetScale() < 0.72f);
+  DX12_EXPECT(controller.NumAdjustments() < 10u);
+  DX12_EXPECT_EQ(CountScaleChanges(trace, 100, 2000), 0u);
+  DX12_EXPECT_EQ(CountMissedFrames(trace, targetFrameTime, 100, 2000), 0u);
+}
+
+DX12_TEST(DynamicResolution_NoisyTimingsAreDamped)
+{
+  // Noise of a few percent of the frame time stays within the hysteresis band once settled:
+  DynamicResolutionController controller;
+  const TraceResult trace = RunTrace(controller, 4000, [](uint32_t) { return 28.0f; }, 0.5f);
+
+  DX12_EXPECT(controller.GetScale() > 0.62f && controller.GetScale() < 0.72f);
+  DX12_EXPECT_EQ(CountScaleChanges(trace, 2000, 4000), 0u);
+  DX12_EXPECT_EQ(CountMissedFrames(trace, controller.GetSettings().targetFrameTime, 2000, 4000), 0u);
+}
+
+DX12_TEST(DynamicResolution_SingleSlowFrameBelowBudgetIsDamped)
+{
+  DynamicResolutionController controller;
+  for (uint32_t i = 0; i < 10; ++i)
+    controller.Update(12.0f);
+
+  // Above the aimed 15ms but within budget, smoothed away:
+  controller.Update(16.0f);
+  DX12_EXPECT_EQ(controller.GetScale(), 1.0f);
+  DX12_EXPECT(controller.GetSmoothedFrameTime() > 12.0f && controller.GetSmoothedFrameTime() < 16.0f);
+
+  // Over budget, acted on straight away however smooth the history:
+  controller.Update(20.0f);
+  DX12_EXPECT(controller.GetScale() < 1.0f);
+  DX12_EXPECT_EQ(controller.NumAdjustments(), 1u);
+}
+
+DX12_TEST(DynamicResolution_IgnoresSamplesFromBeforeChange)
+{
+  DynamicResolutionController controller;
+  controller.Update(30.0f);
+  const float scale = controller.GetScale();
+  DX12_EXPECT(scale < 1.0f);
+
+  // The frames already in flight were rendered at the old scale and would report the same overload:
+  for (uint32_t i = 0; i < controller.GetSettings().latencyFrames; ++i)
+    DX12_EXPECT_EQ(controller.Update(30.0f), scale);
+
+  DX12_EXPECT(controller.Update(30.0f) < scale);
+  DX12_EXPECT_EQ(controller.NumAdjustments(), 2u);
+}
+
+DX12_TEST(DynamicResolution_GrowsOnlyAfterSustainedHeadroom)
+{
+  // Without damping, so each sample is judged on its own:
+  DynamicResolutionSettings settings;
+  settings.smoothing = 1.0f;
+  settings.increaseDelayFrames = 30;
+  DynamicResolutionController controller(settings);
+  controller.Update(40.0f);
+  for (uint32_t i = 0; i < settings.latencyFrames; ++i)
+    controller.Update(40.0f);
+  const float scale = controller.GetScale();
+
+  // A frame back in the band restarts the count:
+  for (uint32_t i = 0; i < 29; ++i)
+    controller.Update(5.0f);
+  controller.Update(14.5f);
+  for (uint32_t i = 0; i < 29; ++i)
+    controller.Update(5.0f);
+  DX12_EXPECT_EQ(controller.GetScale(), scale);
+
+  // Then grows by at most one step:
+  controller.Update(5.0f);
+  DX12_EXPECT(controller.GetScale() > scale);
+  DX12_EXPECT(controller.GetScale() <= scale + settings.maxIncreaseStep + 1e-6f);
+}
+
+DX12_TEST(DynamicResolution_CostStepsOnlyMissFramesInLatencyWindow)
+{
+  // Content 3x heavier every other 500 frames:
+  DynamicResolutionController controller;
+  const uint32_t numFrames = 4000;
+  const TraceResult trace = RunTrace(controller, numFrames, [](uint32_t frame) {
+    return (frame / 500) % 2 ? 30.0f : 10.0f;
+    }, 0.3f);
+  const float targetFrameTime = controller.GetSettings().targetFrameTime;
+
+  // Frames already in flight when the cost goes up, and those rendered before their times come back, can
+  // miss; nothing after that:
+  const uint32_t reactionFrames = 4 * controller.GetSettings().latencyFrames;
+  for (uint32_t step = 500; step < numFrames; step += 500)
+  {
+    DX12_EXPECT(CountMissedFrames(trace, targetFrameTime, step, step + reactionFrames) <= reactionFrames);
+    DX12_EXPECT_EQ(CountMissedFrames(trace, targetFrameTime, step + reactionFrames, step + 500), 0u);
+  }
+
+  // Light phases get back to full resolution:
+  DX12_EXPECT_EQ(trace.scales[numFrames - 501], 1.0f);
+}
+
+DX12_TEST(DynamicResolution_ImpossibleContentClampsToMinimum)
+{
+  DynamicResolutionController controller;
+  RunTrace(controller, 1000, [](uint32_t) { return 200.0f; });
+  DX12_EXPECT_EQ(controller.GetScale(), controller.GetSettings().minScale);
+}
+
+DX12_TEST(DynamicResolution_RenderSize)
+{
+  DynamicResolutionController controller;
+  uint32_t width, height;
+  controller.GetRenderSize(1920, 1080, width, height);
+  DX12_EXPECT_EQ(width, 1920u);
+  DX12_EXPECT_EQ(height, 1080u);
+
+  controller.GetRenderSize(0, 0, width, height);
+  DX12_EXPECT_EQ(width, 1u);
+  DX12_EXPECT_EQ(height, 1u);
+
+  RunTrace(controller, 1000, [](uint32_t) { return 200.0f; });
+  controller.GetRenderSize(1920, 1080, width, height);
+  DX12_EXPECT_EQ(width, 960u);
+  DX12_EXPECT_EQ(height, 540u);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "AdapterSelection.h"
+
+#include <vector>
+
+// IAdapterProbe over a fixed list of adapters and the capabilities each reports when probed, counting
+// probes, which stand for the devices a real probe would create:
+class FakeAdapterProbe : public IAdapterProbe
+{
+public:
+	FakeAdapterProbe()
+		: m_numProbes(0)
+	{
+	}
+
+	uint32_t Add(const AdapterInfo& info, const AdapterCapabilities& capabilities)
+	{
+		m_adapters.push_back(info);
+		m_capabilities.push_back(capabilities);
+		return static_cast<uint32_t>(m_adapters.size() - 1);
+	}
+
+	AdapterInfo& Info(uint32_t adapterIndex) { return m_adapters[adapterIndex]; }
+	AdapterCapabilities& Capabilities(uint32_t adapterIndex) { return m_capabilities[adapterIndex]; }
+
+	const std::vector<AdapterInfo>& GetAdapters() override { return m_adapters; }
+
+	AdapterCapabilities ProbeCapabilities(uint32_t adapterIndex) override
+	{
+		++m_numProbes;
+		return m_capabilities[adapterIndex];
+	}
+
+	uint32_t NumProbes() const { return m_numProbes; }
+	void ResetNumProbes() { m_numProbes = 0; }
+
+private:
+	std::vector<AdapterInfo>					m_adapters;
+	std::vector<AdapterCapabilities>	m_capabilities;
+	uint32_t													m_numProbes;
+};
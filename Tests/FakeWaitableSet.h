@@ -0,0 +1,76 @@
+#pragma once
+
+#include "WaitableSet.h"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+// Scripted IWaitableSet: each Wait() returns the next scripted result instead of blocking, and records
+// what it was asked to wait on. A scripted signal names the handle rather than its index, so scripts don't
+// depend on the order the scheduler lists its handles in. Running out of script (or signalling a handle
+// that isn't being waited on) times out and is counted as unexpected.
+class FakeWaitableSet : public IWaitableSet
+{
+public:
+	struct Wakeup
+	{
+		WaitResult			result;
+		WaitableHandle	signalled;		// Signalled results only.
+	};
+
+	struct WaitCall
+	{
+		std::vector<WaitableHandle>	handles;
+		uint32_t										timeoutMs;
+
+		bool IsWaitingOn(WaitableHandle handle) const
+		{
+			return std::find(handles.begin(), handles.end(), handle) != handles.end();
+		}
+	};
+
+	FakeWaitableSet()
+		: m_numUnexpected(0)
+	{
+	}
+
+	void Signal(WaitableHandle handle) { m_script.push_back(Wakeup{ WaitResult::Signalled, handle }); }
+	void PostMessages() { m_script.push_back(Wakeup{ WaitResult::Messages, nullptr }); }
+	void TimeOut() { m_script.push_back(Wakeup{ WaitResult::Timeout, nullptr }); }
+
+	WaitResult Wait(const WaitableHandle* handles, uint32_t numHandles, uint32_t timeoutMs,
+		uint32_t& signalledIndex) override
+	{
+		m_calls.push_back(WaitCall{ std::vector<WaitableHandle>(handles, handles + numHandles), timeoutMs });
+		if (m_script.empty())
+		{
+			++m_numUnexpected;
+			return WaitResult::Timeout;
+		}
+
+		const Wakeup wakeup = m_script.front();
+		m_script.pop_front();
+		if (wakeup.result != WaitResult::Signalled)
+			return wakeup.result;
+
+		const WaitableHandle* handle = std::find(handles, handles + numHandles, wakeup.signalled);
+		if (handle == handles + numHandles)
+		{
+			++m_numUnexpected;
+			return WaitResult::Timeout;
+		}
+
+		signalledIndex = static_cast<uint32_t>(handle - handles);
+		return WaitResult::Signalled;
+	}
+
+	const WaitCall& LastCall() const { return m_calls.back(); }
+	size_t NumCalls() const { return m_calls.size(); }
+	uint32_t NumUnexpected() const { return m_numUnexpected; }
+
+private:
+	std::deque<Wakeup>		m_script;
+	std::vector<WaitCall>	m_calls;
+	uint32_t							m_numUnexpected;
+};
@@ -0,0 +1,45 @@
+#include "Test.h"
+#include "FencedPool.h"
+
+#include <memory>
+
+// FencedPool hands objects back in release order, each only once the fence has reached its value.
+
+DX12_TEST(FencedPool_AcquiresOnceFenceIsReached)
+{
+  FencedPool<int> pool;
+  int object = 0;
+  DX12_EXPECT(!pool.TryAcquire(~0ull, object));
+
+  pool.Release(1, 5);
+  pool.Release(2, 6);
+  pool.Release(3, 6);
+  DX12_EXPECT_EQ(pool.Size(), 3u);
+
+  DX12_EXPECT(!pool.TryAcquire(4, object));
+  DX12_EXPECT(pool.TryAcquire(5, object));
+  DX12_EXPECT_EQ(object, 1);
+  DX12_EXPECT(!pool.TryAcquire(5, object));
+
+  // Everything up to the completed value, oldest first:
+  DX12_EXPECT(pool.TryAcquire(9, object));
+  DX12_EXPECT_EQ(object, 2);
+  DX12_EXPECT(pool.TryAcquire(9, object));
+  DX12_EXPECT_EQ(object, 3);
+  DX12_EXPECT_EQ(pool.Size(), 0u);
+}
+
+DX12_TEST(FencedPool_MovesObjectsThrough)
+{
+  // As it does ComPtrs, without adding references:
+  FencedPool<std::shared_ptr<int>> pool;
+  std::shared_ptr<int> object = std::make_shared<int>(7);
+  const std::weak_ptr<int> weak = object;
+  pool.Release(std::move(object), 1);
+  DX12_EXPECT_EQ(weak.use_count(), 1);
+
+  std::shared_ptr<int> acquired;
+  DX12_EXPECT(pool.TryAcquire(1, acquired));
+  DX12_EXPECT_EQ(weak.use_count(), 1);
+  DX12_EXPECT_EQ(*acquired, 7);
+}
@@ -0,0 +1,171 @@
+#include "Test.h"
+#include "AllocationHook.h"
+#include "FrameArena.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// The transient CPU data of a frame out of FrameArenas never touches the global heap once the arenas
+// have grown to fit it, counted through the operator new AllocationHook.cpp replaces. The frame is the
+// FrameArena benchmark's, smaller: command lists recorded in parallel, each growing draw and barrier
+// lists one element at a time plus a debug name, then a parallel frustum cull with arena scratch.
+
+namespace
+{
+  const uint32_t c_numFramesInFlight = 3;
+  const uint32_t c_numCommandLists = 8;
+  const uint32_t c_drawsPerCommandList = 500;
+  const uint32_t c_barriersPerCommandList = 64;
+  const uint32_t c_numObjects = 16 * 1024;
+
+  struct DrawCommand
+  {
+    uint64_t sortKey;
+    uint32_t meshId;
+    uint32_t objectIndex;
+  };
+
+  struct Barrier
+  {
+    uint32_t resourceId;
+    uint32_t before;
+    uint32_t after;
+  };
+
+  CullingBounds MakeScene()
+  {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    const float extents[3] = { 1.0f, 1.0f, 1.0f };
+
+    CullingBounds bounds;
+    bounds.Reserve(c_numObjects);
+    for (uint32_t i = 0; i < c_numObjects; ++i)
+    {
+      const float center[3] = { position(random), position(random), position(random) };
+      bounds.Add(center, extents);
+    }
+    return bounds;
+  }
+
+  // Culling against the +Z half-space, about half the objects are visible:
+  Frustum MakeFrustum()
+  {
+    Frustum frustum = {};
+    frustum.planes[Frustum::Plane_Near][2] = 1.0f;
+    for (uint32_t plane = 0; plane < Frustum::Plane_Count; ++plane)
+    {
+      if (plane != Frustum::Plane_Near)
+        frustum.planes[plane][3] = 1000.0f;
+    }
+    return frustum;
+  }
+
+  uint64_t RecordCommandList(uint32_t commandListIndex, LinearArena* arena)
+  {
+    ArenaVector<DrawCommand> draws(arena);
+    ArenaVector<Barrier> barriers(arena);
+    for (uint32_t i = 0; i < c_drawsPerCommandList; ++i)
+      draws.push_back(DrawCommand{ (static_cast<uint64_t>(i) * 2654435761u) >> 8, i % 97, i });
+    for (uint32_t i = 0; i < c_barriersPerCommandList; ++i)
+      barriers.push_back(Barrier{ i, 1, 2 });
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%u", commandListIndex);
+    ArenaString name("Command list for the opaque pass of view ", arena);
+    name += buffer;
+
+    return draws.back().sortKey + barriers.size() + name.size();
+  }
+
+  // Each thread records into its own arena, or the heap if there are no arenas:
+  uint64_t BuildFrame(JobSystem& jobSystem, FrameArenas* frameArenas, const CullingBounds& scene,
+    std::vector<uint32_t>& visibleIndices)
+  {
+    std::atomic<uint64_t> checksum(0);
+    jobSystem.ParallelFor(c_numCommandLists, 1, [&](uint32_t begin, uint32_t end) {
+      LinearArena* arena = frameArenas ? &frameArenas->Get(jobSystem.CurrentThreadIndex()) : nullptr;
+      for (uint32_t i = begin; i < end; ++i)
+        checksum.fetch_add(RecordCommandList(i, arena), std::memory_order_relaxed);
+      });
+
+    LinearArena* arena = frameArenas ? &frameArenas->Get(jobSystem.CurrentThreadIndex()) : nullptr;
+    CullFrustumParallel(jobSystem, MakeFrustum(), scene, visibleIndices, GetBestCullingPath(), arena);
+    return checksum.load() + visibleIndices.size();
+  }
+
+  // Workers name themselves for the tracer as they start, which allocates, so counting waits until every
+  // thread has run a job. Each job holds its thread for a moment so the others get to take some:
+  void WaitForWorkersToStart(JobSystem& jobSystem)
+  {
+    std::vector<std::atomic<bool>> hasRunJob(jobSystem.NumThreads());
+    const auto hasRun = [](const std::atomic<bool>& flag) { return flag.load(); };
+    while (!std::all_of(hasRunJob.begin(), hasRunJob.end(), hasRun))
+    {
+      jobSystem.ParallelFor(jobSystem.NumThreads(), 1, [&](uint32_t /*begin*/, uint32_t /*end*/) {
+        hasRunJob[jobSystem.CurrentThreadIndex()].store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    }
+  }
+
+  // Heap allocations over numFrames frames, after a couple of rounds of frames in flight to warm up.
+  // Which thread records what changes from frame to frame, so the warm-up also has every thread's arena
+  // record the whole frame, which is as much as it can ever get:
+  uint64_t CountFrameAllocations(JobSystem& jobSystem, bool useArenas, uint32_t numFrames, uint64_t& checksum)
+  {
+    const CullingBounds scene = MakeScene();
+    FrameArenas frameArenas(c_numFramesInFlight, jobSystem.NumThreads());
+    FrameArenas* arenas = useArenas ? &frameArenas : nullptr;
+    std::vector<uint32_t> visibleIndices;
+
+    WaitForWorkersToStart(jobSystem);
+    uint32_t frameIndex = 0;
+    for (uint32_t i = 0; i < c_numFramesInFlight * 2; ++i, frameIndex = (frameIndex + 1) % c_numFramesInFlight)
+    {
+      frameArenas.BeginFrame(frameIndex);
+      if (useArenas && i < c_numFramesInFlight)
+      {
+        for (uint32_t thread = 0; thread < frameArenas.NumThreads(); ++thread)
+        {
+          for (uint32_t commandList = 0; commandList < c_numCommandLists; ++commandList)
+            RecordCommandList(commandList, &frameArenas.Get(thread));
+        }
+      }
+      checksum = BuildFrame(jobSystem, arenas, scene, visibleIndices);
+    }
+
+    const uint64_t numAllocationsBefore = GetNumHeapAllocations();
+    for (uint32_t i = 0; i < numFrames; ++i, frameIndex = (frameIndex + 1) % c_numFramesInFlight)
+    {
+      frameArenas.BeginFrame(frameIndex);
+      checksum = BuildFrame(jobSystem, arenas, scene, visibleIndices);
+    }
+    return GetNumHeapAllocations() - numAllocationsBefore;
+  }
+}
+
+DX12_TEST(FrameArenas_SteadyStateFrameDoesNotTouchHeap)
+{
+  const uint32_t numFrames = 20;
+  const uint32_t workerCounts[] = { 0, 3 };
+  for (uint32_t numWorkers : workerCounts)
+  {
+    JobSystem jobSystem(numWorkers);
+
+    // The same frame on the heap, so the hook is seen counting:
+    uint64_t heapChecksum = 0;
+    DX12_EXPECT(CountFrameAllocations(jobSystem, false, numFrames, heapChecksum) >= numFrames * c_numCommandLists);
+
+    uint64_t arenaChecksum = 0;
+    DX12_EXPECT_EQ(CountFrameAllocations(jobSystem, true, numFrames, arenaChecksum), 0u);
+    DX12_EXPECT_EQ(arenaChecksum, heapChecksum);
+  }
+}
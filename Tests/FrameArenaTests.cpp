@@ -0,0 +1,145 @@
+#include "Test.h"
+#include "FrameArena.h"
+
+#include <cstring>
+#include <functional>
+#include <map>
+
+// LinearArena's alignment, chunk growth and reuse across resets, STL containers living in one through
+// ArenaAllocator, and FrameArenas keeping each frame's data until its slot comes round again.
+
+namespace
+{
+  const size_t c_alignments[] = { 1, 2, 8, 16, 64, 256 };
+
+  bool IsAligned(const void* pointer, size_t alignment)
+  {
+    return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+  }
+
+  // Every allocation written over, so overlaps or allocations past a chunk's end show up under ASan:
+  void AllocateFrame(LinearArena& arena, TestContext& context)
+  {
+    for (size_t alignment : c_alignments)
+    {
+      void* allocation = arena.Allocate(37, alignment);
+      DX12_EXPECT(IsAligned(allocation, alignment));
+      std::memset(allocation, 0xab, 37);
+    }
+
+    // Bigger than a chunk, gets one of its own:
+    void* big = arena.Allocate(5000, 128);
+    DX12_EXPECT(IsAligned(big, 128));
+    std::memset(big, 0xcd, 5000);
+  }
+}
+
+DX12_TEST(LinearArena_AlignsAndReusesChunksAcrossResets)
+{
+  LinearArena arena(1024);
+  DX12_EXPECT_EQ(arena.GetStats().numChunks, 0u);
+
+  AllocateFrame(arena, context);
+  const LinearArenaStats first = arena.GetStats();
+  DX12_EXPECT(first.bytesAllocated >= 6 * 37 + 5000);
+  DX12_EXPECT(first.bytesReserved >= 1024 + 5000);
+  DX12_EXPECT_EQ(first.highWaterMark, first.bytesAllocated);
+
+  // The same workload again fits the chunks already there, at the same addresses:
+  for (uint32_t round = 0; round < 3; ++round)
+  {
+    arena.Reset();
+    DX12_EXPECT_EQ(arena.GetStats().bytesAllocated, 0u);
+
+    AllocateFrame(arena, context);
+    const LinearArenaStats stats = arena.GetStats();
+    DX12_EXPECT_EQ(stats.bytesAllocated, first.bytesAllocated);
+    DX12_EXPECT_EQ(stats.bytesReserved, first.bytesReserved);
+    DX12_EXPECT_EQ(stats.numChunks, first.numChunks);
+  }
+
+  // A lighter frame keeps the peak of the heavier ones:
+  arena.Reset();
+  arena.Allocate(16);
+  DX12_EXPECT_EQ(arena.GetStats().highWaterMark, first.bytesAllocated);
+}
+
+DX12_TEST(LinearArena_HostsStlContainers)
+{
+  LinearArena arena(1024);
+  for (uint32_t round = 0; round < 3; ++round)
+  {
+    ArenaVector<int> numbers(&arena);
+    for (int i = 0; i < 1000; ++i)
+      numbers.push_back(i);
+
+    std::map<int, int, std::less<int>, ArenaAllocator<std::pair<const int, int>>> squares(&arena);
+    for (int i = 0; i < 100; ++i)
+      squares[i] = i * i;
+
+    ArenaString text("a string too long for the small string buffer", &arena);
+    text += text;
+
+    bool isIntact = numbers.size() == 1000 && squares.size() == 100;
+    for (int i = 0; i < 1000 && isIntact; ++i)
+      isIntact = numbers[i] == i && (i >= 100 || squares[i] == i * i);
+    DX12_EXPECT(isIntact);
+    DX12_EXPECT_EQ(text.size(), 2 * 45u);
+    DX12_EXPECT(arena.GetStats().bytesAllocated >= 1000 * sizeof(int));
+
+    // Containers are gone before the arena's reset:
+    numbers = ArenaVector<int>(&arena);
+    squares.clear();
+    text = ArenaString(&arena);
+    arena.Reset();
+  }
+
+  // Without an arena, the heap:
+  ArenaVector<int> heapNumbers;
+  heapNumbers.assign(100, 7);
+  DX12_EXPECT_EQ(heapNumbers.get_allocator().GetArena(), static_cast<LinearArena*>(nullptr));
+  DX12_EXPECT_EQ(heapNumbers.back(), 7);
+  DX12_EXPECT(ArenaAllocator<int>(&arena) == ArenaAllocator<char>(&arena));
+  DX12_EXPECT(ArenaAllocator<int>(&arena) != ArenaAllocator<int>());
+}
+
+DX12_TEST(FrameArenas_KeepDataUntilSlotComesRound)
+{
+  const uint32_t numFrames = 3;
+  FrameArenas arenas(numFrames, 2, 4096);
+  uint8_t* frameData[numFrames] = {};
+
+  for (uint32_t frame = 0; frame < 9; ++frame)
+  {
+    const uint32_t frameIndex = frame % numFrames;
+    arenas.BeginFrame(frameIndex);
+
+    // The other frames in flight still have what they wrote:
+    for (uint32_t other = 1; other < numFrames && frame >= other; ++other)
+    {
+      const uint8_t* data = frameData[(frame - other) % numFrames];
+      const uint32_t size = 100 * (frame - other + 1);
+      bool isIntact = true;
+      for (uint32_t i = 0; i < size; ++i)
+        isIntact &= data[i] == static_cast<uint8_t>(frame - other);
+      DX12_EXPECT(isIntact);
+    }
+
+    frameData[frameIndex] = arenas.Get(0).AllocateArray<uint8_t>(100 * (frame + 1));
+    std::memset(frameData[frameIndex], static_cast<int>(frame), 100 * (frame + 1));
+    arenas.Get(1).Allocate(10);
+  }
+
+  // Frame 8 (900 + 10 bytes, plus alignment) is the biggest, one chunk per thread per frame:
+  const FrameArenaStats stats = arenas.GetStats();
+  DX12_EXPECT(stats.bytesAllocated >= 910 && stats.bytesAllocated < 910 + 2 * alignof(std::max_align_t));
+  DX12_EXPECT_EQ(stats.highWaterMark, stats.bytesAllocated);
+  DX12_EXPECT_EQ(stats.numChunks, numFrames * 2);
+  DX12_EXPECT_EQ(stats.bytesReserved, numFrames * 2 * 4096u);
+  DX12_EXPECT_EQ(arenas.NumThreads(), 2u);
+
+  // Its slot reset, the peak stays:
+  arenas.BeginFrame(2);
+  DX12_EXPECT_EQ(arenas.GetStats().bytesAllocated, 0u);
+  DX12_EXPECT_EQ(arenas.GetStats().highWaterMark, stats.highWaterMark);
+}
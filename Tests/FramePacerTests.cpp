@@ -0,0 +1,241 @@
+#include "Test.h"
+#include "FramePacer.h"
+#include "InputLatency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+// FramePacer's predictor on its own, then in a timeline simulation: a CPU thread with up to 3 frames in
+// flight feeding a single in-order GPU queue, with and without pacing. Latency is a frame's start to its
+// GPU completion, measured after a warm-up of a tenth of the frames. Then InputLatencyTracker's
+// correlation of inputs with frames.
+
+namespace
+{
+  const uint32_t c_maxFramesInFlight = 3;
+  const uint32_t c_numFrames = 4000;
+
+  struct SimulatedContent
+  {
+    double cpuUs;
+    double gpuUs;
+    double jitter;                          // Each time varies by up to this fraction either way.
+    uint32_t spikeInterval;                 // Every this many frames the GPU takes 3x as long, 0 for never.
+  };
+
+  struct SimulationResult
+  {
+    double meanLatencyMs;
+    double p99LatencyMs;
+    double framesPerSecond;
+  };
+
+  // Jitter from the raw generator output rather than a std distribution, whose results differ between
+  // standard libraries:
+  double Jitter(std::mt19937_64& random, double jitter)
+  {
+    const double unit = static_cast<double>(random() >> 11) * (1.0 / 9007199254740992.0);
+    return 1.0 + jitter * (2.0 * unit - 1.0);
+  }
+
+  SimulationResult Simulate(const SimulatedContent& content, bool isPaced)
+  {
+    struct Frame
+    {
+      uint64_t id;
+      uint64_t startUs;
+      uint64_t gpuStartUs;
+      uint64_t gpuEndUs;
+    };
+
+    std::mt19937_64 random(1);
+    FramePacer pacer;
+    std::deque<Frame> inFlight;
+    std::vector<double> latencies;
+    uint64_t nowUs = 0;
+    uint64_t gpuIdleUs = 0;
+
+    // GPU completions are only seen once they've happened:
+    auto reportCompletions = [&]() {
+      while (!inFlight.empty() && inFlight.front().gpuEndUs <= nowUs)
+      {
+        pacer.OnGpuFrameCompleted(inFlight.front().id, inFlight.front().gpuStartUs, inFlight.front().gpuEndUs);
+        inFlight.pop_front();
+      }
+    };
+
+    for (uint64_t frameId = 1; frameId <= c_numFrames; ++frameId)
+    {
+      if (inFlight.size() >= c_maxFramesInFlight)
+        nowUs = std::max(nowUs, inFlight.front().gpuEndUs);
+      reportCompletions();
+
+      if (isPaced)
+      {
+        nowUs = pacer.GetFrameStartTime(nowUs);
+        reportCompletions();
+      }
+
+      Frame frame = {};
+      frame.id = frameId;
+      frame.startUs = nowUs;
+      pacer.OnFrameStart(frameId, nowUs);
+
+      double gpuUs = content.gpuUs * Jitter(random, content.jitter);
+      if (content.spikeInterval && frameId % content.spikeInterval == 0)
+        gpuUs *= 3.0;
+
+      nowUs += static_cast<uint64_t>(content.cpuUs * Jitter(random, content.jitter));
+      pacer.OnFrameSubmitted(frameId, nowUs);
+
+      frame.gpuStartUs = std::max(nowUs, gpuIdleUs);
+      frame.gpuEndUs = frame.gpuStartUs + static_cast<uint64_t>(gpuUs);
+      gpuIdleUs = frame.gpuEndUs;
+      inFlight.push_back(frame);
+
+      if (frameId > c_numFrames / 10)
+        latencies.push_back(static_cast<double>(frame.gpuEndUs - frame.startUs));
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double totalLatency = 0.0;
+    for (double latency : latencies)
+      totalLatency += latency;
+
+    SimulationResult result;
+    result.meanLatencyMs = totalLatency / latencies.size() / 1000.0;
+    result.p99LatencyMs = latencies[latencies.size() * 99 / 100] / 1000.0;
+    result.framesPerSecond = c_numFrames / (gpuIdleUs / 1e6);
+    return result;
+  }
+
+  bool IsNear(float a, float b)
+  {
+    return std::fabs(a - b) < 1e-3f;
+  }
+}
+
+DX12_TEST(FramePacer_PredictsFromMeasuredTimes)
+{
+  FramePacer pacer;
+
+  // Nothing to go on yet, start now:
+  DX12_EXPECT_EQ(pacer.GetFrameStartTime(100), 100u);
+
+  pacer.OnFrameStart(1, 0);
+  pacer.OnFrameSubmitted(1, 2000);
+  pacer.OnGpuFrameCompleted(1, 2000, 12000);
+  DX12_EXPECT_EQ(pacer.GetCpuFrameTimeUs(), 2000.0f);
+  DX12_EXPECT_EQ(pacer.GetGpuFrameTimeUs(), 10000.0f);
+
+  // Frame 2 is predicted to finish at 24000, so frame 3 starts its CPU time and the 1000us margin before:
+  pacer.OnFrameStart(2, 12000);
+  pacer.OnFrameSubmitted(2, 14000);
+  DX12_EXPECT_EQ(pacer.PredictGpuIdleTime(14000), 24000u);
+  DX12_EXPECT_EQ(pacer.GetFrameStartTime(14000), 21000u);
+  DX12_EXPECT_EQ(pacer.GetFrameStartTime(23000), 23000u);
+
+  // A completion older than the latest doesn't move the prediction back:
+  pacer.OnGpuFrameCompleted(2, 14000, 24000);
+  pacer.OnGpuFrameCompleted(1, 2000, 12000);
+  DX12_EXPECT_EQ(pacer.PredictGpuIdleTime(0), 24000u);
+
+  // Idle already, start now:
+  DX12_EXPECT_EQ(pacer.PredictGpuIdleTime(30000), 30000u);
+  DX12_EXPECT_EQ(pacer.GetFrameStartTime(30000), 30000u);
+
+  pacer.Reset();
+  DX12_EXPECT_EQ(pacer.GetFrameStartTime(40000), 40000u);
+}
+
+DX12_TEST(FramePacer_GpuBoundHalvesLatency)
+{
+  // 4ms CPU, 12ms GPU: unpaced, frames queue up behind 3 in flight for about 36ms; paced, a frame only
+  // waits for its own CPU and GPU time plus the margin:
+  const SimulatedContent content = { 4000.0, 12000.0, 0.05, 0 };
+  const SimulationResult unpaced = Simulate(content, false);
+  const SimulationResult paced = Simulate(content, true);
+
+  DX12_EXPECT(unpaced.meanLatencyMs > 35.0 && unpaced.meanLatencyMs < 37.0);
+  DX12_EXPECT(paced.meanLatencyMs > 16.0 && paced.meanLatencyMs < 18.0);
+  DX12_EXPECT(paced.p99LatencyMs < unpaced.p99LatencyMs * 0.55);
+  DX12_EXPECT(paced.framesPerSecond >= unpaced.framesPerSecond * 0.99);
+}
+
+DX12_TEST(FramePacer_CpuBoundIsUnaffected)
+{
+  // Nothing queues on the GPU, there's nothing for pacing to take out:
+  const SimulatedContent content = { 12000.0, 6000.0, 0.1, 0 };
+  const SimulationResult unpaced = Simulate(content, false);
+  const SimulationResult paced = Simulate(content, true);
+
+  DX12_EXPECT(std::fabs(paced.meanLatencyMs - unpaced.meanLatencyMs) < 0.1);
+  DX12_EXPECT(std::fabs(paced.framesPerSecond - unpaced.framesPerSecond) < unpaced.framesPerSecond * 0.01);
+}
+
+DX12_TEST(FramePacer_NoisyContentKeepsThroughput)
+{
+  // Mispredictions leave the GPU idle now and then, which costs a little frame rate (4% with 30% noise)
+  // but never latency:
+  const SimulatedContent contents[] = {
+    { 4000.0, 12000.0, 0.3, 0 },            // GPU bound, noisy.
+    { 4000.0, 12000.0, 0.1, 50 },           // GPU bound, 3x spikes.
+    { 8000.0, 8000.0, 0.1, 0 },             // Balanced.
+  };
+
+  for (const SimulatedContent& content : contents)
+  {
+    const SimulationResult unpaced = Simulate(content, false);
+    const SimulationResult paced = Simulate(content, true);
+
+    DX12_EXPECT(paced.framesPerSecond >= unpaced.framesPerSecond * 0.95);
+    DX12_EXPECT(paced.meanLatencyMs <= unpaced.meanLatencyMs);
+  }
+}
+
+DX12_TEST(InputLatency_CorrelatesInputsWithFrames)
+{
+  InputLatencyTracker tracker;
+
+  // Two inputs before frame 1 starts, one while it's being recorded (so it goes to frame 2):
+  tracker.RecordInput(100);
+  tracker.RecordInput(600);
+  tracker.OnFrameStart(1, 1000);
+  tracker.RecordInput(1500);
+  tracker.OnPresent(1, 3000);
+  tracker.OnFrameStart(2, 4000);
+  tracker.OnPresent(2, 5000);
+  tracker.OnDisplayed(1, 10000);
+  tracker.OnDisplayed(2, 20000);
+  tracker.OnDisplayed(2, 30000);            // Already retired, ignored.
+
+  const LatencyPercentiles toStart = tracker.GetInputToFrameStart().GetPercentiles();
+  DX12_EXPECT_EQ(toStart.numSamples, 3u);
+  DX12_EXPECT(IsNear(toStart.max, 2.5f));
+
+  const LatencyPercentiles toPresent = tracker.GetInputToPresent().GetPercentiles();
+  DX12_EXPECT_EQ(toPresent.numSamples, 3u);
+  DX12_EXPECT(IsNear(toPresent.max, 3.5f));
+
+  const LatencyPercentiles toDisplay = tracker.GetInputToDisplay().GetPercentiles();
+  DX12_EXPECT_EQ(toDisplay.numSamples, 3u);
+  DX12_EXPECT(IsNear(toDisplay.max, 18.5f));
+}
+
+DX12_TEST(InputLatency_HistoryKeepsLatestSamples)
+{
+  LatencyHistory history(100);
+  for (uint32_t i = 1; i <= 200; ++i)
+    history.Add(i * 1000);
+
+  // Only 101..200ms are left:
+  const LatencyPercentiles percentiles = history.GetPercentiles();
+  DX12_EXPECT_EQ(percentiles.numSamples, 100u);
+  DX12_EXPECT(IsNear(percentiles.p50, 150.0f));
+  DX12_EXPECT(IsNear(percentiles.p90, 190.0f));
+  DX12_EXPECT(IsNear(percentiles.p99, 199.0f));
+  DX12_EXPECT(IsNear(percentiles.max, 200.0f));
+}
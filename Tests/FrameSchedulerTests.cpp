@@ -0,0 +1,242 @@
+#include "Test.h"
+#include "FakeWaitableSet.h"
+#include "FrameScheduler.h"
+
+// FrameScheduler driven by a scripted waitable set: what each RunOnce() waits on and with what timeout,
+// and what it does with the wakeup it gets.
+
+namespace
+{
+  // Only compared, never waited on for real:
+  int s_frameLatency;
+  int s_fenceEvent;
+  int s_pacingTimer;
+
+  WaitableHandle FrameLatencyWaitable() { return &s_frameLatency; }
+  WaitableHandle FenceEvent() { return &s_fenceEvent; }
+  WaitableHandle PacingTimer() { return &s_pacingTimer; }
+
+  struct SchedulerCalls
+  {
+    int numPumps = 0;
+    int numFrames = 0;
+    int numPolls = 0;
+    int numPaced = 0;
+    bool shouldQuit = false;
+    bool shouldResume = false;
+    bool shouldPace = false;
+  };
+
+  FrameScheduler::Callbacks MakeCallbacks(SchedulerCalls& calls)
+  {
+    FrameScheduler::Callbacks callbacks;
+    callbacks.pumpMessages = [&calls]() { ++calls.numPumps; return !calls.shouldQuit; };
+    callbacks.renderFrame = [&calls]() { ++calls.numFrames; };
+    callbacks.pollPaused = [&calls]() { ++calls.numPolls; return calls.shouldResume; };
+    callbacks.paceFrame = [&calls]() { ++calls.numPaced; return calls.shouldPace; };
+    return callbacks;
+  }
+}
+
+DX12_TEST(FrameScheduler_RendersWhenSwapChainAcceptsFrame)
+{
+  FakeWaitableSet waitableSet;
+  SchedulerCalls calls;
+  FrameScheduler scheduler(waitableSet, MakeCallbacks(calls));
+  scheduler.SetFrameLatencyWaitable(FrameLatencyWaitable());
+
+  // Sleeps on the swap chain rather than polling it:
+  waitableSet.Signal(FrameLatencyWaitable());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().IsWaitingOn(FrameLatencyWaitable()));
+  DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, g_waitInfinite);
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+
+  // Messages are handed to the pump, which decides when to quit:
+  waitableSet.PostMessages();
+  DX12_EXPECT(scheduler.RunOnce());
+  calls.shouldQuit = true;
+  waitableSet.PostMessages();
+  DX12_EXPECT(!scheduler.RunOnce());
+  DX12_EXPECT_EQ(calls.numPumps, 2);
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+
+  DX12_EXPECT_EQ(scheduler.GetStats().framesRendered, 1u);
+  DX12_EXPECT_EQ(scheduler.GetStats().messageWakeups, 2u);
+  DX12_EXPECT_EQ(waitableSet.NumUnexpected(), 0u);
+}
+
+DX12_TEST(FrameScheduler_WithoutLatencyWaitableRendersImmediately)
+{
+  FakeWaitableSet waitableSet;
+  SchedulerCalls calls;
+  FrameScheduler scheduler(waitableSet, MakeCallbacks(calls));
+
+  // Only checks for messages before starting the frame:
+  waitableSet.TimeOut();
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, 0u);
+  DX12_EXPECT(waitableSet.LastCall().handles.empty());
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+}
+
+DX12_TEST(FrameScheduler_FrameGateHoldsBackFrame)
+{
+  FakeWaitableSet waitableSet;
+  SchedulerCalls calls;
+  FrameScheduler scheduler(waitableSet, MakeCallbacks(calls));
+  scheduler.SetFrameLatencyWaitable(FrameLatencyWaitable());
+  scheduler.AddFrameGate(FenceEvent());
+
+  // The latency waitable isn't waited on until the gate opens, waiting on it would consume its frame:
+  waitableSet.Signal(FenceEvent());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().IsWaitingOn(FenceEvent()));
+  DX12_EXPECT(!waitableSet.LastCall().IsWaitingOn(FrameLatencyWaitable()));
+  DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, g_waitInfinite);
+  DX12_EXPECT_EQ(calls.numFrames, 0);
+  DX12_EXPECT_EQ(scheduler.GetStats().gateWakeups, 1u);
+
+  // Once it has, the gate is forgotten and the frame waits for the swap chain:
+  waitableSet.Signal(FrameLatencyWaitable());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(!waitableSet.LastCall().IsWaitingOn(FenceEvent()));
+  DX12_EXPECT(waitableSet.LastCall().IsWaitingOn(FrameLatencyWaitable()));
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+
+  // Gates are waited on even while paused, so a frame's fence isn't missed:
+  scheduler.AddFrameGate(FenceEvent());
+  scheduler.SetPaused(true);
+  waitableSet.Signal(FenceEvent());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().IsWaitingOn(FenceEvent()));
+  DX12_EXPECT_EQ(scheduler.GetStats().gateWakeups, 2u);
+  DX12_EXPECT_EQ(waitableSet.NumUnexpected(), 0u);
+}
+
+DX12_TEST(FrameScheduler_PausedOnlyPollsForResume)
+{
+  FakeWaitableSet waitableSet;
+  SchedulerCalls calls;
+  FrameScheduler scheduler(waitableSet, MakeCallbacks(calls));
+  scheduler.SetFrameLatencyWaitable(FrameLatencyWaitable());
+  scheduler.SetPaused(true, 100);
+
+  // Waits for messages or the poll interval, not for the swap chain:
+  waitableSet.TimeOut();
+  waitableSet.PostMessages();
+  waitableSet.TimeOut();
+  for (int i = 0; i < 3; ++i)
+  {
+    DX12_EXPECT(scheduler.RunOnce());
+    DX12_EXPECT(!waitableSet.LastCall().IsWaitingOn(FrameLatencyWaitable()));
+    DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, 100u);
+  }
+  DX12_EXPECT_EQ(calls.numPolls, 2);
+  DX12_EXPECT_EQ(calls.numFrames, 0);
+  DX12_EXPECT(scheduler.IsPaused());
+
+  // A poll that says rendering can resume unpauses it:
+  calls.shouldResume = true;
+  waitableSet.TimeOut();
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(!scheduler.IsPaused());
+
+  waitableSet.Signal(FrameLatencyWaitable());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, g_waitInfinite);
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+
+  // Without a poll interval a paused scheduler only wakes for messages:
+  scheduler.SetPaused(true);
+  waitableSet.PostMessages();
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, g_waitInfinite);
+  DX12_EXPECT(waitableSet.LastCall().handles.empty());
+
+  DX12_EXPECT_EQ(scheduler.GetStats().timeoutWakeups, 3u);
+  DX12_EXPECT_EQ(waitableSet.NumUnexpected(), 0u);
+}
+
+DX12_TEST(FrameScheduler_OnDemandRendersOnlyRequestedFrames)
+{
+  FakeWaitableSet waitableSet;
+  SchedulerCalls calls;
+  FrameScheduler scheduler(waitableSet, MakeCallbacks(calls));
+  scheduler.SetFrameLatencyWaitable(FrameLatencyWaitable());
+  scheduler.SetContinuousRendering(false);
+
+  // Idle, nothing but messages is waited on and nothing is rendered:
+  waitableSet.PostMessages();
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().handles.empty());
+  DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, g_waitInfinite);
+  DX12_EXPECT_EQ(calls.numFrames, 0);
+
+  // A request renders one frame, however many times it's made:
+  scheduler.RequestFrame();
+  scheduler.RequestFrame();
+  waitableSet.Signal(FrameLatencyWaitable());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().IsWaitingOn(FrameLatencyWaitable()));
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+
+  waitableSet.PostMessages();
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().handles.empty());
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+
+  // Requests made while paused wait for the scheduler to resume:
+  scheduler.SetPaused(true);
+  scheduler.RequestFrame();
+  waitableSet.PostMessages();
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().handles.empty());
+
+  scheduler.SetPaused(false);
+  waitableSet.Signal(FrameLatencyWaitable());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT_EQ(calls.numFrames, 2);
+  DX12_EXPECT_EQ(waitableSet.NumUnexpected(), 0u);
+}
+
+DX12_TEST(FrameScheduler_PacedFrameWaitsForPacingWaitable)
+{
+  FakeWaitableSet waitableSet;
+  SchedulerCalls calls;
+  FrameScheduler scheduler(waitableSet, MakeCallbacks(calls));
+  scheduler.SetFrameLatencyWaitable(FrameLatencyWaitable());
+  scheduler.SetPacingWaitable(PacingTimer());
+  calls.shouldPace = true;
+
+  // The frame the swap chain accepted is held back, not rendered:
+  waitableSet.Signal(FrameLatencyWaitable());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT_EQ(calls.numPaced, 1);
+  DX12_EXPECT_EQ(calls.numFrames, 0);
+
+  // Messages are handled while it waits, and the latency waitable isn't consumed again:
+  waitableSet.PostMessages();
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT(waitableSet.LastCall().IsWaitingOn(PacingTimer()));
+  DX12_EXPECT(!waitableSet.LastCall().IsWaitingOn(FrameLatencyWaitable()));
+  DX12_EXPECT_EQ(calls.numPumps, 1);
+
+  // It's rendered once the timer fires, even if paused in the meantime:
+  scheduler.SetPaused(true, 100);
+  waitableSet.Signal(PacingTimer());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT_EQ(waitableSet.LastCall().timeoutMs, g_waitInfinite);
+  DX12_EXPECT_EQ(calls.numFrames, 1);
+  DX12_EXPECT_EQ(calls.numPaced, 1);
+
+  // A frame paceFrame doesn't hold back renders straight away:
+  scheduler.SetPaused(false);
+  calls.shouldPace = false;
+  waitableSet.Signal(FrameLatencyWaitable());
+  DX12_EXPECT(scheduler.RunOnce());
+  DX12_EXPECT_EQ(calls.numFrames, 2);
+
+  DX12_EXPECT_EQ(scheduler.GetStats().pacedFrames, 1u);
+  DX12_EXPECT_EQ(waitableSet.NumUnexpected(), 0u);
+}
@@ -0,0 +1,290 @@
+#include "Test.h"
+#include "FrustumCulling.h"
+#include "HiZOcclusion.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// HiZ occlusion culling on the CPU: pyramid levels of odd sizes keeping the farthest depth beneath them
+// (checked with SSE here and with the scalar path in Dx12ScalarTests), boxes tested against depth
+// planes, with holes, and where the answer has to be "not occluded" whatever the depth, and the two
+// phases of OcclusionCuller handing over exactly the objects that became visible.
+
+namespace
+{
+  const uint32_t c_width = 67;
+  const uint32_t c_height = 45;
+  const float c_nearZ = 0.1f;
+  const float c_farZ = 1000.0f;
+
+  // 90 degree perspective, camera at the origin looking down +z (row-vector, D3D depth), as the
+  // benchmark's:
+  const float c_xScale = static_cast<float>(c_height) / c_width;
+  const float c_q = c_farZ / (c_farZ - c_nearZ);
+  const float c_viewProjection[16] = {
+    c_xScale, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, c_q, 1.0f,
+    0.0f, 0.0f, -c_q * c_nearZ, 0.0f,
+  };
+
+  float ToDepth(float viewZ)
+  {
+    return c_q - c_q * c_nearZ / viewZ;
+  }
+
+  std::vector<float> MakeRandomDepth(uint32_t width, uint32_t height)
+  {
+    std::mt19937 random(width * 1000 + height);
+    std::vector<float> depth(static_cast<size_t>(width) * height);
+    for (float& value : depth)
+      value = static_cast<float>(random() >> 8) * (1.0f / 16777216.0f);
+    return depth;
+  }
+
+  // A wall at viewZ, with the pixels in [x0, x1) x [y0, y1) showing the far plane:
+  std::vector<float> MakeWall(float viewZ, uint32_t x0 = 0, uint32_t x1 = 0, uint32_t y0 = 0, uint32_t y1 = 0)
+  {
+    std::vector<float> depth(static_cast<size_t>(c_width) * c_height);
+    for (uint32_t y = 0; y < c_height; ++y)
+    {
+      for (uint32_t x = 0; x < c_width; ++x)
+      {
+        const bool isHole = x >= x0 && x < x1 && y >= y0 && y < y1;
+        depth[static_cast<size_t>(y) * c_width + x] = isHole ? 1.0f : ToDepth(viewZ);
+      }
+    }
+    return depth;
+  }
+
+  // A box at a point on screen (NDC) and view depth:
+  struct Box
+  {
+    float center[3];
+    float extents[3];
+  };
+
+  Box MakeBoxAt(float ndcX, float ndcY, float viewZ, float extent)
+  {
+    return { { ndcX * viewZ / c_xScale, ndcY * viewZ, viewZ }, { extent, extent, extent } };
+  }
+}
+
+DX12_TEST(HiZPyramid_OddLevelsKeepFarthestDepth)
+{
+  const uint32_t sizes[][2] = { { 1, 1 }, { 13, 7 }, { 67, 45 }, { 40, 1 }, { 1, 33 }, { 37, 19 } };
+  for (const uint32_t* size : sizes)
+  {
+    const uint32_t width = size[0], height = size[1];
+    const std::vector<float> depth = MakeRandomDepth(width, height);
+    HiZPyramid pyramid;
+    pyramid.Build(depth.data(), width, height);
+
+    // Halving rounding up, down to a single texel:
+    uint32_t numLevels = 1;
+    while ((width - 1) >> (numLevels - 1) || (height - 1) >> (numLevels - 1))
+      ++numLevels;
+    DX12_EXPECT_EQ(pyramid.NumLevels(), numLevels);
+    DX12_EXPECT(pyramid.GetWidth(pyramid.NumLevels() - 1) == 1 && pyramid.GetHeight(pyramid.NumLevels() - 1) == 1);
+
+    // Each texel against the level 0 pixels it covers, clipped to the image:
+    uint32_t numWrongSizes = 0;
+    uint32_t numWrongTexels = 0;
+    for (uint32_t level = 0; level < pyramid.NumLevels(); ++level)
+    {
+      const uint32_t levelWidth = pyramid.GetWidth(level), levelHeight = pyramid.GetHeight(level);
+      numWrongSizes += levelWidth != ((width - 1) >> level) + 1 || levelHeight != ((height - 1) >> level) + 1;
+
+      for (uint32_t y = 0; y < levelHeight; ++y)
+      {
+        for (uint32_t x = 0; x < levelWidth; ++x)
+        {
+          float maxDepth = 0.0f;
+          for (uint32_t y0 = y << level; y0 < std::min((y + 1) << level, height); ++y0)
+          {
+            for (uint32_t x0 = x << level; x0 < std::min((x + 1) << level, width); ++x0)
+              maxDepth = std::max(maxDepth, depth[static_cast<size_t>(y0) * width + x0]);
+          }
+          numWrongTexels += pyramid.GetLevel(level)[static_cast<size_t>(y) * levelWidth + x] != maxDepth;
+        }
+      }
+    }
+    DX12_EXPECT_EQ(numWrongSizes, 0u);
+    DX12_EXPECT_EQ(numWrongTexels, 0u);
+  }
+}
+
+DX12_TEST(HiZPyramid_DownsampleMatchesScalarLoop)
+{
+  // Every width up to a few SIMD blocks, so each count of 2x2 blocks left after them is covered, even and
+  // odd heights. Each level has to be exactly the scalar 2x2 max of the one below, clamped at odd edges:
+  uint32_t numMismatches = 0;
+  for (uint32_t width = 1; width <= 40; ++width)
+  {
+    for (uint32_t height = 1; height <= 3; ++height)
+    {
+      const std::vector<float> depth = MakeRandomDepth(width, height);
+      HiZPyramid pyramid;
+      pyramid.Build(depth.data(), width, height);
+
+      for (uint32_t level = 1; level < pyramid.NumLevels(); ++level)
+      {
+        const float* source = pyramid.GetLevel(level - 1);
+        const uint32_t sourceWidth = pyramid.GetWidth(level - 1), sourceHeight = pyramid.GetHeight(level - 1);
+        for (uint32_t y = 0; y < pyramid.GetHeight(level); ++y)
+        {
+          const uint32_t y0 = 2 * y, y1 = std::min(2 * y + 1, sourceHeight - 1);
+          for (uint32_t x = 0; x < pyramid.GetWidth(level); ++x)
+          {
+            const uint32_t x0 = 2 * x, x1 = std::min(2 * x + 1, sourceWidth - 1);
+            const float expected = std::max(
+              std::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+              std::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+            numMismatches += pyramid.GetLevel(level)[y * pyramid.GetWidth(level) + x] != expected;
+          }
+        }
+      }
+    }
+  }
+  DX12_EXPECT_EQ(numMismatches, 0u);
+}
+
+DX12_TEST(HiZPyramid_OccludesBoxesBehindDepth)
+{
+  // A wall 50 units away with a 3x3 hole around the middle of the screen:
+  const std::vector<float> depth = MakeWall(50.0f, 32, 35, 21, 24);
+  HiZPyramid pyramid;
+  DX12_EXPECT(pyramid.IsEmpty());
+  pyramid.Build(depth.data(), c_width, c_height);
+
+  struct Case
+  {
+    Box box;
+    bool isOccluded;
+  };
+
+  const Case cases[] = {
+    { MakeBoxAt(0.4f, 0.3f, 100.0f, 1.0f), true },      // Behind the wall.
+    { MakeBoxAt(0.4f, 0.3f, 20.0f, 1.0f), false },      // In front of it.
+    { MakeBoxAt(0.4f, 0.3f, 50.0f, 5.0f), false },      // Through it.
+    { MakeBoxAt(0.0f, 0.0f, 100.0f, 1.0f), false },     // Behind, but seen through the hole.
+    { MakeBoxAt(-0.9f, -0.9f, 100.0f, 1.0f), true },    // In a corner, where the coarse levels are clamped.
+    { { { 0.0f, 0.0f, 200.0f }, { 500.0f, 500.0f, 1.0f } }, false },  // Bigger than the screen, over the hole.
+  };
+
+  // Through CullOcclusion, which has to split the objects the same way, keeping their order:
+  CullingBounds bounds;
+  std::vector<uint32_t> indices;
+  for (const Case& testCase : cases)
+  {
+    DX12_EXPECT_EQ(pyramid.IsOccluded(testCase.box.center, testCase.box.extents, c_viewProjection),
+      testCase.isOccluded);
+    indices.push_back(bounds.Add(testCase.box.center, testCase.box.extents));
+  }
+
+  const uint32_t count = static_cast<uint32_t>(indices.size());
+  std::vector<uint32_t> visible(count), occluded(count);
+  uint32_t numOccluded = 0;
+  const uint32_t numVisible = CullOcclusion(pyramid, c_viewProjection, bounds, indices.data(), count,
+    visible.data(), occluded.data(), numOccluded);
+  DX12_EXPECT_EQ(numVisible, 4u);
+  DX12_EXPECT_EQ(numOccluded, 2u);
+  DX12_EXPECT(visible[0] == 1 && visible[1] == 2 && visible[2] == 3 && visible[3] == 5);
+  DX12_EXPECT(occluded[0] == 0 && occluded[1] == 4);
+}
+
+DX12_TEST(HiZPyramid_NeverOccludesNearPlaneOrOffScreenBoxes)
+{
+  // Depth at the near plane everywhere hides anything properly in view:
+  const std::vector<float> depth(static_cast<size_t>(c_width) * c_height, 0.0f);
+  HiZPyramid pyramid;
+  pyramid.Build(depth.data(), c_width, c_height);
+
+  const Box hidden = MakeBoxAt(0.0f, 0.0f, 100.0f, 1.0f);
+  DX12_EXPECT(pyramid.IsOccluded(hidden.center, hidden.extents, c_viewProjection));
+
+  // Partly off screen, only the part on it counts:
+  const Box partly = MakeBoxAt(1.0f, 0.0f, 100.0f, 10.0f);
+  DX12_EXPECT(pyramid.IsOccluded(partly.center, partly.extents, c_viewProjection));
+
+  const Box neverOccluded[] = {
+    MakeBoxAt(0.0f, 0.0f, 0.5f, 1.0f),        // Crossing the near plane.
+    MakeBoxAt(0.0f, 0.0f, 0.5f, 0.45f),       // Only just crossing it.
+    { { 0.0f, 0.0f, -100.0f }, { 1.0f, 1.0f, 1.0f } },   // Behind the camera.
+    MakeBoxAt(3.0f, 0.0f, 100.0f, 1.0f),      // Off each side of the screen.
+    MakeBoxAt(-3.0f, 0.0f, 100.0f, 1.0f),
+    MakeBoxAt(0.0f, 3.0f, 100.0f, 1.0f),
+    MakeBoxAt(0.0f, -3.0f, 100.0f, 1.0f),
+  };
+  for (const Box& box : neverOccluded)
+    DX12_EXPECT(!pyramid.IsOccluded(box.center, box.extents, c_viewProjection));
+
+  // Nor is anything without a pyramid:
+  DX12_EXPECT(!HiZPyramid().IsOccluded(hidden.center, hidden.extents, c_viewProjection));
+}
+
+DX12_TEST(OcclusionCuller_Phase2ReturnsObjectsThatBecameVisible)
+{
+  // Boxes over the screen, behind a wall at 50 (even indices) and in front of it (odd ones):
+  CullingBounds bounds;
+  std::vector<uint32_t> candidates;
+  const float screenX[] = { -0.75f, -0.25f, 0.25f, 0.75f };
+  const float screenY[] = { -0.5f, 0.5f };
+  for (float y : screenY)
+  {
+    for (float x : screenX)
+    {
+      for (float viewZ : { 100.0f, 20.0f })
+      {
+        const Box box = MakeBoxAt(x, y, viewZ, 2.0f);
+        candidates.push_back(bounds.Add(box.center, box.extents));
+      }
+    }
+  }
+  const uint32_t count = static_cast<uint32_t>(candidates.size());
+
+  // First frame, without a previous frame everything's drawn in phase 1:
+  OcclusionCuller culler;
+  DX12_EXPECT(culler.CullPhase1(bounds, candidates.data(), count) == candidates);
+  const std::vector<float> wall = MakeWall(50.0f);
+  DX12_EXPECT(culler.CullPhase2(bounds, c_viewProjection, wall.data(), c_width, c_height).empty());
+  DX12_EXPECT(!culler.GetPyramid().IsEmpty());
+
+  // Second frame, last frame's wall rejects the boxes behind it, then the wall's left half is gone:
+  const std::vector<uint32_t> phase1 = culler.CullPhase1(bounds, candidates.data(), count);
+  std::vector<uint32_t> rejected;
+  for (uint32_t index : candidates)
+  {
+    if (std::find(phase1.begin(), phase1.end(), index) == phase1.end())
+      rejected.push_back(index);
+  }
+  DX12_EXPECT_EQ(phase1.size(), count / 2);
+  DX12_EXPECT_EQ(rejected.size(), count / 2);
+
+  const std::vector<float> halfWall = MakeWall(50.0f, 0, c_width / 2, 0, c_height);
+  const std::vector<uint32_t> phase2 = culler.CullPhase2(bounds, c_viewProjection, halfWall.data(), c_width,
+    c_height);
+
+  // Exactly the rejected ones the new depth doesn't hide, in order: those on the left of the screen:
+  HiZPyramid current;
+  current.Build(halfWall.data(), c_width, c_height);
+  std::vector<uint32_t> expected;
+  for (uint32_t index : rejected)
+  {
+    const float center[3] = { bounds.CenterX()[index], bounds.CenterY()[index], bounds.CenterZ()[index] };
+    const float extents[3] = { bounds.ExtentX()[index], bounds.ExtentY()[index], bounds.ExtentZ()[index] };
+    if (!current.IsOccluded(center, extents, c_viewProjection))
+      expected.push_back(index);
+  }
+  DX12_EXPECT(phase2 == expected);
+  DX12_EXPECT(phase2 == std::vector<uint32_t>({ 0, 2, 8, 10 }));
+
+  // Third frame, only the boxes still behind the wall are rejected:
+  DX12_EXPECT_EQ(culler.CullPhase1(bounds, candidates.data(), count).size(), count - 4);
+
+  // And after a reset, nothing:
+  culler.Reset();
+  DX12_EXPECT(culler.GetPyramid().IsEmpty());
+  DX12_EXPECT_EQ(culler.CullPhase1(bounds, candidates.data(), count).size(), count);
+}
@@ -0,0 +1,214 @@
+#include "Test.h"
+#include "FrustumCulling.h"
+#include "IndirectCommands.h"
+#include "RootSignatureLayout.h"
+
+#include <cstring>
+
+// Command layouts built from known root signatures, and the bytes commands are packed into, checked against
+// what ExecuteIndirect expects: root arguments packed at 4 byte alignment in the order they were asked for,
+// then the D3D12_*_ARGUMENTS of the operation.
+
+namespace
+{
+  const uint32_t c_fillByte = 0xcd;
+
+  // Root constants (2 values), a root CBV, a root SRV and a descriptor table, with a binding in each:
+  RootSignatureLayout MakeRootLayout()
+  {
+    RootParameterDesc constants = {};
+    constants.type = RootParameterType::Constants;
+    constants.num32BitValues = 2;
+
+    RootParameterDesc cbv = {};
+    cbv.type = RootParameterType::CBV;
+
+    RootParameterDesc srv = {};
+    srv.type = RootParameterType::SRV;
+
+    RootParameterDesc table = {};
+    table.type = RootParameterType::DescriptorTable;
+
+    RootSignatureLayout layout;
+    layout.parameters = { constants, cbv, srv, table };
+    layout.bindingLocations = {
+      { "ObjectConstants", 0, 0 },
+      { "PerDraw", 1, 0 },
+      { "Instances", 2, 0 },
+      { "Albedo", 3, 0 },
+    };
+    return layout;
+  }
+
+  void ExpectBytes(TestContext& context, const std::vector<uint8_t>& command, const std::vector<uint8_t>& expected)
+  {
+    DX12_EXPECT_EQ(command.size(), expected.size());
+    for (size_t i = 0; i < command.size() && i < expected.size(); ++i)
+      DX12_EXPECT_EQ(static_cast<uint32_t>(command[i]), static_cast<uint32_t>(expected[i]));
+  }
+}
+
+DX12_TEST(IndirectCommands_ConstantsCbvDrawIndexedLayout)
+{
+  const IndirectCommandLayout layout = BuildIndirectCommandLayout(MakeRootLayout(), { "ObjectConstants", "PerDraw" },
+    IndirectArgumentType::DrawIndexed);
+
+  // Constants, then a GPU address, then D3D12_DRAW_INDEXED_ARGUMENTS (5 values):
+  DX12_EXPECT_EQ(layout.arguments.size(), 3u);
+  DX12_EXPECT(layout.arguments[0].type == IndirectArgumentType::Constant);
+  DX12_EXPECT_EQ(layout.arguments[0].rootIndex, 0u);
+  DX12_EXPECT_EQ(layout.arguments[0].num32BitValues, 2u);
+  DX12_EXPECT_EQ(layout.arguments[0].offsetInBytes, 0u);
+  DX12_EXPECT_EQ(layout.arguments[0].sizeInBytes, 8u);
+  DX12_EXPECT(layout.arguments[1].type == IndirectArgumentType::CBV);
+  DX12_EXPECT_EQ(layout.arguments[1].rootIndex, 1u);
+  DX12_EXPECT_EQ(layout.arguments[1].offsetInBytes, 8u);
+  DX12_EXPECT_EQ(layout.arguments[1].sizeInBytes, 8u);
+  DX12_EXPECT(layout.Operation() == IndirectArgumentType::DrawIndexed);
+  DX12_EXPECT_EQ(layout.GetOperationOffset(), 16u);
+  DX12_EXPECT_EQ(layout.arguments[2].sizeInBytes, 20u);
+  DX12_EXPECT_EQ(layout.byteStride, 36u);
+  DX12_EXPECT(layout.ChangesRootArguments());
+  DX12_EXPECT_EQ(layout.GetBindingOffset(0), 0);
+  DX12_EXPECT_EQ(layout.GetBindingOffset(1), 8);
+
+  std::vector<uint8_t> command(layout.byteStride, c_fillByte);
+  const uint32_t constants[] = { 0x11223344, 0x55667788 };
+  layout.WriteConstants(command.data(), 0, constants, 2);
+  layout.WriteAddress(command.data(), 1, 0x0000000123456780ull);
+  layout.WriteDrawIndexed(command.data(), IndirectDrawIndexedArguments{ 36, 1, 6, -2, 3 });
+
+  ExpectBytes(context, command, {
+    0x44, 0x33, 0x22, 0x11, 0x88, 0x77, 0x66, 0x55,     // Root constants.
+    0x80, 0x67, 0x45, 0x23, 0x01, 0x00, 0x00, 0x00,     // Root CBV address.
+    0x24, 0x00, 0x00, 0x00,                             // IndexCountPerInstance.
+    0x01, 0x00, 0x00, 0x00,                             // InstanceCount.
+    0x06, 0x00, 0x00, 0x00,                             // StartIndexLocation.
+    0xfe, 0xff, 0xff, 0xff,                             // BaseVertexLocation.
+    0x03, 0x00, 0x00, 0x00,                             // StartInstanceLocation.
+    });
+}
+
+DX12_TEST(IndirectCommands_ConstantsCbvDispatchLayout)
+{
+  // Bindings are packed in the order they're asked for, not root parameter order:
+  const IndirectCommandLayout layout = BuildIndirectCommandLayout(MakeRootLayout(), { "PerDraw", "ObjectConstants" },
+    IndirectArgumentType::Dispatch);
+
+  DX12_EXPECT_EQ(layout.arguments.size(), 3u);
+  DX12_EXPECT(layout.arguments[0].type == IndirectArgumentType::CBV);
+  DX12_EXPECT_EQ(layout.arguments[0].rootIndex, 1u);
+  DX12_EXPECT(layout.arguments[1].type == IndirectArgumentType::Constant);
+  DX12_EXPECT_EQ(layout.arguments[1].rootIndex, 0u);
+  DX12_EXPECT_EQ(layout.GetBindingOffset(0), 0);
+  DX12_EXPECT_EQ(layout.GetBindingOffset(1), 8);
+  DX12_EXPECT_EQ(layout.GetOperationOffset(), 16u);
+  DX12_EXPECT_EQ(layout.byteStride, 28u);
+
+  std::vector<uint8_t> command(layout.byteStride, c_fillByte);
+  const uint32_t constants[] = { 0xaabbccdd };
+  layout.WriteAddress(command.data(), 0, 0xfedcba9876543210ull);
+  layout.WriteConstants(command.data(), 1, constants, 1);
+  layout.WriteDispatch(command.data(), IndirectDispatchArguments{ 64, 2, 1 });
+
+  // Writing fewer constants than the root parameter has leaves the rest alone:
+  ExpectBytes(context, command, {
+    0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe,     // Root CBV address.
+    0xdd, 0xcc, 0xbb, 0xaa, 0xcd, 0xcd, 0xcd, 0xcd,     // Root constants, the second not written.
+    0x40, 0x00, 0x00, 0x00,                             // ThreadGroupCountX.
+    0x02, 0x00, 0x00, 0x00,                             // ThreadGroupCountY.
+    0x01, 0x00, 0x00, 0x00,                             // ThreadGroupCountZ.
+    });
+}
+
+DX12_TEST(IndirectCommands_DrawWithoutRootArguments)
+{
+  const IndirectCommandLayout layout = BuildIndirectCommandLayout(MakeRootLayout(), {}, IndirectArgumentType::Draw);
+
+  DX12_EXPECT_EQ(layout.arguments.size(), 1u);
+  DX12_EXPECT(!layout.ChangesRootArguments());
+  DX12_EXPECT_EQ(layout.GetOperationOffset(), 0u);
+  DX12_EXPECT_EQ(layout.byteStride, 16u);
+
+  std::vector<uint8_t> command(layout.byteStride, c_fillByte);
+  layout.WriteDraw(command.data(), IndirectDrawArguments{ 3, 2, 1, 0x100 });
+  ExpectBytes(context, command, {
+    0x03, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    });
+}
+
+DX12_TEST(IndirectCommands_UnusedAndRepeatedBindings)
+{
+  // A binding the shaders don't use gets no argument and writes to it are dropped, one asked for twice
+  // shares its argument:
+  const IndirectCommandLayout layout = BuildIndirectCommandLayout(MakeRootLayout(),
+    { "Instances", "Missing", "ObjectConstants", "Instances" }, IndirectArgumentType::DrawIndexed);
+
+  DX12_EXPECT_EQ(layout.arguments.size(), 3u);
+  DX12_EXPECT(layout.arguments[0].type == IndirectArgumentType::SRV);
+  DX12_EXPECT_EQ(layout.GetBindingOffset(0), 0);
+  DX12_EXPECT_EQ(layout.GetBindingOffset(1), IndirectCommandLayout::c_notBound);
+  DX12_EXPECT_EQ(layout.GetBindingOffset(2), 8);
+  DX12_EXPECT_EQ(layout.GetBindingOffset(3), 0);
+  DX12_EXPECT_EQ(layout.byteStride, 8u + 8u + 20u);
+
+  std::vector<uint8_t> command(layout.byteStride, c_fillByte);
+  const uint32_t constants[] = { 1, 2 };
+  layout.WriteConstants(command.data(), 1, constants, 2);
+  layout.WriteAddress(command.data(), 1, 0);
+  for (uint8_t byte : command)
+    DX12_EXPECT_EQ(static_cast<uint32_t>(byte), c_fillByte);
+}
+
+DX12_TEST(IndirectCommands_GenerateDrawsPacksVisibleInstances)
+{
+  const IndirectCommandLayout layout = BuildIndirectCommandLayout(MakeRootLayout(), { "ObjectConstants" },
+    IndirectArgumentType::DrawIndexed);
+
+  // A box frustum of -10 <= x, y, z <= 10:
+  Frustum frustum = {};
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    frustum.planes[axis * 2][axis] = 1.0f;
+    frustum.planes[axis * 2][3] = 10.0f;
+    frustum.planes[axis * 2 + 1][axis] = -1.0f;
+    frustum.planes[axis * 2 + 1][3] = 10.0f;
+  }
+
+  const IndirectMeshDraw meshDraws[] = {
+    { 36, 0, 0, 0 },
+    { 6, 36, 24, 0 },
+  };
+
+  // The second is outside, the third only overlaps the frustum:
+  const IndirectInstance instances[] = {
+    { { 0.0f, 0.0f, 0.0f }, 1, { 1.0f, 1.0f, 1.0f }, 100 },
+    { { 20.0f, 0.0f, 0.0f }, 0, { 1.0f, 1.0f, 1.0f }, 101 },
+    { { 0.0f, 0.0f, -10.5f }, 0, { 1.0f, 1.0f, 1.0f }, 102 },
+  };
+
+  std::vector<uint8_t> commands(layout.byteStride * 3, c_fillByte);
+  const uint32_t numCommands = GenerateIndirectDraws(layout, 0, frustum, instances, 3, meshDraws, commands.data());
+  DX12_EXPECT_EQ(numCommands, 2u);
+
+  const uint32_t expectedObjects[] = { 100, 102 };
+  const IndirectMeshDraw* expectedMeshDraws[] = { &meshDraws[1], &meshDraws[0] };
+  for (uint32_t i = 0; i < 2; ++i)
+  {
+    const uint8_t* command = commands.data() + i * layout.byteStride;
+    uint32_t objectIndex;
+    IndirectDrawIndexedArguments draw;
+    std::memcpy(&objectIndex, command, sizeof(objectIndex));
+    std::memcpy(&draw, command + layout.GetOperationOffset(), sizeof(draw));
+
+    DX12_EXPECT_EQ(objectIndex, expectedObjects[i]);
+    DX12_EXPECT_EQ(draw.indexCountPerInstance, expectedMeshDraws[i]->indexCount);
+    DX12_EXPECT_EQ(draw.instanceCount, 1u);
+    DX12_EXPECT_EQ(draw.startIndexLocation, expectedMeshDraws[i]->startIndex);
+    DX12_EXPECT_EQ(draw.baseVertexLocation, expectedMeshDraws[i]->baseVertex);
+    DX12_EXPECT_EQ(draw.startInstanceLocation, 0u);
+  }
+
+  // The third command's slot is left alone:
+  DX12_EXPECT_EQ(static_cast<uint32_t>(commands[2 * layout.byteStride]), c_fillByte);
+}
@@ -0,0 +1,133 @@
+#include "Test.h"
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// MemoryTracker's figures on a tracker of its own, then TrackedAllocation and LinearArena against the
+// process-wide one. Other tests' allocations show up there too, so those are checked as differences.
+
+namespace
+{
+  const MemoryCategory c_category = MemoryCategory::QueryHeaps;
+}
+
+DX12_TEST(MemoryTracker_TracksCurrentPeakAndCounts)
+{
+  MemoryTracker tracker;
+  tracker.OnAllocate(MemoryCategory::SwapChain, 100);
+  tracker.OnAllocate(MemoryCategory::SwapChain, 50);
+  tracker.OnFree(MemoryCategory::SwapChain, 50);
+  tracker.OnAllocate(MemoryCategory::Buffers, 10);
+
+  const MemorySnapshot snapshot = tracker.GetSnapshot();
+  const MemoryCategoryStats& swapChain = snapshot.Get(MemoryCategory::SwapChain);
+  DX12_EXPECT_EQ(swapChain.currentBytes, 100u);
+  DX12_EXPECT_EQ(swapChain.peakBytes, 150u);
+  DX12_EXPECT_EQ(swapChain.numAllocations, 1u);
+  DX12_EXPECT_EQ(swapChain.totalAllocations, 2u);
+  DX12_EXPECT_EQ(snapshot.Get(MemoryCategory::Buffers).currentBytes, 10u);
+
+  // The overall peak is when the most was allocated at once, not the sum of the categories' peaks:
+  DX12_EXPECT_EQ(snapshot.currentBytes, 110u);
+  DX12_EXPECT_EQ(snapshot.peakBytes, 150u);
+
+  // Only categories in use are summarised:
+  char summary[256];
+  const size_t summaryLength = snapshot.FormatSummary(summary, sizeof(summary));
+  DX12_EXPECT_EQ(summaryLength, strlen(summary));
+  DX12_EXPECT(strstr(summary, "SwapChain") != nullptr);
+  DX12_EXPECT(strstr(summary, "RenderTargets") == nullptr);
+
+  // A buffer too small gets the start of the line, and the length it would have needed:
+  char truncated[16];
+  DX12_EXPECT_EQ(snapshot.FormatSummary(truncated, sizeof(truncated)), summaryLength);
+  DX12_EXPECT(strlen(truncated) == sizeof(truncated) - 1 && strncmp(truncated, summary, sizeof(truncated) - 1) == 0);
+  DX12_EXPECT_EQ(snapshot.FormatSummary(nullptr, 0), summaryLength);
+
+  const std::string json = snapshot.FormatJson();
+  DX12_EXPECT(json.find("\"SwapChain\": { \"currentBytes\": 100, \"peakBytes\": 150, \"numAllocations\": 1, "
+    "\"totalAllocations\": 2 },") != std::string::npos);
+  DX12_EXPECT(json.find("\"CpuArenas\"") != std::string::npos);
+  DX12_EXPECT(json.find("\"peakBytes\": 150,\n  \"categories\"") != std::string::npos);
+}
+
+DX12_TEST(TrackedAllocation_ReportsUntilReleased)
+{
+  MemoryTracker& tracker = GetMemoryTracker();
+  const MemoryCategoryStats before = tracker.GetSnapshot().Get(c_category);
+  auto currentBytes = [&]() { return tracker.GetSnapshot().Get(c_category).currentBytes - before.currentBytes; };
+
+  {
+    TrackedAllocation a(c_category, 100);
+    TrackedAllocation b(c_category, 50);
+    DX12_EXPECT_EQ(currentBytes(), 150u);
+
+    // Moving hands the allocation over rather than counting it twice:
+    TrackedAllocation c = std::move(a);
+    DX12_EXPECT_EQ(a.GetBytes(), 0u);
+    DX12_EXPECT_EQ(c.GetBytes(), 100u);
+    DX12_EXPECT_EQ(currentBytes(), 150u);
+
+    // Assigning over one releases what it held:
+    b = TrackedAllocation(c_category, 10);
+    DX12_EXPECT_EQ(currentBytes(), 110u);
+
+    c.Reset();
+    DX12_EXPECT_EQ(currentBytes(), 10u);
+  }
+
+  const MemoryCategoryStats after = tracker.GetSnapshot().Get(c_category);
+  DX12_EXPECT_EQ(after.currentBytes, before.currentBytes);
+  DX12_EXPECT_EQ(after.numAllocations, before.numAllocations);
+  DX12_EXPECT_EQ(after.totalAllocations - before.totalAllocations, 3u);
+}
+
+DX12_TEST(TrackedAllocation_BalancesAcrossThreads)
+{
+  const uint32_t numThreads = 8;
+  const uint32_t numAllocations = 100000;
+  MemoryTracker& tracker = GetMemoryTracker();
+  const MemoryCategoryStats before = tracker.GetSnapshot().Get(c_category);
+
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < numThreads; ++i)
+  {
+    threads.emplace_back([]() {
+      for (uint32_t allocation = 0; allocation < numAllocations; ++allocation)
+        TrackedAllocation tracked(c_category, 8);
+      });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  const MemoryCategoryStats after = tracker.GetSnapshot().Get(c_category);
+  DX12_EXPECT_EQ(after.currentBytes, before.currentBytes);
+  DX12_EXPECT_EQ(after.numAllocations, before.numAllocations);
+  DX12_EXPECT_EQ(after.totalAllocations - before.totalAllocations, static_cast<uint64_t>(numThreads) * numAllocations);
+  DX12_EXPECT(after.peakBytes >= before.currentBytes + 8);
+}
+
+DX12_TEST(MemoryTracker_CountsArenaChunks)
+{
+  MemoryTracker& tracker = GetMemoryTracker();
+  const MemoryCategoryStats before = tracker.GetSnapshot().Get(MemoryCategory::CpuArenas);
+
+  {
+    LinearArena arena(1000);
+    arena.Allocate(5000);
+    arena.Allocate(500);
+
+    // Both chunks, whatever's used of them:
+    const MemoryCategoryStats during = tracker.GetSnapshot().Get(MemoryCategory::CpuArenas);
+    DX12_EXPECT_EQ(during.currentBytes - before.currentBytes, arena.GetStats().bytesReserved);
+    DX12_EXPECT_EQ(during.numAllocations - before.numAllocations, 2u);
+
+    arena.Reset();
+    DX12_EXPECT_EQ(tracker.GetSnapshot().Get(MemoryCategory::CpuArenas).currentBytes, during.currentBytes);
+  }
+
+  DX12_EXPECT_EQ(tracker.GetSnapshot().Get(MemoryCategory::CpuArenas).currentBytes, before.currentBytes);
+}
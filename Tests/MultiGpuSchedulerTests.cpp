@@ -0,0 +1,175 @@
+#include "Test.h"
+#include "MultiGpuScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+// MultiGpuScheduler driving simulated GPUs. Each GPU is a serial timeline taking a fixed time per row;
+// secondaries start once the composite they wait for is done, the display GPU renders its band then
+// composites once every secondary has signalled. The CPU records a frame per millisecond, at most
+// c_numFramesInFlight composites ahead of the GPUs.
+
+namespace
+{
+  const uint32_t c_numFramesInFlight = 3;
+  const uint32_t c_height = 1080;
+  const double c_compositeMs = 0.1;
+
+  struct SimulationResult
+  {
+    double totalMs;
+    std::vector<uint32_t> framesPerGpu;
+    std::vector<uint32_t> lastRowsPerGpu;
+  };
+
+  SimulationResult Simulate(MultiGpuScheduler& scheduler, const std::vector<double>& msPerRow, uint32_t numFrames,
+    TestContext& context)
+  {
+    const uint32_t numGpus = scheduler.NumGpus();
+    std::vector<double> gpuIdleMs(numGpus, 0.0);
+    std::map<uint64_t, double> compositeEndMs = { { 0, 0.0 } };
+    std::vector<uint64_t> lastFenceValues(numGpus, 0);
+    double cpuMs = 0.0;
+
+    SimulationResult result = {};
+    result.framesPerGpu.assign(numGpus, 0);
+    result.lastRowsPerGpu.assign(numGpus, 0);
+    for (uint64_t frameId = 1; frameId <= numFrames; ++frameId)
+    {
+      const MultiGpuFramePlan& plan = scheduler.PlanFrame(frameId, c_height);
+      DX12_EXPECT_EQ(plan.frameId, frameId);
+      DX12_EXPECT_EQ(plan.compositeFenceValue, frameId);
+
+      // Bands are contiguous and cover every row once:
+      uint32_t nextRow = 0;
+      double compositeStartMs = 0.0;
+      std::fill(result.lastRowsPerGpu.begin(), result.lastRowsPerGpu.end(), 0);
+      for (const MultiGpuWork& work : plan.work)
+      {
+        DX12_EXPECT_EQ(work.band.top, nextRow);
+        DX12_EXPECT(work.band.bottom > work.band.top);
+        nextRow = work.band.bottom;
+
+        const uint32_t numRows = work.band.bottom - work.band.top;
+        const double ms = msPerRow[work.gpu] * numRows;
+        double startMs = std::max(gpuIdleMs[work.gpu], cpuMs);
+        if (work.gpu != 0)
+        {
+          // Each secondary's fence counts its frames, its slot was last used a whole ring ago, and the
+          // composite it waits for has already been planned:
+          DX12_EXPECT_EQ(work.fenceValue, lastFenceValues[work.gpu] + 1);
+          DX12_EXPECT(work.slotFenceValue == 0 || work.fenceValue - work.slotFenceValue == c_numFramesInFlight);
+          DX12_EXPECT(work.compositeWaitValue < plan.compositeFenceValue);
+          lastFenceValues[work.gpu] = work.fenceValue;
+          startMs = std::max(startMs, compositeEndMs.at(work.compositeWaitValue));
+        }
+
+        gpuIdleMs[work.gpu] = startMs + ms;
+        compositeStartMs = std::max(compositeStartMs, gpuIdleMs[work.gpu]);
+        scheduler.ReportGpuTime(work.gpu, work.band, static_cast<float>(ms));
+        ++result.framesPerGpu[work.gpu];
+        result.lastRowsPerGpu[work.gpu] = numRows;
+      }
+      DX12_EXPECT_EQ(nextRow, c_height);
+
+      gpuIdleMs[0] = std::max(compositeStartMs, gpuIdleMs[0]) + c_compositeMs;
+      compositeEndMs[plan.compositeFenceValue] = gpuIdleMs[0];
+
+      cpuMs += 1.0;
+      if (frameId >= c_numFramesInFlight)
+        cpuMs = std::max(cpuMs, compositeEndMs[frameId - c_numFramesInFlight + 1]);
+    }
+
+    result.totalMs = gpuIdleMs[0];
+    return result;
+  }
+
+  double SingleGpuMs(const std::vector<double>& msPerRow, uint32_t numFrames)
+  {
+    return numFrames * (msPerRow[0] * c_height + c_compositeMs);
+  }
+}
+
+DX12_TEST(MultiGpuScheduler_AlternateFrameRoundRobins)
+{
+  const std::vector<double> msPerRow = { 0.01, 0.01 };
+  MultiGpuScheduler scheduler(2, c_numFramesInFlight, MultiGpuMode::AlternateFrame);
+  const SimulationResult result = Simulate(scheduler, msPerRow, 300, context);
+
+  // Whole frames, split evenly, and nearly twice as fast as one GPU:
+  DX12_EXPECT_EQ(result.framesPerGpu[0], 150u);
+  DX12_EXPECT_EQ(result.framesPerGpu[1], 150u);
+  DX12_EXPECT(result.lastRowsPerGpu[0] == c_height || result.lastRowsPerGpu[1] == c_height);
+  DX12_EXPECT(result.totalMs < SingleGpuMs(msPerRow, 300) * 0.6);
+
+  // Consecutive frames alternate:
+  const uint32_t gpu = scheduler.PlanFrame(301, c_height).work[0].gpu;
+  DX12_EXPECT(scheduler.PlanFrame(302, c_height).work[0].gpu != gpu);
+}
+
+DX12_TEST(MultiGpuScheduler_SplitFrameBalancesOnMeasuredTimes)
+{
+  // The secondary is twice as fast, so it ends up with two thirds of the rows:
+  const std::vector<double> msPerRow = { 0.02, 0.01 };
+  MultiGpuScheduler scheduler(2, c_numFramesInFlight, MultiGpuMode::SplitFrame);
+  DX12_EXPECT(std::fabs(scheduler.GetSplit()[0] - 0.5f) < 1e-6f);
+
+  const SimulationResult result = Simulate(scheduler, msPerRow, 300, context);
+  DX12_EXPECT_EQ(result.framesPerGpu[0], 300u);
+  DX12_EXPECT_EQ(result.framesPerGpu[1], 300u);
+  DX12_EXPECT(std::fabs(scheduler.GetSplit()[0] - 1.0f / 3.0f) < 0.01f);
+  DX12_EXPECT(std::fabs(scheduler.GetSplit()[1] - 2.0f / 3.0f) < 0.01f);
+  DX12_EXPECT(result.lastRowsPerGpu[1] > result.lastRowsPerGpu[0] * 19 / 10);
+  DX12_EXPECT(result.totalMs < SingleGpuMs(msPerRow, 300) * 0.4);
+
+  // A mode change starts the balance over, but fence values carry on:
+  const uint64_t fenceValue = scheduler.PlanFrame(301, c_height).work[1].fenceValue;
+  scheduler.SetMode(MultiGpuMode::SplitFrame);
+  DX12_EXPECT(std::fabs(scheduler.GetSplit()[0] - 0.5f) < 1e-6f);
+  DX12_EXPECT_EQ(scheduler.PlanFrame(302, c_height).work[1].fenceValue, fenceValue + 1);
+}
+
+DX12_TEST(MultiGpuScheduler_SlowGpuKeepsMinimumShare)
+{
+  // Measured as 100x slower, it still gets a band to be measured again on, its 5% floor only shrinking a
+  // little when the shares are normalised:
+  const std::vector<double> msPerRow = { 0.01, 1.0, 0.01 };
+  MultiGpuScheduler scheduler(3, c_numFramesInFlight, MultiGpuMode::SplitFrame);
+  const SimulationResult result = Simulate(scheduler, msPerRow, 100, context);
+
+  DX12_EXPECT_EQ(result.framesPerGpu[1], 100u);
+  DX12_EXPECT(scheduler.GetSplit()[1] > 0.045f);
+  DX12_EXPECT(std::fabs(scheduler.GetSplit()[0] - scheduler.GetSplit()[2]) < 0.01f);
+}
+
+DX12_TEST(MultiGpuScheduler_FallsBackToSingleGpu)
+{
+  const std::vector<double> msPerRow = { 0.01 };
+
+  // One GPU renders everything whatever the mode:
+  for (MultiGpuMode mode : { MultiGpuMode::Single, MultiGpuMode::AlternateFrame, MultiGpuMode::SplitFrame })
+  {
+    MultiGpuScheduler scheduler(1, c_numFramesInFlight, mode);
+    const SimulationResult result = Simulate(scheduler, msPerRow, 10, context);
+    DX12_EXPECT_EQ(result.framesPerGpu[0], 10u);
+    DX12_EXPECT_EQ(result.lastRowsPerGpu[0], c_height);
+  }
+
+  // So does the display GPU in single mode, with others there:
+  MultiGpuScheduler scheduler(2, c_numFramesInFlight, MultiGpuMode::Single);
+  const SimulationResult result = Simulate(scheduler, { 0.01, 0.01 }, 10, context);
+  DX12_EXPECT_EQ(result.framesPerGpu[0], 10u);
+  DX12_EXPECT_EQ(result.framesPerGpu[1], 0u);
+
+  // Fewer rows than GPUs, the empty bands are left out:
+  MultiGpuScheduler tiny(4, c_numFramesInFlight, MultiGpuMode::SplitFrame);
+  const MultiGpuFramePlan& plan = tiny.PlanFrame(1, 2);
+  uint32_t numRows = 0;
+  for (const MultiGpuWork& work : plan.work)
+  {
+    DX12_EXPECT(work.band.bottom > work.band.top);
+    numRows += work.band.bottom - work.band.top;
+  }
+  DX12_EXPECT_EQ(numRows, 2u);
+}
@@ -0,0 +1,86 @@
+#include "Test.h"
+#include "JobSystem.h"
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+// RadixSort, serial and split into blocks across the job system, against std::stable_sort of the same
+// key/value pairs: values start as each key's position, so any reordering of equal keys shows up. Sizes
+// go from a single block to several, and keys from random to sharing most or all of their digits.
+
+namespace
+{
+  // Below, at and above the sort's 16K keys per block:
+  const uint32_t c_counts[] = { 0, 1, 2, 1000, 16 * 1024 - 1, 16 * 1024, 3 * 16 * 1024 + 7, 200000 };
+
+  enum class KeyKind
+  {
+    Random,
+    LowDigitsOnly,    // Six of the eight digits trivial, as with unused high bits of a sort key.
+    FewDistinct,      // Long runs of equal keys, for stability.
+    AllEqual,         // Every digit trivial, nothing to sort.
+  };
+
+  std::vector<uint64_t> MakeKeys(KeyKind kind, uint32_t count)
+  {
+    std::mt19937_64 random(count);
+    std::vector<uint64_t> keys(count);
+    for (uint64_t& key : keys)
+    {
+      switch (kind)
+      {
+      case KeyKind::Random:         key = random(); break;
+      case KeyKind::LowDigitsOnly:  key = 0xabcd000000000000ull | (random() & 0xffff); break;
+      case KeyKind::FewDistinct:    key = ((random() % 5) << 40) | (random() % 3); break;
+      case KeyKind::AllEqual:       key = 0x0123456789abcdefull; break;
+      }
+    }
+    return keys;
+  }
+
+  // Sorts the keys both ways, returning whether the radix sort matched key for key and value for value:
+  bool MatchesStableSort(const std::vector<uint64_t>& keys, RadixSortScratch& scratch, JobSystem* jobSystem)
+  {
+    const uint32_t count = static_cast<uint32_t>(keys.size());
+    std::vector<std::pair<uint64_t, uint32_t>> expected(count);
+    for (uint32_t i = 0; i < count; ++i)
+      expected[i] = { keys[i], i };
+    std::stable_sort(expected.begin(), expected.end(),
+      [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+
+    std::vector<uint64_t> sortedKeys = keys;
+    std::vector<uint32_t> values(count);
+    for (uint32_t i = 0; i < count; ++i)
+      values[i] = i;
+    RadixSort(sortedKeys.data(), values.data(), count, scratch, jobSystem);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      if (sortedKeys[i] != expected[i].first || values[i] != expected[i].second)
+        return false;
+    }
+    return true;
+  }
+}
+
+DX12_TEST(RadixSort_MatchesStableSortSerialAndParallel)
+{
+  const KeyKind kinds[] = { KeyKind::Random, KeyKind::LowDigitsOnly, KeyKind::FewDistinct, KeyKind::AllEqual };
+
+  // Four threads, so the biggest sizes are split into several blocks:
+  JobSystem jobSystem(3);
+  RadixSortScratch scratch;
+  for (KeyKind kind : kinds)
+  {
+    for (uint32_t count : c_counts)
+    {
+      // Scratch reused across sizes, as the renderer does:
+      const std::vector<uint64_t> keys = MakeKeys(kind, count);
+      DX12_EXPECT(MatchesStableSort(keys, scratch, nullptr));
+      DX12_EXPECT(MatchesStableSort(keys, scratch, &jobSystem));
+    }
+  }
+}
@@ -0,0 +1,401 @@
+#include "Test.h"
+#include "JobSystem.h"
+#include "SoftwareRasterizer.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// SoftwareRasterizer's output checked three ways: against golden hashes of a scene of random,
+// perspective, alpha blended triangles (identical whatever the thread count, and built a second time as
+// Dx12ScalarRasterizerTests to check the scalar path against the same hashes as SSE), against a
+// brute-force fill rule reference pixel by pixel, and for watertightness over a mesh of shared edges.
+
+namespace
+{
+  const uint32_t c_width = 301;
+  const uint32_t c_height = 203;
+
+  struct Vertex
+  {
+    float position[4];
+    float colour[3];
+  };
+
+  void TransformVertex(const void* /*constants*/, const void* vertex, uint32_t /*instanceId*/, SwVertexOutput& output)
+  {
+    const Vertex& input = *static_cast<const Vertex*>(vertex);
+    for (uint32_t i = 0; i < 4; ++i)
+      output.position[i] = input.position[i];
+    for (uint32_t i = 0; i < 3; ++i)
+      output.varyings[i] = input.colour[i];
+  }
+
+  void ShadeColour(const void* /*constants*/, const SwPixelBlock& input, float colour[4][g_swNumLanes])
+  {
+    for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+    {
+      for (uint32_t channel = 0; channel < 3; ++channel)
+        colour[channel][lane] = input.varyings[channel][lane];
+      colour[3][lane] = 0.6f;
+    }
+  }
+
+  void ShadeWhite(const void* /*constants*/, const SwPixelBlock& /*input*/, float colour[4][g_swNumLanes])
+  {
+    for (uint32_t channel = 0; channel < 4; ++channel)
+    {
+      for (uint32_t lane = 0; lane < g_swNumLanes; ++lane)
+        colour[channel][lane] = 1.0f;
+    }
+  }
+
+  struct KernelConstants
+  {
+    float* output;
+    uint32_t width;
+  };
+
+  void WriteCoordinates(const void* constants, uint32_t groupX, uint32_t groupY, uint32_t /*groupZ*/)
+  {
+    const KernelConstants& kernel = *static_cast<const KernelConstants*>(constants);
+    kernel.output[groupY * kernel.width + groupX] = static_cast<float>(groupX + groupY);
+  }
+
+  // From the raw generator output rather than a std distribution, whose results differ between standard
+  // libraries, so the golden hashes hold everywhere:
+  float Random(std::mt19937& random, float min, float max)
+  {
+    return min + (max - min) * static_cast<float>(random() >> 8) * (1.0f / 16777216.0f);
+  }
+
+  // Screen-space triangles (w = 1), some off screen, then perspective ones with some crossing the near
+  // plane:
+  std::vector<Vertex> MakeScene(uint32_t numScreenSpace, uint32_t numPerspective)
+  {
+    std::mt19937 random(7);
+    std::vector<Vertex> vertices;
+    for (uint32_t i = 0; i < numScreenSpace * 3; ++i)
+    {
+      vertices.push_back({ { Random(random, -1.3f, 1.3f), Random(random, -1.3f, 1.3f), Random(random, 0.1f, 0.9f),
+        1.0f }, { Random(random, 0.0f, 1.0f), Random(random, 0.0f, 1.0f), Random(random, 0.0f, 1.0f) } });
+    }
+    for (uint32_t i = 0; i < numPerspective * 3; ++i)
+    {
+      const float w = Random(random, 0.5f, 3.5f);
+      vertices.push_back({ { Random(random, -4.0f, 4.0f) * w, Random(random, -4.0f, 4.0f) * w,
+        Random(random, -0.2f, 1.2f) * w, w }, { Random(random, 0.0f, 1.0f), Random(random, 0.0f, 1.0f), 0.5f } });
+    }
+    return vertices;
+  }
+
+  SwPipelineState MakePipelineState(SwPixelShader pixelShader)
+  {
+    SwPipelineState pipelineState;
+    pipelineState.vertexShader = TransformVertex;
+    pipelineState.pixelShader = pixelShader;
+    pipelineState.numVaryings = 3;
+    pipelineState.cullMode = SwCullMode::None;
+    return pipelineState;
+  }
+
+  // Records a clear of colour (and depth, if given) and the targets, viewport and pipeline for a draw:
+  void RecordSetup(SwCommandList& commandList, SwTexture* colour, SwTexture* depth,
+    const SwPipelineState* pipelineState)
+  {
+    const float clearColour[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    commandList.ClearRenderTargetView(colour, clearColour);
+    if (depth)
+      commandList.ClearDepthStencilView(depth, 1.0f);
+    commandList.OMSetRenderTargets(colour, depth);
+    commandList.RSSetViewports({ 0.0f, 0.0f, static_cast<float>(c_width), static_cast<float>(c_height), 0.0f, 1.0f });
+    commandList.SetPipelineState(pipelineState);
+  }
+
+  // Whether the top-left fill rule covers pixel (x, y) of a triangle snapped to 1/16 pixel like the
+  // rasterizer's, with either winding:
+  bool IsCovered(const Vertex* triangle, uint32_t x, uint32_t y)
+  {
+    int64_t fixedX[3], fixedY[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+      const float screenX = (triangle[i].position[0] + 1.0f) * 0.5f * c_width;
+      const float screenY = (1.0f - triangle[i].position[1]) * 0.5f * c_height;
+      fixedX[i] = static_cast<int64_t>(std::floor(screenX * 16.0f + 0.5f));
+      fixedY[i] = static_cast<int64_t>(std::floor(screenY * 16.0f + 0.5f));
+    }
+
+    const int64_t area = (fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0]) -
+      (fixedX[2] - fixedX[0]) * (fixedY[1] - fixedY[0]);
+    if (area == 0)
+      return false;
+
+    const uint32_t order[3] = { 0, area < 0 ? 2u : 1u, area < 0 ? 1u : 2u };
+    const int64_t centreX = x * 16 + 8;
+    const int64_t centreY = y * 16 + 8;
+    for (uint32_t edge = 0; edge < 3; ++edge)
+    {
+      const uint32_t a = order[edge];
+      const uint32_t b = order[(edge + 1) % 3];
+      const int64_t dx = fixedX[b] - fixedX[a];
+      const int64_t dy = fixedY[b] - fixedY[a];
+      const int64_t distance = dx * (centreY - fixedY[a]) - dy * (centreX - fixedX[a]);
+      const bool isTopLeft = (dy == 0 && dx > 0) || dy < 0;
+      if (distance < 0 || (distance == 0 && !isTopLeft))
+        return false;
+    }
+    return true;
+  }
+}
+
+DX12_TEST(SoftwareRasterizer_MatchesGoldenHashesOnAnyThreadCount)
+{
+  // Rendered with SSE2 and scalar, with every thread count, and all have to give these:
+  const uint64_t c_goldenColourHash = 0xe548c7e58364beadull;
+  const uint64_t c_goldenDepthHash = 0xb44d496afa146e46ull;
+
+  const std::vector<Vertex> vertices = MakeScene(2000, 1000);
+  SwPipelineState pipelineState = MakePipelineState(ShadeColour);
+  pipelineState.blendMode = SwBlendMode::Alpha;
+
+  const uint32_t threadCounts[] = { 0, 1, 2, 4, 7 };
+  for (uint32_t numThreads : threadCounts)
+  {
+    JobSystem jobSystem(numThreads);
+    SoftwareRasterizer rasterizer(numThreads ? &jobSystem : nullptr);
+    SwTexture colour(SwFormat::RGBA8, c_width, c_height);
+    SwTexture depth(SwFormat::R32Float, c_width, c_height);
+
+    SwCommandList commandList;
+    RecordSetup(commandList, &colour, &depth, &pipelineState);
+    commandList.IASetVertexBuffers(vertices.data(), sizeof(Vertex), static_cast<uint32_t>(vertices.size()));
+    commandList.DrawInstanced(static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+    rasterizer.Execute(commandList);
+
+    DX12_EXPECT_EQ(colour.Hash(), c_goldenColourHash);
+    DX12_EXPECT_EQ(depth.Hash(), c_goldenDepthHash);
+    DX12_EXPECT_EQ(rasterizer.GetStats().numTriangles, 3000u);
+    DX12_EXPECT(rasterizer.GetStats().numPixelsWritten > 0);
+  }
+}
+
+DX12_TEST(SoftwareRasterizer_CoverageFollowsFillRule)
+{
+  const std::vector<Vertex> vertices = MakeScene(200, 0);
+  SwPipelineState pipelineState = MakePipelineState(ShadeWhite);
+  pipelineState.depthTest = false;
+  pipelineState.depthWrite = false;
+
+  SoftwareRasterizer rasterizer;
+  SwTexture colour(SwFormat::RGBA8, c_width, c_height);
+  uint32_t numMismatches = 0;
+  uint32_t numCovered = 0;
+  for (size_t first = 0; first < vertices.size(); first += 3)
+  {
+    SwCommandList commandList;
+    RecordSetup(commandList, &colour, nullptr, &pipelineState);
+    commandList.IASetVertexBuffers(&vertices[first], sizeof(Vertex), 3);
+    commandList.DrawInstanced(3, 1, 0, 0);
+    rasterizer.Execute(commandList);
+
+    for (uint32_t y = 0; y < c_height; ++y)
+    {
+      for (uint32_t x = 0; x < c_width; ++x)
+      {
+        const bool isCovered = IsCovered(&vertices[first], x, y);
+        numCovered += isCovered;
+        if (isCovered != (colour.GetColour()[y * c_width + x] != 0))
+          ++numMismatches;
+      }
+    }
+  }
+
+  DX12_EXPECT(numCovered > 100000u);
+  DX12_EXPECT_EQ(numMismatches, 0u);
+}
+
+DX12_TEST(SoftwareRasterizer_SharedEdgesAreWatertight)
+{
+  // A grid of quads with jittered inner vertices, past the screen's edges, then the same on screen with
+  // w = 2 so it's clipped and divided differently. Every pixel has to be covered by exactly one triangle:
+  const uint32_t c_gridSize = 23;
+  std::mt19937 random(11);
+  std::vector<Vertex> vertices;
+  for (uint32_t y = 0; y <= c_gridSize; ++y)
+  {
+    for (uint32_t x = 0; x <= c_gridSize; ++x)
+    {
+      const bool isInnerX = x > 0 && x < c_gridSize;
+      const bool isInnerY = y > 0 && y < c_gridSize;
+      const float jitterX = isInnerX ? Random(random, -0.03f, 0.03f) : 0.0f;
+      const float jitterY = isInnerY ? Random(random, -0.03f, 0.03f) : 0.0f;
+      vertices.push_back({ { -1.2f + 2.4f * x / c_gridSize + jitterX, -1.2f + 2.4f * y / c_gridSize + jitterY, 0.5f,
+        1.0f }, { 1.0f, 1.0f, 1.0f } });
+    }
+  }
+
+  std::vector<uint32_t> indices;
+  for (uint32_t y = 0; y < c_gridSize; ++y)
+  {
+    for (uint32_t x = 0; x < c_gridSize; ++x)
+    {
+      const uint32_t topLeft = y * (c_gridSize + 1) + x;
+      const uint32_t bottomLeft = topLeft + c_gridSize + 1;
+      indices.insert(indices.end(), { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft });
+    }
+  }
+
+  SwPipelineState pipelineState = MakePipelineState(ShadeWhite);
+  pipelineState.depthTest = false;
+  pipelineState.depthWrite = false;
+
+  for (float w : { 1.0f, 2.0f })
+  {
+    std::vector<Vertex> scaled = vertices;
+    for (Vertex& vertex : scaled)
+    {
+      for (uint32_t i = 0; i < 4; ++i)
+        vertex.position[i] *= w;
+    }
+
+    SoftwareRasterizer rasterizer;
+    SwTexture colour(SwFormat::RGBA8, c_width, c_height);
+    std::vector<uint32_t> hits(c_width * c_height, 0);
+    for (uint32_t first = 0; first < indices.size(); first += 3)
+    {
+      SwCommandList commandList;
+      RecordSetup(commandList, &colour, nullptr, &pipelineState);
+      commandList.IASetVertexBuffers(scaled.data(), sizeof(Vertex), static_cast<uint32_t>(scaled.size()));
+      commandList.IASetIndexBuffer(indices.data(), static_cast<uint32_t>(indices.size()));
+      commandList.DrawIndexedInstanced(3, 1, first, 0, 0);
+      rasterizer.Execute(commandList);
+
+      for (uint32_t i = 0; i < c_width * c_height; ++i)
+        hits[i] += colour.GetColour()[i] != 0;
+    }
+
+    uint32_t numWrong = 0;
+    for (uint32_t numHits : hits)
+      numWrong += numHits != 1;
+    DX12_EXPECT_EQ(numWrong, 0u);
+  }
+}
+
+DX12_TEST(SoftwareRasterizer_ClipsCullsAndScissors)
+{
+  SwPipelineState pipelineState = MakePipelineState(ShadeWhite);
+  SwTexture colour(SwFormat::RGBA8, c_width, c_height);
+  SwTexture depth(SwFormat::R32Float, c_width, c_height);
+
+  // Huge and crossing the near plane, clipped to what's in front, which covers the bottom of the screen:
+  {
+    const Vertex triangle[3] = {
+      { { -50.0f, -50.0f, -10.0f, 0.5f }, { 1.0f, 0.0f, 0.0f } },
+      { { 50.0f, -50.0f, -10.0f, 0.5f }, { 0.0f, 1.0f, 0.0f } },
+      { { 0.0f, 60.0f, 20.0f, 30.0f }, { 0.0f, 0.0f, 1.0f } },
+    };
+    SoftwareRasterizer rasterizer;
+    SwCommandList commandList;
+    RecordSetup(commandList, &colour, &depth, &pipelineState);
+    commandList.IASetVertexBuffers(triangle, sizeof(Vertex), 3);
+    commandList.DrawInstanced(3, 1, 0, 0);
+    rasterizer.Execute(commandList);
+
+    DX12_EXPECT(rasterizer.GetStats().numTrianglesBinned >= 1u);
+    DX12_EXPECT(colour.GetColour()[(c_height - 1) * c_width + c_width / 2] != 0);
+    for (uint32_t i = 0; i < c_width * c_height; ++i)
+    {
+      if (colour.GetColour()[i] != 0 && (depth.GetDepth()[i] < 0.0f || depth.GetDepth()[i] > 1.0f))
+      {
+        DX12_EXPECT(!"Depth outside [0, 1]");
+        break;
+      }
+    }
+  }
+
+  // Entirely behind the near plane:
+  {
+    const Vertex triangle[3] = {
+      { { -1.0f, -1.0f, -1.0f, 1.0f }, {} },
+      { { 0.0f, 1.0f, -1.0f, 1.0f }, {} },
+      { { 1.0f, -1.0f, -1.0f, 1.0f }, {} },
+    };
+    SoftwareRasterizer rasterizer;
+    SwCommandList commandList;
+    RecordSetup(commandList, &colour, &depth, &pipelineState);
+    commandList.IASetVertexBuffers(triangle, sizeof(Vertex), 3);
+    commandList.DrawInstanced(3, 1, 0, 0);
+    rasterizer.Execute(commandList);
+    DX12_EXPECT_EQ(rasterizer.GetStats().numTrianglesBinned, 0u);
+    DX12_EXPECT_EQ(rasterizer.GetStats().numPixelsWritten, 0u);
+  }
+
+  // Counter-clockwise on screen is culled, clockwise drawn, and only inside the scissor rect (which it
+  // covers):
+  pipelineState.cullMode = SwCullMode::Back;
+  const Vertex counterClockwise[3] = {
+    { { -1.0f, -1.0f, 0.5f, 1.0f }, {} },
+    { { 1.0f, -1.0f, 0.5f, 1.0f }, {} },
+    { { 0.0f, 1.0f, 0.5f, 1.0f }, {} },
+  };
+  const Vertex clockwise[3] = { counterClockwise[0], counterClockwise[2], counterClockwise[1] };
+  const SwRect scissorRect = { 130, 150, 170, 180 };
+
+  uint64_t numCulled[2] = {};
+  for (uint32_t i = 0; i < 2; ++i)
+  {
+    SoftwareRasterizer rasterizer;
+    SwCommandList commandList;
+    RecordSetup(commandList, &colour, nullptr, &pipelineState);
+    commandList.RSSetScissorRects(scissorRect);
+    commandList.IASetVertexBuffers(i == 0 ? counterClockwise : clockwise, sizeof(Vertex), 3);
+    commandList.DrawInstanced(3, 1, 0, 0);
+    rasterizer.Execute(commandList);
+    numCulled[i] = rasterizer.GetStats().numTrianglesCulled;
+  }
+  DX12_EXPECT_EQ(numCulled[0], 1u);
+  DX12_EXPECT_EQ(numCulled[1], 0u);
+
+  uint32_t numInside = 0;
+  uint32_t numOutside = 0;
+  for (int32_t y = 0; y < static_cast<int32_t>(c_height); ++y)
+  {
+    for (int32_t x = 0; x < static_cast<int32_t>(c_width); ++x)
+    {
+      if (colour.GetColour()[y * c_width + x] == 0)
+        continue;
+      const bool isInside = x >= scissorRect.left && x < scissorRect.right && y >= scissorRect.top &&
+        y < scissorRect.bottom;
+      ++(isInside ? numInside : numOutside);
+    }
+  }
+  DX12_EXPECT_EQ(numInside, 40u * 30u);
+  DX12_EXPECT_EQ(numOutside, 0u);
+}
+
+DX12_TEST(SoftwareRasterizer_DispatchRunsEveryGroup)
+{
+  std::vector<float> output(16 * 8, -1.0f);
+  const KernelConstants constants = { output.data(), 16 };
+  SwPipelineState pipelineState;
+  pipelineState.computeKernel = WriteCoordinates;
+
+  SwCommandList commandList;
+  commandList.SetPipelineState(&pipelineState);
+  commandList.SetComputeRoot32BitConstants(sizeof(constants) / 4, &constants);
+  commandList.Dispatch(16, 8, 1);
+  commandList.ResourceBarrier();
+
+  JobSystem jobSystem(3);
+  SoftwareRasterizer rasterizer(&jobSystem);
+  rasterizer.Execute(commandList);
+
+  DX12_EXPECT_EQ(rasterizer.GetStats().numDispatches, 1u);
+  uint32_t numWrong = 0;
+  for (uint32_t y = 0; y < 8; ++y)
+  {
+    for (uint32_t x = 0; x < 16; ++x)
+      numWrong += output[y * 16 + x] != static_cast<float>(x + y);
+  }
+  DX12_EXPECT_EQ(numWrong, 0u);
+}
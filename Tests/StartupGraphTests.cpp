@@ -0,0 +1,132 @@
+#include "Test.h"
+#include "StartupGraph.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+// StartupGraph over job systems with no workers (everything on the calling thread), one and several:
+// dependencies run in order, main thread tasks stay on the main thread, failures skip the tasks that
+// depend on them, and the critical path follows the chain startup waited on. Tasks sleep rather than
+// spin, so the timings hold on a loaded machine.
+
+namespace
+{
+  const uint32_t c_workerCounts[] = { 0, 1, 3 };
+
+  void SleepMs(int ms)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+DX12_TEST(StartupGraph_RunsTasksAfterTheirDependencies)
+{
+  for (uint32_t numWorkers : c_workerCounts)
+  {
+    JobSystem jobSystem(numWorkers);
+    StartupGraph graph(jobSystem);
+
+    // Shaped like the renderer's startup:
+    std::atomic<int> order(0);
+    int adapterOrder = -1, windowOrder = -1, deviceOrder = -1, swapChainOrder = -1, shadersOrder = -1;
+    std::thread::id windowThread, swapChainThread;
+    const StartupTaskId adapter = graph.Add("Adapter", [&]() { SleepMs(30); adapterOrder = order++; });
+    const StartupTaskId window = graph.Add("Window", [&]() {
+      SleepMs(20);
+      windowOrder = order++;
+      windowThread = std::this_thread::get_id();
+      }, {}, JobAffinity::MainThread);
+    const StartupTaskId device = graph.Add("Device", [&]() { SleepMs(10); deviceOrder = order++; }, { adapter });
+    const StartupTaskId swapChain = graph.Add("Swap chain", [&]() {
+      swapChainOrder = order++;
+      swapChainThread = std::this_thread::get_id();
+      }, { window, device }, JobAffinity::MainThread);
+    const StartupTaskId shaders = graph.Add("Shaders", [&]() { SleepMs(15); shadersOrder = order++; }, { device });
+
+    graph.Run();
+
+    DX12_EXPECT(adapterOrder >= 0 && windowOrder >= 0);
+    DX12_EXPECT(deviceOrder > adapterOrder);
+    DX12_EXPECT(swapChainOrder > deviceOrder && swapChainOrder > windowOrder);
+    DX12_EXPECT(shadersOrder > deviceOrder);
+    DX12_EXPECT(windowThread == std::this_thread::get_id());
+    DX12_EXPECT(swapChainThread == std::this_thread::get_id());
+
+    const std::vector<StartupPhaseTiming> timings = graph.GetTimings();
+    DX12_EXPECT_EQ(timings.size(), 5u);
+    for (const StartupPhaseTiming& timing : timings)
+      DX12_EXPECT(timing.wasRun);
+    DX12_EXPECT(timings[window].isMainThread);
+    DX12_EXPECT(timings[swapChain].isMainThread);
+    DX12_EXPECT(timings[device].startMs >= timings[adapter].startMs + timings[adapter].durationMs);
+    DX12_EXPECT(timings[shaders].startMs >= timings[device].startMs + timings[device].durationMs);
+    DX12_EXPECT(timings[shaders].durationMs >= 14.0);
+    DX12_EXPECT(timings[adapter].durationMs >= 29.0);
+
+    // Work adds up to more than the total with any workers, and never less:
+    double totalWorkMs = 0.0;
+    for (const StartupPhaseTiming& timing : timings)
+      totalWorkMs += timing.durationMs;
+    DX12_EXPECT(graph.GetTotalTime() > 0.0);
+    if (numWorkers > 0)
+      DX12_EXPECT(graph.GetTotalTime() < totalWorkMs);
+
+    // Each task on the path is the dependency of the next, and it ends with the last to finish:
+    const std::vector<StartupTaskId> criticalPath = graph.GetCriticalPath();
+    DX12_EXPECT(!criticalPath.empty());
+    if (!criticalPath.empty())
+    {
+      StartupTaskId lastFinished = 0;
+      for (StartupTaskId id = 0; id < timings.size(); ++id)
+      {
+        if (timings[id].startMs + timings[id].durationMs >
+          timings[lastFinished].startMs + timings[lastFinished].durationMs)
+          lastFinished = id;
+      }
+      DX12_EXPECT_EQ(criticalPath.back(), lastFinished);
+      if (numWorkers > 0)
+        DX12_EXPECT_EQ(criticalPath.front(), adapter);
+    }
+
+    DX12_EXPECT(graph.FormatReport().find("Swap chain") != std::string::npos);
+  }
+}
+
+DX12_TEST(StartupGraph_FailureSkipsDependentTasks)
+{
+  for (uint32_t numWorkers : c_workerCounts)
+  {
+    JobSystem jobSystem(numWorkers);
+    StartupGraph graph(jobSystem);
+
+    std::atomic<bool> ranOther(false);
+    std::atomic<bool> ranDependent(false);
+    const StartupTaskId fails = graph.Add("Fails", []() { throw std::runtime_error("Device creation failed"); });
+    const StartupTaskId other = graph.Add("Other", [&]() { ranOther = true; });
+    const StartupTaskId dependent = graph.Add("Dependent", [&]() { ranDependent = true; }, { fails, other });
+    const StartupTaskId transitive = graph.Add("Transitive", [&]() { ranDependent = true; }, { dependent },
+      JobAffinity::MainThread);
+
+    // The task's own exception comes out of Run(), once everything else has finished:
+    std::string message;
+    try
+    {
+      graph.Run();
+    }
+    catch (const std::runtime_error& error)
+    {
+      message = error.what();
+    }
+
+    DX12_EXPECT_EQ(message, std::string("Device creation failed"));
+    DX12_EXPECT(ranOther);
+    DX12_EXPECT(!ranDependent);
+
+    const std::vector<StartupPhaseTiming> timings = graph.GetTimings();
+    DX12_EXPECT(timings[fails].wasRun);
+    DX12_EXPECT(timings[other].wasRun);
+    DX12_EXPECT(!timings[dependent].wasRun);
+    DX12_EXPECT(!timings[transitive].wasRun);
+  }
+}
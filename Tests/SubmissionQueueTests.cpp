@@ -0,0 +1,100 @@
+#include "Test.h"
+#include "SubmissionQueue.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+// SubmissionQueue handing items over in key order: pushed out of order on one thread, then by producers
+// racing each other through a ring much smaller than the number of keys, which makes them wait on the
+// consumer and on each other's slots all the time.
+
+DX12_TEST(SubmissionQueue_PopsInKeyOrder)
+{
+  SubmissionQueue<uint32_t, 4> queue;
+  uint32_t items[8];
+  DX12_EXPECT(queue.IsDrained());
+  for (uint32_t i = 0; i < 4; ++i)
+    DX12_EXPECT_EQ(queue.ReserveKey(), i);
+  DX12_EXPECT(!queue.IsDrained());
+
+  // Nothing until key 0 is in, however many after it are:
+  DX12_EXPECT(queue.TryPush(2, 20));
+  DX12_EXPECT(queue.TryPush(1, 10));
+  DX12_EXPECT_EQ(queue.TryPop(items, 8), 0u);
+
+  DX12_EXPECT(queue.TryPush(0, 0));
+  DX12_EXPECT_EQ(queue.TryPop(items, 2), 2u);
+  DX12_EXPECT(items[0] == 0 && items[1] == 10);
+  DX12_EXPECT_EQ(queue.TryPop(items, 8), 1u);
+  DX12_EXPECT_EQ(items[0], 20u);
+  DX12_EXPECT_EQ(queue.GetNextPopKey(), 3u);
+
+  // A whole ring ahead of the consumer doesn't fit until it catches up:
+  DX12_EXPECT(queue.TryPush(4, 40));
+  DX12_EXPECT(queue.TryPush(5, 50));
+  DX12_EXPECT(!queue.TryPush(7, 70));
+  DX12_EXPECT(queue.TryPush(3, 30));
+  DX12_EXPECT_EQ(queue.TryPop(items, 8), 3u);
+  DX12_EXPECT(items[0] == 30 && items[1] == 40 && items[2] == 50);
+  DX12_EXPECT(queue.TryPush(7, 70));
+  DX12_EXPECT(queue.TryPush(6, 60));
+  DX12_EXPECT_EQ(queue.TryPop(items, 8), 2u);
+  DX12_EXPECT_EQ(queue.GetNextPopKey(), 8u);
+}
+
+DX12_TEST(SubmissionQueue_StressDrainsEveryKeyOnceInOrder)
+{
+  // Producer i pushes keys i, i + 4, i + 8... with random pauses, as recording threads finish their
+  // lists at different times:
+  const uint32_t numProducers = 4;
+  const uint64_t numKeys = 200000;
+  SubmissionQueue<uint64_t, 4> queue;
+
+  std::vector<std::thread> producers;
+  for (uint32_t i = 0; i < numProducers; ++i)
+  {
+    producers.emplace_back([&queue, i]() {
+      std::mt19937 random(i);
+      for (uint64_t key = i; key < numKeys; key += numProducers)
+      {
+        if (random() % 16 == 0)
+          std::this_thread::yield();
+        queue.Push(key, key * 3);
+      }
+      });
+  }
+
+  std::vector<uint8_t> numPopped(numKeys, 0);
+  uint64_t numMisordered = 0;
+  uint64_t numPops = 0;
+  uint64_t items[16];
+  while (queue.GetNextPopKey() < numKeys)
+  {
+    const uint64_t firstKey = queue.GetNextPopKey();
+    const uint32_t numItems = queue.TryPop(items, 16);
+    for (uint32_t i = 0; i < numItems; ++i)
+    {
+      // Items carry their key, so each is checked against the key it was popped as:
+      numMisordered += items[i] != (firstKey + i) * 3;
+      if (items[i] % 3 == 0 && items[i] / 3 < numKeys)
+        ++numPopped[items[i] / 3];
+    }
+
+    numPops += numItems > 0;
+    if (numItems == 0)
+      std::this_thread::yield();
+  }
+
+  for (std::thread& producer : producers)
+    producer.join();
+
+  uint64_t numNotOnce = 0;
+  for (uint8_t count : numPopped)
+    numNotOnce += count != 1;
+  DX12_EXPECT_EQ(numMisordered, 0u);
+  DX12_EXPECT_EQ(numNotOnce, 0u);
+  DX12_EXPECT_EQ(queue.GetNextPopKey(), numKeys);
+  DX12_EXPECT_EQ(queue.TryPop(items, 16), 0u);
+  DX12_EXPECT(numPops > 0);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal test harness, the counterpart of the benchmarks' for the renderer's platform-independent code.
+// Tests are declared with DX12_TEST and receive a context that DX12_EXPECT/DX12_EXPECT_EQ report failed
+// expectations to; a test keeps running after one fails, so a run reports every failure at once.
+class TestContext
+{
+public:
+	TestContext()
+		: m_numChecks(0)
+	{
+	}
+
+	void Check(bool isTrue, const char* expression, const char* file, int line)
+	{
+		++m_numChecks;
+		if (!isTrue)
+			Fail(std::string(expression), file, line);
+	}
+
+	template<typename A, typename B>
+	void CheckEqual(const A& actual, const B& expected, const char* expression, const char* file, int line)
+	{
+		++m_numChecks;
+		if (actual == expected)
+			return;
+
+		std::ostringstream message;
+		message << expression << " (got " << actual << ", expected " << expected << ")";
+		Fail(message.str(), file, line);
+	}
+
+	uint32_t NumChecks() const { return m_numChecks; }
+	const std::vector<std::string>& Failures() const { return m_failures; }
+
+private:
+	void Fail(const std::string& message, const char* file, int line)
+	{
+		std::ostringstream failure;
+		failure << file << "(" << line << "): " << message;
+		m_failures.push_back(failure.str());
+	}
+
+	uint32_t									m_numChecks;
+	std::vector<std::string>	m_failures;
+};
+
+using TestFunc = void(*)(TestContext&);
+
+struct TestInfo
+{
+	const char*	name;
+	TestFunc		func;
+};
+
+std::vector<TestInfo>& GetRegisteredTests();
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunc func)
+	{
+		GetRegisteredTests().push_back(TestInfo{ name, func });
+	}
+};
+
+#define DX12_TEST(name) \
+	static void name(TestContext& context); \
+	static TestRegistration s_##name##Registration(#name, &name); \
+	static void name(TestContext& context)
+
+#define DX12_EXPECT(condition) \
+	context.Check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+#define DX12_EXPECT_EQ(actual, expected) \
+	context.CheckEqual((actual), (expected), #actual " == " #expected, __FILE__, __LINE__)
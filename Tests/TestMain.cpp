@@ -0,0 +1,63 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+std::vector<TestInfo>& GetRegisteredTests()
+{
+  static std::vector<TestInfo> tests;
+  return tests;
+}
+
+// Usage: Dx12Tests [filter], only tests whose name contains filter are run. Returns non-zero if any test
+// failed, which is what CTest goes by.
+int main(int argc, char** argv)
+{
+  const char* filter = argc > 1 ? argv[1] : "";
+
+  std::vector<TestInfo> tests = GetRegisteredTests();
+  std::sort(tests.begin(), tests.end(), [](const TestInfo& a, const TestInfo& b) {
+    return std::strcmp(a.name, b.name) < 0;
+    });
+
+  uint32_t numRun = 0;
+  uint32_t numFailed = 0;
+  for (const TestInfo& test : tests)
+  {
+    if (!std::strstr(test.name, filter))
+      continue;
+
+    // An exception fails the test rather than ending the run:
+    TestContext context;
+    std::string exceptionMessage;
+    try
+    {
+      test.func(context);
+    }
+    catch (const std::exception& exception)
+    {
+      exceptionMessage = exception.what();
+    }
+    catch (...)
+    {
+      exceptionMessage = "unknown exception";
+    }
+
+    ++numRun;
+    const bool hasFailed = !context.Failures().empty() || !exceptionMessage.empty();
+    std::printf("%-56s %s (%u checks)\n", test.name, hasFailed ? "FAILED" : "passed", context.NumChecks());
+
+    for (const std::string& failure : context.Failures())
+      std::printf("  %s\n", failure.c_str());
+    if (!exceptionMessage.empty())
+      std::printf("  threw: %s\n", exceptionMessage.c_str());
+
+    if (hasFailed)
+      ++numFailed;
+  }
+
+  std::printf("%u of %u tests passed\n", numRun - numFailed, numRun);
+  return numFailed == 0 ? 0 : 1;
+}
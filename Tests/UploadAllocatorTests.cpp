@@ -0,0 +1,34 @@
+#include "Test.h"
+#include "UploadAllocator.h"
+
+// UploadAllocator's aligned linear allocation, running out, and reset to a new size.
+
+namespace
+{
+  // A copy, as the expectations take their arguments by reference and the class constant isn't defined:
+  const uint64_t c_invalidOffset = UploadAllocator::c_invalidOffset;
+}
+
+DX12_TEST(UploadAllocator_AlignsAndRunsOut)
+{
+  UploadAllocator allocator(1024);
+  DX12_EXPECT_EQ(allocator.Allocate(10, 16), 0u);
+  DX12_EXPECT_EQ(allocator.Allocate(10, 256), 256u);
+  DX12_EXPECT_EQ(allocator.Allocate(4, 4), 268u);
+  DX12_EXPECT_EQ(allocator.UsedSize(), 272u);
+
+  // Exactly what's left fits, a byte more doesn't and changes nothing:
+  DX12_EXPECT_EQ(allocator.Allocate(1024 - 512 + 1, 512), c_invalidOffset);
+  DX12_EXPECT_EQ(allocator.UsedSize(), 272u);
+  DX12_EXPECT_EQ(allocator.Allocate(1024 - 512, 512), 512u);
+  DX12_EXPECT_EQ(allocator.Allocate(1, 1), c_invalidOffset);
+
+  allocator.Reset(2048);
+  DX12_EXPECT_EQ(allocator.Size(), 2048u);
+  DX12_EXPECT_EQ(allocator.UsedSize(), 0u);
+  DX12_EXPECT_EQ(allocator.Allocate(2048, 16), 0u);
+
+  // Without a buffer yet, nothing fits:
+  UploadAllocator empty;
+  DX12_EXPECT_EQ(empty.Allocate(1, 1), c_invalidOffset);
+}